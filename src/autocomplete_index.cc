@@ -0,0 +1,284 @@
+// Copyright 2014 Toggl Desktop developers.
+
+#include "../src/autocomplete_index.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "Poco/UTF8String.h"
+
+namespace toggl {
+
+// Match scores, best first
+enum {
+    kScoreNone = 0,
+    kScoreFuzzy = 1,
+    kScoreSubstring = 2,
+    kScoreWord = 3,
+    kScorePrefix = 4
+};
+
+// Orders words by the rest of the text from where they start
+class AutocompleteIndex::WordLess {
+ public:
+    explicit WordLess(const std::vector<std::string> &texts)
+        : texts_(texts) {}
+
+    bool operator()(const Word &a, const Word &b) const {
+        return texts_[a.Item].compare(
+            a.Offset, std::string::npos,
+            texts_[b.Item], b.Offset, std::string::npos) < 0;
+    }
+
+ private:
+    const std::vector<std::string> &texts_;
+};
+
+// Compares only as many characters of a word as the query has
+class AutocompleteIndex::PrefixLess {
+ public:
+    explicit PrefixLess(const std::vector<std::string> &texts)
+        : texts_(texts) {}
+
+    bool operator()(const Word &a, const std::string &query) const {
+        return texts_[a.Item].compare(a.Offset, query.size(), query) < 0;
+    }
+    bool operator()(const std::string &query, const Word &b) const {
+        return texts_[b.Item].compare(b.Offset, query.size(), query) > 0;
+    }
+
+ private:
+    const std::vector<std::string> &texts_;
+};
+
+static bool isWordCharacter(const char c) {
+    // Bytes of multibyte UTF-8 characters count as letters
+    return (c & 0x80) || isalnum(static_cast<unsigned char>(c));
+}
+
+// Offsets of the words in a lowercased text
+static void wordOffsets(
+    const std::string &text,
+    std::vector<Poco::UInt32> *result) {
+    for (Poco::UInt32 offset = 0; offset < text.size(); offset++) {
+        if (!isWordCharacter(text[offset])) {
+            continue;
+        }
+        if (offset && isWordCharacter(text[offset - 1])) {
+            continue;
+        }
+        result->push_back(offset);
+    }
+}
+
+void AutocompleteIndex::Build(const std::vector<view::Autocomplete> &items) {
+    items_ = items;
+    texts_.clear();
+    free_.clear();
+    order_.clear();
+    words_.clear();
+
+    texts_.reserve(items_.size());
+    order_.reserve(items_.size());
+    std::vector<Poco::UInt32> offsets;
+    for (Poco::UInt32 i = 0; i < items_.size(); i++) {
+        texts_.push_back(Poco::UTF8::toLower(items_[i].Text));
+        order_.push_back(i);
+        offsets.clear();
+        wordOffsets(texts_.back(), &offsets);
+        for (size_t j = 0; j < offsets.size(); j++) {
+            Word word;
+            word.Item = i;
+            word.Offset = offsets[j];
+            words_.push_back(word);
+        }
+    }
+    std::sort(words_.begin(), words_.end(), WordLess(texts_));
+    ranked_ = false;
+}
+
+Poco::UInt32 AutocompleteIndex::Insert(
+    const view::Autocomplete &item,
+    Less less) {
+    Poco::UInt32 id(0);
+    if (free_.empty()) {
+        id = static_cast<Poco::UInt32>(items_.size());
+        items_.push_back(item);
+        texts_.push_back(Poco::UTF8::toLower(item.Text));
+    } else {
+        id = free_.back();
+        free_.pop_back();
+        items_[id] = item;
+        texts_[id] = Poco::UTF8::toLower(item.Text);
+    }
+    addWords(id);
+
+    // Binary search over the ranked IDs
+    size_t first = 0;
+    size_t count = order_.size();
+    while (count) {
+        size_t step = count / 2;
+        if (!less(item, items_[order_[first + step]])) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    order_.insert(order_.begin() + first, id);
+    ranked_ = false;
+
+    return id;
+}
+
+void AutocompleteIndex::Remove(const Poco::UInt32 id) {
+    poco_assert(id < items_.size());
+
+    removeWords(id);
+    order_.erase(std::find(order_.begin(), order_.end(), id));
+    items_[id] = view::Autocomplete();
+    texts_[id].clear();
+    free_.push_back(id);
+    ranked_ = false;
+}
+
+void AutocompleteIndex::Items(
+    std::vector<view::Autocomplete> *result) const {
+    result->reserve(result->size() + order_.size());
+    for (size_t i = 0; i < order_.size(); i++) {
+        result->push_back(items_[order_[i]]);
+    }
+}
+
+void AutocompleteIndex::addWords(const Poco::UInt32 id) {
+    std::vector<Poco::UInt32> offsets;
+    wordOffsets(texts_[id], &offsets);
+    for (size_t i = 0; i < offsets.size(); i++) {
+        Word word;
+        word.Item = id;
+        word.Offset = offsets[i];
+        words_.insert(
+            std::upper_bound(words_.begin(), words_.end(),
+                             word, WordLess(texts_)),
+            word);
+    }
+}
+
+void AutocompleteIndex::removeWords(const Poco::UInt32 id) {
+    std::vector<Poco::UInt32> offsets;
+    wordOffsets(texts_[id], &offsets);
+    for (size_t i = 0; i < offsets.size(); i++) {
+        Word word;
+        word.Item = id;
+        word.Offset = offsets[i];
+        // Other items may have words with the same rest of text
+        std::pair<std::vector<Word>::iterator,
+            std::vector<Word>::iterator> range =
+                std::equal_range(words_.begin(), words_.end(),
+                                 word, WordLess(texts_));
+        for (std::vector<Word>::iterator it = range.first;
+                it != range.second; it++) {
+            if (it->Item == id && it->Offset == word.Offset) {
+                words_.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+void AutocompleteIndex::rank() const {
+    if (ranked_) {
+        return;
+    }
+    ranks_.resize(items_.size());
+    for (Poco::UInt32 i = 0; i < order_.size(); i++) {
+        ranks_[order_[i]] = i;
+    }
+    ranked_ = true;
+}
+
+Poco::UInt32 AutocompleteIndex::fuzzyScore(
+    const Poco::UInt32 item,
+    const std::string &query) const {
+    const std::string &text = texts_[item];
+    if (text.find(query) != std::string::npos) {
+        return kScoreSubstring;
+    }
+    // All query characters, in order, but not next to each other
+    size_t pos = 0;
+    for (size_t i = 0; i < query.size(); i++) {
+        pos = text.find(query[i], pos);
+        if (std::string::npos == pos) {
+            return kScoreNone;
+        }
+        pos++;
+    }
+    return kScoreFuzzy;
+}
+
+void AutocompleteIndex::Query(
+    const std::string &text,
+    const size_t limit,
+    std::vector<view::Autocomplete> *result) const {
+    result->clear();
+
+    std::string query = Poco::UTF8::toLower(text);
+    if (query.empty()) {
+        for (size_t i = 0; i < order_.size() && i < limit; i++) {
+            result->push_back(items_[order_[i]]);
+        }
+        return;
+    }
+
+    rank();
+
+    // Scores by item ID, matches by rank
+    std::vector<unsigned char> scores(items_.size(), kScoreNone);
+    std::vector<std::pair<Poco::UInt32, Poco::UInt32> > matches;
+
+    // Prefix and word matches from the sorted words
+    std::pair<std::vector<Word>::const_iterator,
+        std::vector<Word>::const_iterator> range =
+            std::equal_range(words_.begin(), words_.end(),
+                             query, PrefixLess(texts_));
+    for (std::vector<Word>::const_iterator it = range.first;
+            it != range.second; it++) {
+        if (!scores[it->Item]) {
+            matches.push_back(std::make_pair(0, it->Item));
+        }
+        if (!it->Offset) {
+            scores[it->Item] = kScorePrefix;
+        } else if (!scores[it->Item]) {
+            scores[it->Item] = kScoreWord;
+        }
+    }
+    for (size_t i = 0; i < matches.size(); i++) {
+        Poco::UInt32 id = matches[i].second;
+        matches[i].first = kScorePrefix - scores[id];
+        matches[i].second = ranks_[id];
+    }
+
+    // Not enough of those, look further
+    if (matches.size() < limit) {
+        for (Poco::UInt32 i = 0; i < order_.size(); i++) {
+            Poco::UInt32 id = order_[i];
+            if (scores[id]) {
+                continue;
+            }
+            Poco::UInt32 score = fuzzyScore(id, query);
+            if (score) {
+                matches.push_back(std::make_pair(kScorePrefix - score, i));
+            }
+        }
+    }
+
+    // Best score first, then in the order the items are ranked
+    size_t count = std::min(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + count,
+                      matches.end());
+    for (size_t i = 0; i < count; i++) {
+        result->push_back(items_[order_[matches[i].second]]);
+    }
+}
+
+}  // namespace toggl
@@ -0,0 +1,95 @@
+// Copyright 2014 Toggl Desktop developers.
+
+#ifndef SRC_AUTOCOMPLETE_INDEX_H_
+#define SRC_AUTOCOMPLETE_INDEX_H_
+
+#include <string>
+#include <vector>
+
+#include "./gui.h"
+
+namespace toggl {
+
+// Ranks autocomplete items by how well they match typed text.
+// Item texts are lowercased and split into words once, when the
+// item is added. Words are kept sorted, so that prefix and word
+// matches are found with a binary search. Items are scanned for
+// substring and fuzzy matches only if there are not enough of those.
+class AutocompleteIndex {
+ public:
+    AutocompleteIndex()
+        : ranked_(true) {}
+    ~AutocompleteIndex() {}
+
+    typedef bool (*Less)(
+        const view::Autocomplete &a,
+        const view::Autocomplete &b);
+
+    // Items with equal scores are ranked in this order.
+    // The ID of an item is its position in items.
+    void Build(const std::vector<view::Autocomplete> &items);
+
+    // Adds an item after the ones that are not greater by less,
+    // which must be the order the index was built in.
+    // Returns the ID of the item.
+    Poco::UInt32 Insert(const view::Autocomplete &item, Less less);
+
+    void Remove(const Poco::UInt32 id);
+
+    size_t Size() const {
+        return order_.size();
+    }
+
+    // Appends the items to result, in the order they are ranked
+    void Items(std::vector<view::Autocomplete> *result) const;
+
+    // Best matches first, at most limit items
+    void Query(
+        const std::string &text,
+        const size_t limit,
+        std::vector<view::Autocomplete> *result) const;
+
+    // Ranks the items now instead of on the next query, after which
+    // an index that is not changed can be queried from any thread
+    void Rank() const {
+        rank();
+    }
+
+ private:
+    // Where a word starts in the lowercased text of an item
+    struct Word {
+        Poco::UInt32 Item;
+        Poco::UInt32 Offset;
+    };
+
+    class WordLess;
+    class PrefixLess;
+
+    void addWords(const Poco::UInt32 id);
+    void removeWords(const Poco::UInt32 id);
+
+    Poco::UInt32 fuzzyScore(
+        const Poco::UInt32 item,
+        const std::string &query) const;
+
+    // Updates ranks, after items were added or removed
+    void rank() const;
+
+    // By ID, removed items leave an empty slot that is reused
+    std::vector<view::Autocomplete> items_;
+    std::vector<std::string> texts_;
+    std::vector<Poco::UInt32> free_;
+
+    // IDs in ranked order
+    std::vector<Poco::UInt32> order_;
+
+    std::vector<Word> words_;
+
+    // Position of each ID in order_
+    mutable bool ranked_;
+    mutable std::vector<Poco::UInt32> ranks_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_AUTOCOMPLETE_INDEX_H_
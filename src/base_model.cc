@@ -8,6 +8,7 @@
 #include "./database.h"
 #include "./formatter.h"
 #include "./model_change.h"
+#include "./related_data.h"
 
 #include "Poco/Timestamp.h"
 #include "Poco/DateTime.h"
@@ -16,6 +17,44 @@
 
 namespace toggl {
 
+BaseModel::BaseModel(const BaseModel &other)
+    : local_id_(other.local_id_)
+, id_(other.id_)
+, guid_(other.guid_)
+, ui_modified_at_(other.ui_modified_at_)
+, uid_(other.uid_)
+, dirty_(other.dirty_)
+, deleted_at_(other.deleted_at_)
+, is_marked_as_deleted_on_server_(other.is_marked_as_deleted_on_server_)
+, updated_at_(other.updated_at_)
+, validation_error_(other.validation_error_)
+, unsynced_(other.unsynced_)
+, index_(nullptr) {}
+
+BaseModel &BaseModel::operator=(const BaseModel &other) {
+    if (this == &other) {
+        return *this;
+    }
+    SetID(other.id_);
+    SetGUID(other.guid_);
+    local_id_ = other.local_id_;
+    ui_modified_at_ = other.ui_modified_at_;
+    uid_ = other.uid_;
+    dirty_ = other.dirty_;
+    deleted_at_ = other.deleted_at_;
+    is_marked_as_deleted_on_server_ = other.is_marked_as_deleted_on_server_;
+    updated_at_ = other.updated_at_;
+    validation_error_ = other.validation_error_;
+    unsynced_ = other.unsynced_;
+    return *this;
+}
+
+BaseModel::~BaseModel() {
+    if (index_) {
+        index_->Remove(this);
+    }
+}
+
 bool BaseModel::NeedsPush() const {
     // Note that if a model has a validation error previously
     // received and attached from the backend, the model won't be
@@ -79,7 +118,11 @@ void BaseModel::SetUpdatedAt(const Poco::UInt64 value) {
 
 void BaseModel::SetGUID(const std::string value) {
     if (guid_ != value) {
+        guid old_guid = guid_;
         guid_ = value;
+        if (index_) {
+            index_->GUIDChanged(this, old_guid);
+        }
         SetDirty();
     }
 }
@@ -100,7 +143,11 @@ void BaseModel::SetUID(const Poco::UInt64 value) {
 
 void BaseModel::SetID(const Poco::UInt64 value) {
     if (id_ != value) {
+        Poco::UInt64 old_id = id_;
         id_ = value;
+        if (index_) {
+            index_->IDChanged(this, old_id);
+        }
         SetDirty();
     }
 }
@@ -203,10 +250,27 @@ Poco::Logger &BaseModel::logger() const {
 
 void BaseModel::SetDirty() {
     dirty_ = true;
+    if (index_) {
+        index_->MarkChanged(this);
+    }
 }
 
 void BaseModel::SetUnsynced() {
-    unsynced_ = true;
+    if (!unsynced_) {
+        unsynced_ = true;
+        if (index_) {
+            index_->Touch();
+        }
+    }
+}
+
+void BaseModel::ClearUnsynced() {
+    if (unsynced_) {
+        unsynced_ = false;
+        if (index_) {
+            index_->Touch();
+        }
+    }
 }
 
 }   // namespace toggl
@@ -22,6 +22,7 @@ class Logger;
 namespace toggl {
 
 class BatchUpdateResult;
+class ModelIndex;
 
 class BaseModel {
  public:
@@ -36,9 +37,15 @@ class BaseModel {
     , is_marked_as_deleted_on_server_(false)
     , updated_at_(0)
     , validation_error_("")
-    , unsynced_(false) {}
+    , unsynced_(false)
+    , index_(nullptr) {}
 
-    virtual ~BaseModel() {}
+    // Copies are not part of any collection,
+    // so the lookup index is not copied along.
+    BaseModel(const BaseModel &other);
+    BaseModel &operator=(const BaseModel &other);
+
+    virtual ~BaseModel();
 
     const Poco::Int64 &LocalID() const {
         return local_id_;
@@ -82,9 +89,7 @@ class BaseModel {
         return unsynced_;
     }
     void SetUnsynced();
-    void ClearUnsynced() {
-        unsynced_ = false;
-    }
+    void ClearUnsynced();
 
     // Deleting a time entry hides it from
     // UI and flags it for removal from server:
@@ -131,7 +136,7 @@ class BaseModel {
     virtual std::string ModelName() const = 0;
     virtual std::string ModelURL() const = 0;
 
-    virtual void LoadFromJSON(Json::Value value) {}
+    virtual void LoadFromJSON(const Json::Value &value) {}
     virtual Json::Value SaveToJSON() const {
         return 0;
     }
@@ -155,6 +160,16 @@ class BaseModel {
     // Convert model JSON into batch update format.
     error BatchUpdateJSON(Json::Value *result) const;
 
+    // Lookup index of the collection that holds the model.
+    // The index is notified when ID or GUID of the model changes
+    // and when the model becomes dirty.
+    ModelIndex *Index() const {
+        return index_;
+    }
+    void SetIndex(ModelIndex *value) {
+        index_ = value;
+    }
+
  protected:
     Poco::Logger &logger() const;
 
@@ -184,6 +199,8 @@ class BaseModel {
     // pushed to backend. It only means that some
     // attempt to push failed somewhere.
     bool unsynced_;
+
+    ModelIndex *index_;
 };
 
 }  // namespace toggl
@@ -41,7 +41,7 @@ void Client::SetWID(const Poco::UInt64 value) {
     }
 }
 
-void Client::LoadFromJSON(Json::Value data) {
+void Client::LoadFromJSON(const Json::Value &data) {
     std::string guid = data["guid"].asString();
     if (!guid.empty()) {
         SetGUID(guid);
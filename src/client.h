@@ -36,7 +36,7 @@ class Client : public BaseModel {
     std::string String() const;
     std::string ModelName() const;
     std::string ModelURL() const;
-    void LoadFromJSON(Json::Value value);
+    void LoadFromJSON(const Json::Value &value);
     Json::Value SaveToJSON() const;
     bool ResolveError(const toggl::error);
     bool ResourceCannotBeCreated(const toggl::error) const;
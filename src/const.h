@@ -4,15 +4,33 @@
 #define SRC_CONST_H_
 
 #define kOneSecondInMicros 1000000
+#define kFormatBufferSize 64
 
 #define kMaxTimeEntryDurationSeconds 3600000
 #define kHTTPClientTimeoutSeconds 30
+#define kHTTPSessionIdleSeconds 30
 #define kSyncIntervalRangeSeconds 900
 #define kWebsocketRestartRangeSeconds 45
+#define kWebsocketMinFrameBytes (64 * 1024)
+#define kWebsocketMaxFrameBytes (16 * 1024 * 1024)
+#define kWebsocketUpdateBatchSize 100
+#define kWebsocketUpdateBatchMillis 100
+#define kStartupTimeEntryDays 14
+#define kSaveCoalesceMillis 50
+#define kStaleRenderRetryMillis 100
+#define kUIUpdateIntervalSeconds 10
+#define kReminderIntervalSeconds 1
+#define kDatabaseMaintenanceIntervalSeconds 3600
+#define kDatabaseMaintenanceRetrySeconds 60
+#define kDatabaseMaintenanceIdleSeconds 60
+#define kDatabaseMaintenanceBudgetMillis 250
+#define kDatabasePurgeChunkRows 500
+#define kDatabaseVacuumChunkPages 256
 #define kCheckUpdateIntervalSeconds 86400
 #define kRequestThrottleSeconds 2
 #define kTimerStartInterval 10
 #define kTimelineSecondsToKeep 604800
+#define kTimeEntrySecondsToKeep (30 * 86400)
 #define kWindowFocusThresholdSeconds 10
 #define kAutotrackerThresholdSeconds 10
 #define kBetaChannelPercentage 25
@@ -21,6 +39,9 @@
 #define kDebianPackage false
 #define kTimelineUploadIntervalSeconds 60
 #define kTimelineUploadMaxBackoffSeconds (kTimelineUploadIntervalSeconds * 10)  // NOLINT
+#define kTimelineBufferSize 50
+#define kTimelineBufferFlushSeconds 30
+#define kTimelineUploadPageSize 1000
 
 #define kLostPasswordURL "https://toggl.com/forgot-password?desktop=true"
 #define kMacSupportURL "https://support.toggl.com/toggl-desktop-for-mac-osx/"
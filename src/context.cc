@@ -12,6 +12,7 @@
 #include "../src/context.h"
 
 #include <iostream>  // NOLINT
+#include <set>
 
 #include "./autotracker.h"
 #include "./client.h"
@@ -61,25 +62,36 @@ namespace toggl {
 
 std::string Context::log_path_ = "";
 
+// Kinds of jobs in scheduler_
+const std::string kJobPushChanges = "push changes";
+const std::string kJobSync = "sync";
+const std::string kJobFetchUpdates = "fetch updates";
+const std::string kJobLoadMore = "load more";
+const std::string kJobTimelineSettings = "timeline settings";
+const std::string kJobWake = "wake";
+const std::string kJobUIUpdate = "ui update";
+const std::string kJobReminders = "reminders";
+
 Context::Context(const std::string app_name, const std::string app_version)
     : db_(nullptr)
 , user_(nullptr)
+, stale_render_scheduled_(false)
 , timeline_uploader_(nullptr)
 , window_change_recorder_(nullptr)
-, next_sync_at_(0)
-, next_push_changes_at_(0)
-, next_fetch_updates_at_(0)
-, next_update_timeline_settings_at_(0)
-, next_wake_at_(0)
+, scheduler_(&timer_, &timer_m_)
 , time_entry_editor_guid_("")
 , environment_("production")
 , idle_(&ui_)
+, idle_seconds_(0)
 , last_sync_started_(0)
 , sync_interval_seconds_(0)
 , update_check_disabled_(false)
 , quit_(false)
-, ui_updater_(this, &Context::uiUpdaterActivity)
-, reminder_(this, &Context::reminderActivity)
+, ui_running_time_("")
+, persister_(this, &Context::persisterActivity)
+, saves_written_(0)
+, pending_save_(false)
+, pending_save_push_changes_(false)
 , update_path_("") {
     if (!Poco::URIStreamOpener::defaultOpener().supportsScheme("http")) {
         Poco::Net::HTTPStreamFactory::registerFactory();
@@ -99,16 +111,43 @@ Context::Context(const std::string app_name, const std::string app_version)
 
     Poco::Crypto::OpenSSLInitializer::initialize();
 
+    scheduler_.Register(kJobPushChanges,
+                        new Poco::Util::TimerTaskAdapter<Context>(
+                            *this, &Context::onPushChanges));
+    scheduler_.Register(kJobSync,
+                        new Poco::Util::TimerTaskAdapter<Context>(
+                            *this, &Context::onSync));
+    scheduler_.Register(kJobFetchUpdates,
+                        new Poco::Util::TimerTaskAdapter<Context>(
+                            *this, &Context::onFetchUpdates));
+    scheduler_.Register(kJobLoadMore,
+                        new Poco::Util::TimerTaskAdapter<Context>(
+                            *this, &Context::onLoadMore));
+    scheduler_.Register(kJobTimelineSettings,
+                        new Poco::Util::TimerTaskAdapter<Context>(
+                            *this, &Context::onTimelineUpdateServerSettings));
+    scheduler_.Register(kJobWake,
+                        new Poco::Util::TimerTaskAdapter<Context>(
+                            *this, &Context::onWake));
+    scheduler_.Register(kJobUIUpdate,
+                        new Poco::Util::TimerTaskAdapter<Context>(
+                            *this, &Context::onUIUpdate));
+    scheduler_.Register(kJobReminders,
+                        new Poco::Util::TimerTaskAdapter<Context>(
+                            *this, &Context::onReminders));
+
     startPeriodicUpdateCheck();
 
     startPeriodicSync();
 
-    if (!ui_updater_.isRunning()) {
-        ui_updater_.start();
-    }
+    scheduleDatabaseMaintenance(kDatabaseMaintenanceRetrySeconds);
+
+    startPeriodicUIUpdate();
+
+    startPeriodicReminders();
 
-    if (!reminder_.isRunning()) {
-        reminder_.start();
+    if (!persister_.isRunning()) {
+        persister_.start();
     }
 
     last_tracking_reminder_time_ = time(0);
@@ -120,6 +159,11 @@ Context::~Context() {
 
     stopActivities();
 
+    error err = flush();
+    if (err != noError) {
+        logger().error(err);
+    }
+
     {
         Poco::Mutex::ScopedLock lock(window_change_recorder_m_);
         if (window_change_recorder_) {
@@ -136,6 +180,16 @@ Context::~Context() {
         }
     }
 
+    {
+        Poco::Mutex::ScopedLock lock(user_m_);
+        if (user_ && db_) {
+            error err = db_->SaveTimelineEvents(user_);
+            if (err != noError) {
+                logger().error(err);
+            }
+        }
+    }
+
     {
         Poco::Mutex::ScopedLock lock(db_m_);
         if (db_) {
@@ -145,6 +199,7 @@ Context::~Context() {
     }
 
     {
+        Poco::Mutex::ScopedLock flush_lock(flush_m_);
         Poco::Mutex::ScopedLock lock(user_m_);
         if (user_) {
             delete user_;
@@ -152,23 +207,18 @@ Context::~Context() {
         }
     }
 
+    HTTPSClient::Sessions.Clear();
+
     Poco::Net::uninitializeSSL();
 }
 
 void Context::stopActivities() {
     {
-        Poco::Mutex::ScopedLock lock(reminder_m_);
-        if (reminder_.isRunning()) {
-            reminder_.stop();
-            reminder_.wait();
-        }
-    }
-
-    {
-        Poco::Mutex::ScopedLock lock(ui_updater_m_);
-        if (ui_updater_.isRunning()) {
-            ui_updater_.stop();
-            ui_updater_.wait();
+        Poco::Mutex::ScopedLock lock(persister_m_);
+        if (persister_.isRunning()) {
+            persister_.stop();
+            save_requested_.set();
+            persister_.wait();
         }
     }
 
@@ -197,7 +247,14 @@ void Context::stopActivities() {
 void Context::Shutdown() {
     stopActivities();
 
+    // Write what the persister did not get to
+    displayError(flush());
+
+    // Nothing is recorded any more, save what was
+    saveTimelineEvents();
+
     // cancel tasks but allow them finish
+    scheduler_.Cancel();
     {
         Poco::Mutex::ScopedLock lock(timer_m_);
         timer_.cancel(true);
@@ -235,9 +292,12 @@ error Context::StartEvents() {
         render.display_settings = true;
         updateUI(render);
 
-        // See if user was logged in into app previously
+        // See if user was logged in into app previously.
+        // Only recent data is loaded before the first render,
+        // the rest is loaded in the background.
         User *user = new User();
-        err = db()->LoadCurrentUser(user);
+        err = db()->LoadCurrentUser(
+            user, time(0) - kStartupTimeEntryDays * 86400);
         if (err != noError) {
             delete user;
             setUser(nullptr);
@@ -248,6 +308,9 @@ error Context::StartEvents() {
             setUser(nullptr);
             return noError;
         }
+        // Models removed until the rest is merged must not come back
+        user->related.TrackRemoved(true);
+
         // Clear since param to force full sync on app start
         user->SetSince(0);
         logger().debug("fullSyncOnAppStart");
@@ -256,6 +319,14 @@ error Context::StartEvents() {
 
         updateUI(UIElements::Reset());
 
+        {
+            Poco::Util::TimerTask::Ptr ptask =
+                new Poco::Util::TimerTaskAdapter<Context>(
+                    *this, &Context::onLoadRemainingUserData);
+            Poco::Mutex::ScopedLock lock(timer_m_);
+            timer_.schedule(ptask, postpone(0));
+        }
+
         if ("production" == environment_) {
             std::string update_channel("");
             UpdateChannel(&update_channel);
@@ -273,36 +344,105 @@ error Context::StartEvents() {
 }
 
 error Context::save(const bool push_changes) {
-    logger().debug("save");
+    std::vector<ModelChange> changes;
+    {
+        Poco::Mutex::ScopedLock lock(user_m_);
+        if (user_) {
+            user_->related.PendingChanges(&changes);
+        }
+    }
+
+    {
+        Poco::Mutex::ScopedLock lock(pending_save_m_);
+        pending_save_ = true;
+        pending_save_push_changes_ =
+            pending_save_push_changes_ || push_changes;
+    }
+
+    // Render right away, saving is written behind
+    UIElements render;
+    render.display_unsynced_items = true;
+    render.ApplyChanges(time_entry_editor_guid_, changes);
+    updateUI(render);
+
+    if (persister_.isRunning()) {
+        save_requested_.set();
+        return noError;
+    }
+
+    // Persister is not running yet or anymore, save right away
+    return flush();
+}
+
+void Context::persisterActivity() {
+    while (true) {
+        // Stopping sets the event, too
+        save_requested_.wait();
+        if (persister_.isStopped()) {
+            return;
+        }
+
+        // Let the saves that closely follow share the commit
+        Poco::Thread::sleep(kSaveCoalesceMillis);
+
+        displayError(flush());
+    }
+}
+
+error Context::flush() {
     try {
-        std::vector<ModelChange> changes;
+        Poco::Mutex::ScopedLock flush_lock(flush_m_);
 
+        bool push_changes(false);
+        UserSnapshot snapshot;
         {
             Poco::Mutex::ScopedLock lock(user_m_);
-            error err = db()->SaveUser(user_, true, &changes);
-            if (err != noError) {
-                return err;
+            {
+                Poco::Mutex::ScopedLock l(pending_save_m_);
+                if (!pending_save_) {
+                    return noError;
+                }
+                push_changes = pending_save_push_changes_;
+                pending_save_ = false;
+                pending_save_push_changes_ = false;
             }
+            if (!user_) {
+                logger().warning("Cannot save user, user is logged out");
+                return noError;
+            }
+            user_->TakeSnapshot(&snapshot);
         }
 
-        UIElements render;
-        render.display_unsynced_items = true;
-        render.ApplyChanges(time_entry_editor_guid_, changes);
-        updateUI(render);
+        // Written without holding up the user
+        std::vector<ModelChange> changes;
+        error err = writeSnapshot(&snapshot, &changes);
+
+        // Edits were rendered when saving was requested
+        bool cascaded(false);
+        {
+            // The user is not deleted while flush_m_ is held
+            Poco::Mutex::ScopedLock lock(user_m_);
+            cascaded = user_->ApplySnapshot(
+                &snapshot, err == noError, changes);
+        }
+
+        if (err != noError) {
+            return err;
+        }
+
+        if (cascaded) {
+            // Models that referred to deleted ones were changed
+            save(false);
+        }
 
         if (push_changes) {
-            next_push_changes_at_ =
+            Poco::Timestamp at =
                 postpone(kRequestThrottleSeconds * kOneSecondInMicros);
-            Poco::Util::TimerTask::Ptr ptask =
-                new Poco::Util::TimerTaskAdapter<Context>(
-                    *this, &Context::onPushChanges);
-
-            Poco::Mutex::ScopedLock lock(timer_m_);
-            timer_.schedule(ptask, next_push_changes_at_);
+            scheduler_.Schedule(kJobPushChanges, at);
 
             std::stringstream ss;
             ss << "Next push at "
-               << Formatter::Format8601(next_push_changes_at_);
+               << Formatter::Format8601(at);
             logger().debug(ss.str());
         }
     } catch(const Poco::Exception& exc) {
@@ -315,6 +455,38 @@ error Context::save(const bool push_changes) {
     return noError;
 }
 
+error Context::writeSnapshot(
+    UserSnapshot *snapshot,
+    std::vector<ModelChange> *changes) {
+    try {
+        if (snapshot->Empty()) {
+            return noError;
+        }
+        logger().debug("save");
+        error err = db()->SaveUser(&snapshot->Copy, true, changes);
+        if (err != noError) {
+            return err;
+        }
+        saves_written_++;
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
+    }
+    return noError;
+}
+
+error Context::Flush() {
+    return displayError(flush());
+}
+
+Poco::UInt64 Context::SavesWritten() {
+    Poco::Mutex::ScopedLock lock(flush_m_);
+    return saves_written_;
+}
+
 UIElements UIElements::Reset() {
     UIElements render;
     render.display_time_entries = true;
@@ -460,39 +632,322 @@ void Context::OpenTimeEntryList() {
     updateUI(render);
 }
 
+Poco::UInt64 RenderSnapshot::PartsFor(const UIElements &what) {
+    Poco::UInt64 parts(0);
+    if (what.display_time_entries) {
+        parts |= kTimeEntries;
+    }
+    if (what.display_timer_state) {
+        parts |= kRunningEntry;
+    }
+    if (what.display_unsynced_items) {
+        parts |= kUnsyncedItems;
+    }
+    if (what.display_workspace_select) {
+        parts |= kWorkspaces;
+    }
+    if (what.display_client_select) {
+        parts |= kClients;
+    }
+    if (what.display_time_entry_autocomplete) {
+        parts |= kTimeEntryAutocomplete;
+    }
+    if (what.display_mini_timer_autocomplete) {
+        parts |= kMinitimerAutocomplete;
+    }
+    if (what.display_project_autocomplete) {
+        parts |= kProjectAutocomplete;
+    }
+    return parts;
+}
+
+bool RenderSnapshot::SameSource(const RenderSnapshot &other) const {
+    return Revision == other.Revision
+           && HasLoadedMore == other.HasLoadedMore
+           && TimeOfDayFormat == other.TimeOfDayFormat
+           && DurationFormat == other.DurationFormat
+           && Tzd == other.Tzd
+           && Day == other.Day
+           && Minute == other.Minute;
+}
+
+std::shared_ptr<const RenderSnapshot> Context::renderSnapshot(
+    const UIElements &what) {
+    Poco::UInt64 parts = RenderSnapshot::PartsFor(what);
+    if (!parts) {
+        return std::shared_ptr<const RenderSnapshot>(new RenderSnapshot());
+    }
+
+    if (!user_m_.tryLock()) {
+        // User data is being changed. Render what was published
+        // last, if it has the parts, and render again when done.
+        std::shared_ptr<const RenderSnapshot> snapshot;
+        bool schedule(false);
+        {
+            Poco::Mutex::ScopedLock lock(render_snapshot_m_);
+            if (render_snapshot_
+                    && !(parts & ~render_snapshot_->Parts)) {
+                snapshot = render_snapshot_;
+
+                UIElements &stale = stale_render_;
+                stale.display_time_entries = stale.display_time_entries
+                                             || what.display_time_entries;
+                stale.display_timer_state = stale.display_timer_state
+                                            || what.display_timer_state;
+                stale.display_unsynced_items = stale.display_unsynced_items
+                                               || what.display_unsynced_items;
+                stale.display_workspace_select =
+                    stale.display_workspace_select
+                    || what.display_workspace_select;
+                stale.display_client_select = stale.display_client_select
+                                              || what.display_client_select;
+                stale.display_time_entry_autocomplete =
+                    stale.display_time_entry_autocomplete
+                    || what.display_time_entry_autocomplete;
+                stale.display_mini_timer_autocomplete =
+                    stale.display_mini_timer_autocomplete
+                    || what.display_mini_timer_autocomplete;
+                stale.display_project_autocomplete =
+                    stale.display_project_autocomplete
+                    || what.display_project_autocomplete;
+
+                schedule = !stale_render_scheduled_;
+                stale_render_scheduled_ = true;
+            }
+        }
+        if (snapshot) {
+            if (schedule && !quit_) {
+                Poco::Util::TimerTask::Ptr ptask =
+                    new Poco::Util::TimerTaskAdapter<Context>(
+                        *this, &Context::onRenderStale);
+                Poco::Mutex::ScopedLock lock(timer_m_);
+                timer_.schedule(ptask,
+                                postpone(kStaleRenderRetryMillis * 1000));
+            }
+            return snapshot;
+        }
+
+        // Nothing to render yet, wait for the user data
+        user_m_.lock();
+    }
+
+    try {
+        refreshRenderSnapshot(parts);
+    } catch(...) {
+        user_m_.unlock();
+        throw;
+    }
+    user_m_.unlock();
+
+    Poco::Mutex::ScopedLock lock(render_snapshot_m_);
+    if (!render_snapshot_) {
+        // Logged out
+        return std::shared_ptr<const RenderSnapshot>(new RenderSnapshot());
+    }
+    return render_snapshot_;
+}
+
+void Context::refreshRenderSnapshot(const Poco::UInt64 parts) {
+    std::shared_ptr<const RenderSnapshot> current;
+    {
+        Poco::Mutex::ScopedLock lock(render_snapshot_m_);
+        current = render_snapshot_;
+    }
+
+    if (!user_) {
+        Poco::Mutex::ScopedLock lock(render_snapshot_m_);
+        render_snapshot_.reset();
+        return;
+    }
+
+    std::shared_ptr<RenderSnapshot> snapshot(new RenderSnapshot());
+    snapshot->Revision = user_->related.Revision();
+    snapshot->HasLoadedMore = user_->HasLoadedMore();
+    snapshot->TimeOfDayFormat = Formatter::TimeOfDayFormat;
+    snapshot->DurationFormat = Formatter::DurationFormat;
+    Poco::LocalDateTime now;
+    snapshot->Tzd = now.tzd();
+    snapshot->Day = now.year() * 1000 + now.dayOfYear();
+
+    // Date durations include the running entry, which grows
+    TimeEntry *running_entry = user_->RunningTimeEntry();
+    if (running_entry) {
+        snapshot->Minute = time(0) / 60;
+    }
+
+    if (current && current->SameSource(*snapshot)) {
+        if (!(parts & ~current->Parts)) {
+            return;
+        }
+        // Keep the parts that are up to date
+        *snapshot = *current;
+    }
+
+    Poco::UInt64 missing = parts & ~snapshot->Parts;
+
+    if (missing & RenderSnapshot::kProjectAutocomplete) {
+        user_->related.ProjectAutocompleteItems(
+            &snapshot->ProjectAutocompletes);
+        snapshot->AutocompleteIndexes[kAutocompleteProject] =
+            user_->related.AutocompleteIndexCopy(kAutocompleteProject);
+    }
+
+    if (missing & RenderSnapshot::kTimeEntryAutocomplete) {
+        user_->related.TimeEntryAutocompleteItems(
+            &snapshot->TimeEntryAutocompletes);
+        snapshot->AutocompleteIndexes[kAutocompleteTimeEntry] =
+            user_->related.AutocompleteIndexCopy(kAutocompleteTimeEntry);
+    }
+
+    if (missing & RenderSnapshot::kMinitimerAutocomplete) {
+        user_->related.MinitimerAutocompleteItems(
+            &snapshot->MinitimerAutocompletes);
+        snapshot->AutocompleteIndexes[kAutocompleteMinitimer] =
+            user_->related.AutocompleteIndexCopy(kAutocompleteMinitimer);
+    }
+
+    if (missing & RenderSnapshot::kWorkspaces) {
+        std::vector<Workspace *> workspaces;
+        user_->related.WorkspaceList(&workspaces);
+        for (std::vector<Workspace *>::const_iterator
+                it = workspaces.begin();
+                it != workspaces.end();
+                it++) {
+            Workspace *ws = *it;
+            view::Generic view;
+            view.GUID = ws->GUID();
+            view.ID = ws->ID();
+            view.WID = ws->ID();
+            view.Name = ws->Name();
+            view.WorkspaceName = ws->Name();
+            snapshot->Workspaces.push_back(view);
+        }
+    }
+
+    if (missing & RenderSnapshot::kClients) {
+        std::vector<Client *> models;
+        user_->related.ClientList(&models);
+        for (std::vector<Client *>::const_iterator it = models.begin();
+                it != models.end();
+                it++) {
+            Client *c = *it;
+            view::Generic view;
+            view.GUID = c->GUID();
+            view.ID = c->ID();
+            view.WID = c->WID();
+            view.Name = c->Name();
+            if (c->WID()) {
+                Workspace *ws = user_->related.WorkspaceByID(c->WID());
+                if (ws) {
+                    view.WorkspaceName = ws->Name();
+                }
+            }
+            snapshot->Clients.push_back(view);
+        }
+    }
+
+    if ((missing & RenderSnapshot::kRunningEntry) && running_entry) {
+        view::TimeEntry &running_entry_view = snapshot->RunningEntry;
+        running_entry_view.Fill(running_entry);
+        running_entry_view.Duration =
+            toggl::Formatter::FormatDuration(
+                running_entry->DurationInSeconds(),
+                Format::Classic);
+        running_entry_view.DateDuration =
+            Formatter::FormatDurationForDateHeader(
+                user_->related.TotalDurationForDate(
+                    running_entry));
+        user_->related.ProjectLabelAndColorCode(
+            running_entry,
+            &running_entry_view);
+    }
+
+    if (missing & RenderSnapshot::kTimeEntries) {
+        std::vector<view::TimeEntry> &time_entry_views =
+            snapshot->TimeEntries;
+
+        // Get a sorted list of time entries
+        std::vector<TimeEntry *> time_entries =
+            user_->related.VisibleTimeEntries();
+        std::sort(time_entries.begin(), time_entries.end(),
+                  CompareByStart);
+
+        // Collect the time entries into a list
+        std::string date_header("");
+        std::string date_duration("");
+        for (unsigned int i = 0; i < time_entries.size(); i++) {
+            TimeEntry *te = time_entries[i];
+            // Dont render running entry in list,
+            // although its calculated into totals per date.
+            if (te->Duration() < 0) {
+                continue;
+            }
+            view::TimeEntry view;
+            view.Fill(te);
+            user_->related.ProjectLabelAndColorCode(
+                te,
+                &view);
+
+            view.Locked = isTimeEntryLocked(te);
+
+            view.Duration = toggl::Formatter::FormatDuration(
+                view.DurationInSeconds,
+                Formatter::DurationFormat);
+
+            // Entries are sorted, so each date header
+            // total is looked up once
+            if (view.DateHeader != date_header) {
+                date_header = view.DateHeader;
+                date_duration = Formatter::FormatDurationForDateHeader(
+                    user_->related.TotalDurationForDate(te));
+            }
+            view.DateDuration = date_duration;
+
+            time_entry_views.push_back(view);
+        }
+    }
+
+    if (missing & RenderSnapshot::kUnsyncedItems) {
+        snapshot->UnsyncedItemCount =
+            user_->related.NumberOfUnsyncedTimeEntries();
+    }
+
+    snapshot->Parts |= parts;
+
+    Poco::Mutex::ScopedLock lock(render_snapshot_m_);
+    render_snapshot_ = snapshot;
+}
+
+
+
 void Context::updateUI(const UIElements &what) {
     logger().debug("updateUI " + what.String());
 
     view::TimeEntry editor_time_entry_view;
 
-    std::vector<view::Autocomplete> time_entry_autocompletes;
-    std::vector<view::Autocomplete> minitimer_autocompletes;
-    std::vector<view::Autocomplete> project_autocompletes;
-
     bool use_proxy(false);
     bool record_timeline(false);
-    Poco::Int64 unsynced_item_count(0);
     Proxy proxy;
 
-    view::TimeEntry running_entry_view;
-
-    std::vector<view::TimeEntry> time_entry_views;
-
-    std::vector<view::Generic> client_views;
-    std::vector<view::Generic> workspace_views;
     std::vector<view::Generic> tag_views;
 
     std::vector<view::AutotrackerRule> autotracker_rule_views;
     std::vector<std::string> autotracker_title_views;
 
+    // Time entries, timer, selects and autocompletes are
+    // rendered from a snapshot, without waiting for user_m_
+    std::shared_ptr<const RenderSnapshot> snapshot = renderSnapshot(what);
+
+    if (what.display_time_entries && what.open_time_entry_list) {
+        time_entry_editor_guid_ = "";
+    }
+
     // Collect data
-    {
+    if (what.display_time_entry_editor
+            || what.display_settings
+            || what.display_autotracker_rules) {
         Poco::Mutex::ScopedLock lock(user_m_);
 
-        if (what.display_project_autocomplete && user_) {
-            user_->related.ProjectAutocompleteItems(&project_autocompletes);
-        }
-
         if (what.display_time_entry_editor && user_) {
             TimeEntry *editor_time_entry =
                 user_->related.TimeEntryByGUID(what.time_entry_editor_guid);
@@ -556,121 +1011,6 @@ void Context::updateUI(const UIElements &what) {
             }
         }
 
-        if (what.display_time_entry_autocomplete && user_) {
-            user_->related.TimeEntryAutocompleteItems(
-                &time_entry_autocompletes);
-        }
-
-        if (what.display_mini_timer_autocomplete && user_) {
-            user_->related.MinitimerAutocompleteItems(&minitimer_autocompletes);
-        }
-
-        if (what.display_workspace_select && user_) {
-            std::vector<Workspace *> workspaces;
-            user_->related.WorkspaceList(&workspaces);
-            for (std::vector<Workspace *>::const_iterator
-                    it = workspaces.begin();
-                    it != workspaces.end();
-                    it++) {
-                Workspace *ws = *it;
-                view::Generic view;
-                view.GUID = ws->GUID();
-                view.ID = ws->ID();
-                view.WID = ws->ID();
-                view.Name = ws->Name();
-                view.WorkspaceName = ws->Name();
-                workspace_views.push_back(view);
-            }
-        }
-
-        if (what.display_client_select && user_) {
-            std::vector<Client *> models;
-            user_->related.ClientList(&models);
-            for (std::vector<Client *>::const_iterator it = models.begin();
-                    it != models.end();
-                    it++) {
-                Client *c = *it;
-                view::Generic view;
-                view.GUID = c->GUID();
-                view.ID = c->ID();
-                view.WID = c->WID();
-                view.Name = c->Name();
-                if (c->WID()) {
-                    Workspace *ws = user_->related.WorkspaceByID(c->WID());
-                    if (ws) {
-                        view.WorkspaceName = ws->Name();
-                    }
-                }
-                client_views.push_back(view);
-            }
-        }
-
-        if (what.display_timer_state && user_) {
-            TimeEntry *running_entry = user_->RunningTimeEntry();
-            if (running_entry) {
-                running_entry_view.Fill(running_entry);
-                running_entry_view.Duration =
-                    toggl::Formatter::FormatDuration(
-                        running_entry->DurationInSeconds(),
-                        Format::Classic);
-                running_entry_view.DateDuration =
-                    Formatter::FormatDurationForDateHeader(
-                        user_->related.TotalDurationForDate(
-                            running_entry));
-                user_->related.ProjectLabelAndColorCode(
-                    running_entry,
-                    &running_entry_view);
-            }
-        }
-
-        if (what.display_time_entries && user_) {
-            if (what.open_time_entry_list) {
-                time_entry_editor_guid_ = "";
-            }
-
-            // Get a sorted list of time entries
-            std::vector<TimeEntry *> time_entries =
-                user_->related.VisibleTimeEntries();
-            std::sort(time_entries.begin(), time_entries.end(),
-                      CompareByStart);
-
-            // Collect the time entries into a list
-            std::map<std::string, Poco::Int64> date_durations;
-            for (unsigned int i = 0; i < time_entries.size(); i++) {
-                TimeEntry *te = time_entries[i];
-                view::TimeEntry view;
-                view.Fill(te);
-                // Calculate total duration for each date:
-                // will be displayed in date header
-                Poco::Int64 duration = date_durations[view.DateHeader];
-                duration += Formatter::AbsDuration(te->Duration());
-                date_durations[view.DateHeader] = duration;
-                // Dont render running entry in list,
-                // although its calculated into totals per date.
-                if (te->Duration() < 0) {
-                    // Don't display running entries
-                    continue;
-                }
-                user_->related.ProjectLabelAndColorCode(
-                    te,
-                    &view);
-
-                view.Locked = isTimeEntryLocked(te);
-
-                time_entry_views.push_back(view);
-            }
-            // Assign the date durations we calculated previously
-            for (unsigned int i = 0; i < time_entry_views.size(); i++) {
-                view::TimeEntry &view = time_entry_views[i];
-                view.Duration = toggl::Formatter::FormatDuration(
-                    view.DurationInSeconds,
-                    Formatter::DurationFormat);
-                view.DateDuration =
-                    Formatter::FormatDurationForDateHeader(
-                        date_durations[view.DateHeader]);
-            }
-        }
-
         if (what.display_settings) {
             error err = db()->LoadSettings(&settings_);
             if (err != noError) {
@@ -695,10 +1035,6 @@ void Context::updateUI(const UIElements &what) {
             HTTPSClient::Config.AutodetectProxy = settings_.autodetect_proxy;
         }
 
-        if (what.display_unsynced_items && user_) {
-            unsynced_item_count = user_->related.NumberOfUnsyncedTimeEntries();
-        }
-
         if (what.display_autotracker_rules && user_) {
             if (UI()->CanDisplayAutotrackerRules()) {
                 // Collect rules
@@ -747,30 +1083,32 @@ void Context::updateUI(const UIElements &what) {
     if (what.display_time_entries) {
         UI()->DisplayTimeEntryList(
             what.open_time_entry_list,
-            time_entry_views,
-            !user_->HasLoadedMore());
+            snapshot->TimeEntries,
+            !snapshot->HasLoadedMore);
         last_time_entry_list_render_at_ = Poco::LocalDateTime();
     }
 
     if (what.display_time_entry_autocomplete) {
-        UI()->DisplayTimeEntryAutocomplete(&time_entry_autocompletes);
+        UI()->DisplayTimeEntryAutocomplete(
+            &snapshot->TimeEntryAutocompletes);
     }
 
     if (what.display_mini_timer_autocomplete) {
-        UI()->DisplayMinitimerAutocomplete(&minitimer_autocompletes);
+        UI()->DisplayMinitimerAutocomplete(
+            &snapshot->MinitimerAutocompletes);
     }
 
     if (what.display_workspace_select) {
-        UI()->DisplayWorkspaceSelect(workspace_views);
+        UI()->DisplayWorkspaceSelect(snapshot->Workspaces);
     }
 
     if (what.display_client_select) {
-        UI()->DisplayClientSelect(client_views);
+        UI()->DisplayClientSelect(snapshot->Clients);
     }
 
     if (what.display_timer_state) {
-        if (!running_entry_view.GUID.empty() && user_) {
-            UI()->DisplayTimerState(running_entry_view);
+        if (!snapshot->RunningEntry.GUID.empty()) {
+            UI()->DisplayTimerState(snapshot->RunningEntry);
         } else {
             UI()->DisplayEmptyTimerState();
         }
@@ -803,11 +1141,12 @@ void Context::updateUI(const UIElements &what) {
     // Apply autocomplete as last element,
     // as its depending on selects on Windows
     if (what.display_project_autocomplete) {
-        UI()->DisplayProjectAutocomplete(&project_autocompletes);
+        UI()->DisplayProjectAutocomplete(
+            &snapshot->ProjectAutocompletes);
     }
 
     if (what.display_unsynced_items) {
-        UI()->DisplayUnsyncedItems(unsynced_item_count);
+        UI()->DisplayUnsyncedItems(snapshot->UnsyncedItemCount);
     }
 }
 
@@ -816,22 +1155,6 @@ Poco::Timestamp Context::postpone(
     return Poco::Timestamp() + throttleMicros;
 }
 
-bool Context::isPostponed(
-    const Poco::Timestamp value,
-    const Poco::Timestamp::TimeDiff throttleMicros) const {
-    Poco::Timestamp now;
-    if (now > value) {
-        return false;
-    }
-    Poco::Timestamp::TimeDiff diff = value - now;
-    if (diff > 2*throttleMicros) {
-        logger().warning(
-            "Cannot postpone task, its foo far in the future");
-        return false;
-    }
-    return true;
-}
-
 error Context::displayError(const error err) {
     if ((err.find(kForbiddenError) != std::string::npos)
             || (err.find(kUnauthorizedError) != std::string::npos)) {
@@ -879,35 +1202,33 @@ void Context::Sync() {
     logger().debug("Sync");
 
     Poco::Timestamp::TimeDiff delay = 0;
-    if (next_sync_at_ > 0) {
+    if (scheduler_.IsPending(kJobSync) || scheduler_.FireCount(kJobSync)) {
         delay = kRequestThrottleSeconds * kOneSecondInMicros;
     }
 
-    next_sync_at_ = postpone(delay);
-    Poco::Util::TimerTask::Ptr ptask =
-        new Poco::Util::TimerTaskAdapter<Context>(*this, &Context::onSync);
-
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_sync_at_);
+    Poco::Timestamp at = postpone(delay);
+    scheduler_.Schedule(kJobSync, at);
 
     std::stringstream ss;
     ss << "Next sync at "
-       << Formatter::Format8601(next_sync_at_);
+       << Formatter::Format8601(at);
     logger().debug(ss.str());
 }
 
 void Context::onSync(Poco::Util::TimerTask& task) {  // NOLINT
-    if (isPostponed(next_sync_at_,
-                    kRequestThrottleSeconds * kOneSecondInMicros)) {
-        logger().debug("onSync postponed");
-        return;
-    }
     logger().debug("onFullSync executing");
 
     last_sync_started_ = time(0);
 
+    // Server data is merged against the complete local data
+    error err = loadRemainingUserData();
+    if (err != noError) {
+        displayError(err);
+        return;
+    }
+
     TogglClient client(UI());
-    error err = pullAllUserData(&client);
+    err = pullAllUserData(&client);
     if (err != noError) {
         displayError(err);
         return;
@@ -949,11 +1270,6 @@ void Context::setOnline(const std::string reason) {
 }
 
 void Context::onPushChanges(Poco::Util::TimerTask& task) {  // NOLINT
-    if (isPostponed(next_push_changes_at_,
-                    kRequestThrottleSeconds * kOneSecondInMicros)) {
-        logger().debug("onPushChanges postponed");
-        return;
-    }
     logger().debug("onPushChanges executing");
 
     TogglClient client(UI());
@@ -988,27 +1304,152 @@ void Context::switchWebSocketOff() {
 void Context::onSwitchWebSocketOff(Poco::Util::TimerTask& task) {  // NOLINT
     logger().debug("onSwitchWebSocketOff");
 
-    Poco::Mutex::ScopedLock lock(ws_client_m_);
-    ws_client_.Shutdown();
+    Poco::Mutex::ScopedLock lock(ws_client_m_);
+    ws_client_.Shutdown();
+}
+
+error Context::LoadUpdateFromJSON(const Json::Value &update) {
+    std::stringstream ss;
+    ss << "LoadUpdateFromJSON model=" << update["model"].asString()
+       << " action=" << update["action"].asString();
+    logger().debug(ss.str());
+
+    size_t queued(0);
+    {
+        Poco::Mutex::ScopedLock lock(websocket_updates_m_);
+        websocket_updates_.push_back(update);
+        queued = websocket_updates_.size();
+    }
+
+    // Updates are applied in batches, when enough of them have
+    // arrived or a moment after the first one
+    if (queued >= kWebsocketUpdateBatchSize) {
+        scheduleLoadUpdates(Poco::Timestamp());
+    } else if (1 == queued) {
+        scheduleLoadUpdates(postpone(kWebsocketUpdateBatchMillis * 1000));
+    }
+
+    return noError;
+}
+
+void Context::scheduleLoadUpdates(const Poco::Timestamp at) {
+    if (quit_) {
+        return;
+    }
+
+    Poco::Util::TimerTask::Ptr ptask =
+        new Poco::Util::TimerTaskAdapter<Context>(
+            *this, &Context::onLoadUpdates);
+
+    Poco::Mutex::ScopedLock lock(timer_m_);
+    timer_.schedule(ptask, at);
+}
+
+void Context::onRenderStale(Poco::Util::TimerTask& task) {  // NOLINT
+    UIElements render;
+    {
+        Poco::Mutex::ScopedLock lock(render_snapshot_m_);
+        render = stale_render_;
+        stale_render_ = UIElements();
+        stale_render_scheduled_ = false;
+    }
+    updateUI(render);
+}
+
+void Context::onLoadUpdates(Poco::Util::TimerTask& task) {  // NOLINT
+    loadUpdates();
+}
+
+error Context::loadUpdates() {
+    std::vector<Json::Value> updates;
+    {
+        Poco::Mutex::ScopedLock lock(websocket_updates_m_);
+        updates.swap(websocket_updates_);
+    }
+
+    if (updates.empty()) {
+        return noError;
+    }
+
+    error err = loadRemainingUserData();
+    if (err != noError) {
+        return displayError(err);
+    }
+
+    try {
+        Poco::Mutex::ScopedLock lock(user_m_);
+        if (!user_) {
+            logger().warning("User is logged out, cannot update");
+            return noError;
+        }
+
+        size_t applied = user_->LoadUserUpdatesFromJSON(updates);
+
+        std::stringstream ss;
+        ss << "Applied " << applied << " of "
+           << updates.size() << " update(s)";
+        logger().debug(ss.str());
+
+        return displayError(save());
+    } catch(const Poco::Exception& exc) {
+        return displayError(exc.displayText());
+    } catch(const std::exception& ex) {
+        return displayError(ex.what());
+    } catch(const std::string& ex) {
+        return displayError(ex);
+    }
+    return noError;
 }
 
-error Context::LoadUpdateFromJSONString(const std::string json) {
-    std::stringstream ss;
-    ss << "LoadUpdateFromJSONString json=" << json;
-    logger().debug(ss.str());
+void Context::onLoadRemainingUserData(Poco::Util::TimerTask& task) {  // NOLINT
+    displayError(loadRemainingUserData());
+}
 
-    Poco::Mutex::ScopedLock lock(user_m_);
-    if (!user_) {
-        logger().warning("User is logged out, cannot update");
-        return noError;
+error Context::loadRemainingUserData() {
+    User *user(nullptr);
+    Poco::UInt64 user_id(0);
+    Poco::UInt64 since(0);
+    {
+        Poco::Mutex::ScopedLock lock(user_m_);
+        if (!user_ || !user_->PartialDataSince()) {
+            return noError;
+        }
+        user = user_;
+        user_id = user_->ID();
+        since = user_->PartialDataSince();
     }
 
-    error err = user_->LoadUserUpdateFromJSONString(json);
+    // Load without blocking the UI, which keeps rendering
+    // from the recent data meanwhile
+    RelatedData related;
+    error err = db()->LoadUserRemainingData(user_id, since, &related);
     if (err != noError) {
-        return displayError(err);
+        related.Clear();
+        return err;
     }
 
-    return displayError(save());
+    {
+        Poco::Mutex::ScopedLock lock(user_m_);
+        if (user_ != user || user_->ID() != user_id) {
+            related.Clear();
+            return noError;
+        }
+        if (!user_->PartialDataSince()) {
+            // Merged by another load already, removed
+            // models are not tracked any more
+            related.Clear();
+            return noError;
+        }
+        user_->related.Merge(&related);
+        user_->related.TrackRemoved(false);
+        user_->SetPartialDataSince(0);
+    }
+
+    UI()->DisplayDataComplete(user_id);
+
+    updateUI(UIElements::Reset());
+
+    return noError;
 }
 
 void Context::switchWebSocketOn() {
@@ -1041,7 +1482,8 @@ void Context::onSwitchWebSocketOn(Poco::Util::TimerTask& task) {  // NOLINT
 
     {
         Poco::Mutex::ScopedLock lock(ws_client_m_);
-        ws_client_.Start(this, apitoken, on_websocket_message);
+        ws_client_.Start(this, apitoken, on_websocket_message,
+                         on_websocket_missed_message);
     }
 }
 
@@ -1111,28 +1553,17 @@ void Context::onSwitchTimelineOn(Poco::Util::TimerTask& task) {  // NOLINT
 void Context::fetchUpdates() {
     logger().debug("fetchUpdates");
 
-    next_fetch_updates_at_ =
+    Poco::Timestamp at =
         postpone(kRequestThrottleSeconds * kOneSecondInMicros);
-    Poco::Util::TimerTask::Ptr ptask =
-        new Poco::Util::TimerTaskAdapter<Context>(
-            *this, &Context::onFetchUpdates);
-
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_fetch_updates_at_);
+    scheduler_.Schedule(kJobFetchUpdates, at);
 
     std::stringstream ss;
     ss << "Next update fetch at "
-       << Formatter::Format8601(next_fetch_updates_at_);
+       << Formatter::Format8601(at);
     logger().debug(ss.str());
 }
 
 void Context::onFetchUpdates(Poco::Util::TimerTask& task) {  // NOLINT
-    if (isPostponed(next_fetch_updates_at_,
-                    kRequestThrottleSeconds * kOneSecondInMicros)) {
-        logger().debug("onFetchUpdates postponed");
-        return;
-    }
-
     executeUpdateCheck();
 }
 
@@ -1164,6 +1595,91 @@ void Context::onPeriodicSync(Poco::Util::TimerTask& task) {  // NOLINT
     startPeriodicSync();
 }
 
+void Context::scheduleDatabaseMaintenance(const Poco::UInt64 seconds) {
+    if (quit_) {
+        return;
+    }
+
+    Poco::Util::TimerTask::Ptr ptask =
+        new Poco::Util::TimerTaskAdapter<Context>
+    (*this, &Context::onDatabaseMaintenance);
+
+    Poco::Mutex::ScopedLock lock(timer_m_);
+    timer_.schedule(ptask, postpone(seconds * kOneSecondInMicros));
+}
+
+void Context::onDatabaseMaintenance(Poco::Util::TimerTask& task) {  // NOLINT
+    logger().debug("onDatabaseMaintenance");
+
+    // Only while the user is away, so it doesn't get in the way
+    Poco::UInt64 idle_seconds(0);
+    {
+        Poco::Mutex::ScopedLock lock(idle_seconds_m_);
+        idle_seconds = idle_seconds_;
+    }
+    if (idle_seconds < kDatabaseMaintenanceIdleSeconds) {
+        scheduleDatabaseMaintenance(kDatabaseMaintenanceRetrySeconds);
+        return;
+    }
+
+    DatabaseMaintenance run;
+    error err = noError;
+    {
+        // Old time entries are dropped from memory in the same step
+        // as their rows, the ones still in use are kept in both
+        Poco::Mutex::ScopedLock user_lock(user_m_);
+        if (user_ && user_->PartialDataSince()) {
+            scheduleDatabaseMaintenance(kDatabaseMaintenanceRetrySeconds);
+            return;
+        }
+        Poco::Timestamp purge_before(
+            Poco::Timestamp::fromEpochTime(
+                time(0) - kTimeEntrySecondsToKeep));
+        std::set<Poco::Int64> keep;
+        if (user_) {
+            if (pomodoro_break_entry_ && !user_->HasLoadedMore()
+                    && pomodoro_break_entry_->Stop()
+                    && pomodoro_break_entry_->Stop()
+                    < static_cast<Poco::UInt64>(purge_before.epochTime())) {
+                pomodoro_break_entry_ = nullptr;
+            }
+            user_->ForgetTimeEntries(purge_before.epochTime(), &keep);
+        }
+
+        Poco::Mutex::ScopedLock lock(db_m_);
+        if (!db_) {
+            scheduleDatabaseMaintenance(kDatabaseMaintenanceRetrySeconds);
+            return;
+        }
+        err = db_->PurgeTimeEntries(
+            kDatabaseMaintenanceBudgetMillis * 1000,
+            purge_before, keep, &run);
+    }
+
+    // Vacuum and checkpoint leave the user alone
+    {
+        Poco::Mutex::ScopedLock lock(db_m_);
+        if (db_ && err == noError) {
+            err = db_->Reclaim(
+                kDatabaseMaintenanceBudgetMillis * 1000, &run);
+        }
+        if (err != noError) {
+            logger().error("Database maintenance failed: " + err);
+        }
+        last_database_maintenance_ = run;
+    }
+
+    // Continue a while later if the time budget ran out
+    scheduleDatabaseMaintenance(run.complete
+                                ? kDatabaseMaintenanceIntervalSeconds
+                                : kDatabaseMaintenanceRetrySeconds);
+}
+
+std::string Context::DatabaseMaintenanceReport() {
+    Poco::Mutex::ScopedLock lock(db_m_);
+    return last_database_maintenance_.String();
+}
+
 void Context::startPeriodicUpdateCheck() {
     logger().debug("startPeriodicUpdateCheck");
 
@@ -1401,18 +1917,13 @@ const std::string Context::installerPlatform() {
 void Context::TimelineUpdateServerSettings() {
     logger().debug("TimelineUpdateServerSettings");
 
-    next_update_timeline_settings_at_ =
+    Poco::Timestamp at =
         postpone(kRequestThrottleSeconds * kOneSecondInMicros);
-    Poco::Util::TimerTask::Ptr ptask =
-        new Poco::Util::TimerTaskAdapter<Context>(*this,
-                &Context::onTimelineUpdateServerSettings);
-
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_update_timeline_settings_at_);
+    scheduler_.Schedule(kJobTimelineSettings, at);
 
     std::stringstream ss;
     ss << "Next timeline settings update at "
-       << Formatter::Format8601(next_update_timeline_settings_at_);
+       << Formatter::Format8601(at);
     logger().debug(ss.str());
 }
 
@@ -1420,12 +1931,6 @@ const std::string kRecordTimelineEnabledJSON = "{\"record_timeline\": true}";
 const std::string kRecordTimelineDisabledJSON = "{\"record_timeline\": false}";
 
 void Context::onTimelineUpdateServerSettings(Poco::Util::TimerTask& task) {  // NOLINT
-    if (isPostponed(next_update_timeline_settings_at_,
-                    kRequestThrottleSeconds * kOneSecondInMicros)) {
-        logger().debug("onTimelineUpdateServerSettings postponed");
-        return;
-    }
-
     logger().debug("onTimelineUpdateServerSettings executing");
 
     std::string apitoken("");
@@ -1890,6 +2395,10 @@ void Context::OpenSettings() {
     updateUI(render);
 }
 
+void Context::SetWebSocketClientURL(const std::string value) {
+    urls::SetWebSocketURL(value);
+}
+
 error Context::SetDBPath(
     const std::string path) {
     try {
@@ -2074,15 +2583,38 @@ void Context::setUser(User *value, const bool logged_in) {
 
     Poco::UInt64 user_id(0);
 
+    // Previous user must be saved before it's deleted
+    error err = flush();
+    if (err != noError) {
+        logger().error(err);
+    }
+
     {
+        Poco::Mutex::ScopedLock flush_lock(flush_m_);
         Poco::Mutex::ScopedLock lock(user_m_);
         if (user_) {
+            if (db_) {
+                err = db_->SaveTimelineEvents(user_);
+                if (err != noError) {
+                    logger().error(err);
+                }
+            }
             delete user_;
         }
         user_ = value;
         if (user_) {
             user_id = user_->ID();
         }
+
+        // Views of the previous user must not be rendered
+        Poco::Mutex::ScopedLock l(render_snapshot_m_);
+        render_snapshot_.reset();
+    }
+
+    {
+        // Queued updates were meant for the previous user
+        Poco::Mutex::ScopedLock lock(websocket_updates_m_);
+        websocket_updates_.clear();
     }
 
     if (quit_) {
@@ -2138,17 +2670,17 @@ void Context::setUser(User *value, const bool logged_in) {
 
     fetchUpdates();
 
-    if (!ui_updater_.isRunning()) {
-        ui_updater_.start();
+    if (!scheduler_.IsPending(kJobUIUpdate)) {
+        startPeriodicUIUpdate();
     }
 
-    if (!reminder_.isRunning()) {
-        reminder_.start();
+    if (!scheduler_.IsPending(kJobReminders)) {
+        startPeriodicReminders();
     }
 
     // Offer beta channel, if not offered yet
     bool did_offer_beta_channel(false);
-    error err = offerBetaChannel(&did_offer_beta_channel);
+    err = offerBetaChannel(&did_offer_beta_channel);
     if (err != noError) {
         displayError(err);
     }
@@ -2249,12 +2781,30 @@ error Context::ClearCache() {
         error err = noError;
 
         {
+            // No save of the user may be written meanwhile
+            Poco::Mutex::ScopedLock flush_lock(flush_m_);
             Poco::Mutex::ScopedLock lock(user_m_);
             if (!user_) {
                 logger().warning("User is logged out, cannot clear cache");
                 return noError;
             }
             err = db()->DeleteUser(user_, true);
+            if (err == noError) {
+                // No save may write the user back after it's deleted
+                {
+                    Poco::Mutex::ScopedLock l(pending_save_m_);
+                    pending_save_ = false;
+                    pending_save_push_changes_ = false;
+                }
+
+                // Drop the recorded timeline with the rest
+                std::vector<TimelineEvent *> *buffer =
+                    &user_->related.TimelineBuffer;
+                for (size_t i = 0; i < buffer->size(); i++) {
+                    delete (*buffer)[i];
+                }
+                buffer->clear();
+            }
         }
 
         if (err != noError) {
@@ -3218,6 +3768,46 @@ error Context::DefaultTID(Poco::UInt64 *result) {
     return noError;
 }
 
+error Context::AutocompleteQuery(
+    const Poco::UInt64 kind,
+    const std::string text,
+    const Poco::UInt64 limit,
+    std::vector<view::Autocomplete> *result) {
+    try {
+        poco_check_ptr(result);
+        result->clear();
+
+        UIElements what;
+        if (kAutocompleteTimeEntry == kind) {
+            what.display_time_entry_autocomplete = true;
+        } else if (kAutocompleteMinitimer == kind) {
+            what.display_mini_timer_autocomplete = true;
+        } else if (kAutocompleteProject == kind) {
+            what.display_project_autocomplete = true;
+        } else {
+            return noError;
+        }
+
+        // Queried from the published views, so that typing doesn't
+        // wait for the user data while it's being changed
+        std::shared_ptr<const RenderSnapshot> snapshot = renderSnapshot(what);
+        const std::shared_ptr<const AutocompleteIndex> &index =
+            snapshot->AutocompleteIndexes[kind];
+        if (!index) {
+            logger().warning("Cannot query autocomplete, user logged out");
+            return noError;
+        }
+        index->Query(text, limit, result);
+    } catch(const Poco::Exception& exc) {
+        return displayError(exc.displayText());
+    } catch(const std::exception& ex) {
+        return displayError(ex.what());
+    } catch(const std::string& ex) {
+        return displayError(ex);
+    }
+    return noError;
+}
+
 error Context::AddAutotrackerRule(
     const std::string term,
     const Poco::UInt64 pid,
@@ -3281,15 +3871,20 @@ error Context::AddAutotrackerRule(
             rule->SetPID(p->ID());
         }
         rule->SetUID(user_->ID());
-        user_->related.AutotrackerRules.push_back(rule);
+        user_->related.Push(rule);
     }
 
+    // Rule gets its ID when it's saved
     error err = save();
+    if (noError == err) {
+        err = flush();
+    }
     if (noError != err) {
         return displayError(err);
     }
 
     if (rule) {
+        Poco::Mutex::ScopedLock lock(user_m_);
         *rule_id = rule->LocalID();
     }
 
@@ -3420,7 +4015,7 @@ error Context::AddObmAction(
         action->SetUID(user_->ID());
         action->SetKey(trimmed_key);
         action->SetValue(trimmed_value);
-        user_->related.ObmActions.push_back(action);
+        user_->related.Push(action);
     }
     return displayError(save());
 }
@@ -3636,29 +4231,20 @@ void Context::SetWake() {
     logger().debug("SetWake");
 
     Poco::Timestamp::TimeDiff delay = 0;
-    if (next_wake_at_ > 0) {
+    if (scheduler_.IsPending(kJobWake) || scheduler_.FireCount(kJobWake)) {
         delay = kRequestThrottleSeconds * kOneSecondInMicros;
     }
 
-    next_wake_at_ = postpone(delay);
-    Poco::Util::TimerTask::Ptr ptask =
-        new Poco::Util::TimerTaskAdapter<Context>(*this, &Context::onWake);
-
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_wake_at_);
+    Poco::Timestamp at = postpone(delay);
+    scheduler_.Schedule(kJobWake, at);
 
     std::stringstream ss;
     ss << "Next wake at "
-       << Formatter::Format8601(next_wake_at_);
+       << Formatter::Format8601(at);
     logger().debug(ss.str());
 }
 
 void Context::onWake(Poco::Util::TimerTask& task) {  // NOLINT
-    if (isPostponed(next_wake_at_,
-                    kRequestThrottleSeconds * kOneSecondInMicros)) {
-        logger().debug("onWake postponed");
-        return;
-    }
     logger().debug("onWake executing");
 
     try {
@@ -3692,16 +4278,13 @@ void Context::SetOnline() {
     // Schedule a sync, a but a bit later
     // For example, on Windows we're not yet online although
     // we're told we are. So wait a bit
-    next_sync_at_ = postpone(2 * kRequestThrottleSeconds * kOneSecondInMicros);
-    Poco::Util::TimerTask::Ptr ptask =
-        new Poco::Util::TimerTaskAdapter<Context>(*this, &Context::onSync);
-
-    Poco::Mutex::ScopedLock lock(timer_m_);
-    timer_.schedule(ptask, next_sync_at_);
+    Poco::Timestamp at =
+        postpone(2 * kRequestThrottleSeconds * kOneSecondInMicros);
+    scheduler_.Schedule(kJobSync, at);
 
     std::stringstream ss;
     ss << "Next sync at "
-       << Formatter::Format8601(next_sync_at_);
+       << Formatter::Format8601(at);
     logger().debug(ss.str());
 }
 
@@ -3919,13 +4502,18 @@ error Context::CreateCompressedTimelineBatchForUpload(TimelineBatch *batch) {
             return noError;
         }
 
-        user_->CompressTimeline();
-        error err = save();
-        if (err != noError) {
-            return displayError(err);
+        // Compress once per round of uploads, before its first page
+        if (!batch->Cursor()) {
+            user_->CompressTimeline();
+            error err = db()->SaveTimelineEvents(user_);
+            if (err != noError) {
+                return displayError(err);
+            }
         }
 
-        batch->SetEvents(user_->CompressedTimeline());
+        Poco::UInt64 cursor = batch->Cursor();
+        batch->SetEvents(user_->CompressedTimeline(batch->Limit(), &cursor));
+        batch->SetCursor(cursor);
         batch->SetUserID(user_->ID());
         batch->SetAPIToken(user_->APIToken());
         batch->SetDesktopID(db_->DesktopID());
@@ -3943,16 +4531,62 @@ error Context::StartTimelineEvent(TimelineEvent *event) {
     try {
         poco_check_ptr(event);
 
+        size_t buffered(0);
+        {
+            Poco::Mutex::ScopedLock lock(user_m_);
+            if (!user_ || !user_->RecordTimeline()) {
+                delete event;
+                return noError;
+            }
+
+            event->SetUID(static_cast<unsigned int>(user_->ID()));
+            user_->related.AddTimelineEvent(event);
+            buffered = user_->related.TimelineBuffer.size()
+                       + user_->related.TimelineEventIndex.ChangedCount();
+        }
+
+        // Chunks are saved in batches, when enough of them have
+        // been added or changed, or a while after the first one
+        if (buffered >= kTimelineBufferSize) {
+            scheduleSaveTimelineEvents(Poco::Timestamp());
+        } else if (1 == buffered) {
+            scheduleSaveTimelineEvents(
+                postpone(kTimelineBufferFlushSeconds * kOneSecondInMicros));
+        }
+    } catch(const Poco::Exception& exc) {
+        return displayError(exc.displayText());
+    } catch(const std::exception& ex) {
+        return displayError(ex.what());
+    } catch(const std::string& ex) {
+        return displayError(ex);
+    }
+    return noError;
+}
+
+void Context::scheduleSaveTimelineEvents(const Poco::Timestamp at) {
+    if (quit_) {
+        return;
+    }
+
+    Poco::Util::TimerTask::Ptr ptask =
+        new Poco::Util::TimerTaskAdapter<Context>(
+            *this, &Context::onSaveTimelineEvents);
+
+    Poco::Mutex::ScopedLock lock(timer_m_);
+    timer_.schedule(ptask, at);
+}
+
+void Context::onSaveTimelineEvents(Poco::Util::TimerTask& task) {  // NOLINT
+    saveTimelineEvents();
+}
+
+error Context::saveTimelineEvents() {
+    try {
         Poco::Mutex::ScopedLock lock(user_m_);
         if (!user_) {
             return noError;
         }
-
-        if (user_ && user_->RecordTimeline()) {
-            event->SetUID(static_cast<unsigned int>(user_->ID()));
-            user_->related.TimelineEvents.push_back(event);
-            return displayError(save());
-        }
+        return displayError(db()->SaveTimelineEvents(user_));
     } catch(const Poco::Exception& exc) {
         return displayError(exc.displayText());
     } catch(const std::exception& ex) {
@@ -3973,7 +4607,7 @@ error Context::MarkTimelineBatchAsUploaded(
             return noError;
         }
         user_->MarkTimelineBatchAsUploaded(events);
-        return displayError(save());
+        return displayError(db()->SaveTimelineEvents(user_));
     } catch(const Poco::Exception& exc) {
         return displayError(exc.displayText());
     } catch(const std::exception& ex) {
@@ -3994,42 +4628,42 @@ error Context::SetPromotionResponse(
     return noError;
 }
 
-void Context::uiUpdaterActivity() {
-    std::string running_time("");
-    while (!ui_updater_.isStopped()) {
-        // Sleep in increments for faster shutdown.
-        for (unsigned int i = 0; i < 4*10; i++) {
-            if (ui_updater_.isStopped()) {
-                return;
-            }
-            Poco::Thread::sleep(250);
-        }
-
-        TimeEntry *te = nullptr;
-        Poco::Int64 duration(0);
-        {
-            Poco::Mutex::ScopedLock lock(user_m_);
-            if (!user_) {
-                continue;
-            }
-            te = user_->RunningTimeEntry();
-            if (!te) {
-                continue;
-            }
-            duration = user_->related.TotalDurationForDate(te);
-        }
+void Context::startPeriodicUIUpdate() {
+    if (quit_) {
+        return;
+    }
+    scheduler_.Schedule(
+        kJobUIUpdate,
+        postpone(kUIUpdateIntervalSeconds * kOneSecondInMicros));
+}
 
-        std::string date_duration =
-            Formatter::FormatDurationForDateHeader(duration);
+void Context::onUIUpdate(Poco::Util::TimerTask& task) {  // NOLINT
+    startPeriodicUIUpdate();
 
-        if (running_time != date_duration) {
-            UIElements render;
-            render.display_time_entries = true;
-            updateUI(render);
+    TimeEntry *te = nullptr;
+    Poco::Int64 duration(0);
+    {
+        Poco::Mutex::ScopedLock lock(user_m_);
+        if (!user_) {
+            return;
+        }
+        te = user_->RunningTimeEntry();
+        if (!te) {
+            return;
         }
+        duration = user_->related.TotalDurationForDate(te);
+    }
+
+    std::string date_duration =
+        Formatter::FormatDurationForDateHeader(duration);
 
-        running_time = date_duration;
+    if (ui_running_time_ != date_duration) {
+        UIElements render;
+        render.display_time_entries = true;
+        updateUI(render);
     }
+
+    ui_running_time_ = date_duration;
 }
 
 void Context::checkReminders() {
@@ -4038,18 +4672,19 @@ void Context::checkReminders() {
     displayPomodoroBreak();
 }
 
-void Context::reminderActivity() {
-    while (true) {
-        // Sleep in increments for faster shutdown.
-        for (int i = 0; i < 4; i++) {
-            if (reminder_.isStopped()) {
-                return;
-            }
-            Poco::Thread::sleep(250);
-        }
-
-        checkReminders();
+void Context::startPeriodicReminders() {
+    if (quit_) {
+        return;
     }
+    scheduler_.Schedule(
+        kJobReminders,
+        postpone(kReminderIntervalSeconds * kOneSecondInMicros));
+}
+
+void Context::onReminders(Poco::Util::TimerTask& task) {  // NOLINT
+    startPeriodicReminders();
+
+    checkReminders();
 }
 
 void Context::LoadMore() {
@@ -4059,13 +4694,7 @@ void Context::LoadMore() {
             return;
         }
     }
-    {
-        Poco::Util::TimerTask::Ptr task =
-            new Poco::Util::TimerTaskAdapter<Context>(*this,
-                    &Context::onLoadMore);
-        Poco::Mutex::ScopedLock lock(timer_m_);
-        timer_.schedule(task, postpone(0));
-    }
+    scheduler_.Schedule(kJobLoadMore, postpone(0));
 }
 
 void Context::onLoadMore(Poco::Util::TimerTask& task) {
@@ -4084,6 +4713,13 @@ void Context::onLoadMore(Poco::Util::TimerTask& task) {
             "cannot load more time entries without API token");
     }
 
+    // Loaded time entries are merged against the complete local data
+    error err = loadRemainingUserData();
+    if (err != noError) {
+        displayError(err);
+        return;
+    }
+
     try {
         std::stringstream ss;
         ss << "/api/v9/me/time_entries?since="
@@ -4112,7 +4748,7 @@ void Context::onLoadMore(Poco::Util::TimerTask& task) {
             Poco::Mutex::ScopedLock lock(user_m_);
             if (!user_)
                 return;
-            error err = user_->LoadTimeEntriesFromJSONString(json);
+            err = user_->LoadTimeEntriesFromJSONString(json);
 
             if (err != noError) {
                 logger().error(err);
@@ -4559,23 +5195,39 @@ bool Context::isTimeLockedInWorkspace(time_t t, Workspace* ws) {
 }
 
 error Context::pullWorkspacePreferences(TogglClient* toggl_client) {
-    Poco::Mutex::ScopedLock lock(user_m_);
-
-    std::vector<Workspace*> workspaces;
-    user_->related.WorkspaceList(&workspaces);
+    // Collect what the requests need, so that the user data
+    // is not locked while waiting for the network
+    std::vector<Poco::UInt64> workspace_ids;
+    std::string api_token("");
+    {
+        Poco::Mutex::ScopedLock lock(user_m_);
+        if (!user_) {
+            return error("cannot pull workspace preferences when logged out");
+        }
+        api_token = user_->APIToken();
 
-    for (std::vector<Workspace*>::const_iterator
-            it = workspaces.begin();
-            it != workspaces.end();
-            it++) {
-        Workspace* ws = *it;
+        std::vector<Workspace*> workspaces;
+        user_->related.WorkspaceList(&workspaces);
 
-        if (!ws->Business())
-            continue;
+        for (std::vector<Workspace*>::const_iterator
+                it = workspaces.begin();
+                it != workspaces.end();
+                it++) {
+            Workspace* ws = *it;
+            if (ws->Business()) {
+                workspace_ids.push_back(ws->ID());
+            }
+        }
+    }
 
+    for (std::vector<Poco::UInt64>::const_iterator
+            it = workspace_ids.begin();
+            it != workspace_ids.end();
+            it++) {
         std::string json("");
 
-        error err = pullWorkspacePreferences(toggl_client, ws, &json);
+        error err = pullWorkspacePreferences(
+            toggl_client, api_token, *it, &json);
         if (err != noError) {
             return err;
         }
@@ -4589,7 +5241,14 @@ error Context::pullWorkspacePreferences(TogglClient* toggl_client) {
             return error("Failed to load workspace preferences");
         }
 
-        ws->LoadSettingsFromJson(root);
+        Poco::Mutex::ScopedLock lock(user_m_);
+        if (!user_) {
+            return error("cannot load workspace preferences when logged out");
+        }
+        Workspace *ws = user_->related.WorkspaceByID(*it);
+        if (ws) {
+            ws->LoadSettingsFromJson(root);
+        }
     }
 
     return noError;
@@ -4597,11 +5256,10 @@ error Context::pullWorkspacePreferences(TogglClient* toggl_client) {
 
 error Context::pullWorkspacePreferences(
     TogglClient* toggl_client,
-    Workspace* workspace,
+    const std::string &api_token,
+    const Poco::UInt64 workspace_id,
     std::string* json) {
 
-    std::string api_token = user_->APIToken();
-
     if (api_token.empty()) {
         return error("cannot pull user data without API token");
     }
@@ -4609,7 +5267,7 @@ error Context::pullWorkspacePreferences(
     try {
         std::stringstream ss;
         ss << "/api/v9/workspaces/"
-           << workspace->ID()
+           << workspace_id
            << "/preferences";
 
         HTTPSRequest req;
@@ -4712,16 +5370,19 @@ void Context::collectPushableModels(
 
 void on_websocket_message(
     void *context,
-    std::string json) {
+    const Json::Value &update) {
 
     poco_check_ptr(context);
 
-    if (json.empty()) {
-        return;
-    }
+    Context *ctx = reinterpret_cast<Context *>(context);
+    ctx->LoadUpdateFromJSON(update);
+}
+
+void on_websocket_missed_message(void *context) {
+    poco_check_ptr(context);
 
     Context *ctx = reinterpret_cast<Context *>(context);
-    ctx->LoadUpdateFromJSONString(json);
+    ctx->Sync();
 }
 
 }  // namespace toggl
@@ -11,26 +11,30 @@
 #include <iostream> // NOLINT
 
 #include "./analytics.h"
+#include "./autocomplete_index.h"
 #include "./custom_error_handler.h"
+#include "./database.h"
 #include "./feedback.h"
 #include "./gui.h"
 #include "./help_article.h"
 #include "./idle.h"
 #include "./model_change.h"
+#include "./task_scheduler.h"
 #include "./timeline_event.h"
 #include "./timeline_notifications.h"
 #include "./types.h"
 #include "./websocket_client.h"
 
 #include "Poco/Activity.h"
+#include "Poco/Event.h"
 #include "Poco/LocalDateTime.h"
 #include "Poco/Timestamp.h"
 #include "Poco/Util/Timer.h"
 
 namespace toggl {
 
-class Database;
 class TimelineUploader;
+class UserSnapshot;
 class WindowChangeRecorder;
 
 class UIElements {
@@ -79,6 +83,61 @@ class UIElements {
     bool display_unsynced_items;
 };
 
+// Views of the user data that the time entry list, timer, selects
+// and autocompletes are rendered from. Never changed once published,
+// so that rendering doesn't need to lock the user data.
+class RenderSnapshot {
+ public:
+    RenderSnapshot()
+        : Revision(0)
+    , HasLoadedMore(false)
+    , Tzd(0)
+    , Day(0)
+    , Minute(0)
+    , Parts(0)
+    , UnsyncedItemCount(0) {}
+
+    // Parts of the views, built only when they're rendered
+    static const Poco::UInt64 kTimeEntries = 1 << 0;
+    static const Poco::UInt64 kRunningEntry = 1 << 1;
+    static const Poco::UInt64 kUnsyncedItems = 1 << 2;
+    static const Poco::UInt64 kWorkspaces = 1 << 3;
+    static const Poco::UInt64 kClients = 1 << 4;
+    static const Poco::UInt64 kTimeEntryAutocomplete = 1 << 5;
+    static const Poco::UInt64 kMinitimerAutocomplete = 1 << 6;
+    static const Poco::UInt64 kProjectAutocomplete = 1 << 7;
+
+    // Parts needed for rendering the elements
+    static Poco::UInt64 PartsFor(const UIElements &elements);
+
+    // What the views were made of. The views are rebuilt
+    // when any of these have changed.
+    Poco::UInt64 Revision;
+    bool HasLoadedMore;
+    std::string TimeOfDayFormat;
+    std::string DurationFormat;
+    int Tzd;
+    Poco::Int64 Day;
+    Poco::Int64 Minute;
+
+    bool SameSource(const RenderSnapshot &other) const;
+
+    Poco::UInt64 Parts;
+    Poco::Int64 UnsyncedItemCount;
+    view::TimeEntry RunningEntry;
+    std::vector<view::TimeEntry> TimeEntries;
+    std::vector<view::Generic> Workspaces;
+    std::vector<view::Generic> Clients;
+    std::vector<view::Autocomplete> TimeEntryAutocompletes;
+    std::vector<view::Autocomplete> MinitimerAutocompletes;
+    std::vector<view::Autocomplete> ProjectAutocompletes;
+
+    // What the autocompletes are queried from, by kind
+    static const Poco::UInt64 kAutocompleteKinds = 3;
+    std::shared_ptr<const AutocompleteIndex>
+    AutocompleteIndexes[kAutocompleteKinds];
+};
+
 class Context : public TimelineDatasource {
  public:
     Context(
@@ -100,8 +159,9 @@ class Context : public TimelineDatasource {
     void TimelineUpdateServerSettings();
     error SendFeedback(Feedback);
 
-    // Load model update from JSON string (from WebSocket)
-    error LoadUpdateFromJSONString(const std::string json);
+    // Queue model update parsed from JSON (from WebSocket),
+    // updates are applied in batches
+    error LoadUpdateFromJSON(const Json::Value &update);
 
     void SetWebSocketClientURL(const std::string value);
 
@@ -362,6 +422,12 @@ class Context : public TimelineDatasource {
     error DefaultPID(Poco::UInt64 *result);
     error DefaultTID(Poco::UInt64 *result);
 
+    error AutocompleteQuery(
+        const Poco::UInt64 kind,
+        const std::string text,
+        const Poco::UInt64 limit,
+        std::vector<view::Autocomplete> *result);
+
     void SearchHelpArticles(
         const std::string keywords);
 
@@ -397,9 +463,22 @@ class Context : public TimelineDatasource {
     error OpenReportsInBrowser();
 
     void SetIdleSeconds(const Poco::UInt64 idle_seconds) {
+        {
+            Poco::Mutex::ScopedLock lock(idle_seconds_m_);
+            idle_seconds_ = idle_seconds;
+        }
         idle_.SetIdleSeconds(idle_seconds, user_);
     }
 
+    // Last background database maintenance, for debugging
+    std::string DatabaseMaintenanceReport();
+
+    // Write pending saves now, instead of waiting for the persister
+    error Flush();
+
+    // Number of saves written to database, for debugging
+    Poco::UInt64 SavesWritten();
+
     void LoadMore();
 
     static void SetLogPath(const std::string path);
@@ -433,9 +512,8 @@ class Context : public TimelineDatasource {
         const int64_t promotion_response);
 
  protected:
-    void uiUpdaterActivity();
     void checkReminders();
-    void reminderActivity();
+    void persisterActivity();
 
  private:
     error updateURL(std::string *result);
@@ -447,8 +525,19 @@ class Context : public TimelineDatasource {
 
     void sync(const bool full_sync);
 
+    // Saves are written behind by the persister thread, so that
+    // callers return as soon as the user data in memory is updated.
+    // Saves requested close together are written in one commit.
     error save(const bool push_changes = true);
 
+    // Writes what was requested to be saved, waiting for the
+    // persister if it's writing already. The user is locked only
+    // to copy what needs saving and to mark it saved afterwards.
+    error flush();
+    error writeSnapshot(
+        UserSnapshot *snapshot,
+        std::vector<ModelChange> *changes);
+
     void fetchUpdates();
 
     // timer_ callbacks
@@ -458,6 +547,8 @@ class Context : public TimelineDatasource {
     void onSwitchWebSocketOn(Poco::Util::TimerTask& task);  // NOLINT
     void onSwitchTimelineOff(Poco::Util::TimerTask& task);  // NOLINT
     void onSwitchTimelineOn(Poco::Util::TimerTask& task);  // NOLINT
+    void onSaveTimelineEvents(Poco::Util::TimerTask& task);  // NOLINT
+    void onLoadUpdates(Poco::Util::TimerTask& task);  // NOLINT
     void onFetchUpdates(Poco::Util::TimerTask& task);  // NOLINT
     void onPeriodicUpdateCheck(Poco::Util::TimerTask& task);  // NOLINT
     void onTimelineUpdateServerSettings(Poco::Util::TimerTask& task);  // NOLINT
@@ -466,12 +557,22 @@ class Context : public TimelineDatasource {
     void onTrackSettingsUsage(Poco::Util::TimerTask& task);  // NOLINT
     void onWake(Poco::Util::TimerTask& task);  // NOLINT
     void onLoadMore(Poco::Util::TimerTask& task); // NOLINT
+    void onDatabaseMaintenance(Poco::Util::TimerTask& task);  // NOLINT
+    void onLoadRemainingUserData(Poco::Util::TimerTask& task);  // NOLINT
+    void onRenderStale(Poco::Util::TimerTask& task);  // NOLINT
+    void onUIUpdate(Poco::Util::TimerTask& task);  // NOLINT
+    void onReminders(Poco::Util::TimerTask& task);  // NOLINT
 
     void startPeriodicUpdateCheck();
     void executeUpdateCheck();
 
     void startPeriodicSync();
 
+    void startPeriodicUIUpdate();
+    void startPeriodicReminders();
+
+    void scheduleDatabaseMaintenance(const Poco::UInt64 seconds);
+
     void setUser(User *value, const bool user_logged_in = false);
 
     void switchWebSocketOff();
@@ -492,6 +593,17 @@ class Context : public TimelineDatasource {
 
     void updateUI(const UIElements &elements);
 
+    // Latest views of the user data, rebuilt first if they're out of
+    // date. Doesn't wait for user_m_ if there's something to render:
+    // while user data is being changed, what was published last is
+    // returned and the elements are rendered again a moment later.
+    std::shared_ptr<const RenderSnapshot> renderSnapshot(
+        const UIElements &elements);
+
+    // Builds the parts of the views that are missing or
+    // out of date. user_m_ must be locked.
+    void refreshRenderSnapshot(const Poco::UInt64 parts);
+
     error displayError(const error err);
 
     void scheduleSync();
@@ -500,10 +612,6 @@ class Context : public TimelineDatasource {
 
     int nextSyncIntervalSeconds() const;
 
-    bool isPostponed(
-        const Poco::Timestamp value,
-        const Poco::Timestamp::TimeDiff throttleMicros) const;
-
     Poco::Timestamp postpone(
         const Poco::Timestamp::TimeDiff throttleMicros) const;
 
@@ -512,6 +620,16 @@ class Context : public TimelineDatasource {
 
     error downloadUpdate();
 
+    void scheduleSaveTimelineEvents(const Poco::Timestamp at);
+    error saveTimelineEvents();
+
+    void scheduleLoadUpdates(const Poco::Timestamp at);
+    error loadUpdates();
+
+    // Loads the user data left out at startup, if any. Runs on the
+    // timer thread before anything that merges in server data.
+    error loadRemainingUserData();
+
     void stopActivities();
 
     error offerBetaChannel(bool *did_offer);
@@ -549,7 +667,9 @@ class Context : public TimelineDatasource {
 
     error pullWorkspacePreferences(TogglClient* https_client);
     error pullWorkspacePreferences(TogglClient* https_client,
-                                   Workspace *workspace, std::string* json);
+                                   const std::string &api_token,
+                                   const Poco::UInt64 workspace_id,
+                                   std::string* json);
 
     error pushObmAction();
 
@@ -563,13 +683,25 @@ class Context : public TimelineDatasource {
 
     Poco::Mutex db_m_;
     Database *db_;
+    DatabaseMaintenance last_database_maintenance_;
 
     Poco::Mutex user_m_;
     User *user_;
 
+    // Views of user_ and the elements that were rendered
+    // from out of date views, to be rendered again
+    Poco::Mutex render_snapshot_m_;
+    std::shared_ptr<const RenderSnapshot> render_snapshot_;
+    UIElements stale_render_;
+    bool stale_render_scheduled_;
+
     Poco::Mutex ws_client_m_;
     WebSocketClient ws_client_;
 
+    // Websocket updates waiting to be applied
+    Poco::Mutex websocket_updates_m_;
+    std::vector<Json::Value> websocket_updates_;
+
     Poco::Mutex timeline_uploader_m_;
     TimelineUploader *timeline_uploader_;
 
@@ -580,15 +712,13 @@ class Context : public TimelineDatasource {
 
     Feedback feedback_;
 
-    // Tasks are scheduled at:
-    Poco::Timestamp next_sync_at_;
-    Poco::Timestamp next_push_changes_at_;
-    Poco::Timestamp next_fetch_updates_at_;
-    Poco::Timestamp next_update_timeline_settings_at_;
-    Poco::Timestamp next_wake_at_;
-
     // Schedule tasks using a timer:
     Poco::Mutex timer_m_;
+
+    // Throttled jobs, one pending run of each. Declared before
+    // the timer, so that it outlives the timer thread.
+    TaskScheduler scheduler_;
+
     Poco::Util::Timer timer_;
 
     class GUI ui_;
@@ -599,6 +729,10 @@ class Context : public TimelineDatasource {
 
     Idle idle_;
 
+    // Set from the UI, read by database maintenance
+    Poco::Mutex idle_seconds_m_;
+    Poco::UInt64 idle_seconds_;
+
     Poco::UInt64 last_sync_started_;
     Poco::Int64 sync_interval_seconds_;
     Poco::UInt64 last_tracking_reminder_time_;
@@ -611,11 +745,24 @@ class Context : public TimelineDatasource {
 
     bool quit_;
 
-    Poco::Mutex ui_updater_m_;
-    Poco::Activity<Context> ui_updater_;
+    // Date header duration of the running entry, as last rendered
+    std::string ui_running_time_;
+
+    Poco::Mutex persister_m_;
+    Poco::Activity<Context> persister_;
 
-    Poco::Mutex reminder_m_;
-    Poco::Activity<Context> reminder_;
+    // Set when a save is requested, to wake up the persister
+    Poco::Event save_requested_;
+
+    // Held while a save is written, so that flush() waits for
+    // it. Taken before user_m_, to delete the user only when no
+    // save of it is being written.
+    Poco::Mutex flush_m_;
+    Poco::UInt64 saves_written_;
+
+    Poco::Mutex pending_save_m_;
+    bool pending_save_;
+    bool pending_save_push_changes_;
 
     Analytics analytics_;
 
@@ -634,7 +781,9 @@ class Context : public TimelineDatasource {
 
 void on_websocket_message(
     void *context,
-    std::string json);
+    const Json::Value &update);
+
+void on_websocket_missed_message(void *context);
 
 }  // namespace toggl
 
@@ -4,6 +4,7 @@
 
 #include "../src/database.h"
 
+#include <algorithm>
 #include <limits>
 #include <string>
 #include <vector>
@@ -11,6 +12,7 @@
 #include "./autotracker.h"
 #include "./client.h"
 #include "./const.h"
+#include "./formatter.h"
 #include "./migrations.h"
 #include "./obm_action.h"
 #include "./project.h"
@@ -63,7 +65,16 @@ Database::Database(const std::string db_path)
         }
     }
 
-    error err = setJournalMode("wal");
+    // Old time entries are purged and free pages reclaimed by
+    // Maintain() in the background. New databases get incremental
+    // auto-vacuum right away, existing ones are converted there.
+    error err = execute("PRAGMA auto_vacuum=INCREMENTAL");
+    if (err != noError) {
+        logger().error("failed to set auto vacuum: " + err);
+        // but will continue, its not vital
+    }
+
+    err = setJournalMode("wal");
     if (err != noError) {
         logger().error("Failed to set journal mode to wal!");
         return;
@@ -87,26 +98,6 @@ Database::Database(const std::string db_path)
         return;
     }
 
-    // Remove Time Entries older than 30 days from local db
-    Poco::LocalDateTime today;
-
-    Poco::LocalDateTime start =
-        today - Poco::Timespan(30 * Poco::Timespan::DAYS);
-
-    err = deleteAllFromTableByDate(
-        "time_entries", start.timestamp());
-
-    if (err != noError) {
-        logger().error("failed to clean Up Data: " + err);
-        // but will continue, its not vital
-    }
-
-    err = vacuum();
-    if (err != noError) {
-        logger().error("failed to vacuum: " + err);
-        // but will continue, its not vital
-    }
-
     Poco::Stopwatch stopwatch;
     stopwatch.start();
 
@@ -128,6 +119,12 @@ Database::Database(const std::string db_path)
 }
 
 Database::~Database() {
+    for (std::map<std::string, sqlite3_stmt *>::iterator it =
+        statements_.begin(); it != statements_.end(); ++it) {
+        sqlite3_finalize(it->second);
+    }
+    statements_.clear();
+
     if (session_) {
         delete session_;
         session_ = nullptr;
@@ -226,13 +223,44 @@ error Database::deleteAllFromTableByUID(
     return last_error("deleteAllFromTableByUID");
 }
 
-error Database::deleteAllFromTableByDate(
-    const std::string table_name,
-    const Poco::Timestamp &time) {
+error Database::setKeptTimeEntries(const std::set<Poco::Int64> &local_ids) {
+    try {
+        Poco::Mutex::ScopedLock lock(session_m_);
 
-    if (table_name.empty()) {
-        return error("Cannot delete from table without table name");
+        poco_check_ptr(session_);
+
+        *session_ << "create temp table if not exists kept_time_entries("
+                  "local_id integer primary key)", now;
+        *session_ << "delete from kept_time_entries", now;
+
+        session_->begin();
+        for (std::set<Poco::Int64>::const_iterator it = local_ids.begin();
+                it != local_ids.end(); it++) {
+            prepared("insert into kept_time_entries(local_id) "
+                     "values(:local_id)")
+            .Bind(*it)
+            .Execute();
+        }
+        session_->commit();
+    } catch(const Poco::Exception& exc) {
+        if (session_->isTransaction()) {
+            session_->rollback();
+        }
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
     }
+    return last_error("setKeptTimeEntries");
+}
+
+error Database::purgeTimeEntries(
+    const Poco::Timestamp &time,
+    const Poco::UInt64 limit,
+    Poco::UInt64 *deleted) {
+
+    poco_check_ptr(deleted);
 
     const Poco::Int64 stopTime = time.epochTime();
 
@@ -241,11 +269,16 @@ error Database::deleteAllFromTableByDate(
 
         poco_check_ptr(session_);
 
-        *session_ <<
-                  "delete from " + table_name + " where "
-                  "id NOT NULL and stop < :stop",
-                  useRef(stopTime),
-                  now;
+        prepared("delete from time_entries where rowid in ("
+                 "select rowid from time_entries where "
+                 "id NOT NULL and stop < :stop and local_id not in ("
+                 "select local_id from kept_time_entries) limit :limit)")
+        .Bind(stopTime)
+        .Bind(limit)
+        .Execute();
+
+        *deleted = sqlite3_changes(
+            Poco::Data::SQLite::Utility::dbHandle(*session_));
     } catch(const Poco::Exception& exc) {
         return exc.displayText();
     } catch(const std::exception& ex) {
@@ -253,7 +286,7 @@ error Database::deleteAllFromTableByDate(
     } catch(const std::string& ex) {
         return ex;
     }
-    return last_error("deleteAllFromTableByDate");
+    return last_error("purgeTimeEntries");
 }
 
 error Database::journalMode(std::string *mode) {
@@ -317,6 +350,172 @@ error Database::vacuum() {
     return last_error("vacuum");
 }
 
+error Database::pragma(const std::string name, Poco::Int64 *value) {
+    try {
+        Poco::Mutex::ScopedLock lock(session_m_);
+
+        poco_check_ptr(session_);
+        poco_check_ptr(value);
+
+        *session_ <<
+                  "PRAGMA " + name,
+                  into(*value),
+                  now;
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
+    }
+    return last_error("pragma " + name);
+}
+
+error Database::incrementalVacuum(const Poco::Int64 pages) {
+    try {
+        Poco::Mutex::ScopedLock lock(session_m_);
+
+        poco_check_ptr(session_);
+
+        std::stringstream ss;
+        ss << "PRAGMA incremental_vacuum(" << pages << ")";
+
+        // Frees one page per step, so it's run through sqlite3_exec
+        // which steps until done
+        char *message = nullptr;
+        int rc = sqlite3_exec(
+            Poco::Data::SQLite::Utility::dbHandle(*session_),
+            ss.str().c_str(), nullptr, nullptr, &message);
+        if (rc != SQLITE_OK) {
+            error err(message ? message : "unknown error");
+            sqlite3_free(message);
+            return error("incrementalVacuum: " + err);
+        }
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
+    }
+    return noError;
+}
+
+error Database::checkpoint() {
+    // Passive, so it does not wait for readers or writers
+    return execute("PRAGMA wal_checkpoint(PASSIVE)");
+}
+
+error Database::Maintain(
+    const Poco::Timestamp::TimeDiff budget_micros,
+    const Poco::Timestamp &purge_before,
+    const std::set<Poco::Int64> &keep_time_entries,
+    DatabaseMaintenance *result) {
+
+    error err = PurgeTimeEntries(
+        budget_micros, purge_before, keep_time_entries, result);
+    if (err != noError) {
+        return err;
+    }
+    return Reclaim(budget_micros, result);
+}
+
+error Database::PurgeTimeEntries(
+    const Poco::Timestamp::TimeDiff budget_micros,
+    const Poco::Timestamp &purge_before,
+    const std::set<Poco::Int64> &keep_time_entries,
+    DatabaseMaintenance *result) {
+
+    poco_check_ptr(result);
+
+    *result = DatabaseMaintenance();
+    result->started.update();
+
+    bool in_budget(true);
+
+    // Remove old time entries from local db,
+    // except the ones still in use
+    error err = setKeptTimeEntries(keep_time_entries);
+    while (err == noError
+            && (in_budget = !result->started.isElapsed(budget_micros))) {
+        Poco::UInt64 deleted(0);
+        err = purgeTimeEntries(
+            purge_before, kDatabasePurgeChunkRows, &deleted);
+        result->rows_purged += deleted;
+        if (deleted < kDatabasePurgeChunkRows) {
+            break;
+        }
+    }
+
+    result->complete = (err == noError) && in_budget;
+    result->ended.update();
+
+    return err;
+}
+
+error Database::Reclaim(
+    const Poco::Timestamp::TimeDiff budget_micros,
+    DatabaseMaintenance *result) {
+
+    poco_check_ptr(result);
+
+    error err = noError;
+    bool in_budget(result->complete);
+
+    // Databases created without incremental auto-vacuum need
+    // one full vacuum to switch, which can't be split up
+    Poco::Int64 auto_vacuum(0);
+    err = pragma("auto_vacuum", &auto_vacuum);
+    if (err == noError && auto_vacuum != 2) {
+        logger().debug("Switching to incremental auto vacuum");
+        err = execute("PRAGMA auto_vacuum=INCREMENTAL");
+        if (err == noError) {
+            err = vacuum();
+        }
+    }
+
+    Poco::Int64 free_pages(0);
+    if (err == noError) {
+        err = pragma("freelist_count", &free_pages);
+    }
+    Poco::Int64 left(free_pages);
+    while (err == noError && left > 0
+            && (in_budget = !result->started.isElapsed(budget_micros))) {
+        Poco::Int64 before(left);
+        err = incrementalVacuum(kDatabaseVacuumChunkPages);
+        if (err == noError) {
+            err = pragma("freelist_count", &left);
+        }
+        if (left >= before) {
+            logger().warning("Incremental vacuum did not free pages");
+            break;
+        }
+    }
+    result->pages_reclaimed = free_pages - left;
+
+    if (err == noError) {
+        err = checkpoint();
+    }
+
+    result->complete = (err == noError) && in_budget;
+    result->ended.update();
+
+    logger().debug("Maintenance " + result->String());
+
+    return err;
+}
+
+std::string DatabaseMaintenance::String() const {
+    std::stringstream ss;
+    ss << "started=" << Formatter::Format8601(started)
+       << " ended=" << Formatter::Format8601(ended)
+       << " elapsed=" << (ended - started) / 1000 << "ms"
+       << " rows_purged=" << rows_purged
+       << " pages_reclaimed=" << pages_reclaimed
+       << " complete=" << complete;
+    return ss.str();
+}
+
 Poco::Logger &Database::logger() const {
     return Poco::Logger::get("database");
 }
@@ -343,11 +542,10 @@ error Database::DeleteFromTable(
         Poco::Mutex::ScopedLock lock(session_m_);
         poco_check_ptr(session_);
 
-        *session_ <<
-                  "delete from " + table_name +
-                  " where local_id = :local_id",
-                  useRef(local_id),
-                  now;
+        prepared("delete from " + table_name +
+                 " where local_id = :local_id")
+        .Bind(local_id)
+        .Execute();
     } catch(const Poco::Exception& exc) {
         return exc.displayText();
     } catch(const std::exception& ex) {
@@ -370,13 +568,62 @@ error Database::last_error(const std::string was_doing) {
     return noError;
 }
 
+void PreparedStatement::Execute() {
+    sqlite3 *db = sqlite3_db_handle(stmt_);
+    int rc = sqlite3_step(stmt_);
+    std::string message;
+    if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+        message = sqlite3_errmsg(db);
+    }
+    sqlite3_reset(stmt_);
+    sqlite3_clear_bindings(stmt_);
+    if (!message.empty()) {
+        Poco::Data::SQLite::Utility::throwException(rc, message);
+    }
+}
+
+PreparedStatement Database::prepared(const std::string &sql) {
+    poco_check_ptr(session_);
+
+    std::map<std::string, sqlite3_stmt *>::const_iterator it =
+        statements_.find(sql);
+    if (it != statements_.end()) {
+        return PreparedStatement(it->second);
+    }
+
+    sqlite3_stmt *stmt = nullptr;
+    int rc = sqlite3_prepare_v2(
+        Poco::Data::SQLite::Utility::dbHandle(*session_),
+        sql.c_str(),
+        static_cast<int>(sql.size()),
+        &stmt,
+        nullptr);
+    if (rc != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        Poco::Data::SQLite::Utility::throwException(
+            rc,
+            Poco::Data::SQLite::Utility::lastError(*session_));
+    }
+    statements_[sql] = stmt;
+    return PreparedStatement(stmt);
+}
+
+Poco::Int64 Database::lastInsertRowID() {
+    poco_check_ptr(session_);
+
+    return sqlite3_last_insert_rowid(
+        Poco::Data::SQLite::Utility::dbHandle(*session_));
+}
+
 std::string Database::GenerateGUID() {
     Poco::UUIDGenerator& generator = Poco::UUIDGenerator::defaultGenerator();
     Poco::UUID uuid(generator.createRandom());
     return uuid.toString();
 }
 
-error Database::LoadCurrentUser(User *user) {
+error Database::LoadCurrentUser(
+    User *user,
+    const Poco::UInt64 since) {
     poco_check_ptr(user);
 
     logger().debug("LoadCurrentUser");
@@ -394,7 +641,132 @@ error Database::LoadCurrentUser(User *user) {
         return noError;
     }
     user->SetAPIToken(api_token);
-    return LoadUserByID(uid, user);
+
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+
+    err = loadUser(uid, user);
+    if (err != noError) {
+        return err;
+    }
+    if (!user->ID()) {
+        return noError;
+    }
+
+    err = loadWorkspaces(user->ID(), &user->related.Workspaces);
+    if (err != noError) {
+        return err;
+    }
+
+    err = loadClients(user->ID(), &user->related.Clients);
+    if (err != noError) {
+        return err;
+    }
+
+    std::stringstream filter;
+    filter << "(start >= " << since << " OR duration < 0)";
+
+    // Along with the projects and tasks of the loaded time entries,
+    // so those show their labels right away
+    std::stringstream used;
+    used << "FROM time_entries WHERE uid = " << user->ID()
+         << " AND " << filter.str();
+
+    err = loadProjects(user->ID(), &user->related.Projects,
+                       "(active = 1 OR id IN (SELECT pid " + used.str()
+                       + ") OR guid IN (SELECT project_guid "
+                       + used.str() + "))");
+    if (err != noError) {
+        return err;
+    }
+
+    err = loadTasks(user->ID(), &user->related.Tasks,
+                    "id IN (SELECT tid " + used.str() + ")");
+    if (err != noError) {
+        return err;
+    }
+
+    err = loadTimeEntries(user->ID(), &user->related.TimeEntries,
+                          filter.str());
+    if (err != noError) {
+        return err;
+    }
+
+    user->related.Reindex();
+    user->SetPartialDataSince(since);
+
+    stopwatch.stop();
+    std::stringstream ss;
+    ss << "Recent user data loaded in "
+       << stopwatch.elapsed() / 1000 << " ms";
+    logger().debug(ss.str());
+
+    return noError;
+}
+
+error Database::LoadUserRemainingData(
+    const Poco::UInt64 &UID,
+    const Poco::UInt64 since,
+    RelatedData *related) {
+
+    if (!UID) {
+        return error("Cannot load user data without an user ID");
+    }
+
+    poco_check_ptr(related);
+
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+
+    error err = loadProjects(UID, &related->Projects, "active = 0");
+    if (err != noError) {
+        return err;
+    }
+
+    err = loadTasks(UID, &related->Tasks);
+    if (err != noError) {
+        return err;
+    }
+
+    err = loadTags(UID, &related->Tags);
+    if (err != noError) {
+        return err;
+    }
+
+    std::stringstream filter;
+    filter << "start < " << since << " AND duration >= 0";
+    err = loadTimeEntries(UID, &related->TimeEntries, filter.str());
+    if (err != noError) {
+        return err;
+    }
+
+    err = loadAutotrackerRules(UID, &related->AutotrackerRules);
+    if (err != noError) {
+        return err;
+    }
+
+    err = loadTimelineEvents(UID, &related->TimelineEvents);
+    if (err != noError) {
+        return err;
+    }
+
+    err = loadObmActions(UID, &related->ObmActions);
+    if (err != noError) {
+        return err;
+    }
+
+    err = loadObmExperiments(UID, &related->ObmExperiments);
+    if (err != noError) {
+        return err;
+    }
+
+    stopwatch.stop();
+    std::stringstream ss;
+    ss << "Remaining user data loaded in "
+       << stopwatch.elapsed() / 1000 << " ms";
+    logger().debug(ss.str());
+
+    return noError;
 }
 
 error Database::LoadSettings(Settings *settings) {
@@ -1087,6 +1459,8 @@ error Database::loadUsersRelatedData(User *user) {
         return err;
     }
 
+    user->related.Reindex();
+
     return noError;
 }
 
@@ -1094,13 +1468,38 @@ error Database::LoadUserByID(
     const Poco::UInt64 &UID,
     User *user) {
 
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+
+    error err = loadUser(UID, user);
+    if (err != noError) {
+        return err;
+    }
+    if (!user->ID()) {
+        return noError;
+    }
+
+    err = loadUsersRelatedData(user);
+    if (err != noError) {
+        return err;
+    }
+
+    stopwatch.stop();
+    std::stringstream ss;
+    ss << "User loaded in " << stopwatch.elapsed() / 1000 << " ms";
+    logger().debug(ss.str());
+
+    return noError;
+}
+
+error Database::loadUser(
+    const Poco::UInt64 &UID,
+    User *user) {
+
     if (!UID) {
         return error("Cannot load user by ID without an ID");
     }
 
-    Poco::Stopwatch stopwatch;
-    stopwatch.start();
-
     try {
         poco_check_ptr(user);
 
@@ -1175,16 +1574,6 @@ error Database::LoadUserByID(
     } catch(const std::string& ex) {
         return ex;
     }
-    error err = loadUsersRelatedData(user);
-    if (err != noError) {
-        return err;
-    }
-
-    stopwatch.stop();
-    std::stringstream ss;
-    ss << "User loaded in " << stopwatch.elapsed() / 1000 << " ms";
-    logger().debug(ss.str());
-
     return noError;
 }
 
@@ -1310,7 +1699,8 @@ error Database::loadClients(
 
 error Database::loadProjects(
     const Poco::UInt64 &UID,
-    std::vector<Project *> *list) {
+    std::vector<Project *> *list,
+    const std::string &filter) {
 
     if (!UID) {
         return error("Cannot load user projects without an user ID");
@@ -1328,7 +1718,8 @@ error Database::loadProjects(
                "SELECT local_id, id, uid, name, guid, wid, color, cid, "
                "active, billable, client_guid "
                "FROM projects "
-               "WHERE uid = :uid "
+               "WHERE uid = :uid " +
+               (filter.empty() ? "" : "AND " + filter + " ") +
                "ORDER BY name",
                useRef(UID);
         error err = last_error("loadProjects");
@@ -1389,7 +1780,8 @@ error Database::loadProjects(
 
 error Database::loadTasks(
     const Poco::UInt64 &UID,
-    std::vector<Task *> *list) {
+    std::vector<Task *> *list,
+    const std::string &filter) {
 
     if (!UID) {
         return error("Cannot load user tasks without an user ID");
@@ -1406,7 +1798,8 @@ error Database::loadTasks(
         select <<
                "SELECT local_id, id, uid, name, wid, pid, active "
                "FROM tasks "
-               "WHERE uid = :uid "
+               "WHERE uid = :uid " +
+               (filter.empty() ? "" : "AND " + filter + " ") +
                "ORDER BY name",
                useRef(UID);
         error err = last_error("loadTasks");
@@ -1747,7 +2140,8 @@ error Database::loadTimelineEvents(
 
 error Database::loadTimeEntries(
     const Poco::UInt64 &UID,
-    std::vector<TimeEntry *> *list) {
+    std::vector<TimeEntry *> *list,
+    const std::string &filter) {
 
     if (!UID) {
         return error("Cannot load user time entries without an user ID");
@@ -1767,7 +2161,8 @@ error Database::loadTimeEntries(
                "duration, tags, created_with, deleted_at, updated_at, "
                "project_guid, validation_error "
                "FROM time_entries "
-               "WHERE uid = :uid "
+               "WHERE uid = :uid " +
+               (filter.empty() ? "" : "AND " + filter + " ") +
                "ORDER BY start DESC",
                useRef(UID);
         error err = last_error("loadTimeEntries");
@@ -1901,6 +2296,7 @@ error Database::saveRelatedModels(
     const Poco::UInt64 UID,
     const std::string table_name,
     std::vector<T *> *list,
+    ModelIndex *index,
     std::vector<ModelChange> *changes) {
 
     if (!UID) {
@@ -1908,36 +2304,57 @@ error Database::saveRelatedModels(
     }
 
     poco_check_ptr(list);
+    poco_check_ptr(index);
     poco_check_ptr(changes);
 
-    typedef typename std::vector<T *>::iterator iterator;
+    // Visit only the models that were added or
+    // changed since the last save.
+    std::vector<T *> changed;
+    index->TakeChanged(&changed);
 
-    for (size_t i = 0; i < list->size(); i++) {
-        T *model = list->at(i);
+    bool purge(false);
+    for (size_t i = 0; i < changed.size(); i++) {
+        T *model = changed[i];
+        error err = noError;
         if (model->IsMarkedAsDeletedOnServer()) {
-            error err = DeleteFromTable(table_name, model->LocalID());
-            if (err != noError) {
-                return err;
+            err = DeleteFromTable(table_name, model->LocalID());
+            if (err == noError) {
+                changes->push_back(ModelChange(
+                    model->ModelName(),
+                    kChangeTypeDelete,
+                    model->ID(),
+                    model->GUID()));
+                purge = true;
+            }
+        } else {
+            model->SetUID(UID);
+            err = saveModel(model, changes);
+            if (err == noError && !model->NeedsToBeSaved()) {
+                // Saving may touch the model (for example,
+                // assign a GUID), which puts it back to journal
+                index->MarkSaved(model);
             }
-            changes->push_back(ModelChange(
-                model->ModelName(),
-                kChangeTypeDelete,
-                model->ID(),
-                model->GUID()));
-            continue;
         }
-        model->SetUID(UID);
-        error err = saveModel(model, changes);
         if (err != noError) {
+            // Keep unsaved models in the journal
+            for (size_t j = i; j < changed.size(); j++) {
+                index->MarkChanged(changed[j]);
+            }
             return err;
         }
     }
 
+    if (!purge) {
+        return noError;
+    }
+
     // Purge deleted models from memory
+    typedef typename std::vector<T *>::iterator iterator;
     iterator it = list->begin();
     while (it != list->end()) {
         T *model = *it;
         if (model->IsMarkedAsDeletedOnServer()) {
+            index->Remove(model);
             it = list->erase(it);
         } else {
             ++it;
@@ -1979,76 +2396,74 @@ error Database::saveModel(
             logger().debug(ss.str());
 
             if (model->ID()) {
-                *session_ <<
-                          "update time_entries set "
-                          "id = :id, uid = :uid, description = :description, "
-                          "wid = :wid, guid = :guid, pid = :pid, tid = :tid, "
-                          "billable = :billable, "
-                          "duronly = :duronly, "
-                          "ui_modified_at = :ui_modified_at, "
-                          "start = :start, stop = :stop, duration = :duration, "
-                          "tags = :tags, created_with = :created_with, "
-                          "deleted_at = :deleted_at, "
-                          "updated_at = :updated_at, "
-                          "project_guid = :project_guid, "
-                          "validation_error = :validation_error "
-                          "where local_id = :local_id",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Description()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          useRef(model->PID()),
-                          useRef(model->TID()),
-                          useRef(model->Billable()),
-                          useRef(model->DurOnly()),
-                          useRef(model->UIModifiedAt()),
-                          useRef(model->Start()),
-                          useRef(model->Stop()),
-                          useRef(model->DurationInSeconds()),
-                          useRef(model->Tags()),
-                          useRef(model->CreatedWith()),
-                          useRef(model->DeletedAt()),
-                          useRef(model->UpdatedAt()),
-                          useRef(model->ProjectGUID()),
-                          useRef(model->ValidationError()),
-                          useRef(model->LocalID()),
-                          now;
+                prepared("update time_entries set "
+                         "id = :id, uid = :uid, description = :description, "
+                         "wid = :wid, guid = :guid, pid = :pid, tid = :tid, "
+                         "billable = :billable, "
+                         "duronly = :duronly, "
+                         "ui_modified_at = :ui_modified_at, "
+                         "start = :start, stop = :stop, duration = :duration, "
+                         "tags = :tags, created_with = :created_with, "
+                         "deleted_at = :deleted_at, "
+                         "updated_at = :updated_at, "
+                         "project_guid = :project_guid, "
+                         "validation_error = :validation_error "
+                         "where local_id = :local_id")
+                .Bind(model->ID())
+                .Bind(model->UID())
+                .Bind(model->Description())
+                .Bind(model->WID())
+                .Bind(model->GUID())
+                .Bind(model->PID())
+                .Bind(model->TID())
+                .Bind(model->Billable())
+                .Bind(model->DurOnly())
+                .Bind(model->UIModifiedAt())
+                .Bind(model->Start())
+                .Bind(model->Stop())
+                .Bind(model->DurationInSeconds())
+                .Bind(model->Tags())
+                .Bind(model->CreatedWith())
+                .Bind(model->DeletedAt())
+                .Bind(model->UpdatedAt())
+                .Bind(model->ProjectGUID())
+                .Bind(model->ValidationError())
+                .Bind(model->LocalID())
+                .Execute();
             } else {
-                *session_ <<
-                          "update time_entries set "
-                          "uid = :uid, description = :description, wid = :wid, "
-                          "guid = :guid, pid = :pid, tid = :tid, "
-                          "billable = :billable, "
-                          "duronly = :duronly, "
-                          "ui_modified_at = :ui_modified_at, "
-                          "start = :start, stop = :stop, duration = :duration, "
-                          "tags = :tags, created_with = :created_with, "
-                          "deleted_at = :deleted_at, "
-                          "updated_at = :updated_at, "
-                          "project_guid = :project_guid, "
-                          "validation_error = :validation_error "
-                          "where local_id = :local_id",
-                          useRef(model->UID()),
-                          useRef(model->Description()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          useRef(model->PID()),
-                          useRef(model->TID()),
-                          useRef(model->Billable()),
-                          useRef(model->DurOnly()),
-                          useRef(model->UIModifiedAt()),
-                          useRef(model->Start()),
-                          useRef(model->Stop()),
-                          useRef(model->DurationInSeconds()),
-                          useRef(model->Tags()),
-                          useRef(model->CreatedWith()),
-                          useRef(model->DeletedAt()),
-                          useRef(model->UpdatedAt()),
-                          useRef(model->ProjectGUID()),
-                          useRef(model->ValidationError()),
-                          useRef(model->LocalID()),
-                          now;
+                prepared("update time_entries set "
+                         "uid = :uid, description = :description, wid = :wid, "
+                         "guid = :guid, pid = :pid, tid = :tid, "
+                         "billable = :billable, "
+                         "duronly = :duronly, "
+                         "ui_modified_at = :ui_modified_at, "
+                         "start = :start, stop = :stop, duration = :duration, "
+                         "tags = :tags, created_with = :created_with, "
+                         "deleted_at = :deleted_at, "
+                         "updated_at = :updated_at, "
+                         "project_guid = :project_guid, "
+                         "validation_error = :validation_error "
+                         "where local_id = :local_id")
+                .Bind(model->UID())
+                .Bind(model->Description())
+                .Bind(model->WID())
+                .Bind(model->GUID())
+                .Bind(model->PID())
+                .Bind(model->TID())
+                .Bind(model->Billable())
+                .Bind(model->DurOnly())
+                .Bind(model->UIModifiedAt())
+                .Bind(model->Start())
+                .Bind(model->Stop())
+                .Bind(model->DurationInSeconds())
+                .Bind(model->Tags())
+                .Bind(model->CreatedWith())
+                .Bind(model->DeletedAt())
+                .Bind(model->UpdatedAt())
+                .Bind(model->ProjectGUID())
+                .Bind(model->ValidationError())
+                .Bind(model->LocalID())
+                .Execute();
             }
             error err = last_error("saveTimeEntry");
             if (err != noError) {
@@ -2073,88 +2488,77 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().debug(ss.str());
             if (model->ID()) {
-                *session_ <<
-                          "insert into time_entries(id, uid, description, "
-                          "wid, guid, pid, tid, billable, "
-                          "duronly, ui_modified_at, "
-                          "start, stop, duration, "
-                          "tags, created_with, deleted_at, updated_at, "
-                          "project_guid, validation_error) "
-                          "values(:id, :uid, :description, :wid, "
-                          ":guid, :pid, :tid, :billable, "
-                          ":duronly, :ui_modified_at, "
-                          ":start, :stop, :duration, "
-                          ":tags, :created_with, :deleted_at, :updated_at, "
-                          ":project_guid, :validation_error)",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Description()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          useRef(model->PID()),
-                          useRef(model->TID()),
-                          useRef(model->Billable()),
-                          useRef(model->DurOnly()),
-                          useRef(model->UIModifiedAt()),
-                          useRef(model->Start()),
-                          useRef(model->Stop()),
-                          useRef(model->DurationInSeconds()),
-                          useRef(model->Tags()),
-                          useRef(model->CreatedWith()),
-                          useRef(model->DeletedAt()),
-                          useRef(model->UpdatedAt()),
-                          useRef(model->ProjectGUID()),
-                          useRef(model->ValidationError()),
-                          now;
+                prepared("insert into time_entries(id, uid, description, "
+                         "wid, guid, pid, tid, billable, "
+                         "duronly, ui_modified_at, "
+                         "start, stop, duration, "
+                         "tags, created_with, deleted_at, updated_at, "
+                         "project_guid, validation_error) "
+                         "values(:id, :uid, :description, :wid, "
+                         ":guid, :pid, :tid, :billable, "
+                         ":duronly, :ui_modified_at, "
+                         ":start, :stop, :duration, "
+                         ":tags, :created_with, :deleted_at, :updated_at, "
+                         ":project_guid, :validation_error)")
+                .Bind(model->ID())
+                .Bind(model->UID())
+                .Bind(model->Description())
+                .Bind(model->WID())
+                .Bind(model->GUID())
+                .Bind(model->PID())
+                .Bind(model->TID())
+                .Bind(model->Billable())
+                .Bind(model->DurOnly())
+                .Bind(model->UIModifiedAt())
+                .Bind(model->Start())
+                .Bind(model->Stop())
+                .Bind(model->DurationInSeconds())
+                .Bind(model->Tags())
+                .Bind(model->CreatedWith())
+                .Bind(model->DeletedAt())
+                .Bind(model->UpdatedAt())
+                .Bind(model->ProjectGUID())
+                .Bind(model->ValidationError())
+                .Execute();
             } else {
-                *session_ <<
-                          "insert into time_entries(uid, description, wid, "
-                          "guid, pid, tid, billable, "
-                          "duronly, ui_modified_at, "
-                          "start, stop, duration, "
-                          "tags, created_with, deleted_at, updated_at, "
-                          "project_guid, validation_error "
-                          ") values ("
-                          ":uid, :description, :wid, "
-                          ":guid, :pid, :tid, :billable, "
-                          ":duronly, :ui_modified_at, "
-                          ":start, :stop, :duration, "
-                          ":tags, :created_with, :deleted_at, :updated_at, "
-                          ":project_guid, :validation_error)",
-                          useRef(model->UID()),
-                          useRef(model->Description()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          useRef(model->PID()),
-                          useRef(model->TID()),
-                          useRef(model->Billable()),
-                          useRef(model->DurOnly()),
-                          useRef(model->UIModifiedAt()),
-                          useRef(model->Start()),
-                          useRef(model->Stop()),
-                          useRef(model->DurationInSeconds()),
-                          useRef(model->Tags()),
-                          useRef(model->CreatedWith()),
-                          useRef(model->DeletedAt()),
-                          useRef(model->UpdatedAt()),
-                          useRef(model->ProjectGUID()),
-                          useRef(model->ValidationError()),
-                          now;
+                prepared("insert into time_entries(uid, description, wid, "
+                         "guid, pid, tid, billable, "
+                         "duronly, ui_modified_at, "
+                         "start, stop, duration, "
+                         "tags, created_with, deleted_at, updated_at, "
+                         "project_guid, validation_error "
+                         ") values ("
+                         ":uid, :description, :wid, "
+                         ":guid, :pid, :tid, :billable, "
+                         ":duronly, :ui_modified_at, "
+                         ":start, :stop, :duration, "
+                         ":tags, :created_with, :deleted_at, :updated_at, "
+                         ":project_guid, :validation_error)")
+                .Bind(model->UID())
+                .Bind(model->Description())
+                .Bind(model->WID())
+                .Bind(model->GUID())
+                .Bind(model->PID())
+                .Bind(model->TID())
+                .Bind(model->Billable())
+                .Bind(model->DurOnly())
+                .Bind(model->UIModifiedAt())
+                .Bind(model->Start())
+                .Bind(model->Stop())
+                .Bind(model->DurationInSeconds())
+                .Bind(model->Tags())
+                .Bind(model->CreatedWith())
+                .Bind(model->DeletedAt())
+                .Bind(model->UpdatedAt())
+                .Bind(model->ProjectGUID())
+                .Bind(model->ValidationError())
+                .Execute();
             }
             error err = last_error("saveTimeEntry");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ <<
-                      "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveTimeEntry");
-            if (err != noError) {
-                return err;
-            }
-            model->SetLocalID(local_id);
+            model->SetLocalID(lastInsertRowID());
             changes->push_back(ModelChange(
                 model->ModelName(),
                 kChangeTypeInsert,
@@ -2220,29 +2624,28 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
 
-            *session_ <<
-                      "update timeline_events set "
-                      " guid = :guid, "
-                      " title = :title, "
-                      " filename = :filename, "
-                      " uid = :uid, "
-                      " start_time = :start_time, "
-                      " end_time = :end_time, "
-                      " idle = :idle, "
-                      " uploaded = :uploaded, "
-                      " chunked = :chunked "
-                      "where local_id = :local_id",
-                      useRef(model->GUID()),
-                      useRef(model->Title()),
-                      useRef(model->Filename()),
-                      useRef(model->UID()),
-                      useRef(start_time),
-                      useRef(end_time),
-                      useRef(model->Idle()),
-                      useRef(model->Uploaded()),
-                      useRef(model->Chunked()),
-                      useRef(model->LocalID()),
-                      now;
+            prepared("update timeline_events set "
+                     " guid = :guid, "
+                     " title = :title, "
+                     " filename = :filename, "
+                     " uid = :uid, "
+                     " start_time = :start_time, "
+                     " end_time = :end_time, "
+                     " idle = :idle, "
+                     " uploaded = :uploaded, "
+                     " chunked = :chunked "
+                     "where local_id = :local_id")
+            .Bind(model->GUID())
+            .Bind(model->Title())
+            .Bind(model->Filename())
+            .Bind(model->UID())
+            .Bind(start_time)
+            .Bind(end_time)
+            .Bind(model->Idle())
+            .Bind(model->Uploaded())
+            .Bind(model->Chunked())
+            .Bind(model->LocalID())
+            .Execute();
 
             error err = last_error("update timeline event");
             if (err != noError) {
@@ -2267,52 +2670,42 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
 
-            *session_ <<
-                      "insert into timeline_events("
-                      " guid, "
-                      " title, "
-                      " filename, "
-                      " uid, "
-                      " start_time, "
-                      " end_time, "
-                      " idle, "
-                      " uploaded, "
-                      " chunked "
-                      ") values ("
-                      " :guid, "
-                      " :title, "
-                      " :filename, "
-                      " :uid, "
-                      " :start_time, "
-                      " :end_time, "
-                      " :idle, "
-                      " :uploaded, "
-                      " :chunked "
-                      ")",
-                      useRef(model->GUID()),
-                      useRef(model->Title()),
-                      useRef(model->Filename()),
-                      useRef(model->UID()),
-                      useRef(start_time),
-                      useRef(end_time),
-                      useRef(model->Idle()),
-                      useRef(model->Uploaded()),
-                      useRef(model->Chunked()),
-                      now;
+            prepared("insert into timeline_events("
+                     " guid, "
+                     " title, "
+                     " filename, "
+                     " uid, "
+                     " start_time, "
+                     " end_time, "
+                     " idle, "
+                     " uploaded, "
+                     " chunked "
+                     ") values ("
+                     " :guid, "
+                     " :title, "
+                     " :filename, "
+                     " :uid, "
+                     " :start_time, "
+                     " :end_time, "
+                     " :idle, "
+                     " :uploaded, "
+                     " :chunked "
+                     ")")
+            .Bind(model->GUID())
+            .Bind(model->Title())
+            .Bind(model->Filename())
+            .Bind(model->UID())
+            .Bind(start_time)
+            .Bind(end_time)
+            .Bind(model->Idle())
+            .Bind(model->Uploaded())
+            .Bind(model->Chunked())
+            .Execute();
             error err = last_error("insert timeline event");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ <<
-                      "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("select last inserted timeline event ID");
-            if (err != noError) {
-                return err;
-            }
-            model->SetLocalID(local_id);
+            model->SetLocalID(lastInsertRowID());
             changes->push_back(ModelChange(
                 model->ModelName(),
                 kChangeTypeInsert,
@@ -2351,17 +2744,16 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
 
-            *session_ <<
-                      "update autotracker_settings set "
-                      "uid = :uid, term = :term, pid = :pid, "
-                      "tid = :tid "
-                      "where local_id = :local_id",
-                      useRef(model->UID()),
-                      useRef(model->Term()),
-                      useRef(model->PID()),
-                      useRef(model->TID()),
-                      useRef(model->LocalID()),
-                      now;
+            prepared("update autotracker_settings set "
+                     "uid = :uid, term = :term, pid = :pid, "
+                     "tid = :tid "
+                     "where local_id = :local_id")
+            .Bind(model->UID())
+            .Bind(model->Term())
+            .Bind(model->PID())
+            .Bind(model->TID())
+            .Bind(model->LocalID())
+            .Execute();
             error err = last_error("saveAutotrackerRule");
             if (err != noError) {
                 return err;
@@ -2385,28 +2777,18 @@ error Database::saveModel(
             ss << "Inserting autotracker rule " + model->String()
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
-            *session_ <<
-                      "insert into autotracker_settings(uid, term, pid, tid) "
-                      "values(:uid, :term, :pid, :tid)",
-                      useRef(model->UID()),
-                      useRef(model->Term()),
-                      useRef(model->PID()),
-                      useRef(model->TID()),
-                      now;
+            prepared("insert into autotracker_settings(uid, term, pid, tid) "
+                     "values(:uid, :term, :pid, :tid)")
+            .Bind(model->UID())
+            .Bind(model->Term())
+            .Bind(model->PID())
+            .Bind(model->TID())
+            .Execute();
             error err = last_error("saveAutotrackerRule");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ <<
-                      "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveAutotrackerRule");
-            if (err != noError) {
-                return err;
-            }
-            model->SetLocalID(local_id);
+            model->SetLocalID(lastInsertRowID());
             changes->push_back(ModelChange(
                 model->ModelName(),
                 kChangeTypeInsert,
@@ -2445,19 +2827,18 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
 
-            *session_ <<
-                      "update obm_actions set "
-                      "uid = :uid, "
-                      "experiment_id = :experiment_id, "
-                      "key = :key, "
-                      "value = :value "
-                      "where local_id = :local_id",
-                      useRef(model->UID()),
-                      useRef(model->ExperimentID()),
-                      useRef(model->Key()),
-                      useRef(model->Value()),
-                      useRef(model->LocalID()),
-                      now;
+            prepared("update obm_actions set "
+                     "uid = :uid, "
+                     "experiment_id = :experiment_id, "
+                     "key = :key, "
+                     "value = :value "
+                     "where local_id = :local_id")
+            .Bind(model->UID())
+            .Bind(model->ExperimentID())
+            .Bind(model->Key())
+            .Bind(model->Value())
+            .Bind(model->LocalID())
+            .Execute();
             error err = last_error("saveObmAction");
             if (err != noError) {
                 return err;
@@ -2481,28 +2862,18 @@ error Database::saveModel(
             ss << "Inserting OBM action " + model->String()
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
-            *session_ <<
-                      "insert into obm_actions(uid, experiment_id, key, value) "
-                      "values(:uid, :experiment_id, :key, :value)",
-                      useRef(model->UID()),
-                      useRef(model->ExperimentID()),
-                      useRef(model->Key()),
-                      useRef(model->Value()),
-                      now;
+            prepared("insert into obm_actions(uid, experiment_id, key, value) "
+                     "values(:uid, :experiment_id, :key, :value)")
+            .Bind(model->UID())
+            .Bind(model->ExperimentID())
+            .Bind(model->Key())
+            .Bind(model->Value())
+            .Execute();
             error err = last_error("saveObmAction");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ <<
-                      "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveObmAction");
-            if (err != noError) {
-                return err;
-            }
-            model->SetLocalID(local_id);
+            model->SetLocalID(lastInsertRowID());
             changes->push_back(ModelChange(
                 model->ModelName(),
                 kChangeTypeInsert,
@@ -2542,24 +2913,23 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
 
-            *session_ <<
-                      "update workspaces set "
-                      "id = :id, uid = :uid, name = :name, premium = :premium, "
-                      "only_admins_may_create_projects = "
-                      ":only_admins_may_create_projects, admin = :admin, "
-                      "is_business = :is_business, "
-                      "locked_time = :locked_time "
-                      "where local_id = :local_id",
-                      useRef(model->ID()),
-                      useRef(model->UID()),
-                      useRef(model->Name()),
-                      useRef(model->Premium()),
-                      useRef(model->OnlyAdminsMayCreateProjects()),
-                      useRef(model->Admin()),
-                      useRef(model->Business()),
-                      useRef(model->LockedTime()),
-                      useRef(model->LocalID()),
-                      now;
+            prepared("update workspaces set "
+                     "id = :id, uid = :uid, name = :name, premium = :premium, "
+                     "only_admins_may_create_projects = "
+                     ":only_admins_may_create_projects, admin = :admin, "
+                     "is_business = :is_business, "
+                     "locked_time = :locked_time "
+                     "where local_id = :local_id")
+            .Bind(model->ID())
+            .Bind(model->UID())
+            .Bind(model->Name())
+            .Bind(model->Premium())
+            .Bind(model->OnlyAdminsMayCreateProjects())
+            .Bind(model->Admin())
+            .Bind(model->Business())
+            .Bind(model->LockedTime())
+            .Bind(model->LocalID())
+            .Execute();
             error err = last_error("saveWorkspace");
             if (err != noError) {
                 return err;
@@ -2572,36 +2942,26 @@ error Database::saveModel(
             ss << "Inserting workspace " + model->String()
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
-            *session_ <<
-                      "insert into workspaces(id, uid, name, premium, "
-                      "only_admins_may_create_projects, admin, "
-                      "is_business, locked_time) "
-                      "values(:id, :uid, :name, :premium, "
-                      ":only_admins_may_create_projects, :admin, "
-                      ":is_business, :locked_time)",
-                      useRef(model->ID()),
-                      useRef(model->UID()),
-                      useRef(model->Name()),
-                      useRef(model->Premium()),
-                      useRef(model->OnlyAdminsMayCreateProjects()),
-                      useRef(model->Admin()),
-                      useRef(model->Business()),
-                      useRef(model->LockedTime()),
-                      now;
+            prepared("insert into workspaces(id, uid, name, premium, "
+                     "only_admins_may_create_projects, admin, "
+                     "is_business, locked_time) "
+                     "values(:id, :uid, :name, :premium, "
+                     ":only_admins_may_create_projects, :admin, "
+                     ":is_business, :locked_time)")
+            .Bind(model->ID())
+            .Bind(model->UID())
+            .Bind(model->Name())
+            .Bind(model->Premium())
+            .Bind(model->OnlyAdminsMayCreateProjects())
+            .Bind(model->Admin())
+            .Bind(model->Business())
+            .Bind(model->LockedTime())
+            .Execute();
             error err = last_error("saveWorkspace");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ <<
-                      "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveWorkspace");
-            if (err != noError) {
-                return err;
-            }
-            model->SetLocalID(local_id);
+            model->SetLocalID(lastInsertRowID());
             changes->push_back(ModelChange(
                 model->ModelName(), kChangeTypeInsert, model->ID(), ""));
         }
@@ -2647,29 +3007,27 @@ error Database::saveModel(
             logger().trace(ss.str());
 
             if (model->GUID().empty()) {
-                *session_ <<
-                          "update clients set "
-                          "id = :id, uid = :uid, name = :name, wid = :wid "
-                          "where local_id = :local_id",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          useRef(model->LocalID()),
-                          now;
+                prepared("update clients set "
+                         "id = :id, uid = :uid, name = :name, wid = :wid "
+                         "where local_id = :local_id")
+                .Bind(model->ID())
+                .Bind(model->UID())
+                .Bind(model->Name())
+                .Bind(model->WID())
+                .Bind(model->LocalID())
+                .Execute();
             } else {
-                *session_ <<
-                          "update clients set "
-                          "id = :id, uid = :uid, name = :name, guid = :guid, "
-                          "wid = :wid "
-                          "where local_id = :local_id",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->GUID()),
-                          useRef(model->WID()),
-                          useRef(model->LocalID()),
-                          now;
+                prepared("update clients set "
+                         "id = :id, uid = :uid, name = :name, guid = :guid, "
+                         "wid = :wid "
+                         "where local_id = :local_id")
+                .Bind(model->ID())
+                .Bind(model->UID())
+                .Bind(model->Name())
+                .Bind(model->GUID())
+                .Bind(model->WID())
+                .Bind(model->LocalID())
+                .Execute();
             }
             error err = last_error("saveClient");
             if (err != noError) {
@@ -2687,39 +3045,28 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
             if (model->GUID().empty()) {
-                *session_ <<
-                          "insert into clients(id, uid, name, wid) "
-                          "values(:id, :uid, :name, :wid)",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          now;
+                prepared("insert into clients(id, uid, name, wid) "
+                         "values(:id, :uid, :name, :wid)")
+                .Bind(model->ID())
+                .Bind(model->UID())
+                .Bind(model->Name())
+                .Bind(model->WID())
+                .Execute();
             } else {
-                *session_ <<
-                          "insert into clients(id, uid, name, guid, wid) "
-                          "values(:id, :uid, :name, :guid, :wid)",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->GUID()),
-                          useRef(model->WID()),
-                          now;
+                prepared("insert into clients(id, uid, name, guid, wid) "
+                         "values(:id, :uid, :name, :guid, :wid)")
+                .Bind(model->ID())
+                .Bind(model->UID())
+                .Bind(model->Name())
+                .Bind(model->GUID())
+                .Bind(model->WID())
+                .Execute();
             }
             error err = last_error("saveClient");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ <<
-                      "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveClient");
-            if (err != noError) {
-                return err;
-            }
-            model->SetLocalID(local_id);
+            model->SetLocalID(lastInsertRowID());
             changes->push_back(ModelChange(
                 model->ModelName(),
                 kChangeTypeInsert,
@@ -2769,84 +3116,80 @@ error Database::saveModel(
 
             if (model->ID()) {
                 if (model->GUID().empty()) {
-                    *session_ <<
-                              "update projects set "
-                              "id = :id, uid = :uid, name = :name, "
-                              "wid = :wid, color = :color, cid = :cid, "
-                              "active = :active, billable = :billable, "
-                              "client_guid = :client_guid "
-                              "where local_id = :local_id",
-                              useRef(model->ID()),
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              useRef(model->LocalID()),
-                              now;
+                    prepared("update projects set "
+                             "id = :id, uid = :uid, name = :name, "
+                             "wid = :wid, color = :color, cid = :cid, "
+                             "active = :active, billable = :billable, "
+                             "client_guid = :client_guid "
+                             "where local_id = :local_id")
+                    .Bind(model->ID())
+                    .Bind(model->UID())
+                    .Bind(model->Name())
+                    .Bind(model->WID())
+                    .Bind(model->Color())
+                    .Bind(model->CID())
+                    .Bind(model->Active())
+                    .Bind(model->Billable())
+                    .Bind(model->ClientGUID())
+                    .Bind(model->LocalID())
+                    .Execute();
                 } else {
-                    *session_ <<
-                              "update projects set "
-                              "id = :id, uid = :uid, name = :name, "
-                              "guid = :guid,"
-                              "wid = :wid, color = :color, cid = :cid, "
-                              "active = :active, billable = :billable, "
-                              "client_guid = :client_guid "
-                              "where local_id = :local_id",
-                              useRef(model->ID()),
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->GUID()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              useRef(model->LocalID()),
-                              now;
+                    prepared("update projects set "
+                             "id = :id, uid = :uid, name = :name, "
+                             "guid = :guid,"
+                             "wid = :wid, color = :color, cid = :cid, "
+                             "active = :active, billable = :billable, "
+                             "client_guid = :client_guid "
+                             "where local_id = :local_id")
+                    .Bind(model->ID())
+                    .Bind(model->UID())
+                    .Bind(model->Name())
+                    .Bind(model->GUID())
+                    .Bind(model->WID())
+                    .Bind(model->Color())
+                    .Bind(model->CID())
+                    .Bind(model->Active())
+                    .Bind(model->Billable())
+                    .Bind(model->ClientGUID())
+                    .Bind(model->LocalID())
+                    .Execute();
                 }
             } else {
                 if (model->GUID().empty()) {
-                    *session_ <<
-                              "update projects set "
-                              "uid = :uid, name = :name, "
-                              "wid = :wid, color = :color, cid = :cid, "
-                              "active = :active, billable = :billable, "
-                              "client_guid = :client_guid "
-                              "where local_id = :local_id",
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              useRef(model->LocalID()),
-                              now;
+                    prepared("update projects set "
+                             "uid = :uid, name = :name, "
+                             "wid = :wid, color = :color, cid = :cid, "
+                             "active = :active, billable = :billable, "
+                             "client_guid = :client_guid "
+                             "where local_id = :local_id")
+                    .Bind(model->UID())
+                    .Bind(model->Name())
+                    .Bind(model->WID())
+                    .Bind(model->Color())
+                    .Bind(model->CID())
+                    .Bind(model->Active())
+                    .Bind(model->Billable())
+                    .Bind(model->ClientGUID())
+                    .Bind(model->LocalID())
+                    .Execute();
                 } else {
-                    *session_ <<
-                              "update projects set "
-                              "uid = :uid, name = :name, guid = :guid,"
-                              "wid = :wid, color = :color, cid = :cid, "
-                              "active = :active, billable = :billable, "
-                              "client_guid = :client_guid "
-                              "where local_id = :local_id",
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->GUID()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              useRef(model->LocalID()),
-                              now;
+                    prepared("update projects set "
+                             "uid = :uid, name = :name, guid = :guid,"
+                             "wid = :wid, color = :color, cid = :cid, "
+                             "active = :active, billable = :billable, "
+                             "client_guid = :client_guid "
+                             "where local_id = :local_id")
+                    .Bind(model->UID())
+                    .Bind(model->Name())
+                    .Bind(model->GUID())
+                    .Bind(model->WID())
+                    .Bind(model->Color())
+                    .Bind(model->CID())
+                    .Bind(model->Active())
+                    .Bind(model->Billable())
+                    .Bind(model->ClientGUID())
+                    .Bind(model->LocalID())
+                    .Execute();
                 }
             }
             error err = last_error("saveProject");
@@ -2866,107 +3209,94 @@ error Database::saveModel(
             logger().debug(ss.str());
             if (model->ID()) {
                 if (model->GUID().empty()) {
-                    *session_ <<
-                              "insert into projects("
-                              "id, uid, name, wid, color, cid, active, "
-                              "is_private, billable, client_guid"
-                              ") values("
-                              ":id, :uid, :name, :wid, :color, :cid, :active, "
-                              ":is_private, :billable, :client_guid"
-                              ")",
-                              useRef(model->ID()),
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->IsPrivate()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              now;
+                    prepared("insert into projects("
+                             "id, uid, name, wid, color, cid, active, "
+                             "is_private, billable, client_guid"
+                             ") values("
+                             ":id, :uid, :name, :wid, :color, :cid, :active, "
+                             ":is_private, :billable, :client_guid"
+                             ")")
+                    .Bind(model->ID())
+                    .Bind(model->UID())
+                    .Bind(model->Name())
+                    .Bind(model->WID())
+                    .Bind(model->Color())
+                    .Bind(model->CID())
+                    .Bind(model->Active())
+                    .Bind(model->IsPrivate())
+                    .Bind(model->Billable())
+                    .Bind(model->ClientGUID())
+                    .Execute();
                 } else {
-                    *session_ <<
-                              "insert into projects("
-                              "id, uid, name, guid, wid, color, cid, "
-                              "active, is_private, "
-                              "billable, client_guid"
-                              ") values("
-                              ":id, :uid, :name, :guid, :wid, :color, :cid, "
-                              ":active, :is_private, "
-                              ":billable, :client_guid"
-                              ")",
-                              useRef(model->ID()),
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->GUID()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->IsPrivate()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              now;
+                    prepared("insert into projects("
+                             "id, uid, name, guid, wid, color, cid, "
+                             "active, is_private, "
+                             "billable, client_guid"
+                             ") values("
+                             ":id, :uid, :name, :guid, :wid, :color, :cid, "
+                             ":active, :is_private, "
+                             ":billable, :client_guid"
+                             ")")
+                    .Bind(model->ID())
+                    .Bind(model->UID())
+                    .Bind(model->Name())
+                    .Bind(model->GUID())
+                    .Bind(model->WID())
+                    .Bind(model->Color())
+                    .Bind(model->CID())
+                    .Bind(model->Active())
+                    .Bind(model->IsPrivate())
+                    .Bind(model->Billable())
+                    .Bind(model->ClientGUID())
+                    .Execute();
                 }
             } else {
                 if (model->GUID().empty()) {
-                    *session_ <<
-                              "insert into projects("
-                              "uid, name, wid, color, cid, active, "
-                              "is_private, billable, client_guid"
-                              ") values("
-                              ":uid, :name, :wid, :color, :cid, :active, "
-                              ":is_private, :billable, :client_guid"
-                              ")",
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->IsPrivate()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              now;
+                    prepared("insert into projects("
+                             "uid, name, wid, color, cid, active, "
+                             "is_private, billable, client_guid"
+                             ") values("
+                             ":uid, :name, :wid, :color, :cid, :active, "
+                             ":is_private, :billable, :client_guid"
+                             ")")
+                    .Bind(model->UID())
+                    .Bind(model->Name())
+                    .Bind(model->WID())
+                    .Bind(model->Color())
+                    .Bind(model->CID())
+                    .Bind(model->Active())
+                    .Bind(model->IsPrivate())
+                    .Bind(model->Billable())
+                    .Bind(model->ClientGUID())
+                    .Execute();
                 } else {
-                    *session_ <<
-                              "insert into projects("
-                              "uid, name, guid, wid, color, cid, "
-                              "active, is_private, billable, "
-                              "client_guid "
-                              ") values("
-                              ":uid, :name, :guid, :wid, :color, :cid, "
-                              ":active, :is_private, :billable, "
-                              ":client_guid "
-                              ")",
-                              useRef(model->UID()),
-                              useRef(model->Name()),
-                              useRef(model->GUID()),
-                              useRef(model->WID()),
-                              useRef(model->Color()),
-                              useRef(model->CID()),
-                              useRef(model->Active()),
-                              useRef(model->IsPrivate()),
-                              useRef(model->Billable()),
-                              useRef(model->ClientGUID()),
-                              now;
+                    prepared("insert into projects("
+                             "uid, name, guid, wid, color, cid, "
+                             "active, is_private, billable, "
+                             "client_guid "
+                             ") values("
+                             ":uid, :name, :guid, :wid, :color, :cid, "
+                             ":active, :is_private, :billable, "
+                             ":client_guid "
+                             ")")
+                    .Bind(model->UID())
+                    .Bind(model->Name())
+                    .Bind(model->GUID())
+                    .Bind(model->WID())
+                    .Bind(model->Color())
+                    .Bind(model->CID())
+                    .Bind(model->Active())
+                    .Bind(model->IsPrivate())
+                    .Bind(model->Billable())
+                    .Bind(model->ClientGUID())
+                    .Execute();
                 }
             }
             error err = last_error("saveProject");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ <<
-                      "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveProject");
-            if (err != noError) {
-                return err;
-            }
-            model->SetLocalID(local_id);
+            model->SetLocalID(lastInsertRowID());
             changes->push_back(ModelChange(
                 model->ModelName(),
                 kChangeTypeInsert,
@@ -3004,19 +3334,18 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
 
-            *session_ <<
-                      "update tasks set "
-                      "id = :id, uid = :uid, name = :name, wid = :wid, "
-                      "pid = :pid, active = :active "
-                      "where local_id = :local_id",
-                      useRef(model->ID()),
-                      useRef(model->UID()),
-                      useRef(model->Name()),
-                      useRef(model->WID()),
-                      useRef(model->PID()),
-                      useRef(model->Active()),
-                      useRef(model->LocalID()),
-                      now;
+            prepared("update tasks set "
+                     "id = :id, uid = :uid, name = :name, wid = :wid, "
+                     "pid = :pid, active = :active "
+                     "where local_id = :local_id")
+            .Bind(model->ID())
+            .Bind(model->UID())
+            .Bind(model->Name())
+            .Bind(model->WID())
+            .Bind(model->PID())
+            .Bind(model->Active())
+            .Bind(model->LocalID())
+            .Execute();
             error err = last_error("saveTask");
             if (err != noError) {
                 return err;
@@ -3029,30 +3358,20 @@ error Database::saveModel(
             ss << "Inserting task " + model->String()
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
-            *session_ <<
-                      "insert into tasks(id, uid, name, wid, pid, active) "
-                      "values(:id, :uid, :name, :wid, :pid, :active)",
-                      useRef(model->ID()),
-                      useRef(model->UID()),
-                      useRef(model->Name()),
-                      useRef(model->WID()),
-                      useRef(model->PID()),
-                      useRef(model->Active()),
-                      now;
+            prepared("insert into tasks(id, uid, name, wid, pid, active) "
+                     "values(:id, :uid, :name, :wid, :pid, :active)")
+            .Bind(model->ID())
+            .Bind(model->UID())
+            .Bind(model->Name())
+            .Bind(model->WID())
+            .Bind(model->PID())
+            .Bind(model->Active())
+            .Execute();
             error err = last_error("saveTask");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ <<
-                      "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveTask");
-            if (err != noError) {
-                return err;
-            }
-            model->SetLocalID(local_id);
+            model->SetLocalID(lastInsertRowID());
             changes->push_back(ModelChange(
                 model->ModelName(), kChangeTypeInsert, model->ID(), ""));
         }
@@ -3088,29 +3407,27 @@ error Database::saveModel(
             logger().trace(ss.str());
 
             if (model->GUID().empty()) {
-                *session_ <<
-                          "update tags set "
-                          "id = :id, uid = :uid, name = :name, wid = :wid "
-                          "where local_id = :local_id",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          useRef(model->LocalID()),
-                          now;
+                prepared("update tags set "
+                         "id = :id, uid = :uid, name = :name, wid = :wid "
+                         "where local_id = :local_id")
+                .Bind(model->ID())
+                .Bind(model->UID())
+                .Bind(model->Name())
+                .Bind(model->WID())
+                .Bind(model->LocalID())
+                .Execute();
             } else {
-                *session_ <<
-                          "update tags set "
-                          "id = :id, uid = :uid, name = :name, wid = :wid, "
-                          "guid = :guid "
-                          "where local_id = :local_id",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          useRef(model->LocalID()),
-                          now;
+                prepared("update tags set "
+                         "id = :id, uid = :uid, name = :name, wid = :wid, "
+                         "guid = :guid "
+                         "where local_id = :local_id")
+                .Bind(model->ID())
+                .Bind(model->UID())
+                .Bind(model->Name())
+                .Bind(model->WID())
+                .Bind(model->GUID())
+                .Bind(model->LocalID())
+                .Execute();
             }
             error err = last_error("saveTag");
             if (err != noError) {
@@ -3128,39 +3445,28 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
             if (model->GUID().empty()) {
-                *session_ <<
-                          "insert into tags(id, uid, name, wid) "
-                          "values(:id, :uid, :name, :wid)",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          now;
+                prepared("insert into tags(id, uid, name, wid) "
+                         "values(:id, :uid, :name, :wid)")
+                .Bind(model->ID())
+                .Bind(model->UID())
+                .Bind(model->Name())
+                .Bind(model->WID())
+                .Execute();
             } else {
-                *session_ <<
-                          "insert into tags(id, uid, name, wid, guid) "
-                          "values(:id, :uid, :name, :wid, :guid)",
-                          useRef(model->ID()),
-                          useRef(model->UID()),
-                          useRef(model->Name()),
-                          useRef(model->WID()),
-                          useRef(model->GUID()),
-                          now;
+                prepared("insert into tags(id, uid, name, wid, guid) "
+                         "values(:id, :uid, :name, :wid, :guid)")
+                .Bind(model->ID())
+                .Bind(model->UID())
+                .Bind(model->Name())
+                .Bind(model->WID())
+                .Bind(model->GUID())
+                .Execute();
             }
             error err = last_error("saveTag");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ <<
-                      "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveTag");
-            if (err != noError) {
-                return err;
-            }
-            model->SetLocalID(local_id);
+            model->SetLocalID(lastInsertRowID());
             changes->push_back(ModelChange(
                 model->ModelName(),
                 kChangeTypeInsert,
@@ -3220,33 +3526,32 @@ error Database::SaveUser(
                    << " in thread " << Poco::Thread::currentTid();
                 logger().trace(ss.str());
 
-                *session_ <<
-                          "update users set "
-                          "default_wid = :default_wid, "
-                          "since = :since, id = :id, fullname = :fullname, "
-                          "email = :email, record_timeline = :record_timeline, "
-                          "store_start_and_stop_time = "
-                          " :store_start_and_stop_time, "
-                          "timeofday_format = :timeofday_format, "
-                          "duration_format = :duration_format, "
-                          "offline_data = :offline_data, "
-                          "default_pid = :default_pid, "
-                          "default_tid = :default_tid "
-                          "where local_id = :local_id",
-                          useRef(user->DefaultWID()),
-                          useRef(user->Since()),
-                          useRef(user->ID()),
-                          useRef(user->Fullname()),
-                          useRef(user->Email()),
-                          useRef(user->RecordTimeline()),
-                          useRef(user->StoreStartAndStopTime()),
-                          useRef(user->TimeOfDayFormat()),
-                          useRef(user->DurationFormat()),
-                          useRef(user->OfflineData()),
-                          useRef(user->DefaultPID()),
-                          useRef(user->DefaultTID()),
-                          useRef(user->LocalID()),
-                          now;
+                prepared("update users set "
+                         "default_wid = :default_wid, "
+                         "since = :since, id = :id, fullname = :fullname, "
+                         "email = :email, record_timeline = :record_timeline, "
+                         "store_start_and_stop_time = "
+                         " :store_start_and_stop_time, "
+                         "timeofday_format = :timeofday_format, "
+                         "duration_format = :duration_format, "
+                         "offline_data = :offline_data, "
+                         "default_pid = :default_pid, "
+                         "default_tid = :default_tid "
+                         "where local_id = :local_id")
+                .Bind(user->DefaultWID())
+                .Bind(user->Since())
+                .Bind(user->ID())
+                .Bind(user->Fullname())
+                .Bind(user->Email())
+                .Bind(user->RecordTimeline())
+                .Bind(user->StoreStartAndStopTime())
+                .Bind(user->TimeOfDayFormat())
+                .Bind(user->DurationFormat())
+                .Bind(user->OfflineData())
+                .Bind(user->DefaultPID())
+                .Bind(user->DefaultTID())
+                .Bind(user->LocalID())
+                .Execute();
                 error err = last_error("SaveUser");
                 if (err != noError) {
                     session_->rollback();
@@ -3259,48 +3564,37 @@ error Database::SaveUser(
                 ss << "Inserting user " + user->String()
                    << " in thread " << Poco::Thread::currentTid();
                 logger().trace(ss.str());
-                *session_ <<
-                          "insert into users("
-                          "id, default_wid, since, fullname, email, "
-                          "record_timeline, store_start_and_stop_time, "
-                          "timeofday_format, duration_format, offline_data, "
-                          "default_pid, default_tid"
-                          ") values("
-                          ":id, :default_wid, :since, :fullname, "
-                          ":email, "
-                          ":record_timeline, :store_start_and_stop_time, "
-                          ":timeofday_format, :duration_format, :offline_data, "
-                          ":default_pid, :default_tid"
-                          ")",
-                          useRef(user->ID()),
-                          useRef(user->DefaultWID()),
-                          useRef(user->Since()),
-                          useRef(user->Fullname()),
-                          useRef(user->Email()),
-                          useRef(user->RecordTimeline()),
-                          useRef(user->StoreStartAndStopTime()),
-                          useRef(user->TimeOfDayFormat()),
-                          useRef(user->DurationFormat()),
-                          useRef(user->OfflineData()),
-                          useRef(user->DefaultPID()),
-                          useRef(user->DefaultTID()),
-                          now;
+                prepared("insert into users("
+                         "id, default_wid, since, fullname, email, "
+                         "record_timeline, store_start_and_stop_time, "
+                         "timeofday_format, duration_format, offline_data, "
+                         "default_pid, default_tid"
+                         ") values("
+                         ":id, :default_wid, :since, :fullname, "
+                         ":email, "
+                         ":record_timeline, :store_start_and_stop_time, "
+                         ":timeofday_format, :duration_format, :offline_data, "
+                         ":default_pid, :default_tid"
+                         ")")
+                .Bind(user->ID())
+                .Bind(user->DefaultWID())
+                .Bind(user->Since())
+                .Bind(user->Fullname())
+                .Bind(user->Email())
+                .Bind(user->RecordTimeline())
+                .Bind(user->StoreStartAndStopTime())
+                .Bind(user->TimeOfDayFormat())
+                .Bind(user->DurationFormat())
+                .Bind(user->OfflineData())
+                .Bind(user->DefaultPID())
+                .Bind(user->DefaultTID())
+                .Execute();
                 error err = last_error("SaveUser");
                 if (err != noError) {
                     session_->rollback();
                     return err;
                 }
-                Poco::Int64 local_id(0);
-                *session_ <<
-                          "select last_insert_rowid()",
-                          into(local_id),
-                          now;
-                err = last_error("SaveUser");
-                if (err != noError) {
-                    session_->rollback();
-                    return err;
-                }
-                user->SetLocalID(local_id);
+                user->SetLocalID(lastInsertRowID());
                 changes->push_back(ModelChange(
                     user->ModelName(),
                     kChangeTypeInsert,
@@ -3326,6 +3620,7 @@ error Database::SaveUser(
         error err = saveRelatedModels(user->ID(),
                                       "workspaces",
                                       &user->related.Workspaces,
+                                      &user->related.WorkspaceIndex,
                                       &workspace_changes);
         if (err != noError) {
             session_->rollback();
@@ -3347,6 +3642,7 @@ error Database::SaveUser(
         err = saveRelatedModels(user->ID(),
                                 "clients",
                                 &user->related.Clients,
+                                &user->related.ClientIndex,
                                 &client_changes);
         if (err != noError) {
             session_->rollback();
@@ -3368,6 +3664,7 @@ error Database::SaveUser(
         err = saveRelatedModels(user->ID(),
                                 "projects",
                                 &user->related.Projects,
+                                &user->related.ProjectIndex,
                                 &project_changes);
         if (err != noError) {
             session_->rollback();
@@ -3389,6 +3686,7 @@ error Database::SaveUser(
         err = saveRelatedModels(user->ID(),
                                 "tasks",
                                 &user->related.Tasks,
+                                &user->related.TaskIndex,
                                 &task_changes);
         if (err != noError) {
             session_->rollback();
@@ -3409,6 +3707,7 @@ error Database::SaveUser(
         err = saveRelatedModels(user->ID(),
                                 "tags",
                                 &user->related.Tags,
+                                &user->related.TagIndex,
                                 changes);
         if (err != noError) {
             session_->rollback();
@@ -3419,6 +3718,7 @@ error Database::SaveUser(
         err = saveRelatedModels(user->ID(),
                                 "time_entries",
                                 &user->related.TimeEntries,
+                                &user->related.TimeEntryIndex,
                                 changes);
         if (err != noError) {
             session_->rollback();
@@ -3429,6 +3729,7 @@ error Database::SaveUser(
         err = saveRelatedModels(user->ID(),
                                 "autotracker_settings",
                                 &user->related.AutotrackerRules,
+                                &user->related.AutotrackerRuleIndex,
                                 changes);
         if (err != noError) {
             session_->rollback();
@@ -3439,6 +3740,7 @@ error Database::SaveUser(
         err = saveRelatedModels(user->ID(),
                                 "obm_actions",
                                 &user->related.ObmActions,
+                                &user->related.ObmActionIndex,
                                 changes);
         if (err != noError) {
             session_->rollback();
@@ -3449,6 +3751,7 @@ error Database::SaveUser(
         err = saveRelatedModels(user->ID(),
                                 "obm_experiments",
                                 &user->related.ObmExperiments,
+                                &user->related.ObmExperimentIndex,
                                 changes);
         if (err != noError) {
             session_->rollback();
@@ -3456,9 +3759,15 @@ error Database::SaveUser(
         }
 
         // Timeline events
+        err = saveTimelineBuffer(user);
+        if (err != noError) {
+            session_->rollback();
+            return err;
+        }
         err = saveRelatedModels(user->ID(),
                                 "timeline_events",
                                 &user->related.TimelineEvents,
+                                &user->related.TimelineEventIndex,
                                 changes);
         if (err != noError) {
             session_->rollback();
@@ -3481,6 +3790,177 @@ error Database::SaveUser(
     return noError;
 }
 
+error Database::SaveTimelineEvents(User *user) {
+    Poco::Mutex::ScopedLock lock(session_m_);
+
+    // Do nothing, if user has already logged out
+    if (!user) {
+        logger().warning("Cannot save timeline, user is logged out");
+        return noError;
+    }
+
+    poco_check_ptr(session_);
+
+    if (!user->ID()) {
+        return error("Missing user ID, cannot save timeline events");
+    }
+    if (user->related.TimelineBuffer.empty()
+            && !user->related.TimelineEventIndex.ChangedCount()) {
+        return noError;
+    }
+
+    Poco::Stopwatch stopwatch;
+    stopwatch.start();
+
+    size_t count = user->related.TimelineBuffer.size()
+                   + user->related.TimelineEventIndex.ChangedCount();
+
+    session_->begin();
+
+    error err = saveTimelineBuffer(user);
+    if (err != noError) {
+        session_->rollback();
+        return err;
+    }
+
+    // Chunks that recorded events were added to
+    std::vector<ModelChange> changes;
+    err = saveRelatedModels(user->ID(),
+                            "timeline_events",
+                            &user->related.TimelineEvents,
+                            &user->related.TimelineEventIndex,
+                            &changes);
+    if (err != noError) {
+        session_->rollback();
+        return err;
+    }
+
+    session_->commit();
+
+    stopwatch.stop();
+
+    {
+        std::stringstream ss;
+        ss  << count << " timeline events saved in "
+            << stopwatch.elapsed() / 1000 << " ms in thread "
+            << Poco::Thread::currentTid();
+        logger().debug(ss.str());
+    }
+
+    return noError;
+}
+
+error Database::saveTimelineBuffer(User *user) {
+    poco_check_ptr(user);
+
+    std::vector<TimelineEvent *> buffer;
+    buffer.swap(user->related.TimelineBuffer);
+
+    const size_t kMaxTimelineStringSize = 300;
+
+    std::vector<TimelineEvent *> events;
+    for (size_t i = 0; i < buffer.size(); i++) {
+        TimelineEvent *model = buffer[i];
+        if (!model->Start() || !model->EndTime()) {
+            logger().warning("Dropping invalid timeline event "
+                             + model->String());
+            delete model;
+            continue;
+        }
+        model->SetUID(user->ID());
+        model->EnsureGUID();
+        if (model->Filename().length() > kMaxTimelineStringSize) {
+            model->SetFilename(
+                model->Filename().substr(0, kMaxTimelineStringSize));
+        }
+        if (model->Title().length() > kMaxTimelineStringSize) {
+            model->SetTitle(model->Title().substr(0, kMaxTimelineStringSize));
+        }
+        events.push_back(model);
+    }
+
+    error err = insertTimelineEvents(events);
+
+    // Events that failed to insert are left unsaved,
+    // to be retried with the rest of the user's data
+    for (size_t i = 0; i < events.size(); i++) {
+        user->related.Push(events[i]);
+    }
+
+    return err;
+}
+
+error Database::insertTimelineEvents(
+    const std::vector<TimelineEvent *> &events) {
+    // Nine columns per row, sqlite allows 999 variables per statement
+    const size_t kTimelineEventsPerInsert = 100;
+
+    try {
+        std::vector<Poco::Int64> local_ids;
+
+        for (size_t first = 0;
+                first < events.size();
+                first += kTimelineEventsPerInsert) {
+            size_t count = std::min(kTimelineEventsPerInsert,
+                                    events.size() - first);
+
+            std::stringstream sql;
+            sql << "insert into timeline_events("
+                "guid, title, filename, uid, start_time, end_time, "
+                "idle, uploaded, chunked) values ";
+            for (size_t i = 0; i < count; i++) {
+                if (i) {
+                    sql << ", ";
+                }
+                sql << "(?, ?, ?, ?, ?, ?, ?, ?, ?)";
+            }
+
+            PreparedStatement statement = prepared(sql.str());
+            for (size_t i = first; i < first + count; i++) {
+                TimelineEvent *model = events[i];
+                Poco::Int64 start_time(model->Start());
+                Poco::Int64 end_time(model->EndTime());
+                statement
+                .Bind(model->GUID())
+                .Bind(model->Title())
+                .Bind(model->Filename())
+                .Bind(model->UID())
+                .Bind(start_time)
+                .Bind(end_time)
+                .Bind(model->Idle())
+                .Bind(model->Uploaded())
+                .Bind(model->Chunked());
+            }
+            statement.Execute();
+
+            error err = last_error("insert timeline events");
+            if (err != noError) {
+                return err;
+            }
+
+            // Rows of one insert get consecutive local IDs, the
+            // table has no autoincrement and we hold the write lock
+            Poco::Int64 last = lastInsertRowID();
+            for (size_t i = 0; i < count; i++) {
+                local_ids.push_back(
+                    last - static_cast<Poco::Int64>(count - 1 - i));
+            }
+        }
+
+        for (size_t i = 0; i < events.size(); i++) {
+            events[i]->SetLocalID(local_ids[i]);
+            events[i]->ClearDirty();
+        }
+    } catch(const Poco::Exception& exc) {
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        return ex.what();
+    } catch(const std::string& ex) {
+        return ex;
+    }
+    return noError;
+}
+
 error Database::ensureMigrationTable() {
     std::string table_name;
     // Check if we have migrations table
@@ -3527,11 +4007,33 @@ error Database::initialize_tables() {
         return err;
     }
 
-    err = Migrations(this).Run();
-    if (err != noError) {
-        return err;
+    // Pending migrations are applied in a single transaction, so that
+    // startup pays for one commit instead of one per migration.
+    Migrations migrations(this);
+    try {
+        session_->begin();
+        err = migrations.Run();
+        if (err != noError) {
+            session_->rollback();
+            return err;
+        }
+        session_->commit();
+    } catch(const Poco::Exception& exc) {
+        session_->rollback();
+        return exc.displayText();
+    } catch(const std::exception& ex) {
+        session_->rollback();
+        return ex.what();
+    } catch(const std::string& ex) {
+        session_->rollback();
+        return ex;
     }
 
+    std::stringstream ss;
+    ss  << "Applied " << migrations.Pending() << " migrations, "
+        << migrations.Applied() << " already applied";
+    logger().debug(ss.str());
+
     return noError;
 }
 
@@ -3947,21 +4449,20 @@ error Database::saveModel(
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
 
-            *session_ <<
-                      "update obm_experiments set "
-                      "uid = :uid, "
-                      "nr = :nr, "
-                      "included = :included, "
-                      "has_seen = :has_seen, "
-                      "actions = :actions "
-                      "where local_id = :local_id",
-                      useRef(model->UID()),
-                      useRef(model->Nr()),
-                      useRef(model->Included()),
-                      useRef(model->HasSeen()),
-                      useRef(model->Actions()),
-                      useRef(model->LocalID()),
-                      now;
+            prepared("update obm_experiments set "
+                     "uid = :uid, "
+                     "nr = :nr, "
+                     "included = :included, "
+                     "has_seen = :has_seen, "
+                     "actions = :actions "
+                     "where local_id = :local_id")
+            .Bind(model->UID())
+            .Bind(model->Nr())
+            .Bind(model->Included())
+            .Bind(model->HasSeen())
+            .Bind(model->Actions())
+            .Bind(model->LocalID())
+            .Execute();
             error err = last_error("saveObmExperiment");
             if (err != noError) {
                 return err;
@@ -3985,32 +4486,22 @@ error Database::saveModel(
             ss << "Inserting OBM action " + model->String()
                << " in thread " << Poco::Thread::currentTid();
             logger().trace(ss.str());
-            *session_ <<
-                      "insert into obm_experiments("
-                      "uid, nr, included, has_seen, actions "
-                      ") values("
-                      ":uid, :nr, :included, :has_seen, :actions"
-                      ")",
-                      useRef(model->UID()),
-                      useRef(model->Nr()),
-                      useRef(model->Included()),
-                      useRef(model->HasSeen()),
-                      useRef(model->Actions()),
-                      now;
+            prepared("insert into obm_experiments("
+                     "uid, nr, included, has_seen, actions "
+                     ") values("
+                     ":uid, :nr, :included, :has_seen, :actions"
+                     ")")
+            .Bind(model->UID())
+            .Bind(model->Nr())
+            .Bind(model->Included())
+            .Bind(model->HasSeen())
+            .Bind(model->Actions())
+            .Execute();
             error err = last_error("saveObmExperiment");
             if (err != noError) {
                 return err;
             }
-            Poco::Int64 local_id(0);
-            *session_ <<
-                      "select last_insert_rowid()",
-                      into(local_id),
-                      now;
-            err = last_error("saveObmExperiment");
-            if (err != noError) {
-                return err;
-            }
-            model->SetLocalID(local_id);
+            model->SetLocalID(lastInsertRowID());
             changes->push_back(ModelChange(
                 model->ModelName(),
                 kChangeTypeInsert,
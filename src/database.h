@@ -9,10 +9,13 @@
 #include "sqlite3.h" // NOLINT
 #endif
 
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "Poco/Data/SQLite/Connector.h"
+#include "Poco/Timestamp.h"
 
 #include "./model_change.h"
 #include "./timeline_event.h"
@@ -31,10 +34,12 @@ namespace toggl {
 
 class AutotrackerRule;
 class Client;
+class ModelIndex;
 class ObmAction;
 class ObmExperiment;
 class Project;
 class Proxy;
+class RelatedData;
 class Settings;
 class Tag;
 class Task;
@@ -42,6 +47,56 @@ class TimeEntry;
 class User;
 class Workspace;
 
+// A cached sqlite statement, bound positionally in the order
+// the parameters appear in its SQL.
+class PreparedStatement {
+ public:
+    explicit PreparedStatement(sqlite3_stmt *stmt)
+        : stmt_(stmt)
+    , index_(0) {}
+
+    template<typename T>
+    PreparedStatement &Bind(const T &value) {
+        sqlite3_bind_int64(stmt_, ++index_,
+                           static_cast<sqlite3_int64>(value));
+        return *this;
+    }
+
+    PreparedStatement &Bind(const std::string &value) {
+        sqlite3_bind_text(stmt_, ++index_, value.c_str(),
+                          static_cast<int>(value.size()), SQLITE_TRANSIENT);
+        return *this;
+    }
+
+    // Runs the statement and resets it for the next caller.
+    // Throws a Poco::Data::SQLite exception on failure.
+    void Execute();
+
+ private:
+    sqlite3_stmt *stmt_;
+    int index_;
+};
+
+// Outcome of a Database::Maintain run
+class DatabaseMaintenance {
+ public:
+    DatabaseMaintenance()
+        : started(0)
+    , ended(0)
+    , rows_purged(0)
+    , pages_reclaimed(0)
+    , complete(false) {}
+
+    std::string String() const;
+
+    Poco::Timestamp started;
+    Poco::Timestamp ended;
+    Poco::UInt64 rows_purged;
+    Poco::Int64 pages_reclaimed;
+    // False if the time budget ran out before all was done
+    bool complete;
+};
+
 class Database {
  public:
     explicit Database(const std::string db_path);
@@ -63,7 +118,21 @@ class Database {
         const std::string &email,
         User *model);
 
-    error LoadCurrentUser(User *user);
+    // Loads the logged in user with only what the first screen needs:
+    // workspaces, clients, active projects and the time entries that
+    // started since the given time or are still running, with the
+    // projects and tasks they use.
+    // LoadUserRemainingData loads the rest later.
+    error LoadCurrentUser(
+        User *user,
+        const Poco::UInt64 since);
+
+    // Loads the data left out by LoadCurrentUser into related.
+    // The lookup indexes of related are not built.
+    error LoadUserRemainingData(
+        const Poco::UInt64 &UID,
+        const Poco::UInt64 since,
+        RelatedData *related);
 
     error LoadSettings(Settings *settings);
 
@@ -222,6 +291,11 @@ class Database {
     error SaveUser(User *user, bool with_related_data,
                    std::vector<ModelChange> *changes);
 
+    // Saves the user's buffered timeline events in one transaction,
+    // with multi-row inserts, and moves them to the timeline events.
+    // Changed timeline events are saved in the same transaction.
+    error SaveTimelineEvents(User *user);
+
     error LoadTimeEntriesForUpload(User *user);
 
     error CurrentAPIToken(
@@ -252,9 +326,40 @@ class Database {
 
     error Trim(const std::string text, std::string *result);
 
+    // Purges time entries that stopped before purge_before, except
+    // the ones with local IDs in keep_time_entries, reclaims free
+    // pages and checkpoints the WAL in small steps, for about
+    // budget_micros. Meant to be run in the background, the session
+    // is locked only per step.
+    error Maintain(
+        const Poco::Timestamp::TimeDiff budget_micros,
+        const Poco::Timestamp &purge_before,
+        const std::set<Poco::Int64> &keep_time_entries,
+        DatabaseMaintenance *result);
+
+    // The purge step of Maintain, starts a new result.
+    // Needs the time entries in memory to stay as they are.
+    error PurgeTimeEntries(
+        const Poco::Timestamp::TimeDiff budget_micros,
+        const Poco::Timestamp &purge_before,
+        const std::set<Poco::Int64> &keep_time_entries,
+        DatabaseMaintenance *result);
+
+    // The vacuum and checkpoint steps of Maintain, in what is left
+    // of the budget of result. Doesn't touch any models.
+    error Reclaim(
+        const Poco::Timestamp::TimeDiff budget_micros,
+        DatabaseMaintenance *result);
+
  private:
     error vacuum();
 
+    error pragma(const std::string name, Poco::Int64 *value);
+
+    error incrementalVacuum(const Poco::Int64 pages);
+
+    error checkpoint();
+
     error initialize_tables();
 
     error ensureMigrationTable();
@@ -275,9 +380,19 @@ class Database {
     error last_error(
         const std::string was_doing);
 
+    // Returns a statement from the cache, preparing it on first use.
+    // Session must be locked by the caller.
+    PreparedStatement prepared(const std::string &sql);
+
+    Poco::Int64 lastInsertRowID();
+
     error journalMode(std::string *);
     error setJournalMode(const std::string);
 
+    error loadUser(
+        const Poco::UInt64 &UID,
+        User *user);
+
     error loadUsersRelatedData(User *user);
 
     error loadWorkspaces(
@@ -290,11 +405,13 @@ class Database {
 
     error loadProjects(
         const Poco::UInt64 &UID,
-        std::vector<Project *> *list);
+        std::vector<Project *> *list,
+        const std::string &filter = "");
 
     error loadTasks(
         const Poco::UInt64 &UID,
-        std::vector<Task *> *list);
+        std::vector<Task *> *list,
+        const std::string &filter = "");
 
     error loadTags(
         const Poco::UInt64 &UID,
@@ -314,7 +431,8 @@ class Database {
 
     error loadTimeEntries(
         const Poco::UInt64 &UID,
-        std::vector<TimeEntry *> *list);
+        std::vector<TimeEntry *> *list,
+        const std::string &filter = "");
 
     error loadTimelineEvents(
         const Poco::UInt64 &UID,
@@ -329,11 +447,17 @@ class Database {
         const Poco::UInt64 UID,
         const std::string table_name,
         std::vector<T *> *list,
+        ModelIndex *index,
         std::vector<ModelChange> *changes);
 
-    error deleteAllFromTableByDate(
-        const std::string table_name,
-        const Poco::Timestamp &time);
+    // Time entries that purgeTimeEntries must not delete
+    error setKeptTimeEntries(const std::set<Poco::Int64> &local_ids);
+
+    // Deletes at most limit rows per call
+    error purgeTimeEntries(
+        const Poco::Timestamp &time,
+        const Poco::UInt64 limit,
+        Poco::UInt64 *deleted);
 
     error deleteAllFromTableByUID(
         const std::string table_name,
@@ -379,6 +503,11 @@ class Database {
         TimelineEvent *model,
         std::vector<ModelChange> *changes);
 
+    error saveTimelineBuffer(User *user);
+
+    error insertTimelineEvents(
+        const std::vector<TimelineEvent *> &events);
+
     error saveDesktopID();
     error saveAnalyticsClientID();
 
@@ -397,6 +526,8 @@ class Database {
     Poco::Mutex session_m_;
     Poco::Data::Session *session_;
 
+    std::map<std::string, sqlite3_stmt *> statements_;
+
     std::string desktop_id_;
     std::string analytics_client_id_;
 };
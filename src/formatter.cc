@@ -5,6 +5,8 @@
 #include <time.h>
 #include <sstream>
 #include <cctype>
+#include <cmath>
+#include <cstdlib>
 #include <set>
 
 #include "./client.h"
@@ -15,19 +17,297 @@
 #include "./workspace.h"
 
 #include "Poco/DateTimeFormat.h"
-#include "Poco/DateTimeFormatter.h"
 #include "Poco/DateTimeParser.h"
-#include "Poco/LocalDateTime.h"
 #include "Poco/Logger.h"
-#include "Poco/NumberFormatter.h"
 #include "Poco/NumberParser.h"
 #include "Poco/String.h"
 #include "Poco/StringTokenizer.h"
+#include "Poco/Timezone.h"
 #include "Poco/Types.h"
 #include "Poco/UTF8String.h"
 
 namespace toggl {
 
+namespace {
+
+const Poco::Int64 kSecondsPerDay = 86400;
+
+Poco::Int64 floorDiv(const Poco::Int64 a, const Poco::Int64 b) {
+    Poco::Int64 q = a / b;
+    if ((a % b) && ((a < 0) != (b < 0))) {
+        q--;
+    }
+    return q;
+}
+
+char *appendString(char *out, const char *value) {
+    while (*value) {
+        *out++ = *value++;
+    }
+    return out;
+}
+
+// First three letters of a weekday or month name
+char *appendAbbreviation(char *out, const std::string &name) {
+    for (size_t i = 0; i < 3 && i < name.size(); i++) {
+        *out++ = name[i];
+    }
+    return out;
+}
+
+// Writes value in decimal, zero padded to at least width digits
+char *appendNumber(char *out, Poco::UInt64 value, const int width = 1) {
+    char digits[24];
+    int n(0);
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n < width) {
+        digits[n++] = '0';
+    }
+    while (n) {
+        *out++ = digits[--n];
+    }
+    return out;
+}
+
+size_t terminate(char *begin, char *end) {
+    *end = 0;
+    return end - begin;
+}
+
+// Civil date of days since epoch, see
+// http://howardhinnant.github.io/date_algorithms.html
+void civilFromDays(
+    const Poco::Int64 days,
+    Poco::Int64 *year,
+    int *month,
+    int *day) {
+    Poco::Int64 z = days + 719468;
+    Poco::Int64 era = floorDiv(z, 146097);
+    Poco::Int64 doe = z - era * 146097;
+    Poco::Int64 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    Poco::Int64 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    Poco::Int64 mp = (5 * doy + 2) / 153;
+    *day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    *month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    *year = yoe + era * 400 + (*month <= 2);
+}
+
+Poco::Int64 daysFromCivil(Poco::Int64 year, const int month, const int day) {
+    year -= month <= 2;
+    Poco::Int64 era = floorDiv(year, 400);
+    Poco::Int64 yoe = year - era * 400;
+    Poco::Int64 doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5
+                      + day - 1;
+    Poco::Int64 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+int daysOfMonth(const int year, const int month) {
+    static const int days[] = {
+        31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+    };
+    if (2 == month
+            && ((!(year % 4) && (year % 100)) || !(year % 400))) {
+        return 29;
+    }
+    return days[month - 1];
+}
+
+bool parseDigits(const char *p, const int count, int *value) {
+    int result(0);
+    for (int i = 0; i < count; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+        result = result * 10 + (p[i] - '0');
+    }
+    *value = result;
+    return true;
+}
+
+// Parses the shapes of timestamps the API sends,
+// YYYY-MM-DDTHH:MM:SS followed by Z, +HH:MM or +HHMM.
+// Returns false for anything else, so that it can be handed
+// to the Poco parser.
+bool parse8601(const std::string &value, Poco::Int64 *epoch_time) {
+    const size_t size = value.size();
+    if (size != 20 && size != 24 && size != 25) {
+        return false;
+    }
+    const char *p = value.data();
+    if (p[4] != '-' || p[7] != '-' || p[10] != 'T'
+            || p[13] != ':' || p[16] != ':') {
+        return false;
+    }
+    int year(0), month(0), day(0), hour(0), minute(0), second(0);
+    if (!parseDigits(p, 4, &year)
+            || !parseDigits(p + 5, 2, &month)
+            || !parseDigits(p + 8, 2, &day)
+            || !parseDigits(p + 11, 2, &hour)
+            || !parseDigits(p + 14, 2, &minute)
+            || !parseDigits(p + 17, 2, &second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > daysOfMonth(year, month)
+            || hour > 23 || minute > 59 || second > 59) {
+        return false;
+    }
+
+    int tzd(0);
+    const char *zone = p + 19;
+    if (20 == size) {
+        if (*zone != 'Z') {
+            return false;
+        }
+    } else {
+        if (*zone != '+' && *zone != '-') {
+            return false;
+        }
+        int tzd_hours(0), tzd_minutes(0);
+        const char *minutes = zone + 3;
+        if (25 == size) {
+            if (*minutes != ':') {
+                return false;
+            }
+            minutes++;
+        }
+        if (!parseDigits(zone + 1, 2, &tzd_hours)
+                || !parseDigits(minutes, 2, &tzd_minutes)) {
+            return false;
+        }
+        tzd = tzd_hours * 3600 + tzd_minutes * 60;
+        if ('-' == *zone) {
+            tzd = -tzd;
+        }
+    }
+
+    *epoch_time = daysFromCivil(year, month, day) * kSecondsPerDay
+                  + hour * 3600 + minute * 60 + second - tzd;
+    return true;
+}
+
+// Local time as Poco::LocalDateTime has it: the UTC offset plus
+// an hour when DST is in effect. Offsets are cached by UTC day,
+// unless DST starts or ends on that day, and dropped when the
+// TZ variable changes, or the UTC offset when checked once a second.
+class LocalTime {
+ public:
+    LocalTime()
+        : utc_offset_(0)
+    , validated_at_(0)
+    , today_(0)
+    , today_checked_at_(0)
+    , today_ends_(0) {
+        clear();
+    }
+
+    // Seconds to add to the UTC time to get local time
+    int Tzd(const std::time_t t) {
+        Poco::Mutex::ScopedLock lock(m_);
+        validate();
+
+        const Poco::Int64 day = floorDiv(t, kSecondsPerDay);
+        Day &cached = days_[day & (kDays - 1)];
+        if (!cached.valid || cached.day != day) {
+            cached.day = day;
+            cached.tzd = tzd(day * kSecondsPerDay);
+            cached.changes =
+                cached.tzd != tzd((day + 1) * kSecondsPerDay - 1);
+            cached.valid = true;
+        }
+        if (cached.changes) {
+            return tzd(t);
+        }
+        return cached.tzd;
+    }
+
+    // Local days since epoch
+    Poco::Int64 DayOf(const std::time_t t) {
+        return floorDiv(t + Tzd(t), kSecondsPerDay);
+    }
+
+    Poco::Int64 Today() {
+        const std::time_t now = time(0);
+        Poco::Mutex::ScopedLock lock(m_);
+        validate();
+        if (now < today_checked_at_ || now >= today_ends_) {
+            today_ = DayOf(now);
+            today_checked_at_ = now;
+            today_ends_ = (today_ + 1) * kSecondsPerDay - Tzd(now);
+            if (DayOf(today_ends_ - 1) != today_) {
+                // Offset changes before midnight
+                today_ends_ = now + 1;
+            }
+        }
+        return today_;
+    }
+
+ private:
+    enum { kDays = 64 };
+
+    struct Day {
+        Poco::Int64 day;
+        int tzd;
+        bool changes;
+        bool valid;
+    };
+
+    int tzd(const std::time_t t) const {
+        struct tm local;
+#if defined(_WIN32) || defined(WIN32)
+        localtime_s(&local, &t);
+#else
+        localtime_r(&t, &local);
+#endif
+        return utc_offset_ + ((local.tm_isdst == 1) ? 3600 : 0);
+    }
+
+    void validate() {
+        const char *tz = getenv("TZ");
+        if (!tz) {
+            tz = "";
+        }
+        const std::time_t now = time(0);
+        if (tz_ == tz && now == validated_at_) {
+            return;
+        }
+        validated_at_ = now;
+
+        // Also calls tzset(), which localtime_r() may not
+        const int utc_offset = Poco::Timezone::utcOffset();
+        if (utc_offset != utc_offset_ || tz_ != tz) {
+            clear();
+            utc_offset_ = utc_offset;
+            tz_ = tz;
+        }
+    }
+
+    void clear() {
+        for (int i = 0; i < kDays; i++) {
+            days_[i].valid = false;
+        }
+        today_checked_at_ = 0;
+        today_ends_ = 0;
+    }
+
+    Poco::Mutex m_;
+    int utc_offset_;
+    std::string tz_;
+    std::time_t validated_at_;
+    Day days_[kDays];
+
+    Poco::Int64 today_;
+    std::time_t today_checked_at_;
+    std::time_t today_ends_;
+};
+
+LocalTime local_time;
+
+}  // namespace
+
 const std::string Format::Classic = std::string("classic");
 const std::string Format::Improved = std::string("improved");
 const std::string Format::Decimal = std::string("decimal");
@@ -35,14 +315,6 @@ const std::string Format::Decimal = std::string("decimal");
 std::string Formatter::TimeOfDayFormat = std::string("");
 std::string Formatter::DurationFormat = Format::Improved;
 
-std::string Formatter::togglTimeOfDayToPocoFormat(
-    const std::string toggl_format) {
-    if ("h:mm A" == toggl_format) {
-        return "%h:%M %A";
-    }
-    return "%H:%M";
-}
-
 std::string Formatter::JoinTaskName(
     Task * const t,
     Project * const p,
@@ -71,39 +343,76 @@ std::string Formatter::JoinTaskName(
 
 std::string Formatter::FormatTimeForTimeEntryEditor(
     const std::time_t date) {
+    char buf[kFormatBufferSize];
+    size_t n = FormatTimeForTimeEntryEditor(date, buf);
+    return std::string(buf, n);
+}
+
+size_t Formatter::FormatTimeForTimeEntryEditor(
+    const std::time_t date,
+    char *out) {
+    char *p = out;
     if (!date) {
-        return "";
-    }
-    Poco::Timestamp ts = Poco::Timestamp::fromEpochTime(date);
-    Poco::LocalDateTime local(ts);
-    std::string fmt = togglTimeOfDayToPocoFormat(TimeOfDayFormat);
-    return Poco::DateTimeFormatter::format(local, fmt);
+        return terminate(out, p);
+    }
+    Poco::Int64 local = date + local_time.Tzd(date);
+    Poco::Int64 seconds = local - floorDiv(local, kSecondsPerDay)
+                          * kSecondsPerDay;
+    int hour = static_cast<int>(seconds / 3600);
+    int minute = static_cast<int>(seconds % 3600 / 60);
+
+    // "%h:%M %A" or "%H:%M"
+    if ("h:mm A" == TimeOfDayFormat) {
+        int hour_ampm = hour % 12;
+        if (!hour_ampm) {
+            hour_ampm = 12;
+        }
+        p = appendNumber(p, hour_ampm, 2);
+        *p++ = ':';
+        p = appendNumber(p, minute, 2);
+        p = appendString(p, hour < 12 ? " AM" : " PM");
+        return terminate(out, p);
+    }
+    p = appendNumber(p, hour, 2);
+    *p++ = ':';
+    p = appendNumber(p, minute, 2);
+    return terminate(out, p);
 }
 
 std::string Formatter::FormatDateHeader(const std::time_t date) {
+    char buf[kFormatBufferSize];
+    size_t n = FormatDateHeader(date, buf);
+    return std::string(buf, n);
+}
+
+size_t Formatter::FormatDateHeader(
+    const std::time_t date,
+    char *out) {
+    char *p = out;
     if (!date) {
-        return "";
+        return terminate(out, p);
     }
 
-    Poco::Timestamp ts = Poco::Timestamp::fromEpochTime(date);
-    Poco::LocalDateTime datetime(ts);
-
-    Poco::LocalDateTime today;
-    if (today.year() == datetime.year() &&
-            today.month() == datetime.month() &&
-            today.day() == datetime.day()) {
-        return "Today";
+    Poco::Int64 day = local_time.DayOf(date);
+    Poco::Int64 today = local_time.Today();
+    if (today == day) {
+        return terminate(out, appendString(p, "Today"));
     }
-
-    Poco::LocalDateTime yesterday =
-        today - Poco::Timespan(24 * Poco::Timespan::HOURS);
-    if (yesterday.year() == datetime.year() &&
-            yesterday.month() == datetime.month() &&
-            yesterday.day() == datetime.day()) {
-        return "Yesterday";
+    if (today - 1 == day) {
+        return terminate(out, appendString(p, "Yesterday"));
     }
 
-    return Poco::DateTimeFormatter::format(datetime, "%w, %d %b");
+    // "%w, %d %b"
+    Poco::Int64 year(0);
+    int month(0), month_day(0);
+    civilFromDays(day, &year, &month, &month_day);
+    int weekday = static_cast<int>(day + 4 - floorDiv(day + 4, 7) * 7);
+    p = appendAbbreviation(p, Poco::DateTimeFormat::WEEKDAY_NAMES[weekday]);
+    p = appendString(p, ", ");
+    p = appendNumber(p, month_day, 2);
+    *p++ = ' ';
+    p = appendAbbreviation(p, Poco::DateTimeFormat::MONTH_NAMES[month - 1]);
+    return terminate(out, p);
 }
 
 bool Formatter::parseTimeInputAMPM(const std::string numbers,
@@ -405,27 +714,39 @@ Poco::UInt64 Formatter::AbsDuration(const Poco::Int64 value) {
 
 std::string Formatter::FormatDurationForDateHeader(
     const Poco::Int64 value) {
-    Poco::Int64 duration = AbsDuration(value);
-
-    std::stringstream ss;
-
-    Poco::Int64 hours = duration / 3600;
-    ss << hours << " h ";
-
-    Poco::Int64 minutes = (duration - (hours * 3600)) / 60;
-    if (minutes < 10) {
-        ss << "0";
-    }
-    ss << minutes << " min";
+    char buf[kFormatBufferSize];
+    size_t n = FormatDurationForDateHeader(value, buf);
+    return std::string(buf, n);
+}
 
-    return ss.str();
+size_t Formatter::FormatDurationForDateHeader(
+    const Poco::Int64 value,
+    char *out) {
+    Poco::UInt64 duration = AbsDuration(value);
+
+    char *p = appendNumber(out, duration / 3600);
+    p = appendString(p, " h ");
+    p = appendNumber(p, duration % 3600 / 60, 2);
+    p = appendString(p, " min");
+    return terminate(out, p);
 }
 
 std::string Formatter::FormatDuration(
     const Poco::Int64 value,
     const std::string format_name,
     const bool with_seconds) {
+    char buf[kFormatBufferSize];
+    size_t n = FormatDuration(value, format_name, with_seconds, buf);
+    return std::string(buf, n);
+}
+
+size_t Formatter::FormatDuration(
+    const Poco::Int64 value,
+    const std::string &format_name,
+    const bool with_seconds,
+    char *out) {
     Poco::Int64 duration = AbsDuration(value);
+    char *p = out;
 
     if (Format::Decimal == format_name) {
         double hours = duration / 3600.0;
@@ -437,68 +758,67 @@ std::string Formatter::FormatDuration(
         if (d > 0.5) {
             b++;
         }
-        double c = b / 100.0;
-        std::stringstream ss;
-        ss << Poco::NumberFormatter::format(c, 2) << " h";
-        return ss.str();
+        // Hundredths of an hour, as b / 100.0 with two decimals
+        p = appendNumber(p, b / 100);
+        *p++ = '.';
+        p = appendNumber(p, b % 100, 2);
+        p = appendString(p, " h");
+        return terminate(out, p);
     }
 
     if (Format::Classic == format_name) {
         if (duration < 60) {
-            std::stringstream ss;
-            ss << duration << " sec";
-            return ss.str();
+            p = appendNumber(p, duration);
+            p = appendString(p, " sec");
+            return terminate(out, p);
         }
         if (duration < 3600) {
-            Poco::Timespan span(duration * Poco::Timespan::SECONDS);
-            return Poco::DateTimeFormatter::format(span, "%M:%S min");
-        }
-        std::stringstream ss;
-        Poco::Int64 hours = duration / 3600;
-        // Poco DateTimeFormatter will not format hours above 24h.
-        // So format hours by hand:
-        if (hours < 10) {
-            ss << "0";
+            p = appendNumber(p, duration / 60, 2);
+            *p++ = ':';
+            p = appendNumber(p, duration % 60, 2);
+            p = appendString(p, " min");
+            return terminate(out, p);
         }
-        ss << hours;
-        ss << ":";
-        Poco::Timespan span(duration * Poco::Timespan::SECONDS);
-        ss << Poco::DateTimeFormatter::format(span, "%M:%S");
-        return ss.str();
+        p = appendNumber(p, duration / 3600, 2);
+        *p++ = ':';
+        p = appendNumber(p, duration % 3600 / 60, 2);
+        *p++ = ':';
+        p = appendNumber(p, duration % 60, 2);
+        return terminate(out, p);
     }
 
     // Default, 'improved' format
-    // Poco DateTimeFormatter will not format hours above 24h.
-    // So format hours by hand:
-    std::stringstream ss;
-    Poco::Int64 hours = duration / 3600;
-    ss << hours;
-    ss << ":";
-    Poco::Timespan span(duration * Poco::Timespan::SECONDS);
+    p = appendNumber(p, duration / 3600);
+    *p++ = ':';
+    p = appendNumber(p, duration % 3600 / 60, 2);
     if (with_seconds) {
-        ss << Poco::DateTimeFormatter::format(span, "%M:%S");
-    } else {
-        ss << Poco::DateTimeFormatter::format(span, "%M");
+        *p++ = ':';
+        p = appendNumber(p, duration % 60, 2);
     }
-    return ss.str();
+    return terminate(out, p);
 }
 
-std::time_t Formatter::Parse8601(const std::string iso_8601_formatted_date) {
+std::time_t Formatter::Parse8601(
+    const std::string &iso_8601_formatted_date) {
     if ("null" == iso_8601_formatted_date) {
         return 0;
     }
     if (iso_8601_formatted_date.empty()) {
         return 0;
     }
-    int tzd;
-    Poco::DateTime dt;
-    if (!Poco::DateTimeParser::tryParse(Poco::DateTimeFormat::ISO8601_FORMAT,
-                                        iso_8601_formatted_date, dt, tzd)) {
-        return 0;
+    Poco::Int64 parsed(0);
+    if (!parse8601(iso_8601_formatted_date, &parsed)) {
+        int tzd;
+        Poco::DateTime dt;
+        if (!Poco::DateTimeParser::tryParse(
+                Poco::DateTimeFormat::ISO8601_FORMAT,
+                iso_8601_formatted_date, dt, tzd)) {
+            return 0;
+        }
+        dt.makeUTC(tzd);
+        parsed = dt.timestamp().epochTime();
     }
-    dt.makeUTC(tzd);
-    Poco::Timestamp ts = dt.timestamp();
-    time_t epoch_time = ts.epochTime();
+    time_t epoch_time = static_cast<time_t>(parsed);
 
     // Sun  9 Sep 2001 03:46:40 EET
     if (epoch_time < 1000000000) {
@@ -523,17 +843,50 @@ std::time_t Formatter::Parse8601(const std::string iso_8601_formatted_date) {
 }
 
 std::string Formatter::Format8601(const std::time_t date) {
+    char buf[kFormatBufferSize];
+    size_t n = Format8601(date, buf);
+    return std::string(buf, n);
+}
+
+std::string Formatter::Format8601(const Poco::Timestamp ts) {
+    char buf[kFormatBufferSize];
+    size_t n = format8601(
+        floorDiv(ts.epochMicroseconds(), Poco::Timestamp::resolution()), buf);
+    return std::string(buf, n);
+}
+
+size_t Formatter::Format8601(
+    const std::time_t date,
+    char *out) {
     if (!date) {
-        return "null";
+        return terminate(out, appendString(out, "null"));
     }
-    Poco::Timestamp ts = Poco::Timestamp::fromEpochTime(date);
-    return Format8601(ts);
+    return format8601(date, out);
 }
 
-std::string Formatter::Format8601(const Poco::Timestamp ts) {
-    return Poco::DateTimeFormatter::format(
-        ts,
-        Poco::DateTimeFormat::ISO8601_FORMAT);
+size_t Formatter::format8601(
+    const Poco::Int64 epoch_time,
+    char *out) {
+    // Poco::DateTimeFormat::ISO8601_FORMAT in UTC
+    Poco::Int64 day = floorDiv(epoch_time, kSecondsPerDay);
+    Poco::Int64 seconds = epoch_time - day * kSecondsPerDay;
+    Poco::Int64 year(0);
+    int month(0), month_day(0);
+    civilFromDays(day, &year, &month, &month_day);
+
+    char *p = appendNumber(out, year, 4);
+    *p++ = '-';
+    p = appendNumber(p, month, 2);
+    *p++ = '-';
+    p = appendNumber(p, month_day, 2);
+    *p++ = 'T';
+    p = appendNumber(p, seconds / 3600, 2);
+    *p++ = ':';
+    p = appendNumber(p, seconds % 3600 / 60, 2);
+    *p++ = ':';
+    p = appendNumber(p, seconds % 60, 2);
+    *p++ = 'Z';
+    return terminate(out, p);
 }
 
 std::string Formatter::EscapeJSONString(const std::string input) {
@@ -605,8 +958,8 @@ bool CompareAutotrackerTitles(const std::string &a, const std::string &b) {
 }
 
 bool CompareAutocompleteItems(
-    view::Autocomplete a,
-    view::Autocomplete b) {
+    const view::Autocomplete &a,
+    const view::Autocomplete &b) {
 
     // Time entries first
     if (a.IsTimeEntry() && !b.IsTimeEntry()) {
@@ -636,8 +989,8 @@ bool CompareAutocompleteItems(
 }
 
 bool CompareStructuredAutocompleteItems(
-    view::Autocomplete a,
-    view::Autocomplete b) {
+    const view::Autocomplete &a,
+    const view::Autocomplete &b) {
 
     if (a.WorkspaceName == b.WorkspaceName) {
         if (a.IsWorkspace() && !b.IsWorkspace()) {
@@ -9,6 +9,7 @@
 
 #include "Poco/Timestamp.h"
 
+#include "./const.h"
 #include "./types.h"
 
 namespace toggl {
@@ -70,6 +71,32 @@ class Formatter {
     static std::string FormatTimeForTimeEntryEditor(
         const std::time_t date);
 
+    // Same as above, but written into a buffer of kFormatBufferSize
+    // bytes without allocating. Return the length of the formatted
+    // string, which is NUL terminated.
+
+    static size_t FormatDuration(
+        const Poco::Int64 value,
+        const std::string &format_name,
+        const bool with_seconds,
+        char *out);
+
+    static size_t FormatDurationForDateHeader(
+        const Poco::Int64 value,
+        char *out);
+
+    static size_t Format8601(
+        const std::time_t date,
+        char *out);
+
+    static size_t FormatDateHeader(
+        const std::time_t date,
+        char *out);
+
+    static size_t FormatTimeForTimeEntryEditor(
+        const std::time_t date,
+        char *out);
+
     static error CollectErrors(
         std::vector<error> * const errors);
 
@@ -80,7 +107,7 @@ class Formatter {
     // Parse
 
     static std::time_t Parse8601(
-        const std::string iso_8601_formatted_date);
+        const std::string &iso_8601_formatted_date);
 
     static int ParseDurationString(
         const std::string value);
@@ -96,8 +123,9 @@ class Formatter {
         const std::string input);
 
  private:
-    static std::string togglTimeOfDayToPocoFormat(
-        const std::string toggl_format);
+    static size_t format8601(
+        const Poco::Int64 epoch_time,
+        char *out);
 
     static void take(
         const std::string delimiter,
@@ -140,11 +168,11 @@ bool CompareByStart(
     TimedEvent *a,
     TimedEvent *b);
 bool CompareAutocompleteItems(
-    view::Autocomplete a,
-    view::Autocomplete b);
+    const view::Autocomplete &a,
+    const view::Autocomplete &b);
 bool CompareStructuredAutocompleteItems(
-    view::Autocomplete a,
-    view::Autocomplete b);
+    const view::Autocomplete &a,
+    const view::Autocomplete &b);
 bool CompareWorkspaceByName(
     Workspace *a,
     Workspace *b);
@@ -11,4 +11,13 @@ int getFocusedWindowInfo(
     std::string *filename,
     bool *idle);
 
+// Blocks until the focused window or its title may have changed.
+// Returns true if the focused window should be inspected, false
+// if the wait was cancelled. Platforms that can't tell when the
+// focus changes just wait for timeout_millis and return true.
+bool waitForFocusChange(const int timeout_millis);
+
+// Makes a waitForFocusChange call in another thread return early.
+void cancelWaitForFocusChange();
+
 #endif  // SRC_GET_FOCUSED_WINDOW_H_
@@ -5,11 +5,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sys/select.h>
+#include <sys/time.h>
 
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
 
 #include <cstring>
+#include <map>
 #include <string>
 #include <typeinfo>
 
@@ -23,12 +27,66 @@
   __eintr_result__;\
 })
 
-static const char kNetActiveWindow[] = "_NET_ACTIVE_WINDOW";
 static const int kMaxPropertyValueLen = 4096;
 
+// Even with focus change events, inspect the
+// focused window at least this often.
+static const int kFocusChangeMaxWaitMillis = 60000;
+
+// Process names are looked up by pid once, until the cache fills up
+static const size_t kMaxCachedProcessNames = 256;
+
+// One X connection is kept open for the lifetime of the app.
+// It's used only by the window change recorder thread.
+static Display *display = NULL;
+static Atom net_active_window_atom;
+static Atom net_wm_name_atom;
+static Atom net_wm_pid_atom;
+static Atom wm_name_atom;
+static Atom utf8_string_atom;
+
+// Window whose title changes we're subscribed to
+static Window watched_window = (Window)0;
+
+static std::map<unsigned long, std::string> process_names; // NOLINT
+
+// Writing to this pipe wakes up waitForFocusChange
+static int wake_pipe[2] = { -1, -1 };
+static pthread_once_t wake_pipe_once = PTHREAD_ONCE_INIT;
+
+static void create_wake_pipe() {
+    if (pipe(wake_pipe) != 0) {
+        wake_pipe[0] = wake_pipe[1] = -1;
+        return;
+    }
+    fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+}
+
+static bool open_display() {
+    if (display) {
+        return true;
+    }
+    display = XOpenDisplay(NULL);
+    if (!display) {
+        return false;
+    }
+
+    net_active_window_atom = XInternAtom(display, "_NET_ACTIVE_WINDOW", False);
+    net_wm_name_atom = XInternAtom(display, "_NET_WM_NAME", False);
+    net_wm_pid_atom = XInternAtom(display, "_NET_WM_PID", False);
+    wm_name_atom = XInternAtom(display, "WM_NAME", False);
+    utf8_string_atom = XInternAtom(display, "UTF8_STRING", False);
+
+    // Root window property changes tell us when _NET_ACTIVE_WINDOW changes
+    XSelectInput(display, DefaultRootWindow(display), PropertyChangeMask);
+    XFlush(display);
+
+    return true;
+}
+
 static char *get_property(Display *disp, Window win, Atom xa_prop_type,
-                          const char *prop_name, unsigned long *size) { // NOLINT
-    Atom xa_prop_name;
+                          Atom xa_prop_name, unsigned long *size) { // NOLINT
     Atom xa_ret_type;
     int ret_format;
     unsigned long ret_nitems; // NOLINT
@@ -37,8 +95,6 @@ static char *get_property(Display *disp, Window win, Atom xa_prop_type,
     unsigned char *ret_prop;
     char *ret;
 
-    xa_prop_name = XInternAtom(disp, prop_name, False);
-
     // kMaxPropertyValueLen / 4 explanation (XGetWindowProperty manpage):
     // long_length = Specifies the length in 32-bit multiples of the data
     // to be retrieved.
@@ -76,6 +132,45 @@ static char *get_property(Display *disp, Window win, Atom xa_prop_type,
     return ret;
 }
 
+static std::string process_name(const unsigned long pid) { // NOLINT
+    std::map<unsigned long, std::string>::const_iterator it = // NOLINT
+        process_names.find(pid);
+    if (it != process_names.end()) {
+        return it->second;
+    }
+
+    std::string name("");
+    char buf[256];
+    snprintf(buf, sizeof(buf), "/proc/%lu/stat", pid);
+    const int fd = open(buf, O_RDONLY);
+    if (fd < 0) {
+        return name;
+    }
+    const ssize_t len = HANDLE_EINTR(read(fd, buf, sizeof(buf) - 1));
+    HANDLE_EINTR(close(fd));
+    if (len <= 0) {
+        return name;
+    }
+    buf[len] = 0;
+    // The start of the file looks like:
+    //   <pid> (<name>) R <parent pid>
+    unsigned tmp_pid, tmp_ppid;
+    char *tmp_name = 0;
+    if (sscanf(buf, "%u (%m[^)]) %*c %u", // NOLINT
+               &tmp_pid, &tmp_name, &tmp_ppid) == 3) {
+        name = std::string(tmp_name);
+    }
+    free(tmp_name);
+
+    // Pids get reused, so don't hold on to old entries forever
+    if (process_names.size() >= kMaxCachedProcessNames) {
+        process_names.clear();
+    }
+    process_names[pid] = name;
+
+    return name;
+}
+
 int getFocusedWindowInfo(
     std::string *title,
     std::string *filename,
@@ -84,8 +179,7 @@ int getFocusedWindowInfo(
     *filename = "";
     *idle = false;
 
-    Display *display = XOpenDisplay(NULL);
-    if (!display) {
+    if (!open_display()) {
         return 1;
     }
 
@@ -96,26 +190,35 @@ int getFocusedWindowInfo(
         display,
         DefaultRootWindow(display),
         XA_WINDOW,
-        kNetActiveWindow,
+        net_active_window_atom,
         &size);
     if (prop) {
         active_window = *(reinterpret_cast<Window *>(prop));
     }
     free(prop);
 
+    // Subscribe to title changes of the newly focused window.
+    // Events from previously focused windows are ignored later,
+    // so there's no need to unsubscribe from them.
+    if (active_window && active_window != watched_window) {
+        XSelectInput(display, active_window, PropertyChangeMask);
+        XFlush(display);
+    }
+    watched_window = active_window;
+
     // get title of active window
     if (active_window) {
         char *net_wm_name = get_property(
             display,
             active_window,
-            XInternAtom(display, "UTF8_STRING", false),
-            "_NET_WM_NAME",
+            utf8_string_atom,
+            net_wm_name_atom,
             NULL);
         if (net_wm_name) {
             *title = std::string(net_wm_name);
         } else {
             char *wm_name = get_property(display, active_window,
-                                         XA_STRING, "WM_NAME", NULL);
+                                         XA_STRING, wm_name_atom, NULL);
             if (wm_name) {
                 *title = std::string(wm_name);
             }
@@ -128,35 +231,115 @@ int getFocusedWindowInfo(
     unsigned long *pid = 0; // NOLINT
     if (active_window) {
         pid = (unsigned long *)get_property(display, active_window, // NOLINT
-                                            XA_CARDINAL, "_NET_WM_PID", NULL);
+                                            XA_CARDINAL, net_wm_pid_atom,
+                                            NULL);
         if (pid) {
-            // get process name by pid
-            char buf[256];
-            snprintf(buf, sizeof(buf), "/proc/%lu/stat", *pid);
-            const int fd = open(buf, O_RDONLY);
-            if (fd >= 0) {
-                const ssize_t len =
-                    HANDLE_EINTR(read(fd, buf, sizeof(buf) - 1));
-                HANDLE_EINTR(close(fd));
-                if (len > 0) {
-                    buf[len] = 0;
-                    // The start of the file looks like:
-                    //   <pid> (<name>) R <parent pid>
-                    unsigned tmp_pid, tmp_ppid;
-                    char *process_name = 0;
-                    if (sscanf(buf, "%u (%a[^)]) %*c %u", // NOLINT
-                               &tmp_pid, &process_name, &tmp_ppid) == 3) {
-                        *filename = std::string(process_name);
-                    }
-                    free(process_name);
-                }
-            }
+            *filename = process_name(*pid);
         }
         free(pid);
     }
 
-    // Must close display, else max window client count is reached quickly
-    XCloseDisplay(display);
-
     return 0;
 }
+
+// Reads queued X events, returns true if any of them
+// could mean that the focused window or its title changed.
+static bool focus_changed() {
+    bool changed(false);
+    while (XPending(display)) {
+        XEvent event;
+        XNextEvent(display, &event);
+        if (event.type != PropertyNotify) {
+            continue;
+        }
+        const XPropertyEvent &e = event.xproperty;
+        if (e.window == DefaultRootWindow(display)) {
+            if (e.atom == net_active_window_atom) {
+                changed = true;
+            }
+        } else if (e.window == watched_window) {
+            if (e.atom == net_wm_name_atom || e.atom == wm_name_atom) {
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+static void drain_wake_pipe() {
+    char buf[64];
+    while (HANDLE_EINTR(read(wake_pipe[0], buf, sizeof(buf))) > 0) {}
+}
+
+bool waitForFocusChange(const int timeout_millis) {
+    pthread_once(&wake_pipe_once, create_wake_pipe);
+
+    // Without a display, there are no events, so just poll
+    const bool events = open_display();
+    int wait_millis = events ? kFocusChangeMaxWaitMillis : timeout_millis;
+
+    if (events && focus_changed()) {
+        return true;
+    }
+
+    const int x_fd = events ? ConnectionNumber(display) : -1;
+
+    struct timeval deadline;
+    gettimeofday(&deadline, NULL);
+    deadline.tv_sec += wait_millis / 1000;
+    deadline.tv_usec += (wait_millis % 1000) * 1000;
+    if (deadline.tv_usec >= 1000000) {
+        deadline.tv_sec++;
+        deadline.tv_usec -= 1000000;
+    }
+
+    while (true) {
+        struct timeval now, timeout;
+        gettimeofday(&now, NULL);
+        timersub(&deadline, &now, &timeout);
+        if (timeout.tv_sec < 0) {
+            return true;
+        }
+
+        fd_set fds;
+        FD_ZERO(&fds);
+        int max_fd = -1;
+        if (x_fd >= 0) {
+            FD_SET(x_fd, &fds);
+            max_fd = x_fd;
+        }
+        if (wake_pipe[0] >= 0) {
+            FD_SET(wake_pipe[0], &fds);
+            if (wake_pipe[0] > max_fd) {
+                max_fd = wake_pipe[0];
+            }
+        }
+
+        int ready = select(max_fd + 1, &fds, NULL, NULL, &timeout);
+        if (ready < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return true;
+        }
+        if (!ready) {
+            // Timed out, inspect anyway
+            return true;
+        }
+        if (wake_pipe[0] >= 0 && FD_ISSET(wake_pipe[0], &fds)) {
+            drain_wake_pipe();
+            return false;
+        }
+        if (x_fd >= 0 && FD_ISSET(x_fd, &fds) && focus_changed()) {
+            return true;
+        }
+    }
+}
+
+void cancelWaitForFocusChange() {
+    pthread_once(&wake_pipe_once, create_wake_pipe);
+    if (wake_pipe[1] >= 0) {
+        char c = 0;
+        HANDLE_EINTR(write(wake_pipe[1], &c, 1));
+    }
+}
@@ -5,6 +5,8 @@
 
 #include <string>
 
+#include "Poco/Event.h"
+
 #include "./get_focused_window.h"
 
 static const int kTitleBufferSize = 255;
@@ -89,3 +91,15 @@ int getFocusedWindowInfo(
 
     return 0;
 }
+
+// Focus changes are not observed here, so the window
+// change recorder polls at the given interval.
+static Poco::Event focus_wait_cancelled;
+
+bool waitForFocusChange(const int timeout_millis) {
+    return !focus_wait_cancelled.tryWait(timeout_millis);
+}
+
+void cancelWaitForFocusChange() {
+    focus_wait_cancelled.set();
+}
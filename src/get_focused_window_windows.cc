@@ -6,6 +6,7 @@
 #include <time.h>
 #include <string>
 
+#include "Poco/Event.h"
 #include "Poco/UnicodeConverter.h"
 
 #include "./get_focused_window.h"
@@ -81,3 +82,15 @@ int getFocusedWindowInfo(
 
     return 0;
 }
+
+// Focus changes are not observed here, so the window
+// change recorder polls at the given interval.
+static Poco::Event focus_wait_cancelled;
+
+bool waitForFocusChange(const int timeout_millis) {
+    return !focus_wait_cancelled.tryWait(timeout_millis);
+}
+
+void cancelWaitForFocusChange() {
+    focus_wait_cancelled.set();
+}
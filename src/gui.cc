@@ -25,7 +25,107 @@ namespace toggl {
 namespace view {
 
 bool TimeEntry::operator == (const TimeEntry& a) const {
-    return false;
+    return DurationInSeconds == a.DurationInSeconds
+           && Description == a.Description
+           && ProjectAndTaskLabel == a.ProjectAndTaskLabel
+           && TaskLabel == a.TaskLabel
+           && ProjectLabel == a.ProjectLabel
+           && ClientLabel == a.ClientLabel
+           && WID == a.WID
+           && PID == a.PID
+           && TID == a.TID
+           && Duration == a.Duration
+           && Color == a.Color
+           && GUID == a.GUID
+           && Billable == a.Billable
+           && Tags == a.Tags
+           && Started == a.Started
+           && Ended == a.Ended
+           && StartTimeString == a.StartTimeString
+           && EndTimeString == a.EndTimeString
+           && UpdatedAt == a.UpdatedAt
+           && DurOnly == a.DurOnly
+           && DateHeader == a.DateHeader
+           && DateDuration == a.DateDuration
+           && CanAddProjects == a.CanAddProjects
+           && CanSeeBillable == a.CanSeeBillable
+           && DefaultWID == a.DefaultWID
+           && WorkspaceName == a.WorkspaceName
+           && Unsynced == a.Unsynced
+           && Error == a.Error
+           && Locked == a.Locked;
+}
+
+bool IsDateHeader(
+    const std::vector<TimeEntry> &list,
+    const size_t i) {
+    return !i || list[i].DateHeader != list[i - 1].DateHeader;
+}
+
+void DiffTimeEntryList(
+    const std::vector<TimeEntry> &from,
+    const std::vector<TimeEntry> &to,
+    std::vector<TimeEntryListChange> *changes) {
+    changes->clear();
+
+    std::set<std::string> wanted;
+    for (size_t i = 0; i < to.size(); i++) {
+        wanted.insert(to[i].GUID);
+    }
+
+    // Remove from the end, so that indexes stay valid
+    for (size_t i = from.size(); i > 0; i--) {
+        if (!wanted.count(from[i - 1].GUID)) {
+            TimeEntryListChange change;
+            change.Type = kTimeEntryListChangeRemove;
+            change.Index = i - 1;
+            changes->push_back(change);
+        }
+    }
+
+    // Indexes in "from" of the items displayed after the
+    // changes so far. Inserted items are marked with from.size().
+    std::vector<size_t> displayed;
+    for (size_t i = 0; i < from.size(); i++) {
+        if (wanted.count(from[i].GUID)) {
+            displayed.push_back(i);
+        }
+    }
+
+    for (size_t i = 0; i < to.size(); i++) {
+        TimeEntryListChange change;
+        change.Index = i;
+
+        if (i < displayed.size() && displayed[i] < from.size()
+                && from[displayed[i]].GUID == to[i].GUID) {
+            if (from[displayed[i]] == to[i]
+                    && IsDateHeader(from, displayed[i])
+                    == IsDateHeader(to, i)) {
+                continue;
+            }
+            change.Type = kTimeEntryListChangeUpdate;
+            changes->push_back(change);
+            continue;
+        }
+
+        size_t j = i + 1;
+        while (j < displayed.size()
+                && (displayed[j] >= from.size()
+                    || from[displayed[j]].GUID != to[i].GUID)) {
+            j++;
+        }
+        if (j < displayed.size()) {
+            change.Type = kTimeEntryListChangeMove;
+            change.OldIndex = j;
+            size_t index = displayed[j];
+            displayed.erase(displayed.begin() + j);
+            displayed.insert(displayed.begin() + i, index);
+        } else {
+            change.Type = kTimeEntryListChangeInsert;
+            displayed.insert(displayed.begin() + i, from.size());
+        }
+        changes->push_back(change);
+    }
 }
 
 void TimeEntry::Fill(toggl::TimeEntry * const model) {
@@ -125,6 +225,16 @@ void GUI::DisplayLogin(const bool open, const uint64_t user_id) {
     lastDisplayLoginUserID = user_id;
 }
 
+void GUI::DisplayDataComplete(const uint64_t user_id) {
+    std::stringstream ss;
+    ss << "DisplayDataComplete user_id=" << user_id;
+    logger().debug(ss.str());
+
+    if (on_display_data_complete_) {
+        on_display_data_complete_(user_id);
+    }
+}
+
 error GUI::DisplayError(const error err) {
     if (noError == err) {
         return noError;
@@ -195,13 +305,16 @@ error GUI::findMissingCallbacks() {
     if (!on_display_reminder_) {
         return error("!on_display_reminder_");
     }
-    if (!on_display_time_entry_list_) {
+    if (!on_display_time_entry_list_ && !on_display_time_entry_array_
+            && !on_display_time_entry_list_diff_) {
         return error("!on_display_time_entry_list_");
     }
-    if (!on_display_time_entry_autocomplete_) {
+    if (!on_display_time_entry_autocomplete_
+            && !on_display_time_entry_autocomplete_array_) {
         return error("!on_display_time_entry_autocomplete_");
     }
-    if (!on_display_project_autocomplete_) {
+    if (!on_display_project_autocomplete_
+            && !on_display_project_autocomplete_array_) {
         return error("!on_display_project_autocomplete_");
     }
     if (!on_display_workspace_select_) {
@@ -225,7 +338,8 @@ error GUI::findMissingCallbacks() {
     if (!on_display_idle_notification_) {
         return error("!on_display_idle_notification_");
     }
-    if (!on_display_mini_timer_autocomplete_) {
+    if (!on_display_mini_timer_autocomplete_
+            && !on_display_mini_timer_autocomplete_array_) {
         return error("!on_display_mini_timer_autocomplete_");
     }
     if (!on_display_pomodoro_) {
@@ -347,12 +461,17 @@ void GUI::DisplayOnlineState(const Poco::Int64 state) {
 }
 
 void GUI::DisplayTimeEntryAutocomplete(
-    std::vector<toggl::view::Autocomplete> *items) {
+    const std::vector<toggl::view::Autocomplete> *items) {
     logger().debug("DisplayTimeEntryAutocomplete");
 
-    TogglAutocompleteView *first = autocomplete_list_init(items);
-    on_display_time_entry_autocomplete_(first);
-    autocomplete_item_clear(first);
+    Poco::Mutex::ScopedLock lock(render_m_);
+    TogglAutocompleteView *first =
+        autocomplete_list_init(&time_entry_autocomplete_arena_, *items);
+    if (on_display_time_entry_autocomplete_array_) {
+        on_display_time_entry_autocomplete_array_(first, items->size());
+    } else {
+        on_display_time_entry_autocomplete_(first);
+    }
 }
 
 void GUI::DisplayHelpArticles(
@@ -369,21 +488,31 @@ void GUI::DisplayHelpArticles(
 }
 
 void GUI::DisplayMinitimerAutocomplete(
-    std::vector<toggl::view::Autocomplete> *items) {
+    const std::vector<toggl::view::Autocomplete> *items) {
     logger().debug("DisplayMinitimerAutocomplete");
 
-    TogglAutocompleteView *first = autocomplete_list_init(items);
-    on_display_mini_timer_autocomplete_(first);
-    autocomplete_item_clear(first);
+    Poco::Mutex::ScopedLock lock(render_m_);
+    TogglAutocompleteView *first =
+        autocomplete_list_init(&mini_timer_autocomplete_arena_, *items);
+    if (on_display_mini_timer_autocomplete_array_) {
+        on_display_mini_timer_autocomplete_array_(first, items->size());
+    } else {
+        on_display_mini_timer_autocomplete_(first);
+    }
 }
 
 void GUI::DisplayProjectAutocomplete(
-    std::vector<toggl::view::Autocomplete> *items) {
+    const std::vector<toggl::view::Autocomplete> *items) {
     logger().debug("DisplayProjectAutocomplete");
 
-    TogglAutocompleteView *first = autocomplete_list_init(items);
-    on_display_project_autocomplete_(first);
-    autocomplete_item_clear(first);
+    Poco::Mutex::ScopedLock lock(render_m_);
+    TogglAutocompleteView *first =
+        autocomplete_list_init(&project_autocomplete_arena_, *items);
+    if (on_display_project_autocomplete_array_) {
+        on_display_project_autocomplete_array_(first, items->size());
+    } else {
+        on_display_project_autocomplete_(first);
+    }
 }
 
 void GUI::DisplayTimeEntryList(const bool open,
@@ -399,25 +528,23 @@ void GUI::DisplayTimeEntryList(const bool open,
     }
 
     // Render
-    TogglTimeEntryView *first = nullptr;
-    for (unsigned int i = 0; i < list.size(); i++) {
-        view::TimeEntry te = list.at(i);
-        TogglTimeEntryView *item = time_entry_view_item_init(te);
-        item->Next = first;
-        if (first && compare_string(item->DateHeader, first->DateHeader) != 0) {
-            first->IsHeader = true;
+    {
+        Poco::Mutex::ScopedLock lock(render_m_);
+        if (on_display_time_entry_list_diff_) {
+            displayTimeEntryListDiff(open, list, show_load_more_button);
+        } else {
+            TogglTimeEntryView *first =
+                time_entry_view_list_init(&time_entry_arena_, list);
+            if (on_display_time_entry_array_) {
+                on_display_time_entry_array_(
+                    open, first, list.size(), show_load_more_button);
+            } else {
+                on_display_time_entry_list_(
+                    open, first, show_load_more_button);
+            }
         }
-        first = item;
-    }
-
-    if (first) {
-        first->IsHeader = true;
     }
 
-    on_display_time_entry_list_(open, first, show_load_more_button);
-
-    time_entry_view_item_clear(first);
-
     stopwatch.stop();
     {
         std::stringstream ss;
@@ -427,6 +554,55 @@ void GUI::DisplayTimeEntryList(const bool open,
     }
 }
 
+void GUI::displayTimeEntryListDiff(
+    const bool open,
+    const std::vector<view::TimeEntry> &list,
+    const bool show_load_more_button) {
+    // Display order is latest first
+    std::vector<view::TimeEntry> displayed(list.rbegin(), list.rend());
+
+    view::DiffTimeEntryList(
+        time_entry_list_, displayed, &time_entry_list_changes_);
+    time_entry_list_.swap(displayed);
+
+    if (time_entry_list_changes_.empty() && !open
+            && time_entry_list_load_more_ == show_load_more_button) {
+        return;
+    }
+    time_entry_list_load_more_ = show_load_more_button;
+
+    std::vector<const view::TimeEntry *> items;
+    for (size_t i = 0; i < time_entry_list_changes_.size(); i++) {
+        const view::TimeEntryListChange &change = time_entry_list_changes_[i];
+        if (change.Type != kTimeEntryListChangeRemove) {
+            items.push_back(&time_entry_list_[change.Index]);
+        }
+    }
+    TogglTimeEntryView *item =
+        time_entry_view_items_init(&time_entry_arena_, items);
+
+    time_entry_list_change_views_.resize(time_entry_list_changes_.size());
+    for (size_t i = 0; i < time_entry_list_changes_.size(); i++) {
+        const view::TimeEntryListChange &change = time_entry_list_changes_[i];
+        TogglTimeEntryListChange &view = time_entry_list_change_views_[i];
+        view.Type = change.Type;
+        view.Index = change.Index;
+        view.OldIndex = change.OldIndex;
+        view.Item = nullptr;
+        if (change.Type != kTimeEntryListChangeRemove) {
+            item->IsHeader = view::IsDateHeader(time_entry_list_, change.Index);
+            view.Item = item++;
+        }
+    }
+
+    on_display_time_entry_list_diff_(
+        open,
+        time_entry_list_change_views_.empty()
+        ? nullptr : &time_entry_list_change_views_[0],
+        time_entry_list_change_views_.size(),
+        show_load_more_button);
+}
+
 void GUI::DisplayTags(const std::vector<view::Generic> list) {
     logger().debug("DisplayTags");
 
@@ -15,6 +15,8 @@
 #include "./toggl_api_private.h"
 #include "./types.h"
 
+#include "Poco/Mutex.h"
+
 namespace Poco {
 class Logger;
 }
@@ -95,6 +97,31 @@ class TimeEntry {
     bool operator == (const TimeEntry& other) const;
 };
 
+// One step of turning a displayed time entry list into another
+class TimeEntryListChange {
+ public:
+    TimeEntryListChange()
+        : Type(kTimeEntryListChangeRemove)
+    , Index(0)
+    , OldIndex(0) {}
+
+    uint64_t Type;
+    size_t Index;
+    size_t OldIndex;
+};
+
+// Lists are in display order. Items are matched by GUID.
+// Item data for inserts, moves and updates is to[Index].
+void DiffTimeEntryList(
+    const std::vector<TimeEntry> &from,
+    const std::vector<TimeEntry> &to,
+    std::vector<TimeEntryListChange> *changes);
+
+// First item of each date is displayed as a date header
+bool IsDateHeader(
+    const std::vector<TimeEntry> &list,
+    const size_t i);
+
 class Autocomplete {
  public:
     Autocomplete()
@@ -331,6 +358,13 @@ class GUI : public SyncStateMonitor {
     , on_display_help_articles_(nullptr)
     , on_display_project_colors_(nullptr)
     , on_display_obm_experiment_(nullptr)
+    , on_display_time_entry_array_(nullptr)
+    , on_display_time_entry_autocomplete_array_(nullptr)
+    , on_display_project_autocomplete_array_(nullptr)
+    , on_display_mini_timer_autocomplete_array_(nullptr)
+    , on_display_time_entry_list_diff_(nullptr)
+    , on_display_data_complete_(nullptr)
+    , time_entry_list_load_more_(false)
     , lastSyncState(-1)
     , lastUnsyncedItemsCount(-1)
     , lastDisplayLoginOpen(false)
@@ -363,11 +397,14 @@ class GUI : public SyncStateMonitor {
         toggl::Project *const p,
         toggl::Task *const t);
 
-    void DisplayMinitimerAutocomplete(std::vector<toggl::view::Autocomplete> *);
+    void DisplayMinitimerAutocomplete(
+        const std::vector<toggl::view::Autocomplete> *);
 
-    void DisplayTimeEntryAutocomplete(std::vector<toggl::view::Autocomplete> *);
+    void DisplayTimeEntryAutocomplete(
+        const std::vector<toggl::view::Autocomplete> *);
 
-    void DisplayProjectAutocomplete(std::vector<toggl::view::Autocomplete> *);
+    void DisplayProjectAutocomplete(
+        const std::vector<toggl::view::Autocomplete> *);
 
     void DisplayTimeEntryList(
         const bool open,
@@ -398,6 +435,8 @@ class GUI : public SyncStateMonitor {
 
     void DisplayLogin(const bool open, const uint64_t user_id);
 
+    void DisplayDataComplete(const uint64_t user_id);
+
     void DisplaySettings(
         const bool open,
         const bool record_timeline,
@@ -481,6 +520,19 @@ class GUI : public SyncStateMonitor {
         on_display_time_entry_list_ = cb;
     }
 
+    void OnDisplayTimeEntryArray(TogglDisplayTimeEntryArray cb) {
+        on_display_time_entry_array_ = cb;
+    }
+
+    void OnDisplayTimeEntryListDiff(TogglDisplayTimeEntryListDiff cb) {
+        on_display_time_entry_list_diff_ = cb;
+        time_entry_list_.clear();
+    }
+
+    void OnDisplayDataComplete(TogglDisplayDataComplete cb) {
+        on_display_data_complete_ = cb;
+    }
+
     void OnDisplayWorkspaceSelect(TogglDisplayViewItems cb) {
         on_display_workspace_select_ = cb;
     }
@@ -505,6 +557,16 @@ class GUI : public SyncStateMonitor {
         on_display_project_autocomplete_ = cb;
     }
 
+    void OnDisplayTimeEntryAutocompleteArray(
+        TogglDisplayAutocompleteArray cb) {
+        on_display_time_entry_autocomplete_array_ = cb;
+    }
+
+    void OnDisplayProjectAutocompleteArray(
+        TogglDisplayAutocompleteArray cb) {
+        on_display_project_autocomplete_array_ = cb;
+    }
+
     void OnDisplaySettings(TogglDisplaySettings cb) {
         on_display_settings_ = cb;
     }
@@ -521,6 +583,11 @@ class GUI : public SyncStateMonitor {
         on_display_mini_timer_autocomplete_ = cb;
     }
 
+    void OnDisplayMinitimerAutocompleteArray(
+        TogglDisplayAutocompleteArray cb) {
+        on_display_mini_timer_autocomplete_array_ = cb;
+    }
+
     void OnDisplaySyncState(TogglDisplaySyncState cb) {
         on_display_sync_state_ = cb;
     }
@@ -575,6 +642,11 @@ class GUI : public SyncStateMonitor {
  private:
     error findMissingCallbacks();
 
+    void displayTimeEntryListDiff(
+        const bool open,
+        const std::vector<view::TimeEntry> &list,
+        const bool show_load_more_button);
+
     TogglDisplayApp on_display_app_;
     TogglDisplayError on_display_error_;
     TogglDisplayOnlineState on_display_online_state_;
@@ -604,6 +676,26 @@ class GUI : public SyncStateMonitor {
     TogglDisplayHelpArticles on_display_help_articles_;
     TogglDisplayProjectColors on_display_project_colors_;
     TogglDisplayObmExperiment on_display_obm_experiment_;
+    TogglDisplayTimeEntryArray on_display_time_entry_array_;
+    TogglDisplayAutocompleteArray on_display_time_entry_autocomplete_array_;
+    TogglDisplayAutocompleteArray on_display_project_autocomplete_array_;
+    TogglDisplayAutocompleteArray on_display_mini_timer_autocomplete_array_;
+    TogglDisplayTimeEntryListDiff on_display_time_entry_list_diff_;
+    TogglDisplayDataComplete on_display_data_complete_;
+
+    // Rendered lists, reused between renders.
+    // UI can be updated from several threads.
+    Poco::Mutex render_m_;
+    ViewArena<TogglTimeEntryView> time_entry_arena_;
+    ViewArena<TogglAutocompleteView> time_entry_autocomplete_arena_;
+    ViewArena<TogglAutocompleteView> project_autocomplete_arena_;
+    ViewArena<TogglAutocompleteView> mini_timer_autocomplete_arena_;
+
+    // Time entry list as last displayed, for diffing
+    std::vector<view::TimeEntry> time_entry_list_;
+    bool time_entry_list_load_more_;
+    std::vector<view::TimeEntryListChange> time_entry_list_changes_;
+    std::vector<TogglTimeEntryListChange> time_entry_list_change_views_;
 
     // Cached views
     Poco::Int64 lastSyncState;
@@ -29,10 +29,12 @@
 #include "Poco/Net/HTTPSClientSession.h"
 #include "Poco/Net/InvalidCertificateHandler.h"
 #include "Poco/Net/NameValueCollection.h"
+#include "Poco/Net/NetException.h"
 #include "Poco/Net/PrivateKeyPassphraseHandler.h"
 #include "Poco/Net/SecureStreamSocket.h"
 #include "Poco/Net/Session.h"
 #include "Poco/Net/SSLManager.h"
+#include "Poco/NullStream.h"
 #include "Poco/NumberParser.h"
 #include "Poco/StreamCopier.h"
 #include "Poco/TextEncoding.h"
@@ -49,6 +51,7 @@ void ServerStatus::startStatusCheck() {
     if (checker_.isRunning()) {
         return;
     }
+    stop_requested_.reset();
     checker_.start();
 }
 
@@ -62,6 +65,7 @@ void ServerStatus::stopStatusCheck(const std::string reason) {
     logger().debug(ss.str());
 
     checker_.stop();
+    stop_requested_.set();
     checker_.wait();
 }
 
@@ -88,15 +92,10 @@ void ServerStatus::runActivity() {
             logger().debug(ss.str());
         }
 
-        // Sleep a bit
-        for (int i = 0; i < delay_seconds; i++) {
-            if (checker_.isStopped()) {
-                return;
-            }
-            Poco::Thread::sleep(1000);
-            if (checker_.isStopped()) {
-                return;
-            }
+        // Sleep a bit, stopping the check wakes us up
+        if (stop_requested_.tryWait(delay_seconds * 1000)
+                || checker_.isStopped()) {
+            return;
         }
 
         // Check server status
@@ -164,7 +163,200 @@ void ServerStatus::UpdateStatus(const Poco::Int64 code) {
     stopStatusCheck(ss.str());
 }
 
+std::string HTTPSSessionPool::key(const Poco::URI &uri) const {
+    std::stringstream ss;
+    ss << uri.getHost() << ":" << uri.getPort();
+    return ss.str();
+}
+
+void HTTPSSessionPool::checkConfig() {
+    std::stringstream ss;
+    ss << HTTPSClient::Config.CACertPath
+       << "|" << HTTPSClient::Config.IgnoreCert
+       << "|" << HTTPSClient::Config.UseProxy
+       << "|" << HTTPSClient::Config.AutodetectProxy
+       << "|" << HTTPSClient::Config.ProxySettings.Host()
+       << "|" << HTTPSClient::Config.ProxySettings.Port()
+       << "|" << HTTPSClient::Config.ProxySettings.Username()
+       << "|" << HTTPSClient::Config.ProxySettings.Password();
+    std::string config = ss.str();
+
+    if (!context_.isNull() && config == config_) {
+        return;
+    }
+
+    for (std::map<std::string, std::vector<IdleSession> >::iterator it =
+        idle_.begin(); it != idle_.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            delete it->second[i].Session;
+        }
+    }
+    idle_.clear();
+    tls_sessions_.clear();
+    generation_++;
+
+    Poco::SharedPtr<Poco::Net::InvalidCertificateHandler>
+    acceptCertHandler =
+        new Poco::Net::AcceptCertificateHandler(true);
+
+    Poco::Net::Context::VerificationMode verification_mode =
+        Poco::Net::Context::VERIFY_RELAXED;
+    if (HTTPSClient::Config.IgnoreCert) {
+        verification_mode = Poco::Net::Context::VERIFY_NONE;
+    }
+    context_ = new Poco::Net::Context(
+        Poco::Net::Context::CLIENT_USE, "", "",
+        HTTPSClient::Config.CACertPath,
+        verification_mode, 9, true, "ALL");
+    context_->enableSessionCache(true);
+
+    Poco::Net::SSLManager::instance().initializeClient(
+        0, acceptCertHandler, context_);
+
+    config_ = config;
+}
+
+void HTTPSSessionPool::evictIdle() {
+    Poco::Timestamp::TimeDiff max_idle =
+        kHTTPSessionIdleSeconds * kOneSecondInMicros;
+    for (std::map<std::string, std::vector<IdleSession> >::iterator it =
+        idle_.begin(); it != idle_.end(); ++it) {
+        std::vector<IdleSession> &list = it->second;
+        for (std::vector<IdleSession>::iterator s = list.begin();
+                s != list.end(); ) {
+            if (s->LastUsed.isElapsed(max_idle)) {
+                delete s->Session;
+                s = list.erase(s);
+            } else {
+                ++s;
+            }
+        }
+    }
+}
+
+Poco::Net::HTTPSClientSession *HTTPSSessionPool::Acquire(
+    const Poco::URI &uri,
+    bool *fresh) {
+    poco_check_ptr(fresh);
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    checkConfig();
+    evictIdle();
+
+    std::string host_key = key(uri);
+
+    Poco::Net::HTTPSClientSession *session = nullptr;
+    std::vector<IdleSession> &list = idle_[host_key];
+    while (!list.empty() && !session) {
+        // Most recently used session is least likely to be closed
+        session = list.back().Session;
+        list.pop_back();
+        if (closedByPeer(session)) {
+            delete session;
+            session = nullptr;
+        }
+    }
+    if (session) {
+        *fresh = false;
+    } else {
+        Poco::Net::Session::Ptr tls_session;
+        std::map<std::string, Poco::Net::Session::Ptr>::const_iterator it =
+            tls_sessions_.find(host_key);
+        if (it != tls_sessions_.end()) {
+            tls_session = it->second;
+        }
+        session = new Poco::Net::HTTPSClientSession(
+            uri.getHost(), uri.getPort(), context_, tls_session);
+        session->setKeepAlive(true);
+        session->setKeepAliveTimeout(
+            Poco::Timespan(kHTTPSessionIdleSeconds, 0));
+        *fresh = true;
+    }
+
+    leased_[session] = generation_;
+    return session;
+}
+
+bool HTTPSSessionPool::closedByPeer(
+    Poco::Net::HTTPSClientSession *session) {
+    // An idle connection has nothing to read, unless the
+    // server has closed it
+    try {
+        return session->socket().poll(
+            Poco::Timespan(0), Poco::Net::Socket::SELECT_READ);
+    } catch(const Poco::Exception &) {
+        return true;
+    }
+}
+
+void HTTPSSessionPool::Release(
+    const Poco::URI &uri,
+    Poco::Net::HTTPSClientSession *session,
+    const bool reusable) {
+    poco_check_ptr(session);
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    Poco::UInt64 generation(0);
+    std::map<Poco::Net::HTTPSClientSession *, Poco::UInt64>::iterator it =
+        leased_.find(session);
+    if (it != leased_.end()) {
+        generation = it->second;
+        leased_.erase(it);
+    }
+
+    if (!reusable || generation != generation_ || !session->connected()) {
+        delete session;
+        return;
+    }
+
+    std::string host_key = key(uri);
+    if (!session->sslSession().isNull()) {
+        tls_sessions_[host_key] = session->sslSession();
+    }
+    idle_[host_key].push_back(IdleSession(session, generation));
+}
+
+void HTTPSSessionPool::CountRequest(Poco::Net::HTTPSClientSession *session) {
+    poco_check_ptr(session);
+
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    requests_++;
+    if (!session->connected()) {
+        handshakes_++;
+    }
+}
+
+void HTTPSSessionPool::Clear() {
+    Poco::Mutex::ScopedLock lock(mutex_);
+
+    for (std::map<std::string, std::vector<IdleSession> >::iterator it =
+        idle_.begin(); it != idle_.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            delete it->second[i].Session;
+        }
+    }
+    idle_.clear();
+    tls_sessions_.clear();
+    context_ = nullptr;
+    config_ = "";
+    generation_++;
+}
+
+Poco::UInt64 HTTPSSessionPool::Handshakes() {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return handshakes_;
+}
+
+Poco::UInt64 HTTPSSessionPool::Requests() {
+    Poco::Mutex::ScopedLock lock(mutex_);
+    return requests_;
+}
+
 HTTPSClientConfig HTTPSClient::Config;
+HTTPSSessionPool HTTPSClient::Sessions;
 std::map<std::string, Poco::Timestamp> HTTPSClient::banned_until_;
 
 Poco::Logger &HTTPSClient::logger() const {
@@ -175,6 +367,11 @@ bool HTTPSClient::isRedirect(const Poco::Int64 status_code) const {
     return (status_code >= 300 && status_code < 400);
 }
 
+bool HTTPSClient::isIdempotent(const std::string &method) const {
+    return Poco::Net::HTTPRequest::HTTP_GET == method
+           || Poco::Net::HTTPRequest::HTTP_HEAD == method;
+}
+
 error HTTPSClient::statusCodeToError(const Poco::Int64 status_code) const {
     switch (status_code) {
     case 200:
@@ -311,181 +508,225 @@ HTTPSResponse HTTPSClient::makeHttpRequest(
     try {
         Poco::URI uri(req.host);
 
-        Poco::SharedPtr<Poco::Net::InvalidCertificateHandler>
-        acceptCertHandler =
-            new Poco::Net::AcceptCertificateHandler(true);
-
-        Poco::Net::Context::VerificationMode verification_mode =
-            Poco::Net::Context::VERIFY_RELAXED;
-        if (HTTPSClient::Config.IgnoreCert) {
-            verification_mode = Poco::Net::Context::VERIFY_NONE;
-        }
-        Poco::Net::Context::Ptr context = new Poco::Net::Context(
-            Poco::Net::Context::CLIENT_USE, "", "",
-            HTTPSClient::Config.CACertPath,
-            verification_mode, 9, true, "ALL");
+        std::string encoded_url("");
+        Poco::URI::encode(req.relative_url, "", encoded_url);
 
-        Poco::Net::SSLManager::instance().initializeClient(
-            0, acceptCertHandler, context);
+        for (int attempt = 1; ; attempt++) {
+            bool fresh(false);
+            Poco::Net::HTTPSClientSession *session =
+                Sessions.Acquire(uri, &fresh);
+
+            if (fresh) {
+                error err = Netconf::ConfigureProxy(
+                    req.host + encoded_url, session);
+                if (err != noError) {
+                    Sessions.Release(uri, session, false);
+                    resp.err = error("Error while configuring proxy: " + err);
+                    logger().error(resp.err);
+                    return resp;
+                }
+            }
 
-        Poco::Net::HTTPSClientSession session(uri.getHost(), uri.getPort(),
-                                              context);
+            // An idle keep-alive connection may have been
+            // closed by the server in the meanwhile.
+            bool stale = !fresh && session->connected();
 
-        session.setKeepAlive(false);
-        session.setTimeout(
-            Poco::Timespan(req.timeout_seconds * Poco::Timespan::SECONDS));
+            session->setTimeout(
+                Poco::Timespan(req.timeout_seconds * Poco::Timespan::SECONDS));
 
-        {
-            std::stringstream ss;
-            ss << "Sending request to "
-               << req.host << req.relative_url << " ..";
-            logger().debug(ss.str());
-        }
+            {
+                std::stringstream ss;
+                ss << "Sending request to "
+                   << req.host << req.relative_url << " ..";
+                logger().debug(ss.str());
+            }
 
-        std::string encoded_url("");
-        Poco::URI::encode(req.relative_url, "", encoded_url);
+            Sessions.CountRequest(session);
+
+            bool sent(false);
+            try {
+                resp = exchange(req, encoded_url, session, &sent);
+            } catch(const Poco::Net::NetException& exc) {
+                Sessions.Release(uri, session, false);
+                if (!stale || attempt > 1) {
+                    throw;
+                }
+                // The server may have got a request that failed while
+                // reading the response, so only requests that are
+                // safe to repeat are sent again.
+                if (sent && !isIdempotent(req.method)) {
+                    throw;
+                }
+                logger().debug("Reconnecting, because keep-alive connection "
+                               "failed: " + exc.displayText());
+                continue;
+            } catch(...) {
+                Sessions.Release(uri, session, false);
+                throw;
+            }
 
-        error err = Netconf::ConfigureProxy(req.host + encoded_url, &session);
-        if (err != noError) {
-            resp.err = error("Error while configuring proxy: " + err);
-            logger().error(resp.err);
-            return resp;
+            Sessions.Release(uri, session, true);
+            break;
         }
+    } catch(const Poco::Exception& exc) {
+        resp.err = exc.displayText();
+        return resp;
+    } catch(const std::exception& ex) {
+        resp.err = ex.what();
+        return resp;
+    } catch(const std::string& ex) {
+        resp.err = ex;
+        return resp;
+    }
+    return resp;
+}
 
-        Poco::Net::HTTPRequest poco_req(req.method,
-                                        encoded_url,
-                                        Poco::Net::HTTPMessage::HTTP_1_1);
-        poco_req.setKeepAlive(false);
+HTTPSResponse HTTPSClient::exchange(
+    HTTPSRequest req,
+    const std::string encoded_url,
+    Poco::Net::HTTPSClientSession *session,
+    bool *sent) {
 
-        // FIXME: should get content type as parameter instead
-        if (req.payload.size()) {
-            poco_req.setContentType(kContentTypeApplicationJSON);
-        }
-        poco_req.set("User-Agent", HTTPSClient::Config.UserAgent());
-        poco_req.setChunkedTransferEncoding(true);
-
-        Poco::Net::HTTPBasicCredentials cred(
-            req.basic_auth_username, req.basic_auth_password);
-        if (!req.basic_auth_username.empty()
-                && !req.basic_auth_password.empty()) {
-            cred.authenticate(poco_req);
-        }
+    poco_check_ptr(sent);
 
-        if (!req.form) {
-            std::istringstream requestStream(req.payload);
+    HTTPSResponse resp;
 
-            Poco::DeflatingInputStream gzipRequest(
-                requestStream,
-                Poco::DeflatingStreamBuf::STREAM_GZIP);
-            Poco::DeflatingStreamBuf *pBuff = gzipRequest.rdbuf();
+    Poco::Net::HTTPRequest poco_req(req.method,
+                                    encoded_url,
+                                    Poco::Net::HTTPMessage::HTTP_1_1);
+    poco_req.setKeepAlive(true);
 
-            Poco::Int64 size =
-                pBuff->pubseekoff(0, std::ios::end, std::ios::in);
-            pBuff->pubseekpos(0, std::ios::in);
+    // FIXME: should get content type as parameter instead
+    if (req.payload.size()) {
+        poco_req.setContentType(kContentTypeApplicationJSON);
+    }
+    poco_req.set("User-Agent", HTTPSClient::Config.UserAgent());
+    poco_req.setChunkedTransferEncoding(true);
+
+    Poco::Net::HTTPBasicCredentials cred(
+        req.basic_auth_username, req.basic_auth_password);
+    if (!req.basic_auth_username.empty()
+            && !req.basic_auth_password.empty()) {
+        cred.authenticate(poco_req);
+    }
 
-            poco_req.setContentLength(size);
-            poco_req.set("Content-Encoding", "gzip");
+    if (!req.form && req.payload_gzipped) {
+        poco_req.setContentLength(req.payload.size());
+        poco_req.set("Content-Encoding", "gzip");
 
-            session.sendRequest(poco_req) << pBuff << std::flush;
-        } else {
-            req.form->prepareSubmit(poco_req);
-            std::ostream& send = session.sendRequest(poco_req);
-            req.form->write(send);
-        }
+        session->sendRequest(poco_req) << req.payload << std::flush;
+    } else if (!req.form) {
+        std::istringstream requestStream(req.payload);
 
-        // Request gzip unless downloading files
-        poco_req.set("Accept-Encoding", "gzip");
+        Poco::DeflatingInputStream gzipRequest(
+            requestStream,
+            Poco::DeflatingStreamBuf::STREAM_GZIP);
+        Poco::DeflatingStreamBuf *pBuff = gzipRequest.rdbuf();
 
-        // Log out request contents
-        std::stringstream request_string;
-        poco_req.write(request_string);
-        logger().debug(request_string.str());
+        Poco::Int64 size =
+            pBuff->pubseekoff(0, std::ios::end, std::ios::in);
+        pBuff->pubseekpos(0, std::ios::in);
 
-        logger().debug("Request sent. Receiving response..");
+        poco_req.setContentLength(size);
+        poco_req.set("Content-Encoding", "gzip");
 
-        // Receive response
-        Poco::Net::HTTPResponse response;
-        std::istream& is = session.receiveResponse(response);
+        session->sendRequest(poco_req) << pBuff << std::flush;
+    } else {
+        req.form->prepareSubmit(poco_req);
+        std::ostream& send = session->sendRequest(poco_req);
+        req.form->write(send);
+    }
 
-        resp.status_code = response.getStatus();
+    *sent = true;
 
-        {
-            std::stringstream ss;
-            ss << "Response status code " << response.getStatus()
-               << ", content length " << response.getContentLength()
-               << ", content type " << response.getContentType();
-            if (response.has("Content-Encoding")) {
-                ss << ", content encoding " << response.get("Content-Encoding");
-            } else {
-                ss << ", unknown content encoding";
-            }
-            logger().debug(ss.str());
-        }
+    // Request gzip unless downloading files
+    poco_req.set("Accept-Encoding", "gzip");
 
-        // Log out X-Toggl-Request-Id, so failed requests can be traced
-        if (response.has("X-Toggl-Request-Id")) {
-            logger().debug("X-Toggl-Request-Id "
-                           + response.get("X-Toggl-Request-Id"));
-        }
+    // Log out request contents
+    std::stringstream request_string;
+    poco_req.write(request_string);
+    logger().debug(request_string.str());
 
-        // Print out response headers
-        Poco::Net::NameValueCollection::ConstIterator it = response.begin();
-        while (it != response.end()) {
-            logger().debug(it->first + ": " + it->second);
-            ++it;
-        }
+    logger().debug("Request sent. Receiving response..");
 
-        // When we get redirect, set the Location as response body
-        if (isRedirect(resp.status_code) && response.has("Location")) {
-            std::string decoded_url("");
-            Poco::URI::decode(response.get("Location"), decoded_url);
-            resp.body = decoded_url;
-
-            // Inflate, if gzip was sent
-        } else if (response.has("Content-Encoding") &&
-                   "gzip" == response.get("Content-Encoding")) {
-            Poco::InflatingInputStream inflater(
-                is,
-                Poco::InflatingStreamBuf::STREAM_GZIP);
-            {
-                std::stringstream ss;
-                ss << inflater.rdbuf();
-                resp.body = ss.str();
-            }
+    // Receive response
+    Poco::Net::HTTPResponse response;
+    std::istream& is = session->receiveResponse(response);
+
+    resp.status_code = response.getStatus();
 
-            // Write the response to string
+    {
+        std::stringstream ss;
+        ss << "Response status code " << response.getStatus()
+           << ", content length " << response.getContentLength()
+           << ", content type " << response.getContentType();
+        if (response.has("Content-Encoding")) {
+            ss << ", content encoding " << response.get("Content-Encoding");
         } else {
-            std::streamsize n =
-                Poco::StreamCopier::copyToString(is, resp.body);
-            std::stringstream ss;
-            ss << n << " characters transferred with download";
-            logger().debug(ss.str());
+            ss << ", unknown content encoding";
         }
+        logger().debug(ss.str());
+    }
 
-        logger().trace(resp.body);
+    // Log out X-Toggl-Request-Id, so failed requests can be traced
+    if (response.has("X-Toggl-Request-Id")) {
+        logger().debug("X-Toggl-Request-Id "
+                       + response.get("X-Toggl-Request-Id"));
+    }
 
-        if (429 == resp.status_code) {
-            Poco::Timestamp ts = Poco::Timestamp() + (60 * kOneSecondInMicros);
-            banned_until_[req.host] = ts;
+    // Print out response headers
+    Poco::Net::NameValueCollection::ConstIterator it = response.begin();
+    while (it != response.end()) {
+        logger().debug(it->first + ": " + it->second);
+        ++it;
+    }
 
+    // When we get redirect, set the Location as response body
+    if (isRedirect(resp.status_code) && response.has("Location")) {
+        std::string decoded_url("");
+        Poco::URI::decode(response.get("Location"), decoded_url);
+        resp.body = decoded_url;
+
+        // Inflate, if gzip was sent
+    } else if (response.has("Content-Encoding") &&
+               "gzip" == response.get("Content-Encoding")) {
+        Poco::InflatingInputStream inflater(
+            is,
+            Poco::InflatingStreamBuf::STREAM_GZIP);
+        {
             std::stringstream ss;
-            ss << "Server indicated we're making too many requests to host "
-               << req.host << ". So we cannot make new requests until "
-               << Formatter::Format8601(ts);
-            logger().debug(ss.str());
+            ss << inflater.rdbuf();
+            resp.body = ss.str();
         }
 
-        resp.err = statusCodeToError(resp.status_code);
-    } catch(const Poco::Exception& exc) {
-        resp.err = exc.displayText();
-        return resp;
-    } catch(const std::exception& ex) {
-        resp.err = ex.what();
-        return resp;
-    } catch(const std::string& ex) {
-        resp.err = ex;
-        return resp;
+        // Write the response to string
+    } else {
+        std::streamsize n =
+            Poco::StreamCopier::copyToString(is, resp.body);
+        std::stringstream ss;
+        ss << n << " characters transferred with download";
+        logger().debug(ss.str());
     }
+
+    logger().trace(resp.body);
+
+    if (429 == resp.status_code) {
+        Poco::Timestamp ts = Poco::Timestamp() + (60 * kOneSecondInMicros);
+        banned_until_[req.host] = ts;
+
+        std::stringstream ss;
+        ss << "Server indicated we're making too many requests to host "
+           << req.host << ". So we cannot make new requests until "
+           << Formatter::Format8601(ts);
+        logger().debug(ss.str());
+    }
+
+    resp.err = statusCodeToError(resp.status_code);
+
+    // Read whatever is left, so the connection can be reused
+    Poco::NullOutputStream null;
+    Poco::StreamCopier::copyStream(is, null);
+
     return resp;
 }
 
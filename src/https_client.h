@@ -13,6 +13,10 @@
 #include "./types.h"
 
 #include "Poco/Activity.h"
+#include "Poco/Event.h"
+#include "Poco/Mutex.h"
+#include "Poco/Net/Context.h"
+#include "Poco/Net/Session.h"
 #include "Poco/Timestamp.h"
 
 namespace Poco {
@@ -22,9 +26,12 @@ class Logger;
 namespace Net {
 
 class HTMLForm;
+class HTTPSClientSession;
 
 }
 
+class URI;
+
 }  // namespace Poco
 
 namespace toggl {
@@ -54,6 +61,9 @@ class ServerStatus {
     Poco::Activity<ServerStatus> checker_;
     bool fast_retry_;
 
+    // Set when the check is stopped, to cut its sleep short
+    Poco::Event stop_requested_;
+
     void setGone(const bool value);
     bool gone();
 
@@ -105,6 +115,7 @@ class HTTPSRequest {
     , host("")
     , relative_url("")
     , payload("")
+    , payload_gzipped(false)
     , basic_auth_username("")
     , basic_auth_password("")
     , form(nullptr)
@@ -115,6 +126,8 @@ class HTTPSRequest {
     std::string host;
     std::string relative_url;
     std::string payload;
+    // Payload is gzip compressed already, send as is
+    bool payload_gzipped;
     std::string basic_auth_username;
     std::string basic_auth_password;
     Poco::Net::HTMLForm *form;
@@ -134,6 +147,79 @@ class HTTPSResponse {
     Poco::Int64 status_code;
 };
 
+// Keep-alive HTTPS sessions shared by all HTTP clients.
+// Sessions are pooled per host and share one SSL context,
+// so reconnects can resume the previous TLS session.
+class HTTPSSessionPool {
+ public:
+    HTTPSSessionPool()
+        : context_(nullptr)
+    , generation_(0)
+    , handshakes_(0)
+    , requests_(0) {}
+    ~HTTPSSessionPool() {
+        Clear();
+    }
+
+    // Takes an idle session for the host or creates a new one.
+    // *fresh is set when the session has never been used, so the
+    // caller still has to configure its proxy.
+    Poco::Net::HTTPSClientSession *Acquire(
+        const Poco::URI &uri,
+        bool *fresh);
+
+    // Puts the session back into the pool, or deletes it if
+    // it's not safe to reuse (for example after an error).
+    void Release(
+        const Poco::URI &uri,
+        Poco::Net::HTTPSClientSession *session,
+        const bool reusable);
+
+    // Counts a request made with the session, and a handshake
+    // if the session has to connect first.
+    void CountRequest(Poco::Net::HTTPSClientSession *session);
+
+    void Clear();
+
+    Poco::UInt64 Handshakes();
+    Poco::UInt64 Requests();
+
+ private:
+    class IdleSession {
+     public:
+        IdleSession(
+            Poco::Net::HTTPSClientSession *session,
+            const Poco::UInt64 generation)
+            : Session(session)
+        , Generation(generation) {}
+
+        Poco::Net::HTTPSClientSession *Session;
+        Poco::UInt64 Generation;
+        Poco::Timestamp LastUsed;
+    };
+
+    std::string key(const Poco::URI &uri) const;
+
+    // Drops all sessions and the SSL context, if the
+    // certificate or proxy settings have changed.
+    void checkConfig();
+
+    void evictIdle();
+
+    static bool closedByPeer(Poco::Net::HTTPSClientSession *session);
+
+    Poco::Mutex mutex_;
+    Poco::Net::Context::Ptr context_;
+    std::string config_;
+    Poco::UInt64 generation_;
+    std::map<std::string, std::vector<IdleSession> > idle_;
+    std::map<std::string, Poco::Net::Session::Ptr> tls_sessions_;
+    std::map<Poco::Net::HTTPSClientSession *, Poco::UInt64> leased_;
+
+    Poco::UInt64 handshakes_;
+    Poco::UInt64 requests_;
+};
+
 class HTTPSClient {
  public:
     HTTPSClient() {}
@@ -150,6 +236,8 @@ class HTTPSClient {
 
     static HTTPSClientConfig Config;
 
+    static HTTPSSessionPool Sessions;
+
  protected:
     virtual HTTPSResponse request(
         HTTPSRequest req);
@@ -164,8 +252,18 @@ class HTTPSClient {
 
     bool isRedirect(const Poco::Int64 status_code) const;
 
+    // Requests that can be repeated without side effects
+    bool isIdempotent(const std::string &method) const;
+
     virtual HTTPSResponse makeHttpRequest(
         HTTPSRequest req);
+
+    // sent is set once the request has been written out in full
+    HTTPSResponse exchange(
+        HTTPSRequest req,
+        const std::string encoded_url,
+        Poco::Net::HTTPSClientSession *session,
+        bool *sent);
 };
 
 class SyncStateMonitor {
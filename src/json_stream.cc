@@ -0,0 +1,192 @@
+// Copyright 2014 Toggl Desktop developers.
+
+#include "../src/json_stream.h"
+
+#include <string>
+
+namespace toggl {
+
+bool JSONStream::fail() {
+    failed_ = true;
+    return false;
+}
+
+void JSONStream::skipWhitespace() {
+    while (pos_ < json_.size()) {
+        char c = json_[pos_];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            return;
+        }
+        pos_++;
+    }
+}
+
+bool JSONStream::skipString() {
+    // pos_ is at the opening quote
+    for (pos_++; pos_ < json_.size(); pos_++) {
+        char c = json_[pos_];
+        if ('\\' == c) {
+            pos_++;
+        } else if ('"' == c) {
+            pos_++;
+            return true;
+        }
+    }
+    return fail();
+}
+
+bool JSONStream::readString(std::string *value) {
+    size_t start = pos_;
+    if (!skipString()) {
+        return false;
+    }
+    std::string raw = json_.substr(start + 1, pos_ - start - 2);
+    if (raw.find('\\') == std::string::npos) {
+        *value = raw;
+        return true;
+    }
+    // Let jsoncpp deal with escapes
+    Json::Value decoded;
+    Json::Reader reader;
+    if (!reader.parse(json_.data() + start, json_.data() + pos_, decoded)) {
+        return fail();
+    }
+    *value = decoded.asString();
+    return true;
+}
+
+bool JSONStream::begin(const char c) {
+    if (failed_) {
+        return false;
+    }
+    skipWhitespace();
+    if (pos_ >= json_.size() || json_[pos_] != c) {
+        return fail();
+    }
+    pos_++;
+    return true;
+}
+
+bool JSONStream::next(const char end) {
+    if (failed_) {
+        return false;
+    }
+    skipWhitespace();
+    if (pos_ < json_.size() && ',' == json_[pos_]) {
+        pos_++;
+        skipWhitespace();
+    }
+    if (pos_ >= json_.size()) {
+        return fail();
+    }
+    if (end == json_[pos_]) {
+        pos_++;
+        return false;
+    }
+    return true;
+}
+
+bool JSONStream::BeginObject() {
+    return begin('{');
+}
+
+bool JSONStream::BeginArray() {
+    return begin('[');
+}
+
+bool JSONStream::NextMember(std::string *name) {
+    if (!next('}')) {
+        return false;
+    }
+    if (json_[pos_] != '"' || !readString(name)) {
+        return fail();
+    }
+    skipWhitespace();
+    if (pos_ >= json_.size() || json_[pos_] != ':') {
+        return fail();
+    }
+    pos_++;
+    skipWhitespace();
+    return true;
+}
+
+bool JSONStream::NextElement() {
+    return next(']');
+}
+
+char JSONStream::Peek() {
+    skipWhitespace();
+    if (failed_ || pos_ >= json_.size()) {
+        return 0;
+    }
+    return json_[pos_];
+}
+
+bool JSONStream::SkipValue() {
+    if (failed_) {
+        return false;
+    }
+    skipWhitespace();
+    if (pos_ >= json_.size()) {
+        return fail();
+    }
+
+    char c = json_[pos_];
+    if ('"' == c) {
+        return skipString();
+    }
+
+    if ('{' == c || '[' == c) {
+        int depth(0);
+        while (pos_ < json_.size()) {
+            c = json_[pos_];
+            if ('"' == c) {
+                if (!skipString()) {
+                    return false;
+                }
+                continue;
+            }
+            if ('{' == c || '[' == c) {
+                depth++;
+            } else if ('}' == c || ']' == c) {
+                depth--;
+            }
+            pos_++;
+            if (!depth) {
+                return true;
+            }
+        }
+        return fail();
+    }
+
+    // Number, true, false or null
+    size_t start = pos_;
+    while (pos_ < json_.size()) {
+        c = json_[pos_];
+        if (',' == c || '}' == c || ']' == c
+                || ' ' == c || '\t' == c || '\n' == c || '\r' == c) {
+            break;
+        }
+        pos_++;
+    }
+    if (start == pos_) {
+        return fail();
+    }
+    return true;
+}
+
+bool JSONStream::ReadValue(Json::Value *value) {
+    skipWhitespace();
+    size_t start = pos_;
+    if (!SkipValue()) {
+        return false;
+    }
+    Json::Reader reader;
+    if (!reader.parse(json_.data() + start, json_.data() + pos_,
+                      *value, false)) {
+        return fail();
+    }
+    return true;
+}
+
+}  // namespace toggl
@@ -0,0 +1,72 @@
+// Copyright 2014 Toggl Desktop developers.
+
+#ifndef SRC_JSON_STREAM_H_
+#define SRC_JSON_STREAM_H_
+
+#include <json/json.h>
+
+#include <string>
+
+namespace toggl {
+
+// Reads a JSON document one value at a time, without
+// building a Json::Value tree of the whole document.
+// Only the value that is read with ReadValue is parsed,
+// so memory use is bounded by the largest single value.
+class JSONStream {
+ public:
+    explicit JSONStream(const std::string &json)
+        : json_(json)
+    , pos_(0)
+    , failed_(false) {}
+    ~JSONStream() {}
+
+    // Enters the object or array at the current position.
+    bool BeginObject();
+    bool BeginArray();
+
+    // Moves to the value of the next object member.
+    // Returns false at the end of the object.
+    bool NextMember(std::string *name);
+
+    // Moves to the next array element.
+    // Returns false at the end of the array.
+    bool NextElement();
+
+    // Returns the first character of the value at the current
+    // position, for example '[' for an array, or 0 at the end.
+    char Peek();
+
+    // Parses the value at the current position and moves past it.
+    bool ReadValue(Json::Value *value);
+
+    // Moves past the value at the current position.
+    bool SkipValue();
+
+    size_t Position() const {
+        return pos_;
+    }
+    void Seek(const size_t pos) {
+        pos_ = pos;
+    }
+
+    bool Failed() const {
+        return failed_;
+    }
+
+ private:
+    bool fail();
+    void skipWhitespace();
+    bool skipString();
+    bool readString(std::string *value);
+    bool begin(const char c);
+    bool next(const char end);
+
+    const std::string &json_;
+    size_t pos_;
+    bool failed_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_JSON_STREAM_H_
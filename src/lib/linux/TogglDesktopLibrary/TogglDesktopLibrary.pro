@@ -21,6 +21,7 @@ SOURCES += \
     ../../../client.cc \
     ../../../idle.cc \
     ../../../analytics.cc \
+    ../../../autocomplete_index.cc \
     ../../../help_article.cc \
     ../../../autotracker.cc \
     ../../../urls.cc \
@@ -35,6 +36,7 @@ SOURCES += \
     ../../../gui.cc \
     ../../../netconf.cc \
     ../../../https_client.cc \
+    ../../../json_stream.cc \
     $$PWD/../../../../third_party/jsoncpp/dist/jsoncpp.cpp \
     ../../../toggl_api.cc \
     ../../../toggl_api_private.cc \
@@ -46,6 +48,7 @@ SOURCES += \
     ../../../settings.cc \
     ../../../tag.cc \
     ../../../task.cc \
+    ../../../task_scheduler.cc \
     ../../../timeline_event.cc \
     ../../../time_entry.cc \
     ../../../timeline_uploader.cc \
@@ -95,6 +98,7 @@ HEADERS += \
     ../../../const.h \
     ../../../idle.h \
     ../../../analytics.h \
+    ../../../autocomplete_index.h \
     ../../../help_article.h \
     ../../../autotracker.h \
     ../../../urls.h \
@@ -108,6 +112,7 @@ HEADERS += \
     ../../../error.h \
     ../../../gui.h \
     ../../../https_client.h \
+    ../../../json_stream.h \
     ../../../toggl_api_private.h \
     ../../../model_change.h \
     ../../../obm_action.h \
@@ -117,6 +122,7 @@ HEADERS += \
     ../../../settings.h \
     ../../../tag.h \
     ../../../task.h \
+    ../../../task_scheduler.h \
     ../../../time_entry.h \
     ../../../timeline_event.h \
     ../../../timeline_notifications.h \
@@ -2,6 +2,8 @@
 
 #include "../src/migrations.h"
 
+#include <vector>
+
 #include "./const.h"
 #include "./database.h"
 
@@ -10,7 +12,7 @@
 namespace toggl {
 
 error Migrations::migrateObmActions() {
-    return db_->Migrate(
+    return migrate(
         "obm_actions",
         "create table obm_actions("
         "local_id integer primary key,"
@@ -24,7 +26,7 @@ error Migrations::migrateObmActions() {
 }
 
 error Migrations::migrateObmExperiments() {
-    error err = db_->Migrate(
+    error err = migrate(
         "obm_experiments",
         "create table obm_experiments("
         "local_id integer primary key,"
@@ -40,7 +42,7 @@ error Migrations::migrateObmExperiments() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "obm_experiments.nr",
         "CREATE UNIQUE INDEX idx_obm_experiments_nr "
         "   ON obm_experiments (uid, nr);");
@@ -48,14 +50,14 @@ error Migrations::migrateObmExperiments() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "drop obm_experiments.idx_obm_experiments_nr",
         "DROP INDEX IF EXISTS idx_obm_experiments_nr;");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "correct obm_experiments.idx_obm_experiments_nr",
         "CREATE UNIQUE INDEX idx_obm_experiments_nr_uid "
         "   ON obm_experiments (uid, nr);");
@@ -67,7 +69,7 @@ error Migrations::migrateObmExperiments() {
 }
 
 error Migrations::migrateAutotracker() {
-    error err = db_->Migrate(
+    error err = migrate(
         "autotracker_settings",
         "create table autotracker_settings("
         "local_id integer primary key,"
@@ -83,7 +85,7 @@ error Migrations::migrateAutotracker() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "autotracker_settings.term",
         "CREATE UNIQUE INDEX autotracker_settings_term "
         "   ON autotracker_settings (uid, term);");
@@ -91,7 +93,7 @@ error Migrations::migrateAutotracker() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "autotracker_settings.tid",
         "alter table autotracker_settings"
         " add column tid integer references tasks (id);");
@@ -103,7 +105,7 @@ error Migrations::migrateAutotracker() {
 }
 
 error Migrations::migrateClients() {
-    error err = db_->Migrate(
+    error err = migrate(
         "clients",
         "create table clients("
         "local_id integer primary key,"
@@ -121,14 +123,14 @@ error Migrations::migrateClients() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "clients.id",
         "CREATE UNIQUE INDEX id_clients_id ON clients (uid, id); ");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "clients.guid",
         "CREATE UNIQUE INDEX id_clients_guid ON clients (uid, guid);");
     if (err != noError) {
@@ -137,7 +139,7 @@ error Migrations::migrateClients() {
 
     // Its perfectly fine to have multiple NULL client ID's in the db,
     // when user creates clients offline.
-    err = db_->Migrate("drop clients.id_clients_id",
+    err = migrate("drop clients.id_clients_id",
                        "drop index if exists id_clients_id");
     if (err != noError) {
         return err;
@@ -147,7 +149,7 @@ error Migrations::migrateClients() {
 }
 
 error Migrations::migrateTasks() {
-    error err = db_->Migrate(
+    error err = migrate(
         "tasks",
         "create table tasks("
         "local_id integer primary key, "
@@ -167,14 +169,14 @@ error Migrations::migrateTasks() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "tasks.id",
         "CREATE UNIQUE INDEX id_tasks_id ON tasks (uid, id);");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "tasks.active",
         "alter table tasks add column active integer not null default 1;");
     if (err != noError) {
@@ -185,7 +187,7 @@ error Migrations::migrateTasks() {
 }
 
 error Migrations::migrateTags() {
-    error err = db_->Migrate(
+    error err = migrate(
         "tags",
         "create table tags("
         "local_id integer primary key, "
@@ -203,14 +205,14 @@ error Migrations::migrateTags() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "tags.id",
         "CREATE UNIQUE INDEX id_tags_id ON tags (uid, id); ");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "tags.guid",
         "CREATE UNIQUE INDEX id_tags_guid ON tags (uid, guid); ");
     if (err != noError) {
@@ -221,7 +223,7 @@ error Migrations::migrateTags() {
 }
 
 error Migrations::migrateSessions() {
-    error err = db_->Migrate(
+    error err = migrate(
         "sessions",
         "create table sessions("
         "local_id integer primary key, "
@@ -232,14 +234,14 @@ error Migrations::migrateSessions() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "sessions.active",
         "CREATE UNIQUE INDEX id_sessions_active ON sessions (active); ");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "sessions.uid",
         "alter table sessions add column uid integer references users (id);");
     if (err != noError) {
@@ -250,7 +252,7 @@ error Migrations::migrateSessions() {
 }
 
 error Migrations::migrateWorkspaces() {
-    error err = db_->Migrate(
+    error err = migrate(
         "workspaces",
         "create table workspaces("
         "local_id integer primary key,"
@@ -265,21 +267,21 @@ error Migrations::migrateWorkspaces() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "workspaces.id",
         "CREATE UNIQUE INDEX id_workspaces_id ON workspaces (uid, id);");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "workspaces.premium",
         "alter table workspaces add column premium int default 0;");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "workspaces.only_admins_may_create_projects",
         "alter table workspaces add column "
         "   only_admins_may_create_projects integer not null default 0; ");
@@ -287,7 +289,7 @@ error Migrations::migrateWorkspaces() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "workspaces.admin",
         "alter table workspaces add column "
         "   admin integer not null default 0; ");
@@ -295,7 +297,7 @@ error Migrations::migrateWorkspaces() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "workspaces.is_business",
         "alter table workspaces add column "
         "   is_business integer not null default 0; ");
@@ -303,7 +305,7 @@ error Migrations::migrateWorkspaces() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "workspaces.locked_date",
         "alter table workspaces add column "
         "   locked_time integer not null default 0; ");
@@ -315,7 +317,7 @@ error Migrations::migrateWorkspaces() {
 }
 
 error Migrations::migrateProjects() {
-    error err = db_->Migrate(
+    error err = migrate(
         "projects",
         "create table projects("
         "local_id integer primary key, "
@@ -338,21 +340,21 @@ error Migrations::migrateProjects() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "projects.billable",
         "ALTER TABLE projects ADD billable INT NOT NULL DEFAULT 0");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "projects.is_private",
         "ALTER TABLE projects ADD is_private INT NOT NULL DEFAULT 0");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "projects.client_guid",
         "ALTER TABLE projects "
         "ADD COLUMN client_guid VARCHAR;");
@@ -360,14 +362,14 @@ error Migrations::migrateProjects() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "projects.id",
         "CREATE UNIQUE INDEX id_projects_id ON projects (uid, id);");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "projects.guid",
         "CREATE UNIQUE INDEX id_projects_guid ON projects (uid, guid);");
     if (err != noError) {
@@ -378,7 +380,7 @@ error Migrations::migrateProjects() {
 }
 
 error Migrations::migrateAnalytics() {
-    error err = db_->Migrate(
+    error err = migrate(
         "analytics_settings",
         "CREATE TABLE analytics_settings("
         "id INTEGER PRIMARY KEY, "
@@ -388,7 +390,7 @@ error Migrations::migrateAnalytics() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "analytics_settings.analytics_client_id",
         "CREATE UNIQUE INDEX id_analytics_settings_client_id "
         "ON analytics_settings(analytics_client_id);");
@@ -405,7 +407,7 @@ error Migrations::migrateAnalytics() {
 }
 
 error Migrations::migrateTimeline() {
-    error err = db_->Migrate(
+    error err = migrate(
         "timeline_installation",
         "CREATE TABLE timeline_installation("
         "id INTEGER PRIMARY KEY, "
@@ -415,7 +417,7 @@ error Migrations::migrateTimeline() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "timeline_installation.desktop_id",
         "CREATE UNIQUE INDEX id_timeline_installation_desktop_id "
         "ON timeline_installation(desktop_id);");
@@ -423,7 +425,7 @@ error Migrations::migrateTimeline() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "timeline_events",
         "CREATE TABLE timeline_events("
         "id INTEGER PRIMARY KEY, "
@@ -443,7 +445,7 @@ error Migrations::migrateTimeline() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "timeline_events.chunked",
         "alter table timeline_events"
         "   add column chunked integer not null default 0;");
@@ -451,7 +453,7 @@ error Migrations::migrateTimeline() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "timeline_events.uploaded",
         "alter table timeline_events"
         "   add column uploaded integer not null default 0;");
@@ -459,14 +461,14 @@ error Migrations::migrateTimeline() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "timeline_events.local_id step #1",
         "ALTER TABLE timeline_events RENAME TO tmp_timeline_events");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "timeline_events.local_id step #2",
         "create table timeline_events("
         "   local_id integer primary key, "
@@ -486,7 +488,7 @@ error Migrations::migrateTimeline() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "timeline_events.local_id step #3",
         "insert into timeline_events"
         "   select id, null, title, filename, user_id, "
@@ -496,7 +498,7 @@ error Migrations::migrateTimeline() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "timeline_events.local_id step #4",
         "drop table tmp_timeline_events");
     if (err != noError) {
@@ -508,7 +510,7 @@ error Migrations::migrateTimeline() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "timeline_events.guid",
         "CREATE UNIQUE INDEX idx_timeline_events_guid "
         "   ON timeline_events (guid);");
@@ -520,7 +522,7 @@ error Migrations::migrateTimeline() {
 }
 
 error Migrations::migrateUsers() {
-    error err = db_->Migrate(
+    error err = migrate(
         "users",
         "create table users("
         "local_id integer primary key, "
@@ -536,7 +538,7 @@ error Migrations::migrateUsers() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "users.store_start_and_stop_time",
         "ALTER TABLE users "
         "ADD COLUMN store_start_and_stop_time INT NOT NULL DEFAULT 0;");
@@ -544,7 +546,7 @@ error Migrations::migrateUsers() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "users.timeofday_format",
         "ALTER TABLE users "
         "ADD COLUMN timeofday_format varchar NOT NULL DEFAULT 'HH:mm';");
@@ -552,14 +554,14 @@ error Migrations::migrateUsers() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "users.id",
         "CREATE UNIQUE INDEX id_users_id ON users (id);");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "users.duration_format",
         "alter table users "
         "add column duration_format varchar "
@@ -568,21 +570,21 @@ error Migrations::migrateUsers() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "drop users.email index",
         "DROP INDEX IF EXISTS id_users_email;");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "users.api_token",
         "CREATE UNIQUE INDEX id_users_api_token ON users (api_token);");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "users.offline_data",
         "alter table users"
         " add column offline_data varchar");
@@ -590,14 +592,14 @@ error Migrations::migrateUsers() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "no api token step #1",
         "ALTER TABLE users RENAME TO tmp_users");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "no api token step #2",
         "create table users("
         "   local_id integer primary key, "
@@ -616,7 +618,7 @@ error Migrations::migrateUsers() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "no api token step #3",
         "insert into users"
         " select local_id, id, default_wid, since, fullname, email,"
@@ -627,14 +629,14 @@ error Migrations::migrateUsers() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "no api token step #4",
         "drop table tmp_users");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "users.default_pid",
         "alter table users"
         " add column default_pid integer");
@@ -642,7 +644,7 @@ error Migrations::migrateUsers() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "users.default_tid",
         "alter table users"
         " add column default_tid integer references tasks (id);");
@@ -654,7 +656,7 @@ error Migrations::migrateUsers() {
 }
 
 error Migrations::migrateTimeEntries() {
-    error err = db_->Migrate(
+    error err = migrate(
         "time_entries",
         "create table time_entries("
         "local_id integer primary key, "
@@ -688,7 +690,7 @@ error Migrations::migrateTimeEntries() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "time_entries.id",
         "CREATE UNIQUE INDEX id_time_entries_id "
         "ON time_entries (uid, id); ");
@@ -696,7 +698,7 @@ error Migrations::migrateTimeEntries() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "time_entries.guid",
         "CREATE UNIQUE INDEX id_time_entries_guid "
         "ON time_entries (uid, guid); ");
@@ -704,7 +706,7 @@ error Migrations::migrateTimeEntries() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "time_entries.project_guid",
         "ALTER TABLE time_entries "
         "ADD COLUMN project_guid VARCHAR;");
@@ -712,14 +714,14 @@ error Migrations::migrateTimeEntries() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "time_entries.guid not null, step 1",
         "ALTER TABLE time_entries RENAME TO tmp_time_entries; ");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "time_entries.guid not null, step 2",
         "create table time_entries("
         "local_id integer primary key, "
@@ -754,7 +756,7 @@ error Migrations::migrateTimeEntries() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "time_entries.guid not null, step 3",
         "insert into time_entries("
         "   local_id, id, uid, description, wid, guid, pid, tid, billable, "
@@ -769,14 +771,14 @@ error Migrations::migrateTimeEntries() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "time_entries.guid not null, step 4",
         "drop table tmp_time_entries;");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "time_entries.guid not null, step 5",
         "CREATE UNIQUE INDEX id_time_entries_id "
         "   ON time_entries (uid, id); ");
@@ -784,7 +786,7 @@ error Migrations::migrateTimeEntries() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "time_entries.guid not null, step 6",
         "CREATE UNIQUE INDEX id_time_entries_guid "
         "   ON time_entries (uid, guid); ");
@@ -792,7 +794,7 @@ error Migrations::migrateTimeEntries() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "time_entries.validation_error",
         "ALTER TABLE time_entries "
         "ADD COLUMN validation_error VARCHAR;");
@@ -804,7 +806,7 @@ error Migrations::migrateTimeEntries() {
 }
 
 error Migrations::migrateSettings() {
-    error err = db_->Migrate(
+    error err = migrate(
         "settings",
         "create table settings("
         "local_id integer primary key, "
@@ -818,7 +820,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.update_channel",
         "ALTER TABLE settings "
         "ADD COLUMN update_channel varchar not null default 'stable';");
@@ -840,7 +842,7 @@ error Migrations::migrateSettings() {
         if (r < kBetaChannelPercentage) {
             channel = "beta";
         }
-        err = db_->Migrate(
+        err = migrate(
             "settings.default",
             "INSERT INTO settings(update_channel) VALUES('" + channel + "')");
         if (err != noError) {
@@ -848,7 +850,7 @@ error Migrations::migrateSettings() {
         }
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.menubar_timer",
         "ALTER TABLE settings "
         "ADD COLUMN menubar_timer integer not null default 0;");
@@ -856,7 +858,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.menubar_project",
         "ALTER TABLE settings "
         "ADD COLUMN menubar_project integer not null default 0;");
@@ -864,7 +866,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.dock_icon",
         "ALTER TABLE settings "
         "ADD COLUMN dock_icon INTEGER NOT NULL DEFAULT 1;");
@@ -872,7 +874,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.on_top",
         "ALTER TABLE settings "
         "ADD COLUMN on_top INTEGER NOT NULL DEFAULT 0;");
@@ -880,7 +882,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.reminder",
         "ALTER TABLE settings "
         "ADD COLUMN reminder INTEGER NOT NULL DEFAULT 1;");
@@ -888,7 +890,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.ignore_cert",
         "ALTER TABLE settings "
         "ADD COLUMN ignore_cert INTEGER NOT NULL DEFAULT 0;");
@@ -896,7 +898,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.idle_minutes",
         "ALTER TABLE settings "
         "ADD COLUMN idle_minutes INTEGER NOT NULL DEFAULT 5;");
@@ -904,7 +906,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.focus_on_shortcut",
         "ALTER TABLE settings "
         "ADD COLUMN focus_on_shortcut INTEGER NOT NULL DEFAULT 0;");
@@ -912,7 +914,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.reminder_minutes",
         "ALTER TABLE settings "
         "ADD COLUMN reminder_minutes INTEGER NOT NULL DEFAULT 10;");
@@ -920,7 +922,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.manual_mode",
         "ALTER TABLE settings "
         "ADD COLUMN manual_mode INTEGER NOT NULL DEFAULT 0;");
@@ -928,14 +930,14 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "focus on shortcut by default #1",
         "ALTER TABLE settings RENAME TO tmp_settings");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "focus on shortcut by default #2",
         "create table settings("
         "   local_id integer primary key, "
@@ -961,7 +963,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "focus on shortcut by default #3",
         "insert into settings"
         " select local_id, use_proxy, "
@@ -974,21 +976,21 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "focus on shortcut by default #4",
         "drop table tmp_settings");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "focus on shortcut by default #5",
         "update settings set focus_on_shortcut = 1");
     if (err != noError) {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.autodetect_proxy",
         "ALTER TABLE settings "
         "ADD COLUMN autodetect_proxy INTEGER NOT NULL DEFAULT 1;");
@@ -996,7 +998,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.window_x",
         "ALTER TABLE settings "
         "ADD COLUMN window_x integer not null default 0;");
@@ -1004,7 +1006,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.window_y",
         "ALTER TABLE settings "
         "ADD COLUMN window_y integer not null default 0;");
@@ -1012,7 +1014,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.window_height",
         "ALTER TABLE settings "
         "ADD COLUMN window_height integer not null default 0;");
@@ -1020,7 +1022,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.window_width",
         "ALTER TABLE settings "
         "ADD COLUMN window_width integer not null default 0;");
@@ -1028,7 +1030,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.remind_mon",
         "ALTER TABLE settings "
         "ADD COLUMN remind_mon integer not null default 1;");
@@ -1036,7 +1038,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.remind_tue",
         "ALTER TABLE settings "
         "ADD COLUMN remind_tue integer not null default 1;");
@@ -1044,7 +1046,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.remind_wed",
         "ALTER TABLE settings "
         "ADD COLUMN remind_wed integer not null default 1;");
@@ -1052,7 +1054,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.remind_thu",
         "ALTER TABLE settings "
         "ADD COLUMN remind_thu integer not null default 1;");
@@ -1060,7 +1062,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.remind_fri",
         "ALTER TABLE settings "
         "ADD COLUMN remind_fri integer not null default 1;");
@@ -1068,7 +1070,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.remind_sat",
         "ALTER TABLE settings "
         "ADD COLUMN remind_sat integer not null default 1;");
@@ -1076,7 +1078,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.remind_sun",
         "ALTER TABLE settings "
         "ADD COLUMN remind_sun integer not null default 1;");
@@ -1084,7 +1086,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.remind_starts",
         "ALTER TABLE settings "
         "ADD COLUMN remind_starts varchar not null default '';");
@@ -1092,7 +1094,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.remind_ends",
         "ALTER TABLE settings "
         "ADD COLUMN remind_ends varchar not null default '';");
@@ -1100,7 +1102,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.autotrack",
         "ALTER TABLE settings "
         "ADD COLUMN autotrack INTEGER NOT NULL DEFAULT 0;");
@@ -1108,7 +1110,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.open_editor_on_shortcut",
         "ALTER TABLE settings "
         "ADD COLUMN open_editor_on_shortcut INTEGER NOT NULL DEFAULT 0;");
@@ -1116,7 +1118,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.has_seen_beta_offering",
         "ALTER TABLE settings "
         "ADD COLUMN has_seen_beta_offering INTEGER NOT NULL DEFAULT 0;");
@@ -1124,7 +1126,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.render_timeline",
         "ALTER TABLE settings "
         "ADD COLUMN render_timeline INTEGER NOT NULL DEFAULT 0;");
@@ -1132,7 +1134,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.window_maximized",
         "ALTER TABLE settings "
         "ADD COLUMN window_maximized INTEGER NOT NULL DEFAULT 0;");
@@ -1140,7 +1142,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.window_minimized",
         "ALTER TABLE settings "
         "ADD COLUMN window_minimized INTEGER NOT NULL DEFAULT 0;");
@@ -1148,7 +1150,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.window_edit_size_height",
         "ALTER TABLE settings "
         "ADD COLUMN window_edit_size_height INTEGER NOT NULL DEFAULT 0;");
@@ -1156,7 +1158,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.window_edit_size_width",
         "ALTER TABLE settings "
         "ADD COLUMN window_edit_size_width INTEGER NOT NULL DEFAULT 0;");
@@ -1164,7 +1166,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.key_start",
         "ALTER TABLE settings "
         "ADD COLUMN key_start varchar not null default ''");
@@ -1172,7 +1174,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.key_show",
         "ALTER TABLE settings "
         "ADD COLUMN key_show varchar not null default '';");
@@ -1180,7 +1182,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.key_modifier_show",
         "ALTER TABLE settings "
         "ADD COLUMN key_modifier_show varchar not null default '';");
@@ -1188,7 +1190,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.key_modifier_start",
         "ALTER TABLE settings "
         "ADD COLUMN key_modifier_start varchar not null default '';");
@@ -1196,7 +1198,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.compact_mode",
         "ALTER TABLE settings "
         "ADD COLUMN compact_mode INTEGER NOT NULL DEFAULT 0;");
@@ -1204,7 +1206,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.keep_end_time_fixed",
         "ALTER TABLE settings "
         "ADD COLUMN keep_end_time_fixed INTEGER NOT NULL DEFAULT 0;");
@@ -1212,7 +1214,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.mini_timer_x",
         "ALTER TABLE settings "
         "ADD COLUMN mini_timer_x INTEGER NOT NULL DEFAULT 0;");
@@ -1220,7 +1222,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.mini_timer_y",
         "ALTER TABLE settings "
         "ADD COLUMN mini_timer_y INTEGER NOT NULL DEFAULT 0;");
@@ -1228,7 +1230,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.mini_timer_w",
         "ALTER TABLE settings "
         "ADD COLUMN mini_timer_w INTEGER NOT NULL DEFAULT 0;");
@@ -1236,7 +1238,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.pomodoro",
         "ALTER TABLE settings "
         "ADD COLUMN pomodoro INTEGER NOT NULL DEFAULT 0;");
@@ -1244,7 +1246,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.pomodoro_break",
         "ALTER TABLE settings "
         "ADD COLUMN pomodoro_break INTEGER NOT NULL DEFAULT 0;");
@@ -1252,7 +1254,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.mini_timer_visible",
         "ALTER TABLE settings "
         "ADD COLUMN mini_timer_visible INTEGER NOT NULL DEFAULT 0;");
@@ -1260,7 +1262,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.pomodoro_minutes",
         "ALTER TABLE settings "
         "ADD COLUMN pomodoro_minutes INTEGER NOT NULL DEFAULT 25;");
@@ -1268,7 +1270,7 @@ error Migrations::migrateSettings() {
         return err;
     }
 
-    err = db_->Migrate(
+    err = migrate(
         "settings.pomodoro_break_minutes",
         "ALTER TABLE settings "
         "ADD COLUMN pomodoro_break_minutes INTEGER NOT NULL DEFAULT 5;");
@@ -1280,10 +1282,15 @@ error Migrations::migrateSettings() {
 }
 
 error Migrations::Run() {
-    error err = noError;
+    applied_.clear();
+    pending_ = 0;
 
-    // FIXME: load known migrations before proceeding
-    // FIXME: dont run db->Migrate directly, but consult existing list first
+    std::vector<std::string> list;
+    error err = db_->LoadMigrations(&list);
+    if (err != noError) {
+        return err;
+    }
+    applied_.insert(list.begin(), list.end());
 
     if (noError == err) {
         err = migrateUsers();
@@ -1331,4 +1338,17 @@ error Migrations::Run() {
     return err;
 }
 
+error Migrations::migrate(const std::string &name, const std::string &sql) {
+    if (applied_.count(name)) {
+        return noError;
+    }
+    error err = db_->Migrate(name, sql);
+    if (err != noError) {
+        return err;
+    }
+    applied_.insert(name);
+    pending_++;
+    return noError;
+}
+
 }   // namespace toggl
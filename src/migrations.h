@@ -3,6 +3,9 @@
 #ifndef SRC_MIGRATIONS_H_
 #define SRC_MIGRATIONS_H_
 
+#include <set>
+#include <string>
+
 #include "./types.h"
 
 namespace toggl {
@@ -12,14 +15,31 @@ class Database;
 class Migrations {
  public:
     explicit Migrations(Database *db)
-        : db_(db) {}
+        : db_(db)
+    , pending_(0) {}
     virtual ~Migrations() {}
 
     error Run();
 
+    // Number of migrations found already applied before Run
+    size_t Applied() const {
+        return applied_.size() - pending_;
+    }
+
+    // Number of migrations applied by Run
+    size_t Pending() const {
+        return pending_;
+    }
+
  private:
     Database *db_;
 
+    // Names of applied migrations, loaded once per Run
+    std::set<std::string> applied_;
+    size_t pending_;
+
+    error migrate(const std::string &name, const std::string &sql);
+
     error migrateAutotracker();
     error migrateClients();
     error migrateTasks();
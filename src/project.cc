@@ -117,7 +117,7 @@ void Project::SetCID(const Poco::UInt64 value) {
     }
 }
 
-void Project::LoadFromJSON(Json::Value data) {
+void Project::LoadFromJSON(const Json::Value &data) {
     if (data.isMember("guid")) {
         SetGUID(data["guid"].asString());
     }
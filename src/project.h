@@ -73,7 +73,7 @@ class Project : public BaseModel {
     std::string String() const;
     std::string ModelName() const;
     std::string ModelURL() const;
-    void LoadFromJSON(Json::Value value);
+    void LoadFromJSON(const Json::Value &value);
     Json::Value SaveToJSON() const;
     bool DuplicateResource(const toggl::error) const;
     bool ResourceCannotBeCreated(const toggl::error) const;
@@ -2,14 +2,19 @@
 
 #include "../src/related_data.h"
 
+#include <time.h>
+
 #include <algorithm>
 #include <sstream>
 
+#include "Poco/Logger.h"
+#include "Poco/Timezone.h"
 #include "Poco/UTF8String.h"
 
 #include "./autotracker.h"
 #include "./formatter.h"
 #include "./client.h"
+#include "./const.h"
 #include "./gui.h"
 #include "./obm_action.h"
 #include "./project.h"
@@ -20,6 +25,346 @@
 
 namespace toggl {
 
+ModelIndex::~ModelIndex() {
+    // Watchers may be gone already
+    watchers_.clear();
+    Clear();
+}
+
+void ModelIndex::Add(BaseModel *model) {
+    poco_check_ptr(model);
+    revision_++;
+
+    model->SetIndex(this);
+    if (model->ID()) {
+        by_id_.insert(std::make_pair(model->ID(), model));
+    }
+    if (!model->GUID().empty()) {
+        by_guid_.insert(std::make_pair(model->GUID(), model));
+    }
+    if (model->NeedsToBeSaved()) {
+        MarkChanged(model);
+    } else {
+        for (size_t i = 0; i < watchers_.size(); i++) {
+            watchers_[i]->ModelChanged(model);
+        }
+    }
+}
+
+void ModelIndex::Remove(BaseModel *model) {
+    poco_check_ptr(model);
+
+    if (model->Index() != this) {
+        return;
+    }
+    revision_++;
+    model->SetIndex(nullptr);
+
+    std::unordered_map<Poco::UInt64, BaseModel *>::iterator by_id =
+        by_id_.find(model->ID());
+    if (by_id != by_id_.end() && by_id->second == model) {
+        by_id_.erase(by_id);
+    }
+    std::unordered_map<guid, BaseModel *>::iterator by_guid =
+        by_guid_.find(model->GUID());
+    if (by_guid != by_guid_.end() && by_guid->second == model) {
+        by_guid_.erase(by_guid);
+    }
+    MarkSaved(model);
+    if (track_removed_) {
+        if (model->LocalID()) {
+            removed_local_ids_.insert(model->LocalID());
+        }
+        if (model->ID()) {
+            removed_ids_.insert(model->ID());
+        }
+        if (!model->GUID().empty()) {
+            removed_guids_.insert(model->GUID());
+        }
+    }
+    for (size_t i = 0; i < watchers_.size(); i++) {
+        watchers_[i]->ModelRemoved(model);
+    }
+}
+
+void ModelIndex::RemoveWatcher(ModelIndexWatcher *watcher) {
+    watchers_.erase(
+        std::remove(watchers_.begin(), watchers_.end(), watcher),
+        watchers_.end());
+}
+
+void ModelIndex::TrackRemoved(const bool track) {
+    track_removed_ = track;
+    removed_local_ids_.clear();
+    removed_ids_.clear();
+    removed_guids_.clear();
+}
+
+bool ModelIndex::WasRemoved(const BaseModel *model) const {
+    poco_check_ptr(model);
+
+    return (model->LocalID() && removed_local_ids_.count(model->LocalID()))
+           || (model->ID() && removed_ids_.count(model->ID()))
+           || (!model->GUID().empty() && removed_guids_.count(model->GUID()));
+}
+
+void ModelIndex::Clear() {
+    for (std::unordered_map<Poco::UInt64, BaseModel *>::iterator it =
+        by_id_.begin();
+            it != by_id_.end(); it++) {
+        if (it->second->Index() == this) {
+            it->second->SetIndex(nullptr);
+        }
+    }
+    for (std::unordered_map<guid, BaseModel *>::iterator it =
+        by_guid_.begin();
+            it != by_guid_.end(); it++) {
+        if (it->second->Index() == this) {
+            it->second->SetIndex(nullptr);
+        }
+    }
+    for (std::unordered_set<BaseModel *>::iterator it = changed_.begin();
+            it != changed_.end(); it++) {
+        if ((*it)->Index() == this) {
+            (*it)->SetIndex(nullptr);
+        }
+    }
+    by_id_.clear();
+    by_guid_.clear();
+    journal_.clear();
+    changed_.clear();
+    revision_++;
+    for (size_t i = 0; i < watchers_.size(); i++) {
+        watchers_[i]->ModelsCleared();
+    }
+}
+
+BaseModel *ModelIndex::ByID(const Poco::UInt64 id) const {
+    if (!id) {
+        return nullptr;
+    }
+    std::unordered_map<Poco::UInt64, BaseModel *>::const_iterator it =
+        by_id_.find(id);
+    if (it == by_id_.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+BaseModel *ModelIndex::ByGUID(const guid &GUID) const {
+    if (GUID.empty()) {
+        return nullptr;
+    }
+    std::unordered_map<guid, BaseModel *>::const_iterator it =
+        by_guid_.find(GUID);
+    if (it == by_guid_.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+void ModelIndex::IDChanged(BaseModel *model, const Poco::UInt64 old_id) {
+    std::unordered_map<Poco::UInt64, BaseModel *>::iterator it =
+        by_id_.find(old_id);
+    if (it != by_id_.end() && it->second == model) {
+        by_id_.erase(it);
+    }
+    if (model->ID()) {
+        by_id_.insert(std::make_pair(model->ID(), model));
+    }
+}
+
+void ModelIndex::GUIDChanged(BaseModel *model, const guid &old_guid) {
+    revision_++;
+    std::unordered_map<guid, BaseModel *>::iterator it =
+        by_guid_.find(old_guid);
+    if (it != by_guid_.end() && it->second == model) {
+        by_guid_.erase(it);
+    }
+    if (!model->GUID().empty()) {
+        by_guid_.insert(std::make_pair(model->GUID(), model));
+    }
+}
+
+void ModelIndex::MarkChanged(BaseModel *model) {
+    revision_++;
+    for (size_t i = 0; i < watchers_.size(); i++) {
+        watchers_[i]->ModelChanged(model);
+    }
+    if (changed_.count(model)) {
+        return;
+    }
+    if (journal_.size() >= 2 * changed_.size() + 64) {
+        compactJournal();
+    }
+    changed_.insert(model);
+    journal_.push_back(model);
+}
+
+void ModelIndex::MarkSaved(BaseModel *model) {
+    if (changed_.erase(model) && changed_.empty()) {
+        journal_.clear();
+    }
+}
+
+void ModelIndex::PendingChanges(std::vector<ModelChange> *result) const {
+    std::unordered_set<BaseModel *> seen;
+    for (std::vector<BaseModel *>::const_iterator it = journal_.begin();
+            it != journal_.end(); it++) {
+        // Saved models may be stale, and are not dereferenced
+        if (!changed_.count(*it) || !seen.insert(*it).second) {
+            continue;
+        }
+        BaseModel *model = *it;
+        std::string change_type(kChangeTypeUpdate);
+        if (model->DeletedAt() || model->IsMarkedAsDeletedOnServer()) {
+            change_type = kChangeTypeDelete;
+        } else if (!model->LocalID()) {
+            change_type = kChangeTypeInsert;
+        }
+        result->push_back(ModelChange(
+            model->ModelName(), change_type, model->ID(), model->GUID()));
+    }
+}
+
+void ModelIndex::compactJournal() {
+    // Drops saved models, and repeats of models that were
+    // changed again after a save
+    std::unordered_set<BaseModel *> kept;
+    std::vector<BaseModel *> journal;
+    for (std::vector<BaseModel *>::const_iterator it = journal_.begin();
+            it != journal_.end(); it++) {
+        if (changed_.count(*it) && kept.insert(*it).second) {
+            journal.push_back(*it);
+        }
+    }
+    journal_.swap(journal);
+}
+
+Poco::Int64 DurationsByDay::day(const Poco::UInt64 time) {
+    time_t t = static_cast<time_t>(time);
+    struct tm local;
+#if defined(_WIN32) || defined(WIN32)
+    localtime_s(&local, &t);
+#else
+    localtime_r(&t, &local);
+#endif
+    return (local.tm_year + 1900) * 1000 + local.tm_yday;
+}
+
+void DurationsByDay::add(const TimeEntry *te) {
+    if (te->GUID().empty() || te->DeletedAt() > 0) {
+        return;
+    }
+    Poco::Int64 d = day(te->Start());
+    if (te->Duration() < 0) {
+        running_[te] = d;
+        return;
+    }
+    Entry &entry = entries_[te];
+    entry.Day = d;
+    entry.Duration = Formatter::AbsDuration(te->Duration());
+    totals_[d] += entry.Duration;
+}
+
+void DurationsByDay::remove(const BaseModel *model) {
+    running_.erase(model);
+    std::unordered_map<const BaseModel *, Entry>::iterator it =
+        entries_.find(model);
+    if (it == entries_.end()) {
+        return;
+    }
+    // Entries of zero duration leave no total
+    std::unordered_map<Poco::Int64, Poco::Int64>::iterator total =
+        totals_.find(it->second.Day);
+    if (total != totals_.end()) {
+        total->second -= it->second.Duration;
+        if (!total->second) {
+            totals_.erase(total);
+        }
+    }
+    entries_.erase(it);
+}
+
+void DurationsByDay::rebuild(const std::vector<TimeEntry *> &list) {
+    totals_.clear();
+    entries_.clear();
+    running_.clear();
+    pending_.clear();
+    for (std::vector<TimeEntry *>::const_iterator it = list.begin();
+            it != list.end(); it++) {
+        add(*it);
+    }
+}
+
+void DurationsByDay::ModelChanged(BaseModel *model) {
+    if (valid_) {
+        pending_.insert(model);
+    }
+}
+
+void DurationsByDay::ModelRemoved(BaseModel *model) {
+    if (valid_) {
+        pending_.erase(model);
+        remove(model);
+    }
+}
+
+void DurationsByDay::ModelsCleared() {
+    valid_ = false;
+}
+
+Poco::Int64 DurationsByDay::Total(
+    const std::vector<TimeEntry *> &list,
+    const TimeEntry *match) {
+    // Also makes sure local time uses the current timezone
+    int tzd = Poco::Timezone::tzd();
+    if (!valid_ || tzd_ != tzd) {
+        rebuild(list);
+        tzd_ = tzd;
+        valid_ = true;
+    } else if (!pending_.empty()) {
+        for (std::unordered_set<const BaseModel *>::const_iterator it =
+            pending_.begin(); it != pending_.end(); it++) {
+            remove(*it);
+            add(static_cast<const TimeEntry *>(*it));
+        }
+        pending_.clear();
+    }
+
+    Poco::Int64 d = day(match->Start());
+    Poco::Int64 duration(0);
+    std::unordered_map<Poco::Int64, Poco::Int64>::const_iterator it =
+        totals_.find(d);
+    if (it != totals_.end()) {
+        duration = it->second;
+    }
+    for (std::unordered_map<const BaseModel *, Poco::Int64>::const_iterator
+            running = running_.begin(); running != running_.end(); running++) {
+        if (running->second == d) {
+            duration += Formatter::AbsDuration(
+                static_cast<const TimeEntry *>(running->first)->Duration());
+        }
+    }
+    return duration;
+}
+
+template<typename T>
+void pushIndexed(T *model, std::vector<T *> *list, ModelIndex *index) {
+    poco_check_ptr(model);
+
+    list->push_back(model);
+    index->Add(model);
+}
+
+template<typename T>
+void reindexList(std::vector<T *> const *list, ModelIndex *index) {
+    index->Clear();
+    for (size_t i = 0; i < list->size(); i++) {
+        index->Add((*list)[i]);
+    }
+}
+
 template<typename T>
 void clearList(std::vector<T *> *list) {
     for (size_t i = 0; i < list->size(); i++) {
@@ -29,7 +374,51 @@ void clearList(std::vector<T *> *list) {
     list->clear();
 }
 
+template<typename T>
+void mergeList(
+    std::vector<T *> *from,
+    std::vector<T *> *list,
+    ModelIndex *index) {
+    std::unordered_set<Poco::Int64> local_ids;
+    for (size_t i = 0; i < list->size(); i++) {
+        local_ids.insert((*list)[i]->LocalID());
+    }
+    for (size_t i = 0; i < from->size(); i++) {
+        T *model = (*from)[i];
+        // A model already in memory may have unsaved changes,
+        // and a removed one must not come back
+        if ((model->LocalID() && local_ids.count(model->LocalID()))
+                || index->ByID(model->ID())
+                || index->ByGUID(model->GUID())
+                || index->WasRemoved(model)) {
+            delete model;
+            continue;
+        }
+        pushIndexed(model, list, index);
+    }
+    from->clear();
+}
+
+template<typename T>
+void purgeList(
+    const std::unordered_set<BaseModel *> &purged,
+    std::vector<T *> *list,
+    ModelIndex *index) {
+    typedef typename std::vector<T *>::iterator iterator;
+    iterator it = list->begin();
+    while (it != list->end()) {
+        T *model = *it;
+        if (purged.count(model)) {
+            index->Remove(model);
+            it = list->erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 void RelatedData::Clear() {
+    timeline_chunks_.clear();
     clearList(&Workspaces);
     clearList(&Clients);
     clearList(&Projects);
@@ -40,6 +429,287 @@ void RelatedData::Clear() {
     clearList(&TimelineEvents);
     clearList(&ObmActions);
     clearList(&ObmExperiments);
+    clearList(&TimelineBuffer);
+}
+
+void RelatedData::Push(Workspace *model) {
+    pushIndexed(model, &Workspaces, &WorkspaceIndex);
+}
+
+void RelatedData::Push(Client *model) {
+    pushIndexed(model, &Clients, &ClientIndex);
+}
+
+void RelatedData::Push(Project *model) {
+    pushIndexed(model, &Projects, &ProjectIndex);
+}
+
+void RelatedData::Push(Task *model) {
+    pushIndexed(model, &Tasks, &TaskIndex);
+}
+
+void RelatedData::Push(Tag *model) {
+    pushIndexed(model, &Tags, &TagIndex);
+}
+
+void RelatedData::Push(TimeEntry *model) {
+    pushIndexed(model, &TimeEntries, &TimeEntryIndex);
+}
+
+void RelatedData::Push(AutotrackerRule *model) {
+    pushIndexed(model, &AutotrackerRules, &AutotrackerRuleIndex);
+}
+
+void RelatedData::Push(TimelineEvent *model) {
+    pushIndexed(model, &TimelineEvents, &TimelineEventIndex);
+}
+
+void RelatedData::Push(ObmAction *model) {
+    pushIndexed(model, &ObmActions, &ObmActionIndex);
+}
+
+void RelatedData::Push(ObmExperiment *model) {
+    pushIndexed(model, &ObmExperiments, &ObmExperimentIndex);
+}
+
+void RelatedData::Reindex() {
+    reindexList(&Workspaces, &WorkspaceIndex);
+    reindexList(&Clients, &ClientIndex);
+    reindexList(&Projects, &ProjectIndex);
+    reindexList(&Tasks, &TaskIndex);
+    reindexList(&Tags, &TagIndex);
+    reindexList(&TimeEntries, &TimeEntryIndex);
+    reindexList(&AutotrackerRules, &AutotrackerRuleIndex);
+    reindexList(&TimelineEvents, &TimelineEventIndex);
+    reindexList(&ObmActions, &ObmActionIndex);
+    reindexList(&ObmExperiments, &ObmExperimentIndex);
+    indexTimelineChunks();
+}
+
+void RelatedData::TrackRemoved(const bool track) {
+    WorkspaceIndex.TrackRemoved(track);
+    ClientIndex.TrackRemoved(track);
+    ProjectIndex.TrackRemoved(track);
+    TaskIndex.TrackRemoved(track);
+    TagIndex.TrackRemoved(track);
+    TimeEntryIndex.TrackRemoved(track);
+    AutotrackerRuleIndex.TrackRemoved(track);
+    TimelineEventIndex.TrackRemoved(track);
+    ObmActionIndex.TrackRemoved(track);
+    ObmExperimentIndex.TrackRemoved(track);
+}
+
+void RelatedData::Merge(RelatedData *other) {
+    poco_check_ptr(other);
+
+    mergeList(&other->Workspaces, &Workspaces, &WorkspaceIndex);
+    mergeList(&other->Clients, &Clients, &ClientIndex);
+    mergeList(&other->Projects, &Projects, &ProjectIndex);
+    mergeList(&other->Tasks, &Tasks, &TaskIndex);
+    mergeList(&other->Tags, &Tags, &TagIndex);
+    mergeList(&other->TimeEntries, &TimeEntries, &TimeEntryIndex);
+    mergeList(&other->AutotrackerRules, &AutotrackerRules,
+              &AutotrackerRuleIndex);
+    mergeList(&other->TimelineEvents, &TimelineEvents, &TimelineEventIndex);
+    mergeList(&other->ObmActions, &ObmActions, &ObmActionIndex);
+    mergeList(&other->ObmExperiments, &ObmExperiments, &ObmExperimentIndex);
+    other->Clear();
+
+    indexTimelineChunks();
+}
+
+void RelatedData::ForgetTimeEntries(
+    const Poco::UInt64 stopped_before,
+    const bool keep_all,
+    std::set<Poco::Int64> *kept) {
+
+    poco_check_ptr(kept);
+
+    std::vector<TimeEntry *>::iterator it = TimeEntries.begin();
+    while (it != TimeEntries.end()) {
+        TimeEntry *te = *it;
+        if (!keep_all && te->Stop() && te->Stop() < stopped_before
+                && te->ID() && te->LocalID()
+                && !te->NeedsToBeSaved() && !te->NeedsPush()) {
+            // Removes itself from the index
+            delete te;
+            it = TimeEntries.erase(it);
+            continue;
+        }
+        if (te->LocalID() && te->Stop() < stopped_before) {
+            kept->insert(te->LocalID());
+        }
+        ++it;
+    }
+}
+
+template<typename T>
+void RelatedData::snapshotList(
+    ModelIndex *index,
+    std::vector<T *> *copies,
+    ModelIndex *copies_index,
+    RelatedSnapshot *snapshot) {
+    ModelChanges *changes = &snapshot->changes_[index];
+    changes->Reset();
+    index->AddWatcher(changes);
+
+    std::vector<T *> changed;
+    index->TakeChanged(&changed);
+    for (size_t i = 0; i < changed.size(); i++) {
+        T *copy = new T(*changed[i]);
+        pushIndexed(copy, copies, copies_index);
+
+        RelatedSnapshot::Copied copied;
+        copied.Model = changed[i];
+        copied.Copy = copy;
+        copied.Index = index;
+        snapshot->copied_.push_back(copied);
+    }
+}
+
+void RelatedData::TakeSnapshot(
+    RelatedData *copies,
+    RelatedSnapshot *snapshot) {
+
+    poco_check_ptr(copies);
+    poco_check_ptr(snapshot);
+
+    // Timeline events are saved in batches of their own
+    snapshotList(&WorkspaceIndex, &copies->Workspaces,
+                 &copies->WorkspaceIndex, snapshot);
+    snapshotList(&ClientIndex, &copies->Clients,
+                 &copies->ClientIndex, snapshot);
+    snapshotList(&ProjectIndex, &copies->Projects,
+                 &copies->ProjectIndex, snapshot);
+    snapshotList(&TaskIndex, &copies->Tasks,
+                 &copies->TaskIndex, snapshot);
+    snapshotList(&TagIndex, &copies->Tags,
+                 &copies->TagIndex, snapshot);
+    snapshotList(&TimeEntryIndex, &copies->TimeEntries,
+                 &copies->TimeEntryIndex, snapshot);
+    snapshotList(&AutotrackerRuleIndex, &copies->AutotrackerRules,
+                 &copies->AutotrackerRuleIndex, snapshot);
+    snapshotList(&ObmActionIndex, &copies->ObmActions,
+                 &copies->ObmActionIndex, snapshot);
+    snapshotList(&ObmExperimentIndex, &copies->ObmExperiments,
+                 &copies->ObmExperimentIndex, snapshot);
+}
+
+void RelatedData::ApplySnapshot(
+    RelatedSnapshot *snapshot,
+    const bool saved) {
+
+    poco_check_ptr(snapshot);
+
+    std::unordered_set<BaseModel *> purged;
+    for (std::vector<RelatedSnapshot::Copied>::const_iterator it =
+        snapshot->copied_.begin();
+            it != snapshot->copied_.end(); it++) {
+        BaseModel *model = it->Model;
+        BaseModel *copy = it->Copy;
+        const ModelChanges &changes = snapshot->changes_[it->Index];
+
+        // Removed models may be deleted already
+        if (changes.Cleared() || changes.Removed().count(model)) {
+            continue;
+        }
+
+        if (!saved) {
+            it->Index->MarkChanged(model);
+            continue;
+        }
+
+        // Changed while saving, so it's saved again
+        bool changed = changes.Changed().count(model) > 0;
+
+        // What saving assigned to the copy
+        if (!model->LocalID()) {
+            model->SetLocalID(copy->LocalID());
+        }
+        if (model->GUID().empty()) {
+            model->SetGUID(copy->GUID());
+        }
+        model->SetUID(copy->UID());
+
+        if (!copy->Index()) {
+            // Deleted from database and purged from the copies
+            if (model->IsMarkedAsDeletedOnServer()) {
+                purged.insert(model);
+            }
+            continue;
+        }
+
+        if (!changed) {
+            model->ClearDirty();
+            it->Index->MarkSaved(model);
+        }
+    }
+
+    for (std::vector<RelatedSnapshot::Copied>::const_iterator it =
+        snapshot->copied_.begin();
+            it != snapshot->copied_.end(); it++) {
+        // Copies still listed are deleted with their collections
+        if (!it->Copy->Index()) {
+            delete it->Copy;
+        }
+    }
+    for (std::map<ModelIndex *, ModelChanges>::iterator it =
+        snapshot->changes_.begin();
+            it != snapshot->changes_.end(); it++) {
+        it->first->RemoveWatcher(&it->second);
+    }
+    snapshot->copied_.clear();
+    snapshot->changes_.clear();
+
+    if (purged.empty()) {
+        return;
+    }
+    purgeList(purged, &Workspaces, &WorkspaceIndex);
+    purgeList(purged, &Clients, &ClientIndex);
+    purgeList(purged, &Projects, &ProjectIndex);
+    purgeList(purged, &Tasks, &TaskIndex);
+    purgeList(purged, &Tags, &TagIndex);
+    purgeList(purged, &TimeEntries, &TimeEntryIndex);
+    purgeList(purged, &AutotrackerRules, &AutotrackerRuleIndex);
+    purgeList(purged, &ObmActions, &ObmActionIndex);
+    purgeList(purged, &ObmExperiments, &ObmExperimentIndex);
+}
+
+size_t RelatedData::ChangedCount() const {
+    return WorkspaceIndex.ChangedCount()
+           + ClientIndex.ChangedCount()
+           + ProjectIndex.ChangedCount()
+           + TaskIndex.ChangedCount()
+           + TagIndex.ChangedCount()
+           + TimeEntryIndex.ChangedCount()
+           + AutotrackerRuleIndex.ChangedCount()
+           + TimelineEventIndex.ChangedCount()
+           + ObmActionIndex.ChangedCount()
+           + ObmExperimentIndex.ChangedCount();
+}
+
+void RelatedData::PendingChanges(std::vector<ModelChange> *result) const {
+    poco_check_ptr(result);
+
+    WorkspaceIndex.PendingChanges(result);
+    ClientIndex.PendingChanges(result);
+    ProjectIndex.PendingChanges(result);
+    TaskIndex.PendingChanges(result);
+    TagIndex.PendingChanges(result);
+    TimeEntryIndex.PendingChanges(result);
+    AutotrackerRuleIndex.PendingChanges(result);
+    ObmActionIndex.PendingChanges(result);
+    ObmExperimentIndex.PendingChanges(result);
+}
+
+Poco::UInt64 RelatedData::Revision() const {
+    // Revisions only increase, so their sum changes with any of them
+    return WorkspaceIndex.Revision()
+           + ClientIndex.Revision()
+           + ProjectIndex.Revision()
+           + TaskIndex.Revision()
+           + TagIndex.Revision()
+           + TimeEntryIndex.Revision();
 }
 
 error RelatedData::DeleteAutotrackerRule(const Poco::Int64 local_id) {
@@ -116,26 +786,100 @@ std::vector<TimelineEvent *> RelatedData::VisibleTimelineEvents() const {
     return result;
 }
 
-std::vector<TimeEntry *> RelatedData::VisibleTimeEntries() const {
-    std::vector<TimeEntry *> result;
-    for (std::vector<TimeEntry *>::const_iterator it =
-        TimeEntries.begin();
-            it != TimeEntries.end(); it++) {
-        TimeEntry *te = *it;
-        if (te->GUID().empty()) {
+void RelatedData::AddTimelineEvent(TimelineEvent *event) {
+    poco_check_ptr(event);
+
+    if (!event->Start() || !event->EndTime()) {
+        Poco::Logger::get("timeline").warning(
+            "Ignoring invalid timeline event " + event->String());
+        delete event;
+        return;
+    }
+
+    Poco::UInt64 open_since =
+        (time(0) / kTimelineChunkSeconds) * kTimelineChunkSeconds;
+    if (addToTimelineChunk(event, open_since)) {
+        delete event;
+        return;
+    }
+    TimelineBuffer.push_back(event);
+}
+
+void RelatedData::CompressTimeline(const Poco::UInt64 minimum_time) {
+    for (size_t i = 0; i < TimelineEvents.size(); i++) {
+        TimelineEvent *event = TimelineEvents[i];
+        if (event->IsMarkedAsDeletedOnServer()) {
             continue;
         }
-        if (te->DeletedAt() > 0) {
+
+        // Purged from memory and database on next save
+        if (event->Start() < minimum_time
+                || event->Uploaded()
+                || event->DeletedAt()) {
+            forgetTimelineChunk(event);
+            event->MarkAsDeletedOnServer();
             continue;
         }
-        result.push_back(te);
+
+        // Recorded before events were chunked as they arrived
+        if (!event->Chunked() && addToTimelineChunk(event, 0)) {
+            event->MarkAsDeletedOnServer();
+        }
     }
-    return result;
 }
 
-Poco::Int64 RelatedData::TotalDurationForDate(const TimeEntry *match) const {
-    std::string date_header = Formatter::FormatDateHeader(match->Start());
-    Poco::Int64 duration(0);
+bool RelatedData::addToTimelineChunk(
+    TimelineEvent *event,
+    const Poco::UInt64 open_since) {
+    Poco::Int64 duration = event->Duration();
+    if (duration < 0) {
+        duration = 0;
+    }
+
+    TimelineChunkKey key(*event);
+    std::unordered_map<TimelineChunkKey, TimelineEvent *,
+        TimelineChunkKeyHash>::iterator it = timeline_chunks_.find(key);
+    if (it != timeline_chunks_.end() && key.ChunkStart >= open_since) {
+        TimelineEvent *chunk = it->second;
+        if (chunk->VisibleToUser() && !chunk->IsMarkedAsDeletedOnServer()) {
+            chunk->SetEndTime(chunk->EndTime() + duration);
+            return true;
+        }
+    }
+
+    event->SetEndTime(event->Start() + duration);
+    event->SetChunked(true);
+    timeline_chunks_[key] = event;
+    return false;
+}
+
+void RelatedData::forgetTimelineChunk(TimelineEvent *chunk) {
+    std::unordered_map<TimelineChunkKey, TimelineEvent *,
+        TimelineChunkKeyHash>::iterator it =
+            timeline_chunks_.find(TimelineChunkKey(*chunk));
+    if (it != timeline_chunks_.end() && it->second == chunk) {
+        timeline_chunks_.erase(it);
+    }
+}
+
+void RelatedData::indexTimelineChunks() {
+    timeline_chunks_.clear();
+    for (size_t i = 0; i < TimelineEvents.size(); i++) {
+        TimelineEvent *event = TimelineEvents[i];
+        if (event->VisibleToUser()) {
+            timeline_chunks_[TimelineChunkKey(*event)] = event;
+        }
+    }
+    for (size_t i = 0; i < TimelineBuffer.size(); i++) {
+        TimelineEvent *event = TimelineBuffer[i];
+        if (event->VisibleToUser()) {
+            timeline_chunks_[TimelineChunkKey(*event)] = event;
+        }
+    }
+}
+
+std::vector<TimeEntry *> RelatedData::VisibleTimeEntries() const {
+    std::vector<TimeEntry *> result;
     for (std::vector<TimeEntry *>::const_iterator it =
         TimeEntries.begin();
             it != TimeEntries.end(); it++) {
@@ -146,11 +890,13 @@ Poco::Int64 RelatedData::TotalDurationForDate(const TimeEntry *match) const {
         if (te->DeletedAt() > 0) {
             continue;
         }
-        if (Formatter::FormatDateHeader(te->Start()) == date_header) {
-            duration += Formatter::AbsDuration(te->Duration());
-        }
+        result.push_back(te);
     }
-    return duration;
+    return result;
+}
+
+Poco::Int64 RelatedData::TotalDurationForDate(const TimeEntry *match) const {
+    return durations_by_day_.Total(TimeEntries, match);
 }
 
 TimeEntry *RelatedData::LatestTimeEntry() const {
@@ -188,85 +934,72 @@ TimeEntry *RelatedData::LatestTimeEntry() const {
     return latest;
 }
 
-// Add time entries, in format:
+// Time entry item, in format:
 // Description - Task. Project. Client
-void RelatedData::timeEntryAutocompleteItems(
-    std::set<std::string> *unique_names,
-    std::vector<view::Autocomplete> *list) const {
-
-    poco_check_ptr(list);
-
-    for (std::vector<TimeEntry *>::const_iterator it =
-        TimeEntries.begin();
-            it != TimeEntries.end(); it++) {
-        TimeEntry *te = *it;
-
-        if (te->DeletedAt() || te->IsMarkedAsDeletedOnServer()
-                || te->Description().empty()) {
-            continue;
-        }
+bool RelatedData::timeEntryAutocompleteItem(
+    const TimeEntry *te,
+    std::string *text,
+    view::Autocomplete *item) const {
 
-        Task *t = nullptr;
-        if (te->TID()) {
-            t = TaskByID(te->TID());
-        }
+    poco_check_ptr(text);
 
-        Project *p = nullptr;
-        if (t && t->PID()) {
-            p = ProjectByID(t->PID());
-        } else if (te->PID()) {
-            p = ProjectByID(te->PID());
-        }
+    if (te->DeletedAt() || te->IsMarkedAsDeletedOnServer()
+            || te->Description().empty()) {
+        return false;
+    }
 
-        if (p && !p->Active()) {
-            continue;
-        }
+    Task *t = nullptr;
+    if (te->TID()) {
+        t = TaskByID(te->TID());
+    }
 
-        Client *c = clientByProject(p);
+    Project *p = nullptr;
+    if (t && t->PID()) {
+        p = ProjectByID(t->PID());
+    } else if (te->PID()) {
+        p = ProjectByID(te->PID());
+    }
 
-        std::string project_task_label =
-            Formatter::JoinTaskName(t, p, c);
+    if (p && !p->Active()) {
+        return false;
+    }
 
-        std::string description = te->Description();
+    Client *c = clientByProject(p);
 
-        std::stringstream search_parts;
-        search_parts << te->Description();
-        if (!project_task_label.empty()) {
-            search_parts << " - " << project_task_label;
-        }
+    std::string project_task_label("");
+    if (t || p || c) {
+        project_task_label = Formatter::JoinTaskName(t, p, c);
+    }
 
-        std::string text = search_parts.str();
-        if (text.empty()) {
-            continue;
-        }
+    *text = te->Description();
+    if (!project_task_label.empty()) {
+        *text += " - " + project_task_label;
+    }
 
-        if (unique_names->find(text) != unique_names->end()) {
-            continue;
-        }
-        unique_names->insert(text);
+    if (!item) {
+        return true;
+    }
 
-        view::Autocomplete autocomplete_item;
-        autocomplete_item.Text = text;
-        autocomplete_item.Description = description;
-        autocomplete_item.ProjectAndTaskLabel = project_task_label;
-        if (p) {
-            autocomplete_item.ProjectColor = p->ColorCode();
-            autocomplete_item.ProjectID = p->ID();
-            autocomplete_item.ProjectLabel = p->Name();
-        }
-        if (c) {
-            autocomplete_item.ClientLabel = c->Name();
-            autocomplete_item.ClientID = c->ID();
-        }
-        if (t) {
-            autocomplete_item.TaskID = t->ID();
-            autocomplete_item.TaskLabel = t->Name();
-        }
-        autocomplete_item.WorkspaceID = te->WID();
-        autocomplete_item.Tags = te->Tags();
-        autocomplete_item.Type = kAutocompleteItemTE;
-        list->push_back(autocomplete_item);
+    item->Text = *text;
+    item->Description = te->Description();
+    item->ProjectAndTaskLabel = project_task_label;
+    if (p) {
+        item->ProjectColor = p->ColorCode();
+        item->ProjectID = p->ID();
+        item->ProjectLabel = p->Name();
+    }
+    if (c) {
+        item->ClientLabel = c->Name();
+        item->ClientID = c->ID();
+    }
+    if (t) {
+        item->TaskID = t->ID();
+        item->TaskLabel = t->Name();
     }
+    item->WorkspaceID = te->WID();
+    item->Tags = te->Tags();
+    item->Type = kAutocompleteItemTE;
+    return true;
 }
 
 // Add tasks, in format:
@@ -392,34 +1125,238 @@ void RelatedData::projectAutocompleteItems(
 
 void RelatedData::TimeEntryAutocompleteItems(
     std::vector<view::Autocomplete> *result) const {
-    std::set<std::string> unique_names;
-
-    timeEntryAutocompleteItems(&unique_names, result);
-    std::sort(result->begin(), result->end(), CompareAutocompleteItems);
+    autocompleteIndex(kAutocompleteTimeEntry).Items(result);
 }
 
 void RelatedData::MinitimerAutocompleteItems(
     std::vector<view::Autocomplete> *result) const {
-    std::set<std::string> unique_names;
-
-    timeEntryAutocompleteItems(&unique_names, result);
-    taskAutocompleteItems(&unique_names, nullptr, result);
-    projectAutocompleteItems(&unique_names, nullptr, result);
-
-    std::sort(result->begin(), result->end(), CompareAutocompleteItems);
+    autocompleteIndex(kAutocompleteMinitimer).Items(result);
 }
 
 void RelatedData::ProjectAutocompleteItems(
     std::vector<view::Autocomplete> *result) const {
+    autocompleteIndex(kAutocompleteProject).Items(result);
+}
+
+void RelatedData::AutocompleteQuery(
+    const Poco::UInt64 kind,
+    const std::string &text,
+    const size_t limit,
+    std::vector<view::Autocomplete> *result) const {
+    poco_check_ptr(result);
+
+    if (kind >= kAutocompleteKinds) {
+        result->clear();
+        return;
+    }
+    autocompleteIndex(kind).Query(text, limit, result);
+}
+
+std::shared_ptr<const AutocompleteIndex> RelatedData::AutocompleteIndexCopy(
+    const Poco::UInt64 kind) const {
+    if (kind >= kAutocompleteKinds) {
+        return std::shared_ptr<const AutocompleteIndex>();
+    }
+    std::shared_ptr<AutocompleteIndex> copy(
+        new AutocompleteIndex(autocompleteIndex(kind)));
+    copy->Rank();
+    return copy;
+}
+
+const AutocompleteIndex &RelatedData::autocompleteIndex(
+    const Poco::UInt64 kind) const {
+    poco_assert(kind < kAutocompleteKinds);
+
+    // Time entries are followed per model
+    Poco::UInt64 revision = TaskIndex.Revision()
+                            + ProjectIndex.Revision()
+                            + ClientIndex.Revision()
+                            + WorkspaceIndex.Revision();
+
+    if (kAutocompleteProject == kind) {
+        if (!autocomplete_valid_[kind]
+                || autocomplete_revisions_[kind] != revision) {
+            std::vector<view::Autocomplete> items;
+            std::set<std::string> unique_names;
+            std::map<Poco::UInt64, std::string> ws_names;
+            workspaceAutocompleteItems(&unique_names, &ws_names, &items);
+            projectAutocompleteItems(&unique_names, &ws_names, &items);
+            taskAutocompleteItems(&unique_names, &ws_names, &items);
+            std::sort(items.begin(), items.end(),
+                      CompareStructuredAutocompleteItems);
+            autocomplete_indexes_[kind].Build(items);
+            autocomplete_revisions_[kind] = revision;
+            autocomplete_valid_[kind] = true;
+        }
+        return autocomplete_indexes_[kind];
+    }
+
+    // Time entry and minitimer items are kept up to date together
+    if (!autocomplete_valid_[kAutocompleteTimeEntry]
+            || autocomplete_revisions_[kAutocompleteTimeEntry] != revision
+            || !updateTimeEntryAutocomplete()) {
+        buildTimeEntryAutocomplete();
+        autocomplete_revisions_[kAutocompleteTimeEntry] = revision;
+        autocomplete_valid_[kAutocompleteTimeEntry] = true;
+    }
+    return autocomplete_indexes_[kind];
+}
+
+// Name that task and project items are unique by
+static std::string autocompleteName(const view::Autocomplete &item) {
+    if (!item.IsProject()) {
+        return item.Text;
+    }
+    std::stringstream ss;
+    ss << item.WorkspaceID << "/" << item.Text;
+    return ss.str();
+}
+
+void RelatedData::buildTimeEntryAutocomplete() const {
+    autocomplete_texts_.clear();
+    autocomplete_entries_.clear();
+    autocomplete_changes_.Reset();
+
+    for (std::vector<TimeEntry *>::const_iterator it = TimeEntries.begin();
+            it != TimeEntries.end(); it++) {
+        addAutocompleteEntry(*it, nullptr);
+    }
+
+    std::vector<view::Autocomplete> items;
+    items.reserve(autocomplete_texts_.size());
+    for (std::unordered_map<std::string, AutocompleteText>::const_iterator it =
+        autocomplete_texts_.begin(); it != autocomplete_texts_.end(); it++) {
+        view::Autocomplete item;
+        std::string text("");
+        timeEntryAutocompleteItem(
+            static_cast<const TimeEntry *>(it->second.Entries.rbegin()->second),
+            &text,
+            &item);
+        items.push_back(item);
+    }
+    std::sort(items.begin(), items.end(), CompareAutocompleteItems);
+    autocomplete_indexes_[kAutocompleteTimeEntry].Build(items);
+
+    // Time entry items rank first, then tasks and projects, except
+    // the ones with the same text as a time entry item
     std::set<std::string> unique_names;
+    std::vector<view::Autocomplete> others;
+    taskAutocompleteItems(&unique_names, nullptr, &others);
+    projectAutocompleteItems(&unique_names, nullptr, &others);
+    minitimer_names_.swap(unique_names);
+    std::sort(others.begin(), others.end(), CompareAutocompleteItems);
+    size_t time_entry_items = items.size();
+    for (size_t i = 0; i < others.size(); i++) {
+        if (!autocomplete_texts_.count(autocompleteName(others[i]))) {
+            items.push_back(others[i]);
+        }
+    }
+    autocomplete_indexes_[kAutocompleteMinitimer].Build(items);
+
+    // Same IDs in both
+    for (Poco::UInt32 i = 0; i < time_entry_items; i++) {
+        AutocompleteText &text = autocomplete_texts_[items[i].Text];
+        text.Indexed = true;
+        text.TimeEntryItem = i;
+        text.MinitimerItem = i;
+    }
+}
+
+bool RelatedData::updateTimeEntryAutocomplete() const {
+    if (autocomplete_changes_.Cleared()) {
+        return false;
+    }
+
+    std::set<std::string> touched;
+    const std::unordered_set<BaseModel *> &removed =
+        autocomplete_changes_.Removed();
+    for (std::unordered_set<BaseModel *>::const_iterator it = removed.begin();
+            it != removed.end(); it++) {
+        removeAutocompleteEntry(*it, &touched);
+    }
+    const std::unordered_set<BaseModel *> &changed =
+        autocomplete_changes_.Changed();
+    for (std::unordered_set<BaseModel *>::const_iterator it = changed.begin();
+            it != changed.end(); it++) {
+        removeAutocompleteEntry(*it, &touched);
+        addAutocompleteEntry(static_cast<const TimeEntry *>(*it), &touched);
+    }
+    autocomplete_changes_.Reset();
+
+    AutocompleteIndex &time_entries =
+        autocomplete_indexes_[kAutocompleteTimeEntry];
+    AutocompleteIndex &minitimer =
+        autocomplete_indexes_[kAutocompleteMinitimer];
+    for (std::set<std::string>::const_iterator it = touched.begin();
+            it != touched.end(); it++) {
+        std::unordered_map<std::string, AutocompleteText>::iterator found =
+            autocomplete_texts_.find(*it);
+        AutocompleteText &text = found->second;
+        bool indexed = text.Indexed;
+        if (indexed) {
+            time_entries.Remove(text.TimeEntryItem);
+            minitimer.Remove(text.MinitimerItem);
+            text.Indexed = false;
+        }
+
+        // A task or project item with the same text would
+        // show up again or be replaced
+        bool replaces = minitimer_names_.count(*it) > 0;
+
+        if (text.Entries.empty()) {
+            autocomplete_texts_.erase(found);
+            if (indexed && replaces) {
+                return false;
+            }
+            continue;
+        }
+        if (!indexed && replaces) {
+            return false;
+        }
+
+        view::Autocomplete item;
+        std::string item_text("");
+        timeEntryAutocompleteItem(
+            static_cast<const TimeEntry *>(text.Entries.rbegin()->second),
+            &item_text,
+            &item);
+        text.TimeEntryItem = time_entries.Insert(
+            item, CompareAutocompleteItems);
+        text.MinitimerItem = minitimer.Insert(
+            item, CompareAutocompleteItems);
+        text.Indexed = true;
+    }
+    return true;
+}
 
-    std::map<Poco::UInt64, std::string> ws_names;
-    workspaceAutocompleteItems(&unique_names, &ws_names, result);
-    projectAutocompleteItems(&unique_names, &ws_names, result);
-    taskAutocompleteItems(&unique_names, &ws_names, result);
+void RelatedData::addAutocompleteEntry(
+    const TimeEntry *te,
+    std::set<std::string> *touched) const {
+    std::string text("");
+    if (!timeEntryAutocompleteItem(te, &text, nullptr)) {
+        return;
+    }
+    autocomplete_entries_[te] = std::make_pair(text, te->Start());
+    autocomplete_texts_[text].Entries.insert(
+        std::make_pair(te->Start(), static_cast<const BaseModel *>(te)));
+    if (touched) {
+        touched->insert(text);
+    }
+}
 
-    std::sort(result->begin(), result->end(),
-              CompareStructuredAutocompleteItems);
+void RelatedData::removeAutocompleteEntry(
+    const BaseModel *model,
+    std::set<std::string> *touched) const {
+    std::unordered_map<const BaseModel *,
+        std::pair<std::string, Poco::UInt64> >::iterator it =
+            autocomplete_entries_.find(model);
+    if (it == autocomplete_entries_.end()) {
+        return;
+    }
+    autocomplete_texts_[it->second.first].Entries.erase(
+        std::make_pair(it->second.second, model));
+    touched->insert(it->second.first);
+    autocomplete_entries_.erase(it);
 }
 
 void RelatedData::workspaceAutocompleteItems(
@@ -563,77 +1500,47 @@ Client *RelatedData::clientByProject(Project *p) const {
 }
 
 Task *RelatedData::TaskByID(const Poco::UInt64 id) const {
-    return modelByID<Task>(id, &Tasks);
+    return static_cast<Task *>(TaskIndex.ByID(id));
 }
 
 Client *RelatedData::ClientByID(const Poco::UInt64 id) const {
-    return modelByID(id, &Clients);
+    return static_cast<Client *>(ClientIndex.ByID(id));
 }
 
 Project *RelatedData::ProjectByID(const Poco::UInt64 id) const {
-    return modelByID(id, &Projects);
+    return static_cast<Project *>(ProjectIndex.ByID(id));
 }
 
 Tag *RelatedData::TagByID(const Poco::UInt64 id) const {
-    return modelByID(id, &Tags);
+    return static_cast<Tag *>(TagIndex.ByID(id));
 }
 
 Workspace *RelatedData::WorkspaceByID(const Poco::UInt64 id) const {
-    return modelByID(id, &Workspaces);
+    return static_cast<Workspace *>(WorkspaceIndex.ByID(id));
 }
 
 TimeEntry *RelatedData::TimeEntryByID(const Poco::UInt64 id) const {
-    return modelByID(id, &TimeEntries);
+    return static_cast<TimeEntry *>(TimeEntryIndex.ByID(id));
 }
 
 TimeEntry *RelatedData::TimeEntryByGUID(const guid GUID) const {
-    return modelByGUID(GUID, &TimeEntries);
+    return static_cast<TimeEntry *>(TimeEntryIndex.ByGUID(GUID));
 }
 
 TimelineEvent *RelatedData::TimelineEventByGUID(const guid GUID) const {
-    return modelByGUID(GUID, &TimelineEvents);
+    return static_cast<TimelineEvent *>(TimelineEventIndex.ByGUID(GUID));
 }
 
 Tag *RelatedData::TagByGUID(const guid GUID) const {
-    return modelByGUID(GUID, &Tags);
+    return static_cast<Tag *>(TagIndex.ByGUID(GUID));
 }
 
 Project *RelatedData::ProjectByGUID(const guid GUID) const {
-    return modelByGUID(GUID, &Projects);
+    return static_cast<Project *>(ProjectIndex.ByGUID(GUID));
 }
 
 Client *RelatedData::ClientByGUID(const guid GUID) const {
-    return modelByGUID(GUID, &Clients);
-}
-
-template <typename T>
-T *modelByGUID(const guid GUID, std::vector<T *> const *list) {
-    if (GUID.empty()) {
-        return nullptr;
-    }
-    typedef typename std::vector<T *>::const_iterator iterator;
-    for (iterator it = list->begin(); it != list->end(); it++) {
-        T *model = *it;
-        if (model->GUID() == GUID) {
-            return model;
-        }
-    }
-    return nullptr;
-}
-
-template<typename T>
-T *modelByID(const Poco::UInt64 id, std::vector<T *> const *list) {
-    if (!id) {
-        return nullptr;
-    }
-    typedef typename std::vector<T *>::const_iterator iterator;
-    for (iterator it = list->begin(); it != list->end(); it++) {
-        T *model = *it;
-        if (model->ID() == id) {
-            return model;
-        }
-    }
-    return nullptr;
+    return static_cast<Client *>(ClientIndex.ByGUID(GUID));
 }
 
 }   // namespace toggl
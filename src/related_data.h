@@ -7,7 +7,13 @@
 #include <set>
 #include <string>
 #include <map>
+#include <memory>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
 
+#include "./autocomplete_index.h"
+#include "./model_change.h"
 #include "./timeline_event.h"
 #include "./types.h"
 
@@ -28,13 +34,278 @@ class TimeEntry;
 };
 
 template<typename T>
-T *modelByID(const Poco::UInt64 id, std::vector<T *> const *list);
+T *modelByID(const Poco::UInt64 id, std::vector<T *> const *list) {
+    if (!id) {
+        return nullptr;
+    }
+    typedef typename std::vector<T *>::const_iterator iterator;
+    for (iterator it = list->begin(); it != list->end(); it++) {
+        T *model = *it;
+        if (model->ID() == id) {
+            return model;
+        }
+    }
+    return nullptr;
+}
 
 template <typename T>
-T *modelByGUID(const guid GUID, std::vector<T *> const *list);
+T *modelByGUID(const guid GUID, std::vector<T *> const *list) {
+    if (GUID.empty()) {
+        return nullptr;
+    }
+    typedef typename std::vector<T *>::const_iterator iterator;
+    for (iterator it = list->begin(); it != list->end(); it++) {
+        T *model = *it;
+        if (model->GUID() == GUID) {
+            return model;
+        }
+    }
+    return nullptr;
+}
+
+// Data derived from the models of an index, updated per model.
+// Changed models may be dereferenced until they are removed.
+class ModelIndexWatcher {
+ public:
+    virtual ~ModelIndexWatcher() {}
+
+    // Added to the index, or changed in a way that needs saving
+    virtual void ModelChanged(BaseModel *model) = 0;
+    virtual void ModelRemoved(BaseModel *model) = 0;
+    virtual void ModelsCleared() = 0;
+};
+
+// Hash index of the models in one collection, by ID and by GUID,
+// and a journal of the models that need to be saved.
+// Models notify the index when their ID or GUID changes or when
+// they become dirty, and remove themselves from it when deleted.
+class ModelIndex {
+ public:
+    ModelIndex()
+        : revision_(0)
+    , track_removed_(false) {}
+    ~ModelIndex();
+
+    void Add(BaseModel *model);
+    void Remove(BaseModel *model);
+    void Clear();
+
+    BaseModel *ByID(const Poco::UInt64 id) const;
+    BaseModel *ByGUID(const guid &GUID) const;
+
+    void IDChanged(BaseModel *model, const Poco::UInt64 old_id);
+    void GUIDChanged(BaseModel *model, const guid &old_guid);
+
+    void MarkChanged(BaseModel *model);
+    void MarkSaved(BaseModel *model);
+
+    // Remember the models removed from now on, until turned off
+    void TrackRemoved(const bool track);
+
+    // Removed since tracking was turned on, matched by local ID,
+    // ID or GUID, so an older copy of the model can be recognized
+    bool WasRemoved(const BaseModel *model) const;
+
+    // The watcher must outlive the index or be removed first
+    void AddWatcher(ModelIndexWatcher *watcher) {
+        watchers_.push_back(watcher);
+    }
+    void RemoveWatcher(ModelIndexWatcher *watcher);
+
+    // A model changed in a way that needs no saving
+    void Touch() {
+        revision_++;
+    }
+
+    size_t ChangedCount() const {
+        return changed_.size();
+    }
+
+    // Describe the models waiting to be saved, as saving them would
+    void PendingChanges(std::vector<ModelChange> *result) const;
+
+    // Increases whenever a model is added, removed or changed,
+    // so data derived from the collection knows when to update.
+    Poco::UInt64 Revision() const {
+        return revision_;
+    }
+
+    // Move models from the journal into result, in the order
+    // they were first changed. The journal is left empty.
+    template<typename T>
+    void TakeChanged(std::vector<T *> *result) {
+        for (std::vector<BaseModel *>::const_iterator it = journal_.begin();
+                it != journal_.end(); it++) {
+            // Skips models saved or removed since they were journaled
+            if (changed_.erase(*it)) {
+                result->push_back(static_cast<T *>(*it));
+            }
+        }
+        journal_.clear();
+        changed_.clear();
+    }
+
+ private:
+    ModelIndex(const ModelIndex &);
+    ModelIndex &operator=(const ModelIndex &);
+
+    std::unordered_map<Poco::UInt64, BaseModel *> by_id_;
+    std::unordered_map<guid, BaseModel *> by_guid_;
+
+    void compactJournal();
+
+    // Models in the order they were changed. Saved models are only
+    // dropped from changed_, and left in the journal until it's
+    // taken or compacted, so the journal may hold stale pointers
+    // that must not be dereferenced.
+    std::vector<BaseModel *> journal_;
+    std::unordered_set<BaseModel *> changed_;
+
+    std::vector<ModelIndexWatcher *> watchers_;
+
+    Poco::UInt64 revision_;
+
+    bool track_removed_;
+    std::unordered_set<Poco::Int64> removed_local_ids_;
+    std::unordered_set<Poco::UInt64> removed_ids_;
+    std::unordered_set<guid> removed_guids_;
+};
+
+// Total durations of time entries by local calendar day.
+// Watches the time entry index and moves the duration of each
+// changed entry to its day when asked next. Rebuilt in one pass
+// when the timezone has changed. Running time entries are added
+// when asked.
+class DurationsByDay : public ModelIndexWatcher {
+ public:
+    DurationsByDay()
+        : tzd_(0)
+    , valid_(false) {}
+    ~DurationsByDay() {}
+
+    Poco::Int64 Total(
+        const std::vector<TimeEntry *> &list,
+        const TimeEntry *match);
+
+    // Implement ModelIndexWatcher
+    void ModelChanged(BaseModel *model);
+    void ModelRemoved(BaseModel *model);
+    void ModelsCleared();
+
+ private:
+    // What an entry adds to its day
+    struct Entry {
+        Poco::Int64 Day;
+        Poco::Int64 Duration;
+    };
+
+    void rebuild(const std::vector<TimeEntry *> &list);
+    void add(const TimeEntry *te);
+    void remove(const BaseModel *model);
+
+    static Poco::Int64 day(const Poco::UInt64 time);
+
+    int tzd_;
+    bool valid_;
+    std::unordered_map<Poco::Int64, Poco::Int64> totals_;
+    std::unordered_map<const BaseModel *, Entry> entries_;
+
+    // Keep growing, so they're added up when asked
+    std::unordered_map<const BaseModel *, Poco::Int64> running_;
+
+    // Changed since asked last
+    std::unordered_set<const BaseModel *> pending_;
+};
+
+// Models of an index that changed since last reset
+class ModelChanges : public ModelIndexWatcher {
+ public:
+    ModelChanges()
+        : cleared_(true) {}
+    ~ModelChanges() {}
+
+    // All models may have changed, the index was
+    // cleared since the changes were reset
+    bool Cleared() const {
+        return cleared_;
+    }
+
+    const std::unordered_set<BaseModel *> &Changed() const {
+        return changed_;
+    }
+
+    // May not be dereferenced
+    const std::unordered_set<BaseModel *> &Removed() const {
+        return removed_;
+    }
+
+    void Reset() {
+        cleared_ = false;
+        changed_.clear();
+        removed_.clear();
+    }
+
+    // Implement ModelIndexWatcher
+    void ModelChanged(BaseModel *model) {
+        if (!cleared_) {
+            changed_.insert(model);
+        }
+    }
+    void ModelRemoved(BaseModel *model) {
+        if (!cleared_) {
+            changed_.erase(model);
+            removed_.insert(model);
+        }
+    }
+    void ModelsCleared() {
+        cleared_ = true;
+        changed_.clear();
+        removed_.clear();
+    }
+
+ private:
+    bool cleared_;
+    std::unordered_set<BaseModel *> changed_;
+    std::unordered_set<BaseModel *> removed_;
+};
+
+// Copies of the models that need saving, taken so they can be
+// written without holding on to the models. Changes made to the
+// models meanwhile are watched, see RelatedData::TakeSnapshot.
+class RelatedSnapshot {
+ public:
+    RelatedSnapshot() {}
+    ~RelatedSnapshot() {}
+
+    size_t Count() const {
+        return copied_.size();
+    }
+
+ private:
+    friend class RelatedData;
+
+    RelatedSnapshot(const RelatedSnapshot &);
+    RelatedSnapshot &operator=(const RelatedSnapshot &);
+
+    struct Copied {
+        BaseModel *Model;
+        BaseModel *Copy;
+        ModelIndex *Index;
+    };
+
+    std::vector<Copied> copied_;
+    std::map<ModelIndex *, ModelChanges> changes_;
+};
 
 class RelatedData {
  public:
+    RelatedData()
+        : autocomplete_revisions_()
+    , autocomplete_valid_() {
+        TimeEntryIndex.AddWatcher(&durations_by_day_);
+        TimeEntryIndex.AddWatcher(&autocomplete_changes_);
+    }
+
     std::vector<Workspace *> Workspaces;
     std::vector<Client *> Clients;
     std::vector<Project *> Projects;
@@ -46,8 +317,80 @@ class RelatedData {
     std::vector<ObmAction *> ObmActions;
     std::vector<ObmExperiment *> ObmExperiments;
 
+    // Recorded timeline events waiting to be saved in one batch.
+    // Saving moves them to TimelineEvents.
+    std::vector<TimelineEvent *> TimelineBuffer;
+
+    // Lookup indexes and change journals of the collections above
+    ModelIndex WorkspaceIndex;
+    ModelIndex ClientIndex;
+    ModelIndex ProjectIndex;
+    ModelIndex TaskIndex;
+    ModelIndex TagIndex;
+    ModelIndex TimeEntryIndex;
+    ModelIndex AutotrackerRuleIndex;
+    ModelIndex TimelineEventIndex;
+    ModelIndex ObmActionIndex;
+    ModelIndex ObmExperimentIndex;
+
     void Clear();
 
+    // Add models to collections. Use these instead of pushing
+    // to the vectors directly, so that the lookup indexes
+    // and change journals stay up to date.
+    void Push(Workspace *model);
+    void Push(Client *model);
+    void Push(Project *model);
+    void Push(Task *model);
+    void Push(Tag *model);
+    void Push(TimeEntry *model);
+    void Push(AutotrackerRule *model);
+    void Push(TimelineEvent *model);
+    void Push(ObmAction *model);
+    void Push(ObmExperiment *model);
+
+    // Rebuild lookup indexes after the vectors
+    // have been filled directly (for example, from database)
+    void Reindex();
+
+    // Track the models removed from the collections, see Merge
+    void TrackRemoved(const bool track);
+
+    // Move the models of other into these collections, except the
+    // ones already here or removed since tracking was turned on.
+    // Models in memory win over loaded copies.
+    void Merge(RelatedData *other);
+
+    // Drop the time entries that stopped before the given time and
+    // have nothing left to save or push, so their rows can be purged.
+    // Fills in the local IDs of the ones in that range that stay.
+    // With keep_all, none are dropped and all of them stay.
+    void ForgetTimeEntries(
+        const Poco::UInt64 stopped_before,
+        const bool keep_all,
+        std::set<Poco::Int64> *kept);
+
+    // Move the models waiting to be saved, except timeline events,
+    // into snapshot and put copies of them into copies. Apply the
+    // snapshot once the copies are saved, or failed to save.
+    void TakeSnapshot(RelatedData *copies, RelatedSnapshot *snapshot);
+
+    // Copy what saving assigned to the models that were not changed
+    // meanwhile and mark them saved, or put all back to the journal
+    // if the copies were not saved. Models purged from the copies
+    // are purged from here, too.
+    void ApplySnapshot(RelatedSnapshot *snapshot, const bool saved);
+
+    // Number of models waiting to be saved
+    size_t ChangedCount() const;
+
+    // Changes waiting to be saved, except timeline events,
+    // so they can be rendered before they're saved
+    void PendingChanges(std::vector<ModelChange> *result) const;
+
+    // Changes whenever the models views are made of change
+    Poco::UInt64 Revision() const;
+
     Task *TaskByID(const Poco::UInt64 id) const;
     Client *ClientByID(const Poco::UInt64 id) const;
     Project *ProjectByID(const Poco::UInt64 id) const;
@@ -75,9 +418,21 @@ class RelatedData {
     // Collect visible timeline events
     std::vector<TimelineEvent *> VisibleTimelineEvents() const;
 
+    // Adds a recorded timeline event to its chunk, see TimelineChunkKey.
+    // The first event of a chunk becomes the chunk and is buffered for
+    // saving, later ones only add their duration to it and are deleted.
+    // Chunks of periods that have ended are not added to any more,
+    // as they may be uploaded already.
+    void AddTimelineEvent(TimelineEvent *event);
+
+    // Chunks events that were saved unchunked, and purges chunks
+    // that are uploaded or older than minimum_time
+    void CompressTimeline(const Poco::UInt64 minimum_time);
+
     // Collect visible time entries
     std::vector<TimeEntry *> VisibleTimeEntries() const;
 
+    // Total duration of time entries on the same local day
     Poco::Int64 TotalDurationForDate(const TimeEntry *match) const;
 
     // avoid duplicates
@@ -89,6 +444,19 @@ class RelatedData {
     void MinitimerAutocompleteItems(std::vector<view::Autocomplete> *) const;
     void ProjectAutocompleteItems(std::vector<view::Autocomplete> *) const;
 
+    // Best matches for text among the autocomplete items of kind
+    // kAutocompleteTimeEntry, Minitimer or Project, at most limit
+    void AutocompleteQuery(
+        const Poco::UInt64 kind,
+        const std::string &text,
+        const size_t limit,
+        std::vector<view::Autocomplete> *result) const;
+
+    // Copy of the autocomplete index of kind, for querying
+    // without the models. Null for an unknown kind.
+    std::shared_ptr<const AutocompleteIndex> AutocompleteIndexCopy(
+        const Poco::UInt64 kind) const;
+
     void ProjectLabelAndColorCode(
         TimeEntry * const te,
         view::TimeEntry *view) const;
@@ -96,9 +464,31 @@ class RelatedData {
     AutotrackerRule *FindAutotrackerRule(const TimelineEvent event) const;
 
  private:
-    void timeEntryAutocompleteItems(
-        std::set<std::string> *unique_names,
-        std::vector<view::Autocomplete> *list) const;
+    // Autocomplete items of a kind, indexed for querying.
+    // Items of time entries are updated per changed time entry,
+    // all items are rebuilt when the other models they are made
+    // of have changed.
+    const AutocompleteIndex &autocompleteIndex(const Poco::UInt64 kind) const;
+
+    // Time entry and minitimer items, which share the time entry items
+    void buildTimeEntryAutocomplete() const;
+
+    // False if the items need to be rebuilt instead
+    bool updateTimeEntryAutocomplete() const;
+
+    void addAutocompleteEntry(
+        const TimeEntry *te,
+        std::set<std::string> *touched) const;
+    void removeAutocompleteEntry(
+        const BaseModel *model,
+        std::set<std::string> *touched) const;
+
+    // False if the time entry has no item. Fills in
+    // only the text of the item if item is null.
+    bool timeEntryAutocompleteItem(
+        const TimeEntry *te,
+        std::string *text,
+        view::Autocomplete *item) const;
 
     void taskAutocompleteItems(
         std::set<std::string> *unique_names,
@@ -116,6 +506,59 @@ class RelatedData {
         std::vector<view::Autocomplete> *list) const;
 
     Client *clientByProject(Project *p) const;
+
+    template<typename T>
+    void snapshotList(
+        ModelIndex *index,
+        std::vector<T *> *copies,
+        ModelIndex *copies_index,
+        RelatedSnapshot *snapshot);
+
+    bool addToTimelineChunk(
+        TimelineEvent *event,
+        const Poco::UInt64 open_since);
+    void forgetTimelineChunk(TimelineEvent *chunk);
+    void indexTimelineChunks();
+
+    mutable DurationsByDay durations_by_day_;
+
+    // Chunks that recorded timeline events can be added to
+    std::unordered_map<TimelineChunkKey, TimelineEvent *,
+        TimelineChunkKeyHash> timeline_chunks_;
+
+    static const Poco::UInt64 kAutocompleteKinds = 3;
+
+    mutable AutocompleteIndex autocomplete_indexes_[kAutocompleteKinds];
+    mutable Poco::UInt64 autocomplete_revisions_[kAutocompleteKinds];
+    mutable bool autocomplete_valid_[kAutocompleteKinds];
+
+    // Time entries with the same autocomplete text make
+    // one item, of the time entry that was started last
+    struct AutocompleteText {
+        AutocompleteText()
+            : Indexed(false)
+        , TimeEntryItem(0)
+        , MinitimerItem(0) {}
+
+        std::set<std::pair<Poco::UInt64, const BaseModel *> > Entries;
+
+        // Item IDs in the time entry and minitimer indexes
+        bool Indexed;
+        Poco::UInt32 TimeEntryItem;
+        Poco::UInt32 MinitimerItem;
+    };
+    mutable std::unordered_map<std::string, AutocompleteText>
+    autocomplete_texts_;
+
+    // Text and start each time entry was added with
+    mutable std::unordered_map<const BaseModel *,
+            std::pair<std::string, Poco::UInt64> > autocomplete_entries_;
+
+    // Unique names of the task and project items of minitimer,
+    // time entry items with the same text replace them
+    mutable std::set<std::string> minitimer_names_;
+
+    mutable ModelChanges autocomplete_changes_;
 };
 
 template<typename T>
@@ -32,7 +32,7 @@ void Tag::SetName(const std::string value) {
     }
 }
 
-void Tag::LoadFromJSON(Json::Value data) {
+void Tag::LoadFromJSON(const Json::Value &data) {
     if (data.isMember("guid")) {
         SetGUID(data["guid"].asString());
     }
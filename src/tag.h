@@ -32,7 +32,7 @@ class Tag : public BaseModel {
     std::string String() const;
     std::string ModelName() const;
     std::string ModelURL() const;
-    void LoadFromJSON(Json::Value data);
+    void LoadFromJSON(const Json::Value &data);
 
  private:
     Poco::UInt64 wid_;
@@ -46,7 +46,7 @@ class Task : public BaseModel {
     std::string String() const;
     std::string ModelName() const;
     std::string ModelURL() const;
-    void LoadFromJSON(Json::Value value);
+    void LoadFromJSON(const Json::Value &value);
 
  private:
     std::string name_;
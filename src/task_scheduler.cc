@@ -0,0 +1,131 @@
+// Copyright 2014 Toggl Desktop developers.
+
+#include "../src/task_scheduler.h"
+
+namespace toggl {
+
+// Timer task of a slot, fires the slot if it's still armed with it
+class TaskScheduler::SlotTask : public Poco::Util::TimerTask {
+ public:
+    SlotTask(
+        TaskScheduler *scheduler,
+        const std::string &kind)
+        : scheduler_(scheduler)
+    , kind_(kind) {}
+
+    void run() {
+        scheduler_->fire(kind_, this);
+    }
+
+ private:
+    TaskScheduler *scheduler_;
+    std::string kind_;
+};
+
+TaskScheduler::TaskScheduler(
+    Poco::Util::Timer *timer,
+    Poco::Mutex *timer_m)
+    : timer_(timer)
+, timer_m_(timer_m)
+, timer_tasks_(0) {}
+
+TaskScheduler::~TaskScheduler() {
+    Cancel();
+}
+
+void TaskScheduler::Register(
+    const std::string &kind,
+    Poco::Util::TimerTask::Ptr job) {
+    Poco::Mutex::ScopedLock lock(m_);
+    slots_[kind].Job = job;
+}
+
+void TaskScheduler::Schedule(
+    const std::string &kind,
+    const Poco::Timestamp at) {
+    Poco::Mutex::ScopedLock lock(m_);
+    Slot &slot = slots_[kind];
+    if (slot.Task && at >= slot.At) {
+        // The armed task fires first and arms the slot again
+        slot.At = at;
+        return;
+    }
+    if (slot.Task) {
+        slot.Task->cancel();
+    }
+    slot.At = at;
+    arm(kind, &slot);
+}
+
+void TaskScheduler::Cancel() {
+    Poco::Mutex::ScopedLock lock(m_);
+    for (std::map<std::string, Slot>::iterator it = slots_.begin();
+            it != slots_.end(); it++) {
+        if (it->second.Task) {
+            it->second.Task->cancel();
+            it->second.Task = nullptr;
+        }
+    }
+}
+
+bool TaskScheduler::IsPending(const std::string &kind) const {
+    Poco::Mutex::ScopedLock lock(m_);
+    std::map<std::string, Slot>::const_iterator it = slots_.find(kind);
+    return it != slots_.end() && it->second.Task;
+}
+
+size_t TaskScheduler::QueueDepth() const {
+    Poco::Mutex::ScopedLock lock(m_);
+    size_t depth(0);
+    for (std::map<std::string, Slot>::const_iterator it = slots_.begin();
+            it != slots_.end(); it++) {
+        if (it->second.Task) {
+            depth++;
+        }
+    }
+    return depth;
+}
+
+Poco::UInt64 TaskScheduler::FireCount(const std::string &kind) const {
+    Poco::Mutex::ScopedLock lock(m_);
+    std::map<std::string, Slot>::const_iterator it = slots_.find(kind);
+    if (it == slots_.end()) {
+        return 0;
+    }
+    return it->second.Fired;
+}
+
+void TaskScheduler::arm(const std::string &kind, Slot *slot) {
+    slot->Task = new SlotTask(this, kind);
+    timer_tasks_++;
+
+    Poco::Mutex::ScopedLock lock(*timer_m_);
+    timer_->schedule(slot->Task, slot->At);
+}
+
+void TaskScheduler::fire(
+    const std::string &kind,
+    Poco::Util::TimerTask *task) {
+    Poco::Util::TimerTask::Ptr job;
+    {
+        Poco::Mutex::ScopedLock lock(m_);
+        Slot &slot = slots_[kind];
+        if (slot.Task.get() != task) {
+            // Cancelled, or replaced by an earlier run
+            return;
+        }
+        if (Poco::Timestamp() < slot.At) {
+            // Moved later since armed
+            arm(kind, &slot);
+            return;
+        }
+        slot.Task = nullptr;
+        slot.Fired++;
+        job = slot.Job;
+    }
+    if (job) {
+        job->run();
+    }
+}
+
+}  // namespace toggl
@@ -0,0 +1,89 @@
+// Copyright 2014 Toggl Desktop developers.
+
+#ifndef SRC_TASK_SCHEDULER_H_
+#define SRC_TASK_SCHEDULER_H_
+
+#include <map>
+#include <string>
+
+#include "Poco/Mutex.h"
+#include "Poco/Timestamp.h"
+#include "Poco/Types.h"
+#include "Poco/Util/Timer.h"
+#include "Poco/Util/TimerTask.h"
+
+namespace toggl {
+
+// Runs jobs on a timer, with at most one pending run per kind of job.
+// Scheduling a job that is pending already moves the pending run,
+// so a burst of requests ends up in a single run, and in a single
+// timer task when the run is only moved later.
+class TaskScheduler {
+ public:
+    TaskScheduler(
+        Poco::Util::Timer *timer,
+        Poco::Mutex *timer_m);
+    ~TaskScheduler();
+
+    // Job to run for the kind. The task is run on the timer thread,
+    // it's never scheduled on the timer itself.
+    void Register(
+        const std::string &kind,
+        Poco::Util::TimerTask::Ptr job);
+
+    // Run the job at the given time, instead of when it was pending
+    void Schedule(
+        const std::string &kind,
+        const Poco::Timestamp at);
+
+    // Drop all pending runs
+    void Cancel();
+
+    bool IsPending(const std::string &kind) const;
+
+    // Number of pending runs
+    size_t QueueDepth() const;
+
+    // How many times the job of the kind has run
+    Poco::UInt64 FireCount(const std::string &kind) const;
+
+    // How many tasks have been handed to the timer
+    Poco::UInt64 TimerTaskCount() const {
+        Poco::Mutex::ScopedLock lock(m_);
+        return timer_tasks_;
+    }
+
+ private:
+    class SlotTask;
+
+    struct Slot {
+        Slot()
+            : At(0)
+        , Fired(0) {}
+
+        Poco::Util::TimerTask::Ptr Job;
+
+        // Armed on the timer while a run is pending. Fires at
+        // or before At, a slot moved later is armed again.
+        Poco::Util::TimerTask::Ptr Task;
+        Poco::Timestamp At;
+
+        Poco::UInt64 Fired;
+    };
+
+    void fire(const std::string &kind, Poco::Util::TimerTask *task);
+
+    // m_ must be locked
+    void arm(const std::string &kind, Slot *slot);
+
+    Poco::Util::Timer *timer_;
+    Poco::Mutex *timer_m_;
+
+    mutable Poco::Mutex m_;
+    std::map<std::string, Slot> slots_;
+    Poco::UInt64 timer_tasks_;
+};
+
+}  // namespace toggl
+
+#endif  // SRC_TASK_SCHEDULER_H_
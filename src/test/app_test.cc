@@ -1,20 +1,32 @@
 // Copyright 2014 Toggl Desktop developers.
 
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include <iostream>  // NOLINT
 
+#include "./../autocomplete_index.h"
 #include "./../autotracker.h"
 #include "./../client.h"
 #include "./../const.h"
 #include "./../database.h"
 #include "./../formatter.h"
+#include "./../gui.h"
+#include "./../json_stream.h"
+#include "./../migrations.h"
 #include "./../obm_action.h"
 #include "./../project.h"
 #include "./../proxy.h"
 #include "./../settings.h"
 #include "./../tag.h"
 #include "./../task.h"
+#include "./../task_scheduler.h"
 #include "./../time_entry.h"
 #include "./../timeline_event.h"
 #include "./../timeline_uploader.h"
@@ -25,8 +37,18 @@
 
 #include "Poco/File.h"
 #include "Poco/FileStream.h"
+#include "Poco/InflatingStream.h"
 #include "Poco/Logger.h"
 #include "Poco/LocalDateTime.h"
+#include "Poco/DateTimeFormat.h"
+#include "Poco/DateTimeFormatter.h"
+#include "Poco/DateTimeParser.h"
+#include "Poco/NumberFormatter.h"
+#include "Poco/Random.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Event.h"
+#include "Poco/Thread.h"
+#include "Poco/Util/TimerTaskAdapter.h"
 
 namespace toggl {
 
@@ -53,6 +75,19 @@ class Database {
     toggl::Database *db_;
 };
 
+TimelineEvent *timelineEvent(
+    const std::string filename,
+    const std::string title,
+    const Poco::UInt64 start,
+    const Poco::UInt64 duration) {
+    TimelineEvent *event = new TimelineEvent();
+    event->SetFilename(filename);
+    event->SetTitle(title);
+    event->SetStart(start);
+    event->SetEndTime(start + duration);
+    return event;
+}
+
 }  // namespace testing
 
 TEST(TimeEntry, TimeEntryReturnsTags) {
@@ -61,6 +96,63 @@ TEST(TimeEntry, TimeEntryReturnsTags) {
     ASSERT_EQ(std::string("alfa|beeta"), te.Tags());
 }
 
+TEST(TimeEntry, SharesInternedTags) {
+    TimeEntry te;
+    te.SetTags("alfa\tbeeta");
+    ASSERT_EQ(uint(2), te.TagNames().size());
+    ASSERT_EQ("alfa", te.TagNames()[0]);
+    ASSERT_EQ("beeta", te.TagNames()[1]);
+
+    TimeEntry te2;
+    te2.SetTags("alfa\tbeeta");
+    ASSERT_EQ(&te.Tags(), &te2.Tags());
+
+    // Same tags again don't dirty the entry
+    te.ClearDirty();
+    te.SetTags("alfa\tbeeta");
+    ASSERT_FALSE(te.Dirty());
+
+    te.SetTags("beeta\talfa");
+    ASSERT_TRUE(te.Dirty());
+    ASSERT_EQ("beeta", te.TagNames()[0]);
+    ASSERT_EQ("alfa\tbeeta", te2.Tags());
+
+    // Empty tags are kept when set, but dropped from JSON
+    te.SetTags("alfa\t");
+    ASSERT_EQ(uint(2), te.TagNames().size());
+    Json::Value json;
+    json["tags"].append("");
+    json["tags"].append("alfa");
+    json["tags"].append("beeta");
+    te.LoadFromJSON(json);
+    ASSERT_EQ(&te.Tags(), &te2.Tags());
+    ASSERT_EQ(uint(2), te.SaveToJSON()["tags"].size());
+
+    te.SetTags("");
+    ASSERT_EQ("", te.Tags());
+    ASSERT_EQ(uint(0), te.TagNames().size());
+}
+
+TEST(TimeEntry, DropsUnusedInternedTags) {
+    {
+        TimeEntry te;
+        te.SetTags("gamma\tdelta");
+        TimeEntry copy(te);
+        ASSERT_EQ(&te.Tags(), &copy.Tags());
+    }
+
+    // Interned again after the entries that had it are gone
+    TimeEntry te;
+    te.SetTags("gamma\tdelta");
+    ASSERT_EQ(uint(2), te.TagNames().size());
+    ASSERT_EQ("gamma", te.TagNames()[0]);
+    ASSERT_EQ("gamma\tdelta", te.Tags());
+
+    TimeEntry none;
+    ASSERT_TRUE(none.TagNames().empty());
+    ASSERT_EQ("", none.Tags());
+}
+
 TEST(TimeEntry, WillNotPushUnlessValidationErrorIsCleared) {
     TimeEntry te;
     ASSERT_TRUE(te.NeedsPush());
@@ -109,6 +201,44 @@ TEST(Project, ResolveOnlyAdminsCanChangeProjectVisibility) {
     ASSERT_TRUE(p.IsPrivate());
 }
 
+TEST(User, CompressedTimelinePages) {
+    User user;
+    Poco::UInt64 start = time(0) - 86400;
+    for (int i = 0; i < 5; i++) {
+        TimelineEvent *event = testing::timelineEvent(
+            "Terminal", "vim", start + i * kTimelineChunkSeconds, 10);
+        event->SetChunked(true);
+        event->EnsureGUID();
+        user.related.Push(event);
+    }
+    // Already uploaded chunks are skipped
+    user.related.TimelineEvents[1]->SetUploaded(true);
+
+    Poco::UInt64 cursor(0);
+    std::vector<TimelineEvent> page = user.CompressedTimeline(2, &cursor);
+    ASSERT_EQ(std::size_t(2), page.size());
+    ASSERT_EQ(user.related.TimelineEvents[0]->GUID(), page[0].GUID());
+    ASSERT_EQ(user.related.TimelineEvents[2]->GUID(), page[1].GUID());
+    ASSERT_EQ(Poco::UInt64(3), cursor);
+
+    // The next page continues from the cursor, a failed page
+    // gives the same events when asked again from the same cursor
+    for (int attempt = 0; attempt < 2; attempt++) {
+        Poco::UInt64 next(cursor);
+        page = user.CompressedTimeline(2, &next);
+        ASSERT_EQ(std::size_t(2), page.size());
+        ASSERT_EQ(user.related.TimelineEvents[3]->GUID(), page[0].GUID());
+        ASSERT_EQ(user.related.TimelineEvents[4]->GUID(), page[1].GUID());
+        ASSERT_EQ(Poco::UInt64(5), next);
+    }
+
+    cursor = 5;
+    page = user.CompressedTimeline(2, &cursor);
+    ASSERT_EQ(std::size_t(0), page.size());
+
+    ASSERT_EQ(std::size_t(4), user.CompressedTimeline().size());
+}
+
 TEST(User, CreateCompressedTimelineBatchForUpload) {
     testing::Database db;
 
@@ -130,7 +260,7 @@ TEST(User, CreateCompressedTimelineBatchForUpload) {
     good->SetEndTime(good->Start() + good_duration_seconds);
     good->SetFilename("Notepad.exe");
     good->SetTitle("untitled");
-    user.related.TimelineEvents.push_back(good);
+    user.related.Push(good);
 
     Poco::UInt64 good2_duration_seconds(20);
 
@@ -142,7 +272,7 @@ TEST(User, CreateCompressedTimelineBatchForUpload) {
     good2->SetEndTime(good2->Start() + good2_duration_seconds);
     good2->SetFilename("Notepad.exe");
     good2->SetTitle("untitled");
-    user.related.TimelineEvents.push_back(good2);
+    user.related.Push(good2);
 
     // Another event that happened at least 15 minutes ago,
     // but has already been uploaded to Toggl backend.
@@ -153,17 +283,20 @@ TEST(User, CreateCompressedTimelineBatchForUpload) {
     uploaded->SetFilename("Notepad.exe");
     uploaded->SetTitle("untitled");
     uploaded->SetUploaded(true);
-    user.related.TimelineEvents.push_back(uploaded);
+    user.related.Push(uploaded);
 
-    // This event happened less than 15 minutes ago,
+    // This event happened in the current chunk period,
     // so it must not be uploaded
+    Poco::UInt64 period_start =
+        (time(0) / kTimelineChunkSeconds) * kTimelineChunkSeconds;
     TimelineEvent *too_fresh = new TimelineEvent();
     too_fresh->SetUID(user_id);
-    too_fresh->SetStart(time(0) - 60);  // started 1 minute ago
+    // started up to 1 minute ago
+    too_fresh->SetStart(std::max(Poco::UInt64(time(0) - 60), period_start));
     too_fresh->SetEndTime(time(0));  // lasted until now
     too_fresh->SetFilename("Notepad.exe");
     too_fresh->SetTitle("notes");
-    user.related.TimelineEvents.push_back(too_fresh);
+    user.related.Push(too_fresh);
 
     // This event happened more than 7 days ago,
     // so it must not be uploaded, just deleted
@@ -173,7 +306,7 @@ TEST(User, CreateCompressedTimelineBatchForUpload) {
     too_old->SetEndTime(too_old->EndTime() + 120);  // lasted 2 minutes
     too_old->SetFilename("Notepad.exe");
     too_old->SetTitle("diary");
-    user.related.TimelineEvents.push_back(too_old);
+    user.related.Push(too_old);
 
     db.instance()->SaveUser(&user, true, &changes);
 
@@ -322,6 +455,33 @@ TEST(User, UpdatesTimeEntryFromJSON) {
     ASSERT_EQ("Changed", te->Description());
 }
 
+TEST(User, LoadUserUpdatesFromJSON) {
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
+
+    std::vector<Json::Value> updates;
+    updates.push_back(jsonStringToValue(
+        "{\"action\":\"UPDATE\",\"model\":\"time_entry\","
+        "\"data\":{\"id\":89818605,\"description\":\"First\"}}"));
+    updates.push_back(jsonStringToValue(
+        "{\"action\":\"INSERT\",\"model\":\"time_entry\","
+        "\"data\":{\"id\":1,\"guid\":\"07fba193-91c4-0ec8-2345-820df0548123\","  // NOLINT
+        "\"description\":\"Inserted\",\"duration\":10}}"));
+    updates.push_back(jsonStringToValue(
+        "{\"action\":\"UPDATE\",\"model\":\"time_entry\","
+        "\"data\":{\"id\":89818605,\"description\":\"Last\"}}"));
+    updates.push_back(jsonStringToValue(
+        "{\"action\":\"UPDATE\",\"model\":\"project\","
+        "\"data\":{\"id\":1,\"name\":\"Same ID, other model\"}}"));
+
+    // Only the last update of the same time entry is applied
+    ASSERT_EQ(std::size_t(3), user.LoadUserUpdatesFromJSON(updates));
+    ASSERT_EQ("Last", user.related.TimeEntryByID(89818605)->Description());
+    ASSERT_EQ("Inserted", user.related.TimeEntryByID(1)->Description());
+    ASSERT_TRUE(user.related.ProjectByID(1));
+}
+
 TEST(User, UpdatesTimeEntryIDFromJSONEvenIfUpdatedByUserMeanwhile) {
     User user;
     ASSERT_EQ(noError,
@@ -752,6 +912,474 @@ TEST(Database, SavesModels) {
     ASSERT_EQ(noError, db.instance()->SaveUser(&user, false, &changes));
 }
 
+TEST(Database, SavesOnlyChangedModels) {
+    testing::Database db;
+
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
+    ASSERT_TRUE(user.related.ChangedCount());
+
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+    ASSERT_EQ(size_t(0), user.related.ChangedCount());
+
+    changes.clear();
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+    ASSERT_TRUE(changes.empty());
+
+    TimeEntry *te = user.related.TimeEntryByID(89837445);
+    ASSERT_TRUE(te);
+    te->SetDescription("changed");
+    ASSERT_EQ(size_t(1), user.related.ChangedCount());
+
+    changes.clear();
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+    ASSERT_EQ(size_t(1), changes.size());
+    ASSERT_EQ(te->GUID(), changes[0].GUID());
+    ASSERT_EQ(size_t(0), user.related.ChangedCount());
+
+    User loaded;
+    ASSERT_EQ(noError, db.instance()->LoadUserByID(user.ID(), &loaded));
+    TimeEntry *te2 = loaded.related.TimeEntryByID(89837445);
+    ASSERT_TRUE(te2);
+    ASSERT_EQ("changed", te2->Description());
+    ASSERT_EQ(size_t(0), loaded.related.ChangedCount());
+}
+
+TEST(Database, SavesBufferedTimelineEvents) {
+    testing::Database db;
+
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+
+    // More than fits into one insert
+    const size_t count = 150;
+    const Poco::UInt64 start = time(0) - 3600;
+    for (size_t i = 0; i < count; i++) {
+        TimelineEvent *event = new TimelineEvent();
+        std::stringstream ss;
+        ss << "event " << i;
+        event->SetTitle(ss.str());
+        event->SetFilename("app");
+        event->SetStart(start + i * 10);
+        event->SetEndTime(start + i * 10 + 10);
+        user.related.TimelineBuffer.push_back(event);
+    }
+
+    // Cannot be saved without an end time
+    TimelineEvent *invalid = new TimelineEvent();
+    invalid->SetStart(start);
+    user.related.TimelineBuffer.push_back(invalid);
+
+    ASSERT_EQ(noError, db.instance()->SaveTimelineEvents(&user));
+    ASSERT_TRUE(user.related.TimelineBuffer.empty());
+    ASSERT_EQ(count, user.related.TimelineEvents.size());
+    ASSERT_EQ(size_t(0), user.related.ChangedCount());
+
+    // Whatever is buffered at shutdown is saved with the user
+    TimelineEvent *last = new TimelineEvent();
+    last->SetTitle("last");
+    last->SetStart(start + count * 10);
+    last->SetEndTime(start + count * 10 + 10);
+    user.related.TimelineBuffer.push_back(last);
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+    ASSERT_TRUE(user.related.TimelineBuffer.empty());
+    ASSERT_EQ(count + 1, user.related.TimelineEvents.size());
+
+    User loaded;
+    ASSERT_EQ(noError, db.instance()->LoadUserByID(user.ID(), &loaded));
+    ASSERT_EQ(count + 1, loaded.related.TimelineEvents.size());
+    for (size_t i = 0; i < user.related.TimelineEvents.size(); i++) {
+        TimelineEvent *saved = user.related.TimelineEvents[i];
+        TimelineEvent *event =
+            loaded.related.TimelineEventByGUID(saved->GUID());
+        ASSERT_TRUE(event);
+        ASSERT_EQ(saved->LocalID(), event->LocalID());
+        ASSERT_EQ(saved->Title(), event->Title());
+        ASSERT_EQ(saved->Start(), event->Start());
+    }
+}
+
+TEST(Database, Maintain) {
+    testing::Database db;
+
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
+
+    // Synced time entries that stopped more than 30 days ago
+    const Poco::UInt64 count = 1200;
+    const Poco::UInt64 start = time(0) - 90 * 86400;
+    for (Poco::UInt64 i = 1; i <= count; i++) {
+        TimeEntry *te = new TimeEntry();
+        te->SetID(1000000 + i);
+        te->SetUID(user.ID());
+        te->SetWID(user.DefaultWID());
+        te->SetDescription("old");
+        te->SetStart(start + i * 60);
+        te->SetStop(te->Start() + 30);
+        te->SetDurationInSeconds(30);
+        user.related.Push(te);
+    }
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+
+    Poco::Timestamp purge_before(
+        Poco::Timestamp::fromEpochTime(time(0) - kTimeEntrySecondsToKeep));
+    std::set<Poco::Int64> keep;
+
+    // Without a budget nothing gets done but the checkpoint
+    DatabaseMaintenance run;
+    ASSERT_EQ(noError, db.instance()->Maintain(0, purge_before, keep, &run));
+    ASSERT_FALSE(run.complete);
+    ASSERT_EQ(Poco::UInt64(0), run.rows_purged);
+
+    ASSERT_EQ(noError, db.instance()->Maintain(
+        60 * kOneSecondInMicros, purge_before, keep, &run));
+    ASSERT_TRUE(run.complete);
+    ASSERT_LE(count, run.rows_purged);
+    ASSERT_LT(0, run.pages_reclaimed);
+    ASSERT_LE(run.started, run.ended);
+    ASSERT_NE(std::string::npos, run.String().find("pages_reclaimed="));
+
+    User loaded;
+    ASSERT_EQ(noError, db.instance()->LoadUserByID(user.ID(), &loaded));
+    for (size_t i = 0; i < loaded.related.TimeEntries.size(); i++) {
+        ASSERT_NE("old", loaded.related.TimeEntries[i]->Description());
+    }
+
+    // Nothing left to do
+    ASSERT_EQ(noError, db.instance()->Maintain(
+        60 * kOneSecondInMicros, purge_before, keep, &run));
+    ASSERT_TRUE(run.complete);
+    ASSERT_EQ(Poco::UInt64(0), run.rows_purged);
+    ASSERT_EQ(0, run.pages_reclaimed);
+}
+
+TEST(Database, MaintainKeepsTimeEntriesInUse) {
+    testing::Database db;
+
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
+
+    const Poco::UInt64 start = time(0) - 90 * 86400;
+    for (Poco::UInt64 i = 1; i <= 3; i++) {
+        TimeEntry *te = new TimeEntry();
+        te->SetID(2000000 + i);
+        te->SetUID(user.ID());
+        te->SetWID(user.DefaultWID());
+        te->SetDescription("old");
+        te->SetStart(start + i * 60);
+        te->SetStop(te->Start() + 30);
+        te->SetDurationInSeconds(30);
+        user.related.Push(te);
+    }
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+
+    // Edited, but not saved yet
+    TimeEntry *edited = user.related.TimeEntryByID(2000002);
+    ASSERT_TRUE(edited);
+    edited->SetDescription("edited");
+    std::string edited_guid = edited->GUID();
+    Poco::Int64 edited_local_id = edited->LocalID();
+
+    Poco::Timestamp purge_before(
+        Poco::Timestamp::fromEpochTime(time(0) - kTimeEntrySecondsToKeep));
+    std::set<Poco::Int64> keep;
+    user.ForgetTimeEntries(purge_before.epochTime(), &keep);
+    ASSERT_FALSE(user.related.TimeEntryByID(2000001));
+    ASSERT_FALSE(user.related.TimeEntryByID(2000003));
+    ASSERT_TRUE(keep.count(edited_local_id));
+
+    DatabaseMaintenance run;
+    ASSERT_EQ(noError, db.instance()->Maintain(
+        60 * kOneSecondInMicros, purge_before, keep, &run));
+    ASSERT_TRUE(run.complete);
+    ASSERT_LE(Poco::UInt64(2), run.rows_purged);
+
+    // The entry in use still has its row
+    edited = user.related.TimeEntryByGUID(edited_guid);
+    ASSERT_TRUE(edited);
+    edited->SetDescription("edited again");
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+
+    User loaded;
+    ASSERT_EQ(noError, db.instance()->LoadUserByID(user.ID(), &loaded));
+    ASSERT_EQ(user.related.TimeEntries.size(),
+              loaded.related.TimeEntries.size());
+    TimeEntry *reloaded = loaded.related.TimeEntryByGUID(edited_guid);
+    ASSERT_TRUE(reloaded);
+    ASSERT_EQ("edited again", reloaded->Description());
+    ASSERT_FALSE(loaded.related.TimeEntryByID(2000001));
+    ASSERT_FALSE(loaded.related.TimeEntryByID(2000003));
+}
+
+TEST(Database, MaintainKeepsLoadedMoreTimeEntries) {
+    testing::Database db;
+
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
+
+    // Fetched with "Load more"
+    const Poco::UInt64 start = time(0) - 90 * 86400;
+    for (Poco::UInt64 i = 1; i <= 3; i++) {
+        TimeEntry *te = new TimeEntry();
+        te->SetID(3000000 + i);
+        te->SetUID(user.ID());
+        te->SetWID(user.DefaultWID());
+        te->SetDescription("loaded more");
+        te->SetStart(start + i * 60);
+        te->SetStop(te->Start() + 30);
+        te->SetDurationInSeconds(30);
+        user.related.Push(te);
+    }
+    user.ConfirmLoadedMore();
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+
+    Poco::Timestamp purge_before(
+        Poco::Timestamp::fromEpochTime(time(0) - kTimeEntrySecondsToKeep));
+    std::set<Poco::Int64> keep;
+    user.ForgetTimeEntries(purge_before.epochTime(), &keep);
+    for (Poco::UInt64 i = 1; i <= 3; i++) {
+        TimeEntry *te = user.related.TimeEntryByID(3000000 + i);
+        ASSERT_TRUE(te);
+        ASSERT_TRUE(keep.count(te->LocalID()));
+    }
+
+    DatabaseMaintenance run;
+    ASSERT_EQ(noError, db.instance()->Maintain(
+        60 * kOneSecondInMicros, purge_before, keep, &run));
+    ASSERT_TRUE(run.complete);
+
+    // Still there, in memory and in the database
+    for (Poco::UInt64 i = 1; i <= 3; i++) {
+        ASSERT_TRUE(user.related.TimeEntryByID(3000000 + i));
+    }
+    User loaded;
+    ASSERT_EQ(noError, db.instance()->LoadUserByID(user.ID(), &loaded));
+    for (Poco::UInt64 i = 1; i <= 3; i++) {
+        ASSERT_TRUE(loaded.related.TimeEntryByID(3000000 + i));
+    }
+}
+
+TEST(Database, LoadsCurrentUserInTwoPhases) {
+    testing::Database db;
+
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
+
+    const Poco::UInt64 now = time(0);
+
+    TimeEntry *recent = new TimeEntry();
+    recent->SetUID(user.ID());
+    recent->SetWID(user.DefaultWID());
+    recent->SetDescription("recent");
+    // Task of an archived project
+    recent->SetPID(2598305);
+    recent->SetTID(1894794);
+    recent->SetStart(now - 3600);
+    recent->SetStop(now - 1800);
+    recent->SetDurationInSeconds(1800);
+    user.related.Push(recent);
+
+    // Running for a month, still needed on the first screen
+    TimeEntry *running = new TimeEntry();
+    running->SetUID(user.ID());
+    running->SetWID(user.DefaultWID());
+    running->SetDescription("running");
+    running->SetStart(now - 30 * 86400);
+    running->SetDurationInSeconds(
+        -static_cast<Poco::Int64>(running->Start()));
+    user.related.Push(running);
+
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+    ASSERT_EQ(noError,
+              db.instance()->SetCurrentAPIToken(user.APIToken(), user.ID()));
+
+    const Poco::UInt64 since = now - 14 * 86400;
+    User loaded;
+    ASSERT_EQ(noError, db.instance()->LoadCurrentUser(&loaded, since));
+    ASSERT_EQ(user.ID(), loaded.ID());
+    ASSERT_EQ(since, loaded.PartialDataSince());
+    ASSERT_EQ(user.related.Workspaces.size(), loaded.related.Workspaces.size());
+    ASSERT_EQ(user.related.Clients.size(), loaded.related.Clients.size());
+    ASSERT_EQ(size_t(2), loaded.related.Projects.size());
+    ASSERT_TRUE(loaded.related.ProjectByID(2567324));
+    ASSERT_TRUE(loaded.related.ProjectByID(2598305));
+    ASSERT_EQ(size_t(2), loaded.related.TimeEntries.size());
+    ASSERT_TRUE(loaded.RunningTimeEntry());
+    ASSERT_EQ(size_t(1), loaded.related.Tasks.size());
+    ASSERT_TRUE(loaded.related.TaskByID(1894794));
+    ASSERT_EQ(size_t(0), loaded.related.Tags.size());
+
+    // Changes made in memory before the rest is loaded are kept
+    loaded.related.TimeEntryByGUID(recent->GUID())->SetDescription("changed");
+
+    RelatedData rest;
+    ASSERT_EQ(noError,
+              db.instance()->LoadUserRemainingData(user.ID(), since, &rest));
+    ASSERT_EQ(user.related.Projects.size() - 1, rest.Projects.size());
+    ASSERT_EQ(size_t(5), rest.TimeEntries.size());
+    loaded.related.Merge(&rest);
+    ASSERT_TRUE(rest.TimeEntries.empty());
+
+    User full;
+    ASSERT_EQ(noError, db.instance()->LoadUserByID(user.ID(), &full));
+    ASSERT_EQ(full.related.Projects.size(), loaded.related.Projects.size());
+    ASSERT_EQ(full.related.Tasks.size(), loaded.related.Tasks.size());
+    ASSERT_EQ(full.related.Tags.size(), loaded.related.Tags.size());
+    ASSERT_EQ(size_t(7), loaded.related.TimeEntries.size());
+    ASSERT_TRUE(loaded.related.TimeEntryByID(89818605));
+
+    // Merging copies of models already in memory changes nothing
+    loaded.related.Merge(&full.related);
+    ASSERT_EQ(size_t(7), loaded.related.TimeEntries.size());
+    ASSERT_EQ(user.related.Projects.size(), loaded.related.Projects.size());
+    ASSERT_EQ("changed",
+              loaded.related.TimeEntryByGUID(recent->GUID())->Description());
+}
+
+TEST(Database, MergeSkipsModelsRemovedWhileLoading) {
+    testing::Database db;
+
+    User user;
+    ASSERT_EQ(noError,
+              user.LoadUserAndRelatedDataFromJSONString(loadTestData(), true));
+
+    const Poco::UInt64 now = time(0);
+    TimeEntry *recent = new TimeEntry();
+    recent->SetID(3000001);
+    recent->SetUID(user.ID());
+    recent->SetWID(user.DefaultWID());
+    recent->SetDescription("recent");
+    recent->SetStart(now - 3600);
+    recent->SetStop(now - 1800);
+    recent->SetDurationInSeconds(1800);
+    user.related.Push(recent);
+
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db.instance()->SaveUser(&user, true, &changes));
+    ASSERT_EQ(noError,
+              db.instance()->SetCurrentAPIToken(user.APIToken(), user.ID()));
+
+    User loaded;
+    ASSERT_EQ(noError,
+              db.instance()->LoadCurrentUser(&loaded, now - 14 * 86400));
+    loaded.related.TrackRemoved(true);
+    std::string guid = recent->GUID();
+    ASSERT_TRUE(loaded.related.TimeEntryByGUID(guid));
+
+    // Read in the background before the entry is deleted
+    RelatedData rest;
+    ASSERT_EQ(noError,
+              db.instance()->LoadUserRemainingData(
+                  user.ID(), now + 86400, &rest));
+    bool in_rest(false);
+    for (size_t i = 0; i < rest.TimeEntries.size(); i++) {
+        in_rest = in_rest || rest.TimeEntries[i]->GUID() == guid;
+    }
+    ASSERT_TRUE(in_rest);
+
+    loaded.related.TimeEntryByGUID(guid)->MarkAsDeletedOnServer();
+    ASSERT_EQ(noError, db.instance()->SaveUser(&loaded, true, &changes));
+    ASSERT_FALSE(loaded.related.TimeEntryByGUID(guid));
+
+    loaded.related.Merge(&rest);
+    loaded.related.TrackRemoved(false);
+    ASSERT_FALSE(loaded.related.TimeEntryByGUID(guid));
+    ASSERT_FALSE(loaded.related.TimeEntryByID(3000001));
+
+    User full;
+    ASSERT_EQ(noError, db.instance()->LoadUserByID(user.ID(), &full));
+    ASSERT_EQ(full.related.TimeEntries.size(),
+              loaded.related.TimeEntries.size());
+}
+
+TEST(Database, MigratesEmptyDatabase) {
+    testing::Database db;
+
+    std::vector<std::string> migrations;
+    ASSERT_EQ(noError, db.instance()->LoadMigrations(&migrations));
+    ASSERT_LT(size_t(100), migrations.size());
+
+    // Already applied migrations are skipped without touching the DB
+    Migrations again(db.instance());
+    ASSERT_EQ(noError, again.Run());
+    ASSERT_EQ(size_t(0), again.Pending());
+    ASSERT_EQ(migrations.size(), again.Applied());
+
+    std::vector<std::string> after;
+    ASSERT_EQ(noError, db.instance()->LoadMigrations(&after));
+    ASSERT_EQ(migrations.size(), after.size());
+}
+
+TEST(Database, MigratesOldDatabase) {
+    std::vector<std::string> expected;
+    {
+        testing::Database db;
+        ASSERT_EQ(noError, db.instance()->LoadMigrations(&expected));
+    }
+
+    // Recreate a database left behind by an old app version,
+    // half way through the migrations
+    Poco::File f(TESTDB);
+    if (f.exists()) {
+        f.remove(false);
+    }
+    std::string sql = loadTestDataFile("../testdata/old_database.sql");
+    ASSERT_FALSE(sql.empty());
+    sqlite3 *handle = nullptr;
+    ASSERT_EQ(SQLITE_OK, sqlite3_open(TESTDB, &handle));
+    ASSERT_EQ(SQLITE_OK, sqlite3_exec(handle, sql.c_str(), 0, 0, 0));
+    sqlite3_close(handle);
+
+    toggl::Database db(TESTDB);
+
+    std::vector<std::string> migrations;
+    ASSERT_EQ(noError, db.LoadMigrations(&migrations));
+    ASSERT_EQ(expected.size(), migrations.size());
+
+    Migrations again(&db);
+    ASSERT_EQ(noError, again.Run());
+    ASSERT_EQ(size_t(0), again.Pending());
+
+    // Data survives the table rewrites
+    User user;
+    ASSERT_EQ(noError, db.LoadUserByID(10471231, &user));
+    ASSERT_EQ("johndoe@example.com", user.Email());
+    ASSERT_EQ(Poco::UInt64(123456789), user.DefaultWID());
+    ASSERT_EQ(size_t(1), user.related.Workspaces.size());
+    ASSERT_EQ(size_t(1), user.related.Projects.size());
+    ASSERT_EQ(size_t(2), user.related.TimeEntries.size());
+
+    TimeEntry *te = user.related.TimeEntryByID(89818605);
+    ASSERT_TRUE(te);
+    ASSERT_EQ("Changes to the old database", te->Description());
+    ASSERT_EQ(Poco::UInt64(2598305), te->PID());
+    ASSERT_EQ("billed", te->Tags());
+
+    te = user.related.TimeEntryByGUID("b6b7ad0f-4f2a-7e1c-9d2e-5e3a0d1f9c42");
+    ASSERT_TRUE(te);
+    ASSERT_FALSE(te->ID());
+    ASSERT_EQ(Poco::UInt64(1800), te->DurationInSeconds());
+
+    Settings settings;
+    ASSERT_EQ(noError, db.LoadSettings(&settings));
+    ASSERT_FALSE(settings.use_idle_detection);
+    ASSERT_TRUE(settings.menubar_timer);
+    ASSERT_TRUE(settings.focus_on_shortcut);
+}
+
 TEST(Database, AssignsGUID) {
     std::string json = loadTestData();
     ASSERT_FALSE(json.empty());
@@ -819,7 +1447,7 @@ TEST(User, ParsesAndSavesData) {
     ASSERT_EQ(6356, user.related.TimeEntries[0]->DurationInSeconds());
     ASSERT_EQ("Important things",
               user.related.TimeEntries[0]->Description());
-    ASSERT_EQ(uint(0), user.related.TimeEntries[0]->TagNames.size());
+    ASSERT_EQ(uint(0), user.related.TimeEntries[0]->TagNames().size());
     ASSERT_FALSE(user.related.TimeEntries[0]->DurOnly());
     ASSERT_EQ(user.ID(), user.related.TimeEntries[0]->UID());
 
@@ -1350,6 +1978,363 @@ TEST(TimeEntry, SetDurationOnRunningTimeEntryWithDurOnlySetting) {
     ASSERT_LT(te->Start(), te->Stop());
 }
 
+TEST(RelatedData, TotalDurationForDate) {
+    std::string tz("");
+    if (getenv("TZ")) {
+        tz = getenv("TZ");
+    }
+    setenv("TZ", "UTC", 1);
+
+    RelatedData related;
+    // 2015-01-01 23:00 UTC, 2015-01-02 01:00 UTC
+    const Poco::UInt64 late = 1420153200;
+    const Poco::UInt64 early = late + 2 * 3600;
+
+    TimeEntry *a = new TimeEntry();
+    a->SetGUID("a");
+    a->SetStart(late);
+    a->SetDurationInSeconds(600);
+    related.Push(a);
+
+    TimeEntry *b = new TimeEntry();
+    b->SetGUID("b");
+    b->SetStart(early);
+    b->SetDurationInSeconds(60);
+    related.Push(b);
+
+    ASSERT_EQ(600, related.TotalDurationForDate(a));
+    ASSERT_EQ(60, related.TotalDurationForDate(b));
+
+    // Changes are picked up
+    b->SetDurationInSeconds(120);
+    ASSERT_EQ(120, related.TotalDurationForDate(b));
+
+    TimeEntry *c = new TimeEntry();
+    c->SetGUID("c");
+    c->SetStart(late - 3600);
+    c->SetDurationInSeconds(30);
+    related.Push(c);
+    ASSERT_EQ(630, related.TotalDurationForDate(a));
+
+    c->SetDeletedAt(early);
+    ASSERT_EQ(600, related.TotalDurationForDate(a));
+
+    // Running time entries keep growing
+    c->SetDeletedAt(0);
+    c->SetStart(time(0) - 100);
+    c->SetDurationInSeconds(-c->Start());
+    ASSERT_LE(100, related.TotalDurationForDate(c));
+    ASSERT_GE(110, related.TotalDurationForDate(c));
+
+    // Counted on the day it's moved to
+    c->SetStart(late - 60);
+    c->SetDurationInSeconds(40);
+    ASSERT_EQ(640, related.TotalDurationForDate(a));
+    ASSERT_EQ(120, related.TotalDurationForDate(b));
+
+    // Deleted models are taken out
+    related.TimeEntries.erase(
+        std::find(related.TimeEntries.begin(), related.TimeEntries.end(), c));
+    delete c;
+    ASSERT_EQ(600, related.TotalDurationForDate(a));
+
+    // Five hours behind UTC, both are on the same day
+    setenv("TZ", "EST5", 1);
+    ASSERT_EQ(720, related.TotalDurationForDate(a));
+    ASSERT_EQ(720, related.TotalDurationForDate(b));
+
+    if (tz.empty()) {
+        unsetenv("TZ");
+    } else {
+        setenv("TZ", tz.c_str(), 1);
+    }
+    tzset();
+}
+
+TEST(RelatedData, TotalDurationForDateWithZeroDuration) {
+    RelatedData related;
+    const Poco::UInt64 start = time(0) - 3600;
+
+    TimeEntry *a = new TimeEntry();
+    a->SetGUID("a");
+    a->SetStart(start);
+    a->SetDurationInSeconds(0);
+    related.Push(a);
+
+    TimeEntry *b = new TimeEntry();
+    b->SetGUID("b");
+    b->SetStart(start);
+    b->SetDurationInSeconds(60);
+    related.Push(b);
+    ASSERT_EQ(60, related.TotalDurationForDate(a));
+
+    // The day is left with the entry of zero duration only
+    b->SetDurationInSeconds(0);
+    ASSERT_EQ(0, related.TotalDurationForDate(a));
+
+    related.TimeEntries.erase(
+        std::find(related.TimeEntries.begin(), related.TimeEntries.end(), a));
+    delete a;
+    ASSERT_EQ(0, related.TotalDurationForDate(b));
+
+    related.TimeEntries.erase(
+        std::find(related.TimeEntries.begin(), related.TimeEntries.end(), b));
+    delete b;
+}
+
+TEST(RelatedData, Revision) {
+    RelatedData related;
+    Poco::UInt64 revision = related.Revision();
+
+    TimeEntry *te = new TimeEntry();
+    related.Push(te);
+    ASSERT_NE(revision, related.Revision());
+    revision = related.Revision();
+
+    te->SetDescription("changed");
+    ASSERT_NE(revision, related.Revision());
+    revision = related.Revision();
+
+    // Shown in views, though not saved
+    te->SetUnsynced();
+    ASSERT_NE(revision, related.Revision());
+    revision = related.Revision();
+    te->ClearUnsynced();
+    ASSERT_NE(revision, related.Revision());
+    revision = related.Revision();
+
+    // Not in views
+    related.Push(new TimelineEvent());
+    ASSERT_EQ(revision, related.Revision());
+
+    related.Clear();
+    ASSERT_NE(revision, related.Revision());
+}
+
+TEST(RelatedData, JournalSkipsSavedModels) {
+    RelatedData related;
+    for (size_t i = 0; i < 200; i++) {
+        related.Push(new TimeEntry());
+    }
+    ASSERT_EQ(size_t(200), related.TimeEntryIndex.ChangedCount());
+
+    for (size_t i = 1; i < 200; i += 2) {
+        related.TimeEntryIndex.MarkSaved(related.TimeEntries[i]);
+    }
+    ASSERT_EQ(size_t(100), related.TimeEntryIndex.ChangedCount());
+
+    // Saved and changed again many times, journaled only once
+    TimeEntry *te = related.TimeEntries[1];
+    for (size_t i = 0; i < 1000; i++) {
+        te->SetDescription(i % 2 ? "odd" : "even");
+        related.TimeEntryIndex.MarkSaved(te);
+    }
+    te->SetDescription("changed");
+    ASSERT_EQ(size_t(101), related.TimeEntryIndex.ChangedCount());
+
+    std::vector<TimeEntry *> changed;
+    related.TimeEntryIndex.TakeChanged(&changed);
+    ASSERT_EQ(size_t(101), changed.size());
+    ASSERT_EQ(related.TimeEntries[0], changed[0]);
+    ASSERT_EQ(related.TimeEntries[198], changed[99]);
+    ASSERT_EQ(te, changed[100]);
+    ASSERT_EQ(size_t(0), related.TimeEntryIndex.ChangedCount());
+
+    changed.clear();
+    related.TimeEntryIndex.TakeChanged(&changed);
+    ASSERT_TRUE(changed.empty());
+}
+
+TEST(RelatedData, AutocompleteQuery) {
+    RelatedData related;
+
+    Workspace *ws = new Workspace();
+    ws->SetID(1);
+    ws->SetName("Acme");
+    related.Push(ws);
+
+    Project *p = new Project();
+    p->SetID(2);
+    p->SetWID(1);
+    p->SetName("Website");
+    p->SetActive(true);
+    related.Push(p);
+
+    TimeEntry *te = new TimeEntry();
+    te->SetGUID("a");
+    te->SetWID(1);
+    te->SetDescription("Design review");
+    related.Push(te);
+
+    std::vector<view::Autocomplete> result;
+    related.AutocompleteQuery(kAutocompleteTimeEntry, "rev", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ("Design review", result[0].Description);
+
+    related.AutocompleteQuery(kAutocompleteMinitimer, "web", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ(Poco::UInt64(2), result[0].ProjectID);
+
+    related.AutocompleteQuery(kAutocompleteProject, "web", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ(Poco::UInt64(kAutocompleteItemProject), result[0].Type);
+
+    // Index follows changes to the models
+    te->SetDescription("Copywriting");
+    related.AutocompleteQuery(kAutocompleteTimeEntry, "rev", 10, &result);
+    ASSERT_TRUE(result.empty());
+    related.AutocompleteQuery(kAutocompleteTimeEntry, "copy", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+
+    p->SetName("Webshop");
+    related.AutocompleteQuery(kAutocompleteProject, "webs", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ("Webshop", result[0].ProjectLabel);
+
+    std::vector<view::Autocomplete> items;
+    related.TimeEntryAutocompleteItems(&items);
+    ASSERT_EQ(size_t(1), items.size());
+
+    related.AutocompleteQuery(3, "web", 10, &result);
+    ASSERT_TRUE(result.empty());
+}
+
+TEST(RelatedData, AutocompleteFollowsTimeEntries) {
+    RelatedData related;
+
+    Project *p = new Project();
+    p->SetID(2);
+    p->SetWID(1);
+    p->SetName("Website");
+    p->SetActive(true);
+    related.Push(p);
+
+    Task *t = new Task();
+    t->SetID(3);
+    t->SetPID(2);
+    t->SetWID(1);
+    t->SetName("Review");
+    t->SetActive(true);
+    related.Push(t);
+
+    TimeEntry *older = new TimeEntry();
+    older->SetGUID("a");
+    older->SetStart(1000);
+    older->SetDescription("Standup");
+    older->SetTags("old");
+    related.Push(older);
+
+    std::vector<view::Autocomplete> result;
+    related.AutocompleteQuery(kAutocompleteMinitimer, "", 10, &result);
+    ASSERT_EQ(size_t(3), result.size());
+    ASSERT_EQ("Standup", result[0].Text);
+
+    // Entries with the same text make one item, of the latest one
+    TimeEntry *newer = new TimeEntry();
+    newer->SetGUID("b");
+    newer->SetStart(2000);
+    newer->SetDescription("Standup");
+    newer->SetTags("new");
+    related.Push(newer);
+    related.AutocompleteQuery(kAutocompleteTimeEntry, "stand", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ("new", result[0].Tags);
+
+    related.TimeEntries.pop_back();
+    delete newer;
+    related.AutocompleteQuery(kAutocompleteTimeEntry, "stand", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ("old", result[0].Tags);
+
+    // An entry with the text of a task replaces the task item
+    TimeEntry *review = new TimeEntry();
+    review->SetGUID("c");
+    review->SetDescription("Review. Website");
+    related.Push(review);
+    related.AutocompleteQuery(kAutocompleteMinitimer, "review", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ(Poco::UInt64(kAutocompleteItemTE), result[0].Type);
+
+    review->SetDescription("Reviewing");
+    related.AutocompleteQuery(kAutocompleteMinitimer, "review", 10, &result);
+    ASSERT_EQ(size_t(2), result.size());
+
+    older->SetDeletedAt(3000);
+    related.AutocompleteQuery(kAutocompleteTimeEntry, "", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ("Reviewing", result[0].Text);
+
+    // Same items as when built from scratch
+    std::vector<view::Autocomplete> items;
+    related.MinitimerAutocompleteItems(&items);
+    related.Reindex();
+    std::vector<view::Autocomplete> rebuilt;
+    related.MinitimerAutocompleteItems(&rebuilt);
+    ASSERT_EQ(rebuilt.size(), items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        ASSERT_EQ(rebuilt[i].Text, items[i].Text);
+        ASSERT_EQ(rebuilt[i].Type, items[i].Type);
+    }
+}
+
+TEST(RelatedData, AddTimelineEvent) {
+    RelatedData related;
+
+    // A period that has not ended yet
+    const Poco::UInt64 open =
+        (time(0) / kTimelineChunkSeconds + 1) * kTimelineChunkSeconds;
+
+    related.AddTimelineEvent(
+        testing::timelineEvent("Terminal", "vim", open, 10));
+    related.AddTimelineEvent(
+        testing::timelineEvent("Terminal", "vim", open + 10, 20));
+    related.AddTimelineEvent(
+        testing::timelineEvent("Terminal", "make", open + 30, 5));
+    TimelineEvent *idle = testing::timelineEvent("Terminal", "vim",
+                          open + 35, 60);
+    idle->SetIdle(true);
+    related.AddTimelineEvent(idle);
+
+    ASSERT_EQ(size_t(3), related.TimelineBuffer.size());
+    ASSERT_TRUE(related.TimelineBuffer[0]->Chunked());
+    ASSERT_EQ(Poco::Int64(30), related.TimelineBuffer[0]->Duration());
+    ASSERT_EQ(Poco::Int64(5), related.TimelineBuffer[1]->Duration());
+    ASSERT_EQ(Poco::Int64(60), related.TimelineBuffer[2]->Duration());
+
+    // Chunks of ended periods may be uploaded already
+    const Poco::UInt64 ended = open - 2 * kTimelineChunkSeconds;
+    related.AddTimelineEvent(
+        testing::timelineEvent("Terminal", "vim", ended, 10));
+    related.AddTimelineEvent(
+        testing::timelineEvent("Terminal", "vim", ended + 10, 10));
+    ASSERT_EQ(size_t(5), related.TimelineBuffer.size());
+
+    // Events saved before they were chunked
+    TimelineEvent *a = testing::timelineEvent("Browser", "docs", ended, 10);
+    related.Push(a);
+    TimelineEvent *b = testing::timelineEvent("Browser", "docs",
+                       ended + 20, 15);
+    related.Push(b);
+    related.CompressTimeline(0);
+    ASSERT_TRUE(a->Chunked());
+    ASSERT_EQ(Poco::Int64(25), a->Duration());
+    ASSERT_TRUE(b->IsMarkedAsDeletedOnServer());
+
+    // Uploaded and too old chunks are purged
+    TimelineEvent *old = testing::timelineEvent("Browser", "mail",
+                         ended - 3600, 10);
+    related.Push(old);
+    a->SetUploaded(true);
+    related.CompressTimeline(ended - 60);
+    ASSERT_TRUE(a->IsMarkedAsDeletedOnServer());
+    ASSERT_TRUE(old->IsMarkedAsDeletedOnServer());
+
+    // Not added to a purged chunk
+    related.AddTimelineEvent(
+        testing::timelineEvent("Browser", "docs", ended + 40, 10));
+    ASSERT_EQ(Poco::Int64(25), a->Duration());
+}
+
 TEST(Formatter, CollectErrors) {
     {
         std::vector<error> errors;
@@ -1499,6 +2484,89 @@ TEST(Formatter, Parse8601) {
     ASSERT_EQ(0, Formatter::Parse8601("invalid value"));
 }
 
+namespace testing {
+
+// Parsing as it was done with Poco only
+std::time_t pocoParse8601(const std::string &value) {
+    if ("null" == value || value.empty()) {
+        return 0;
+    }
+    int tzd;
+    Poco::DateTime dt;
+    if (!Poco::DateTimeParser::tryParse(Poco::DateTimeFormat::ISO8601_FORMAT,
+                                        value, dt, tzd)) {
+        return 0;
+    }
+    dt.makeUTC(tzd);
+    std::time_t epoch_time = dt.timestamp().epochTime();
+    if (epoch_time < 1000000000 || epoch_time > 2000000000) {
+        return 0;
+    }
+    return epoch_time;
+}
+
+}  // namespace testing
+
+TEST(Formatter, Parse8601Shapes) {
+    //  date -r 1412220844
+    //  Thu Oct  2 05:34:04 CEST 2014
+    time_t t(1412220844);
+    ASSERT_EQ(t, Formatter::Parse8601("2014-10-02T03:34:04Z"));
+    ASSERT_EQ(t, Formatter::Parse8601("2014-10-02T03:34:04+00:00"));
+    ASSERT_EQ(t, Formatter::Parse8601("2014-10-02T05:34:04+02:00"));
+    ASSERT_EQ(t, Formatter::Parse8601("2014-10-02T05:34:04+0200"));
+    ASSERT_EQ(t, Formatter::Parse8601("2014-10-01T23:04:04-04:30"));
+
+    // Not in the fixed layout, parsed by Poco
+    ASSERT_EQ(t, Formatter::Parse8601("2014-10-02T03:34:04"));
+    ASSERT_EQ(t, Formatter::Parse8601("2014-10-02T03:34:04.123Z"));
+    ASSERT_EQ(t, Formatter::Parse8601("2014-10-02T05:34:04+02"));
+
+    ASSERT_EQ(0, Formatter::Parse8601("2014-02-30T03:34:04Z"));
+    ASSERT_EQ(0, Formatter::Parse8601("2014-10-02T24:34:04Z"));
+    ASSERT_EQ(0, Formatter::Parse8601("1970-01-01T00:00:00Z"));
+}
+
+TEST(Formatter, Parse8601MatchesPoco) {
+    const std::string zones[] = {
+        "Z", "+00:00", "+02:00", "-05:30", "+0300", "-1000", "+14:00",
+        "", "+02", ".123Z", ".5+02:00", " UTC", "GMT", "EST", "+99:99"
+    };
+    const size_t zone_count = sizeof(zones) / sizeof(zones[0]);
+    const std::string junk("0123456789-:T+Z .x");
+
+    Poco::Random random;
+    random.seed(8601);
+    for (int i = 0; i < 100000; i++) {
+        std::time_t t = 900000000 + random.next(1200000000);
+        std::string value = Formatter::Format8601(t);
+        value = value.substr(0, 19) + zones[random.next(zone_count)];
+
+        // Break every other one a bit
+        int mutations = random.next(4) - 1;
+        for (int m = 0; m < mutations && !value.empty(); m++) {
+            size_t pos = random.next(static_cast<Poco::UInt32>(value.size()));
+            char c = junk[random.next(static_cast<Poco::UInt32>(junk.size()))];
+            switch (random.next(4)) {
+            case 0:
+                value.erase(pos, 1);
+                break;
+            case 1:
+                value.insert(pos, 1, c);
+                break;
+            case 2:
+                value.resize(pos);
+                break;
+            default:
+                value[pos] = c;
+            }
+        }
+
+        ASSERT_EQ(testing::pocoParse8601(value), Formatter::Parse8601(value))
+            << value;
+    }
+}
+
 TEST(Formatter, FormatDurationForDateHeader) {
     ASSERT_EQ("0 h 00 min", Formatter::FormatDurationForDateHeader(0));
     ASSERT_EQ("0 h 00 min", Formatter::FormatDurationForDateHeader(30));
@@ -1554,6 +2622,208 @@ TEST(Formatter, FormatDecimal) {
               Formatter::FormatDuration(60*kMinute, Format::Decimal));
 }
 
+namespace testing {
+
+// Formatting as it was done with Poco, before the fixed buffer versions
+
+std::string pocoFormatDuration(
+    const Poco::Int64 value,
+    const std::string format_name,
+    const bool with_seconds) {
+    Poco::Int64 duration = Formatter::AbsDuration(value);
+    Poco::Timespan span(duration * Poco::Timespan::SECONDS);
+    std::stringstream ss;
+    if (Format::Decimal == format_name) {
+        double hours = duration / 3600.0;
+        double a = hours * 100.0;
+        int b = hours * 100;
+        double d = a - std::floor(a);
+        if (d > 0.5) {
+            b++;
+        }
+        double c = b / 100.0;
+        ss << Poco::NumberFormatter::format(c, 2) << " h";
+        return ss.str();
+    }
+    if (Format::Classic == format_name) {
+        if (duration < 60) {
+            ss << duration << " sec";
+            return ss.str();
+        }
+        if (duration < 3600) {
+            return Poco::DateTimeFormatter::format(span, "%M:%S min");
+        }
+        Poco::Int64 hours = duration / 3600;
+        if (hours < 10) {
+            ss << "0";
+        }
+        ss << hours << ":" << Poco::DateTimeFormatter::format(span, "%M:%S");
+        return ss.str();
+    }
+    ss << duration / 3600 << ":"
+       << Poco::DateTimeFormatter::format(
+           span, with_seconds ? "%M:%S" : "%M");
+    return ss.str();
+}
+
+std::string pocoFormatDurationForDateHeader(const Poco::Int64 value) {
+    Poco::Int64 duration = Formatter::AbsDuration(value);
+    std::stringstream ss;
+    Poco::Int64 hours = duration / 3600;
+    ss << hours << " h ";
+    Poco::Int64 minutes = (duration - (hours * 3600)) / 60;
+    if (minutes < 10) {
+        ss << "0";
+    }
+    ss << minutes << " min";
+    return ss.str();
+}
+
+std::string pocoFormat8601(const std::time_t date) {
+    if (!date) {
+        return "null";
+    }
+    return Poco::DateTimeFormatter::format(
+        Poco::Timestamp::fromEpochTime(date),
+        Poco::DateTimeFormat::ISO8601_FORMAT);
+}
+
+std::string pocoFormatDateHeader(const std::time_t date) {
+    if (!date) {
+        return "";
+    }
+    Poco::LocalDateTime datetime(Poco::Timestamp::fromEpochTime(date));
+    Poco::LocalDateTime today;
+    if (today.year() == datetime.year() &&
+            today.month() == datetime.month() &&
+            today.day() == datetime.day()) {
+        return "Today";
+    }
+    Poco::LocalDateTime yesterday =
+        today - Poco::Timespan(24 * Poco::Timespan::HOURS);
+    if (yesterday.year() == datetime.year() &&
+            yesterday.month() == datetime.month() &&
+            yesterday.day() == datetime.day()) {
+        return "Yesterday";
+    }
+    return Poco::DateTimeFormatter::format(datetime, "%w, %d %b");
+}
+
+std::string pocoFormatTimeForTimeEntryEditor(const std::time_t date) {
+    if (!date) {
+        return "";
+    }
+    Poco::LocalDateTime local(Poco::Timestamp::fromEpochTime(date));
+    if ("h:mm A" == Formatter::TimeOfDayFormat) {
+        return Poco::DateTimeFormatter::format(local, "%h:%M %A");
+    }
+    return Poco::DateTimeFormatter::format(local, "%H:%M");
+}
+
+// Timestamps spread over the years, around DST changes and around now
+std::vector<std::time_t> goldenTimestamps() {
+    std::vector<std::time_t> result;
+    result.push_back(0);
+    for (std::time_t t = 1000000000; t < 2000000000; t += 79193) {
+        result.push_back(t);
+    }
+    // 2015-03-08 and 2015-11-01 in North America, 2015-03-29 in Europe
+    const std::time_t changes[] = { 1425780000, 1446343200, 1427590800 };
+    for (size_t i = 0; i < 3; i++) {
+        for (std::time_t t = changes[i] - 86400; t < changes[i] + 86400;
+                t += 599) {
+            result.push_back(t);
+        }
+    }
+    const std::time_t now = time(0);
+    for (std::time_t t = now - 3 * 86400; t < now + 86400; t += 599) {
+        result.push_back(t);
+    }
+    return result;
+}
+
+}  // namespace testing
+
+TEST(Formatter, FormatDurationMatchesPoco) {
+    const std::string formats[] = {
+        Format::Improved, Format::Classic, Format::Decimal
+    };
+    char buf[kFormatBufferSize];
+    for (Poco::Int64 value = 0; value < 400000; value += 7) {
+        for (size_t i = 0; i < 3; i++) {
+            for (int with_seconds = 0; with_seconds < 2; with_seconds++) {
+                std::string expected = testing::pocoFormatDuration(
+                    value, formats[i], with_seconds);
+                ASSERT_EQ(expected, Formatter::FormatDuration(
+                    value, formats[i], with_seconds)) << value;
+                ASSERT_EQ(expected.size(), Formatter::FormatDuration(
+                    value, formats[i], with_seconds, buf));
+                ASSERT_EQ(expected, std::string(buf)) << value;
+            }
+        }
+        std::string expected = testing::pocoFormatDurationForDateHeader(value);
+        ASSERT_EQ(expected, Formatter::FormatDurationForDateHeader(value));
+        ASSERT_EQ(expected.size(),
+                  Formatter::FormatDurationForDateHeader(value, buf));
+        ASSERT_EQ(expected, std::string(buf)) << value;
+    }
+}
+
+TEST(Formatter, FormatTimestampsMatchesPoco) {
+    std::string tz("");
+    if (getenv("TZ")) {
+        tz = getenv("TZ");
+    }
+    std::string time_of_day_format = Formatter::TimeOfDayFormat;
+
+    const std::vector<std::time_t> timestamps = testing::goldenTimestamps();
+    const char *zones[] = {
+        "UTC",
+        "EST5EDT,M3.2.0,M11.1.0",
+        "EET-2EEST,M3.5.0/3,M10.5.0/4",
+        "NST3:30NDT,M3.2.0/0:01,M11.1.0/0:01",
+        "IST-5:30"
+    };
+    const std::string time_of_day_formats[] = { "H:mm", "h:mm A" };
+    char buf[kFormatBufferSize];
+    for (size_t z = 0; z < 5; z++) {
+        setenv("TZ", zones[z], 1);
+        tzset();
+        for (size_t i = 0; i < timestamps.size(); i++) {
+            const std::time_t t = timestamps[i];
+
+            std::string expected = testing::pocoFormat8601(t);
+            ASSERT_EQ(expected, Formatter::Format8601(t));
+            ASSERT_EQ(expected.size(), Formatter::Format8601(t, buf));
+            ASSERT_EQ(expected, std::string(buf));
+
+            expected = testing::pocoFormatDateHeader(t);
+            ASSERT_EQ(expected, Formatter::FormatDateHeader(t))
+                << zones[z] << " " << t;
+            ASSERT_EQ(expected.size(), Formatter::FormatDateHeader(t, buf));
+            ASSERT_EQ(expected, std::string(buf));
+
+            for (size_t f = 0; f < 2; f++) {
+                Formatter::TimeOfDayFormat = time_of_day_formats[f];
+                expected = testing::pocoFormatTimeForTimeEntryEditor(t);
+                ASSERT_EQ(expected, Formatter::FormatTimeForTimeEntryEditor(t))
+                    << zones[z] << " " << t;
+                ASSERT_EQ(expected.size(),
+                          Formatter::FormatTimeForTimeEntryEditor(t, buf));
+                ASSERT_EQ(expected, std::string(buf));
+            }
+        }
+    }
+
+    Formatter::TimeOfDayFormat = time_of_day_format;
+    if (tz.empty()) {
+        unsetenv("TZ");
+    } else {
+        setenv("TZ", tz.c_str(), 1);
+    }
+    tzset();
+}
+
 TEST(Formatter, JoinTaskName) {
     std::string res = Formatter::JoinTaskName(0, 0, 0);
     ASSERT_EQ("", res);
@@ -1607,6 +2877,57 @@ TEST(JSON, LoginToken) {
     ASSERT_EQ("foobar", token);
 }
 
+TEST(JSON, StreamReadsMembersAndElements) {
+    std::string json("{\"since\": 123, \"skip\": {\"a\": [1, \"}\"]},"
+                     " \"na\\\"me\": \"x\", \"list\": [{\"id\": 1}, 2]}");
+    JSONStream stream(json);
+    ASSERT_TRUE(stream.BeginObject());
+
+    std::string name;
+    ASSERT_TRUE(stream.NextMember(&name));
+    ASSERT_EQ("since", name);
+    Json::Value value;
+    ASSERT_TRUE(stream.ReadValue(&value));
+    ASSERT_EQ(Poco::UInt64(123), value.asUInt64());
+
+    ASSERT_TRUE(stream.NextMember(&name));
+    ASSERT_EQ("skip", name);
+    ASSERT_TRUE(stream.SkipValue());
+
+    ASSERT_TRUE(stream.NextMember(&name));
+    ASSERT_EQ("na\"me", name);
+    ASSERT_TRUE(stream.SkipValue());
+
+    ASSERT_TRUE(stream.NextMember(&name));
+    ASSERT_EQ("list", name);
+    ASSERT_EQ('[', stream.Peek());
+    ASSERT_TRUE(stream.BeginArray());
+    ASSERT_TRUE(stream.NextElement());
+    ASSERT_TRUE(stream.ReadValue(&value));
+    ASSERT_EQ(Poco::UInt64(1), value["id"].asUInt64());
+    ASSERT_TRUE(stream.NextElement());
+    ASSERT_TRUE(stream.ReadValue(&value));
+    ASSERT_EQ(2, value.asInt());
+    ASSERT_FALSE(stream.NextElement());
+
+    ASSERT_FALSE(stream.NextMember(&name));
+    ASSERT_FALSE(stream.Failed());
+}
+
+TEST(JSON, StreamFailsOnTruncatedInput) {
+    std::string json("{\"data\": {\"projects\": [{\"id\": 1}");
+    JSONStream stream(json);
+    ASSERT_TRUE(stream.BeginObject());
+    std::string name;
+    ASSERT_TRUE(stream.NextMember(&name));
+    ASSERT_FALSE(stream.SkipValue());
+    ASSERT_TRUE(stream.Failed());
+
+    User user;
+    ASSERT_NE(noError, user.LoadUserAndRelatedDataFromJSONString(json, true));
+    ASSERT_EQ(Poco::UInt64(0), user.ID());
+}
+
 TEST(JSON, ConvertTimelineToJSON) {
     const std::string desktop_id("12345");
 
@@ -1663,6 +2984,44 @@ TEST(JSON, ConvertTimelineToJSON) {
     }
 }
 
+TEST(JSON, CompressTimelineJSON) {
+    const std::string desktop_id("12345");
+
+    std::vector<TimelineEvent> list;
+    TimelineEvent *event = testing::timelineEvent(
+        "C:\\Windows\\notepad.exe", "\"quoted\" \x01\r\n", 1400000000, 60);
+    event->EnsureGUID();
+    list.push_back(*event);
+    delete event;
+    event = testing::timelineEvent("Õhtu", "päev veereb", 1400000060, 30);
+    event->EnsureGUID();
+    list.push_back(*event);
+    delete event;
+
+    std::string json = convertTimelineToJSON(list, desktop_id);
+    ASSERT_EQ(std::string::npos, json.find('\n'));
+
+    std::istringstream compressed(compressTimelineJSON(list, desktop_id));
+    Poco::InflatingInputStream inflater(
+        compressed, Poco::InflatingStreamBuf::STREAM_GZIP);
+    std::stringstream inflated;
+    inflated << inflater.rdbuf();
+    ASSERT_EQ(json, inflated.str());
+
+    Json::Value root = jsonStringToValue(inflated.str());
+    ASSERT_EQ(list.size(), root.size());
+    for (Json::Value::ArrayIndex i = 0; i < root.size(); i++) {
+        const Json::Value v = root[i];
+        ASSERT_EQ(list[i].GUID(), v["guid"].asString());
+        ASSERT_EQ(list[i].Filename(), v["filename"].asString());
+        ASSERT_EQ(list[i].Title(), v["title"].asString());
+        ASSERT_EQ(list[i].Start(), v["start_time"].asUInt64());
+        ASSERT_EQ(list[i].EndTime(), v["end_time"].asUInt64());
+        ASSERT_EQ("timeline", v["created_with"].asString());
+        ASSERT_EQ(desktop_id, v["desktop_id"].asString());
+    }
+}
+
 TEST(JSON, Tag) {
     std::string json("{\"id\":36253522,\"wid\":123456788,\"name\":\"create new\",\"at\":\"2013-10-15T08:51:46+00:00\",\"guid\":\"041390ba-ed9c-b477-b949-1a4ebb60a9ce\"}");  // NOLINT
 
@@ -1949,6 +3308,401 @@ TEST(Settings, IsSame) {
     ASSERT_FALSE(s2.IsSame(s3));
 }
 
+TEST(ViewArena, TimeEntryList) {
+    std::vector<view::TimeEntry> list;
+    for (int i = 0; i < 4; i++) {
+        view::TimeEntry te;
+        std::stringstream ss;
+        ss << "entry " << i;
+        te.Description = ss.str();
+        te.DateHeader = i < 2 ? "Monday" : "Tuesday";
+        if (1 == i) {
+            te.Tags = "tag";
+        }
+        list.push_back(te);
+    }
+
+    ViewArena<TogglTimeEntryView> arena;
+    TogglTimeEntryView *items = time_entry_view_list_init(&arena, list);
+    ASSERT_TRUE(items);
+
+    // Latest entry first, linked like the old list
+    ASSERT_EQ("entry 3", std::string(items[0].Description));
+    ASSERT_EQ("entry 0", std::string(items[3].Description));
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(&items[i + 1], items[i].Next);
+    }
+    ASSERT_FALSE(items[3].Next);
+
+    // First entry of each day is a header
+    ASSERT_TRUE(items[0].IsHeader);
+    ASSERT_FALSE(items[1].IsHeader);
+    ASSERT_TRUE(items[2].IsHeader);
+    ASSERT_FALSE(items[3].IsHeader);
+
+    ASSERT_FALSE(items[0].Tags);
+    ASSERT_EQ("tag", std::string(items[2].Tags));
+    ASSERT_FALSE(items[0].Error);
+
+    // Rendering a shorter list reuses the same storage
+    list.pop_back();
+    ASSERT_EQ(items, time_entry_view_list_init(&arena, list));
+    ASSERT_EQ("entry 2", std::string(items[0].Description));
+    ASSERT_FALSE(items[2].Next);
+
+    list.clear();
+    ASSERT_FALSE(time_entry_view_list_init(&arena, list));
+}
+
+TEST(ViewArena, AutocompleteList) {
+    std::vector<view::Autocomplete> list;
+    for (int i = 0; i < 100; i++) {
+        view::Autocomplete item;
+        std::stringstream ss;
+        ss << "item " << i;
+        item.Text = ss.str();
+        item.ProjectID = i;
+        list.push_back(item);
+    }
+
+    ViewArena<TogglAutocompleteView> arena;
+    TogglAutocompleteView *items = autocomplete_list_init(&arena, list);
+    int count(0);
+    for (TogglAutocompleteView *it = items;
+            it;
+            it = reinterpret_cast<TogglAutocompleteView *>(it->Next)) {
+        std::stringstream ss;
+        ss << "item " << count;
+        ASSERT_EQ(ss.str(), std::string(it->Text));
+        ASSERT_EQ(uint64_t(count), it->ProjectID);
+        ASSERT_EQ("", std::string(it->Description));
+        count++;
+    }
+    ASSERT_EQ(100, count);
+}
+
+TEST(AutocompleteIndex, Query) {
+    const char *texts[] = {
+        "Meeting with Anna",
+        "Code review - Toggl Desktop",
+        "Reading mail",
+        "team meeting",
+        "Coffee",
+        "Écrire le rapport",
+    };
+    std::vector<view::Autocomplete> items;
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+        view::Autocomplete item;
+        item.Text = texts[i];
+        items.push_back(item);
+    }
+
+    AutocompleteIndex index;
+    index.Build(items);
+    ASSERT_EQ(items.size(), index.Size());
+
+    std::vector<view::Autocomplete> result;
+
+    // Prefix match before word match, case does not matter
+    index.Query("MEET", 10, &result);
+    ASSERT_EQ(size_t(2), result.size());
+    ASSERT_EQ("Meeting with Anna", result[0].Text);
+    ASSERT_EQ("team meeting", result[1].Text);
+
+    // Enough word matches, no need to look further
+    index.Query("co", 2, &result);
+    ASSERT_EQ(size_t(2), result.size());
+    ASSERT_EQ("Code review - Toggl Desktop", result[0].Text);
+    ASSERT_EQ("Coffee", result[1].Text);
+
+    // Then substring and fuzzy matches
+    index.Query("eam", 10, &result);
+    ASSERT_EQ(size_t(2), result.size());
+    ASSERT_EQ("team meeting", result[0].Text);
+    ASSERT_EQ("Reading mail", result[1].Text);
+
+    index.Query("rdm", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ("Reading mail", result[0].Text);
+
+    index.Query("ing", 10, &result);
+    ASSERT_EQ(size_t(3), result.size());
+    ASSERT_EQ("Meeting with Anna", result[0].Text);
+    ASSERT_EQ("Reading mail", result[1].Text);
+    ASSERT_EQ("team meeting", result[2].Text);
+
+    index.Query("écrire", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+
+    index.Query("toggl desk", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+
+    index.Query("xyz", 10, &result);
+    ASSERT_TRUE(result.empty());
+
+    // Limit applies, empty text gives items in their order
+    index.Query("e", 2, &result);
+    ASSERT_EQ(size_t(2), result.size());
+    ASSERT_EQ("Meeting with Anna", result[0].Text);
+    ASSERT_EQ("Code review - Toggl Desktop", result[1].Text);
+
+    index.Query("", 3, &result);
+    ASSERT_EQ(size_t(3), result.size());
+    ASSERT_EQ("Meeting with Anna", result[0].Text);
+    ASSERT_EQ("Reading mail", result[2].Text);
+
+    TogglAutocompleteView *first = autocomplete_view_list_init(result);
+    ASSERT_EQ("Meeting with Anna", std::string(first->Text));
+    autocomplete_view_list_clear(first);
+}
+
+namespace testing {
+
+bool compareText(const view::Autocomplete &a, const view::Autocomplete &b) {
+    return a.Text < b.Text;
+}
+
+}  // namespace testing
+
+TEST(AutocompleteIndex, InsertAndRemove) {
+    const char *texts[] = { "beta", "delta", "gamma" };
+    std::vector<view::Autocomplete> items;
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+        view::Autocomplete item;
+        item.Text = texts[i];
+        items.push_back(item);
+    }
+
+    AutocompleteIndex index;
+    index.Build(items);
+
+    view::Autocomplete item;
+    item.Text = "epsilon meeting";
+    index.Insert(item, testing::compareText);
+    item.Text = "alpha meeting";
+    Poco::UInt32 alpha = index.Insert(item, testing::compareText);
+    ASSERT_EQ(size_t(5), index.Size());
+
+    // Ranked by the order, not by when inserted
+    std::vector<view::Autocomplete> result;
+    index.Query("meet", 10, &result);
+    ASSERT_EQ(size_t(2), result.size());
+    ASSERT_EQ("alpha meeting", result[0].Text);
+    ASSERT_EQ("epsilon meeting", result[1].Text);
+
+    index.Query("", 10, &result);
+    ASSERT_EQ(size_t(5), result.size());
+    ASSERT_EQ("alpha meeting", result[0].Text);
+    ASSERT_EQ("beta", result[1].Text);
+    ASSERT_EQ("delta", result[2].Text);
+    ASSERT_EQ("epsilon meeting", result[3].Text);
+    ASSERT_EQ("gamma", result[4].Text);
+
+    // Removed items and their words are gone, IDs are reused
+    index.Remove(alpha);
+    index.Remove(1);
+    index.Query("meet", 10, &result);
+    ASSERT_EQ(size_t(1), result.size());
+    ASSERT_EQ("epsilon meeting", result[0].Text);
+    index.Query("delta", 10, &result);
+    ASSERT_TRUE(result.empty());
+
+    item.Text = "zeta";
+    ASSERT_EQ(Poco::UInt32(1), index.Insert(item, testing::compareText));
+
+    result.clear();
+    index.Items(&result);
+    ASSERT_EQ(size_t(4), result.size());
+    ASSERT_EQ("beta", result[0].Text);
+    ASSERT_EQ("epsilon meeting", result[1].Text);
+    ASSERT_EQ("gamma", result[2].Text);
+    ASSERT_EQ("zeta", result[3].Text);
+}
+
+namespace testing {
+
+view::TimeEntry timeEntryView(
+    const std::string guid,
+    const std::string date_header) {
+    view::TimeEntry te;
+    te.GUID = guid;
+    te.Description = guid;
+    te.DateHeader = date_header;
+    return te;
+}
+
+// Applies changes like a UI would, returns the resulting descriptions
+std::string applyTimeEntryListChanges(
+    const std::vector<view::TimeEntry> &from,
+    const std::vector<view::TimeEntry> &to) {
+    std::vector<view::TimeEntryListChange> changes;
+    view::DiffTimeEntryList(from, to, &changes);
+
+    std::vector<std::string> displayed;
+    for (size_t i = 0; i < from.size(); i++) {
+        displayed.push_back(from[i].Description);
+    }
+    for (size_t i = 0; i < changes.size(); i++) {
+        const view::TimeEntryListChange &change = changes[i];
+        if (kTimeEntryListChangeRemove == change.Type) {
+            displayed.erase(displayed.begin() + change.Index);
+            continue;
+        }
+        const std::string item = to[change.Index].Description;
+        if (kTimeEntryListChangeInsert == change.Type) {
+            displayed.insert(displayed.begin() + change.Index, item);
+        } else if (kTimeEntryListChangeMove == change.Type) {
+            displayed.erase(displayed.begin() + change.OldIndex);
+            displayed.insert(displayed.begin() + change.Index, item);
+        } else {
+            displayed[change.Index] = item;
+        }
+    }
+
+    std::stringstream ss;
+    for (size_t i = 0; i < displayed.size(); i++) {
+        ss << displayed[i] << " ";
+    }
+    return ss.str();
+}
+
+}  // namespace testing
+
+TEST(GUI, DiffTimeEntryList) {
+    std::vector<view::TimeEntry> from;
+    from.push_back(testing::timeEntryView("a", "Today"));
+    from.push_back(testing::timeEntryView("b", "Today"));
+    from.push_back(testing::timeEntryView("c", "Yesterday"));
+    from.push_back(testing::timeEntryView("d", "Yesterday"));
+
+    std::vector<view::TimeEntryListChange> changes;
+
+    // Nothing changed, nothing to do
+    view::DiffTimeEntryList(from, from, &changes);
+    ASSERT_TRUE(changes.empty());
+
+    // First render inserts everything
+    std::vector<view::TimeEntry> empty;
+    view::DiffTimeEntryList(empty, from, &changes);
+    ASSERT_EQ(size_t(4), changes.size());
+    ASSERT_EQ(kTimeEntryListChangeInsert, changes[0].Type);
+    ASSERT_EQ("a b c d ", testing::applyTimeEntryListChanges(empty, from));
+
+    // Only the changed item is updated
+    std::vector<view::TimeEntry> to(from);
+    to[2].Description = "C";
+    view::DiffTimeEntryList(from, to, &changes);
+    ASSERT_EQ(size_t(1), changes.size());
+    ASSERT_EQ(kTimeEntryListChangeUpdate, changes[0].Type);
+    ASSERT_EQ(size_t(2), changes[0].Index);
+    ASSERT_EQ("a b C d ", testing::applyTimeEntryListChanges(from, to));
+
+    // Removing the first item of a day makes the next one a header
+    to = from;
+    to.erase(to.begin() + 2);
+    view::DiffTimeEntryList(from, to, &changes);
+    ASSERT_EQ(size_t(2), changes.size());
+    ASSERT_EQ(kTimeEntryListChangeRemove, changes[0].Type);
+    ASSERT_EQ(size_t(2), changes[0].Index);
+    ASSERT_EQ(kTimeEntryListChangeUpdate, changes[1].Type);
+    ASSERT_EQ("a b d ", testing::applyTimeEntryListChanges(from, to));
+
+    // New entry on top, another one moved
+    to = from;
+    to.insert(to.begin(), testing::timeEntryView("e", "Today"));
+    std::swap(to[1], to[4]);
+    ASSERT_EQ("e d b c a ", testing::applyTimeEntryListChanges(from, to));
+
+    // Everything replaced
+    to.clear();
+    to.push_back(testing::timeEntryView("x", "Today"));
+    to.push_back(testing::timeEntryView("y", "Today"));
+    ASSERT_EQ("x y ", testing::applyTimeEntryListChanges(from, to));
+
+    std::reverse(from.begin(), from.end());
+    to = from;
+    std::reverse(to.begin(), to.end());
+    ASSERT_EQ("a b c d ", testing::applyTimeEntryListChanges(from, to));
+}
+
+namespace testing {
+
+class JobCounter {
+ public:
+    void Run(Poco::Util::TimerTask& task) {  // NOLINT
+        runs++;
+        ran.set();
+    }
+
+    Poco::AtomicCounter runs;
+    Poco::Event ran;
+};
+
+}  // namespace testing
+
+TEST(TaskScheduler, MovesPendingRunLater) {
+    Poco::Util::Timer timer;
+    Poco::Mutex timer_m;
+    TaskScheduler scheduler(&timer, &timer_m);
+
+    testing::JobCounter counter;
+    scheduler.Register("job",
+                       new Poco::Util::TimerTaskAdapter<testing::JobCounter>(
+                           counter, &testing::JobCounter::Run));
+    ASSERT_FALSE(scheduler.IsPending("job"));
+
+    // A burst of requests is one pending run in one timer task
+    Poco::Timestamp now;
+    for (int i = 0; i < 200; i++) {
+        scheduler.Schedule("job", now + 100000 + i * 100);
+    }
+    ASSERT_TRUE(scheduler.IsPending("job"));
+    ASSERT_EQ(size_t(1), scheduler.QueueDepth());
+    ASSERT_EQ(Poco::UInt64(1), scheduler.TimerTaskCount());
+
+    // The task is armed once more for where the run was moved
+    ASSERT_TRUE(counter.ran.tryWait(5000));
+    ASSERT_LE(now + 100000 + 199 * 100, Poco::Timestamp());
+    ASSERT_EQ(Poco::UInt64(1), scheduler.FireCount("job"));
+    ASSERT_EQ(Poco::UInt64(2), scheduler.TimerTaskCount());
+    ASSERT_EQ(size_t(0), scheduler.QueueDepth());
+
+    Poco::Thread::sleep(100);
+    ASSERT_EQ(1, counter.runs.value());
+}
+
+TEST(TaskScheduler, MovesPendingRunEarlier) {
+    Poco::Util::Timer timer;
+    Poco::Mutex timer_m;
+    TaskScheduler scheduler(&timer, &timer_m);
+
+    testing::JobCounter sync;
+    scheduler.Register("sync",
+                       new Poco::Util::TimerTaskAdapter<testing::JobCounter>(
+                           sync, &testing::JobCounter::Run));
+    testing::JobCounter push;
+    scheduler.Register("push",
+                       new Poco::Util::TimerTaskAdapter<testing::JobCounter>(
+                           push, &testing::JobCounter::Run));
+
+    Poco::Timestamp now;
+    scheduler.Schedule("sync", now + 60 * Poco::Timespan::SECONDS);
+    scheduler.Schedule("push", now + 60 * Poco::Timespan::SECONDS);
+    ASSERT_EQ(size_t(2), scheduler.QueueDepth());
+
+    scheduler.Schedule("sync", now);
+    ASSERT_TRUE(sync.ran.tryWait(5000));
+    ASSERT_EQ(Poco::UInt64(1), scheduler.FireCount("sync"));
+    ASSERT_EQ(Poco::UInt64(0), scheduler.FireCount("push"));
+    ASSERT_EQ(size_t(1), scheduler.QueueDepth());
+
+    // Cancelled runs never happen
+    scheduler.Cancel();
+    ASSERT_EQ(size_t(0), scheduler.QueueDepth());
+    ASSERT_FALSE(scheduler.IsPending("push"));
+    ASSERT_EQ(0, push.runs.value());
+}
+
 }  // namespace toggl
 
 int main(int argc, char **argv) {
@@ -0,0 +1,1775 @@
+// Copyright 2014 Toggl Desktop developers.
+
+// Benchmarks are built into a separate binary (make benchmark),
+// so that the regular test run stays fast.
+
+#include "../../src/test/benchmark_test.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "./../autocomplete_index.h"
+#include "./../const.h"
+#include "./../context.h"
+#include "./../database.h"
+#include "./../formatter.h"
+#include "./../get_focused_window.h"
+#include "./../gui.h"
+#include "./../https_client.h"
+#include "./../related_data.h"
+#include "./../time_entry.h"
+#include "./../timeline_uploader.h"
+#include "./../urls.h"
+#include "./../user.h"
+#include "./../websocket_client.h"
+
+#include "Poco/Data/Session.h"
+#include "Poco/DeflatingStream.h"
+#include "Poco/File.h"
+#include "Poco/Logger.h"
+#include "Poco/Net/WebSocket.h"
+#include "Poco/Notification.h"
+#include "Poco/NotificationQueue.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/AcceptCertificateHandler.h"
+#include "Poco/Net/NetSSL.h"
+#include "Poco/Net/PrivateKeyPassphraseHandler.h"
+#include "Poco/Net/SSLManager.h"
+#include "Poco/Net/SecureServerSocket.h"
+#include "Poco/Stopwatch.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/Thread.h"
+#include "Poco/UTF8String.h"
+
+#include <json/json.h>  // NOLINT
+
+#if defined(__linux__)
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#endif
+
+#define BENCHMARKDB "benchmark.db"
+#define BENCHMARKCERT "../third_party/poco/NetSSL_OpenSSL/testsuite/any.pem"
+
+namespace toggl {
+
+namespace benchmark {
+
+void report(
+    const std::string name,
+    const Poco::UInt64 size,
+    const std::string variant,
+    const Poco::Timestamp::TimeDiff elapsed,
+    const Poco::UInt64 iterations) {
+    std::cout << name
+              << " size=" << size
+              << " " << variant
+              << " " << (elapsed * 1000 / iterations) << " ns/op"
+              << std::endl;
+}
+
+std::string guidFor(const Poco::UInt64 i) {
+    std::stringstream ss;
+    ss << "00000000-0000-0000-0000-" << i;
+    return ss.str();
+}
+
+void fillTimeEntries(RelatedData *related, const Poco::UInt64 count) {
+    for (Poco::UInt64 i = 1; i <= count; i++) {
+        TimeEntry *te = new TimeEntry();
+        related->Push(te);
+        te->SetID(i);
+        te->SetGUID(guidFor(i));
+    }
+}
+
+void newDatabase(Database **db) {
+    Poco::File f(BENCHMARKDB);
+    if (f.exists()) {
+        f.remove(false);
+    }
+    *db = new Database(BENCHMARKDB);
+}
+
+void fillUser(User *user, const Poco::UInt64 time_entries) {
+    user->SetID(1);
+    user->SetEmail("benchmark@toggl.com");
+    user->SetAPIToken("benchmark");
+    for (Poco::UInt64 i = 1; i <= time_entries; i++) {
+        TimeEntry *te = new TimeEntry();
+        user->related.Push(te);
+        te->SetID(i);
+        te->SetGUID(guidFor(i));
+        te->SetWID(1);
+        te->SetDescription("benchmark");
+        te->SetStart(1400000000 + i * 3600);
+        te->SetStop(te->Start() + 1800);
+        te->SetDurationInSeconds(1800);
+    }
+}
+
+// Key in the Poco test certificate is encrypted with "secret"
+class SecretPassphraseHandler
+    : public Poco::Net::PrivateKeyPassphraseHandler {
+ public:
+    SecretPassphraseHandler()
+        : Poco::Net::PrivateKeyPassphraseHandler(true) {}
+
+    void onPrivateKeyRequested(const void *, std::string &key) {  // NOLINT
+        key = "secret";
+    }
+};
+
+class StatusHandler : public Poco::Net::HTTPRequestHandler {
+ public:
+    void handleRequest(
+        Poco::Net::HTTPServerRequest &request,  // NOLINT
+        Poco::Net::HTTPServerResponse &response) {  // NOLINT
+        Poco::StreamCopier::copyToString(request.stream(), body_);
+        response.setContentType("application/json");
+        response.setContentLength(2);
+        response.send() << "{}";
+    }
+
+ private:
+    std::string body_;
+};
+
+class StatusHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+ public:
+    Poco::Net::HTTPRequestHandler *createRequestHandler(
+        const Poco::Net::HTTPServerRequest &) {
+        return new StatusHandler();
+    }
+};
+
+// Message for the websocket stand-in to push, in frames of
+// frame_size bytes
+class PushNotification : public Poco::Notification {
+ public:
+    PushNotification(const std::string json, const size_t frame_size)
+        : json_(json)
+    , frame_size_(frame_size) {}
+
+    const std::string &JSON() const {
+        return json_;
+    }
+    const size_t &FrameSize() const {
+        return frame_size_;
+    }
+
+ private:
+    std::string json_;
+    size_t frame_size_;
+};
+
+// Stand-in for the websocket server: accepts the authentication
+// and pushes queued messages until the queue is woken up
+class PushHandler : public Poco::Net::HTTPRequestHandler {
+ public:
+    PushHandler(Poco::NotificationQueue *queue, Poco::Event *connected)
+        : queue_(queue)
+    , connected_(connected) {}
+
+    void handleRequest(
+        Poco::Net::HTTPServerRequest &request,  // NOLINT
+        Poco::Net::HTTPServerResponse &response) {  // NOLINT
+        Poco::Net::WebSocket ws(request, response);
+        char buf[1024];
+        int flags(0);
+        ws.receiveFrame(buf, sizeof(buf), flags);
+        connected_->set();
+
+        while (true) {
+            Poco::AutoPtr<Poco::Notification> n(
+                queue_->waitDequeueNotification());
+            PushNotification *push =
+                dynamic_cast<PushNotification *>(n.get());
+            if (!push) {
+                return;
+            }
+            const std::string &json = push->JSON();
+            for (size_t sent = 0; sent < json.size();
+                    sent += push->FrameSize()) {
+                size_t size = std::min(push->FrameSize(), json.size() - sent);
+                int frame_flags = sent
+                                  ? Poco::Net::WebSocket::FRAME_OP_CONT
+                                  : Poco::Net::WebSocket::FRAME_OP_TEXT;
+                if (sent + size == json.size()) {
+                    frame_flags |= Poco::Net::WebSocket::FRAME_FLAG_FIN;
+                }
+                ws.sendFrame(json.data() + sent, static_cast<int>(size),
+                             frame_flags);
+            }
+        }
+    }
+
+ private:
+    Poco::NotificationQueue *queue_;
+    Poco::Event *connected_;
+};
+
+class PushHandlerFactory : public Poco::Net::HTTPRequestHandlerFactory {
+ public:
+    PushHandlerFactory(Poco::NotificationQueue *queue, Poco::Event *connected)
+        : queue_(queue)
+    , connected_(connected) {}
+
+    Poco::Net::HTTPRequestHandler *createRequestHandler(
+        const Poco::Net::HTTPServerRequest &) {
+        return new PushHandler(queue_, connected_);
+    }
+
+ private:
+    Poco::NotificationQueue *queue_;
+    Poco::Event *connected_;
+};
+
+// Where the websocket client hands over received messages
+Poco::Event websocket_received;
+Poco::Timestamp websocket_received_at;
+std::string websocket_received_model("");
+
+void onWebSocketMessage(void *context, const Json::Value &update) {
+    User *user = reinterpret_cast<User *>(context);
+    websocket_received_model = update["model"].asString();
+    user->LoadUserUpdateFromJSON(update);
+    websocket_received_at.update();
+    websocket_received.set();
+}
+
+void onWebSocketMissedMessage(void *context) {
+}
+
+// Peak resident set size of this process in kilobytes
+Poco::UInt64 peakRSS() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+// Times the threads of this process gave up the CPU to wait
+Poco::UInt64 voluntaryContextSwitches() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw;
+}
+
+// Generates the "data" part of a /me response of about size bytes
+std::string meData(const size_t size) {
+    std::stringstream ss;
+    ss << "{\"id\": 10471231, \"api_token\": \"benchmark\", "
+       << "\"default_wid\": 1, \"email\": \"benchmark@toggl.com\", "
+       << "\"fullname\": \"Benchmark\", \"timeofday_format\": \"H:mm\", "
+       << "\"duration_format\": \"improved\", "
+       << "\"workspaces\": [{\"id\": 1, \"name\": \"Workspace\"}], "
+       << "\"clients\": [{\"id\": 1, \"wid\": 1, \"name\": \"Client\"}], "
+       << "\"tags\": [{\"id\": 1, \"wid\": 1, \"name\": \"tag\"}], "
+       << "\"projects\": [";
+    for (int i = 1; i <= 1000; i++) {
+        if (i > 1) {
+            ss << ", ";
+        }
+        ss << "{\"id\": " << i << ", \"wid\": 1, \"cid\": 1, "
+           << "\"name\": \"Project " << i << "\", \"active\": true, "
+           << "\"color\": \"5\", \"billable\": false}";
+    }
+    ss << "], \"tasks\": [";
+    for (int i = 1; i <= 1000; i++) {
+        if (i > 1) {
+            ss << ", ";
+        }
+        ss << "{\"id\": " << i << ", \"wid\": 1, \"pid\": " << i
+           << ", \"name\": \"Task " << i << "\", \"active\": true}";
+    }
+    ss << "], \"time_entries\": [";
+    for (Poco::UInt64 i = 1; ss.tellp() < std::streampos(size); i++) {
+        if (i > 1) {
+            ss << ", ";
+        }
+        ss << "{\"id\": " << i << ", \"guid\": \"" << guidFor(i) << "\", "
+           << "\"wid\": 1, \"pid\": " << (1 + i % 1000) << ", "
+           << "\"tid\": " << (1 + i % 1000) << ", \"billable\": false, "
+           << "\"start\": \"2015-01-01T10:00:00+00:00\", "
+           << "\"stop\": \"2015-01-01T10:30:00+00:00\", "
+           << "\"duration\": 1800, \"description\": "
+           << "\"Benchmark time entry number " << i << "\", "
+           << "\"tags\": [\"tag\"], \"duronly\": false, "
+           << "\"at\": \"2015-01-01T10:30:00+00:00\"}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+#if defined(__linux__)
+// Plays the window manager: sets _NET_ACTIVE_WINDOW on
+// the root window and titles of its own windows.
+class WindowSwitcher {
+ public:
+    WindowSwitcher()
+        : display_(XOpenDisplay(NULL)) {
+        if (!display_) {
+            return;
+        }
+        Window root = DefaultRootWindow(display_);
+        for (int i = 0; i < 2; i++) {
+            windows_[i] = XCreateSimpleWindow(
+                display_, root, 0, 0, 100, 100, 0, 0, 0);
+            unsigned long pid = getpid(); // NOLINT
+            XChangeProperty(display_, windows_[i],
+                            XInternAtom(display_, "_NET_WM_PID", False),
+                            XA_CARDINAL, 32, PropModeReplace,
+                            reinterpret_cast<unsigned char *>(&pid), 1);
+            std::stringstream ss;
+            ss << "Window " << i;
+            SetTitle(i, ss.str());
+        }
+        Activate(0);
+    }
+
+    ~WindowSwitcher() {
+        if (display_) {
+            XCloseDisplay(display_);
+        }
+    }
+
+    bool Available() const {
+        return display_ != NULL;
+    }
+
+    void Activate(const int i) {
+        XChangeProperty(display_, DefaultRootWindow(display_),
+                        XInternAtom(display_, "_NET_ACTIVE_WINDOW", False),
+                        XA_WINDOW, 32, PropModeReplace,
+                        reinterpret_cast<unsigned char *>(&windows_[i]), 1);
+        XFlush(display_);
+    }
+
+    void SetTitle(const int i, const std::string title) {
+        XChangeProperty(display_, windows_[i],
+                        XInternAtom(display_, "_NET_WM_NAME", False),
+                        XInternAtom(display_, "UTF8_STRING", False),
+                        8, PropModeReplace,
+                        reinterpret_cast<const unsigned char *>(
+                            title.c_str()),
+                        static_cast<int>(title.size()));
+        XFlush(display_);
+    }
+
+ private:
+    Display *display_;
+    Window windows_[2];
+};
+#endif
+
+class FocusWaitCanceller : public Poco::Runnable {
+ public:
+    explicit FocusWaitCanceller(const long millis) // NOLINT
+        : millis_(millis) {}
+
+    void run() {
+        Poco::Thread::sleep(millis_);
+        cancelWaitForFocusChange();
+    }
+
+ private:
+    long millis_; // NOLINT
+};
+
+// Callbacks of a context rendering nowhere
+void onApp(const bool_t open) {}
+void onState(const int64_t state) {}
+void onError(const char_t *errmsg, const bool_t user_error) {}
+void onURL(const char_t *url) {}
+void onLogin(const bool_t open, const uint64_t user_id) {}
+void onText(const char_t *title, const char_t *informative_text) {}
+void onTimeEntryArray(
+    const bool_t open,
+    TogglTimeEntryView *items,
+    const uint64_t count,
+    const bool_t show_load_more_button) {}
+void onAutocompleteArray(TogglAutocompleteView *items, const uint64_t count) {}
+void onViewItems(TogglGenericView *first) {}
+void onTimeEntryEditor(
+    const bool_t open,
+    TogglTimeEntryView *te,
+    const char_t *focused_field_name) {}
+void onSettings(const bool_t open, TogglSettingsView *settings) {}
+void onTimerState(TogglTimeEntryView *te) {}
+void onIdleNotification(
+    const char_t *guid,
+    const char_t *since,
+    const char_t *duration,
+    const uint64_t started,
+    const char_t *description) {}
+void onAutotrackerRules(
+    TogglAutotrackerRuleView *first,
+    const uint64_t title_count,
+    string_list_t title_list) {}
+void onProjectColors(string_list_t color_list, const uint64_t color_count) {}
+
+void setCallbacks(void *context) {
+    toggl_on_show_app(context, onApp);
+    toggl_on_sync_state(context, onState);
+    toggl_on_unsynced_items(context, onState);
+    toggl_on_error(context, onError);
+    toggl_on_update(context, onURL);
+    toggl_on_online_state(context, onState);
+    toggl_on_url(context, onURL);
+    toggl_on_login(context, onLogin);
+    toggl_on_reminder(context, onText);
+    toggl_on_pomodoro(context, onText);
+    toggl_on_pomodoro_break(context, onText);
+    toggl_on_time_entry_list_array(context, onTimeEntryArray);
+    toggl_on_time_entry_autocomplete_array(context, onAutocompleteArray);
+    toggl_on_mini_timer_autocomplete_array(context, onAutocompleteArray);
+    toggl_on_project_autocomplete_array(context, onAutocompleteArray);
+    toggl_on_workspace_select(context, onViewItems);
+    toggl_on_client_select(context, onViewItems);
+    toggl_on_tags(context, onViewItems);
+    toggl_on_time_entry_editor(context, onTimeEntryEditor);
+    toggl_on_settings(context, onSettings);
+    toggl_on_timer_state(context, onTimerState);
+    toggl_on_idle_notification(context, onIdleNotification);
+    toggl_on_autotracker_rules(context, onAutotrackerRules);
+    toggl_on_project_colors(context, onProjectColors);
+}
+
+// Feeds batches of time entry updates to a context,
+// as the websocket does while another client syncs
+class UpdateFeeder : public Poco::Runnable {
+ public:
+    UpdateFeeder(
+        Context *context,
+        const Poco::UInt64 time_entries,
+        const Poco::Timestamp::TimeDiff duration)
+        : context_(context)
+    , time_entries_(time_entries)
+    , duration_(duration)
+    , updates_(0) {}
+
+    void run() {
+        Poco::Stopwatch stopwatch;
+        stopwatch.start();
+        while (stopwatch.elapsed() < duration_) {
+            for (int i = 0; i < kWebsocketUpdateBatchSize; i++) {
+                Poco::UInt64 id = 1 + updates_ % time_entries_;
+                std::stringstream ss;
+                ss << "Synced " << updates_;
+                Json::Value update;
+                update["action"] = "UPDATE";
+                update["model"] = "time_entry";
+                update["data"]["id"] = Json::UInt64(id);
+                update["data"]["guid"] = guidFor(id);
+                update["data"]["wid"] = 1;
+                update["data"]["description"] = ss.str();
+                update["data"]["start"] = "2015-01-01T10:00:00+00:00";
+                update["data"]["duration"] = 1800;
+                context_->LoadUpdateFromJSON(update);
+                updates_++;
+            }
+            Poco::Thread::sleep(kWebsocketUpdateBatchMillis);
+        }
+    }
+
+    Poco::UInt64 Updates() const {
+        return updates_;
+    }
+
+ private:
+    Context *context_;
+    Poco::UInt64 time_entries_;
+    Poco::Timestamp::TimeDiff duration_;
+    Poco::UInt64 updates_;
+};
+
+}  // namespace benchmark
+
+TEST(Benchmark, RelatedDataLookup) {
+    const Poco::UInt64 sizes[] = { 10000, 100000, 1000000 };
+    const Poco::UInt64 linear_lookups = 200;
+    const Poco::UInt64 indexed_lookups = 100000;
+
+    for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+        const Poco::UInt64 size = sizes[n];
+
+        RelatedData related;
+        benchmark::fillTimeEntries(&related, size);
+
+        Poco::Stopwatch stopwatch;
+
+        stopwatch.restart();
+        for (Poco::UInt64 i = 0; i < linear_lookups; i++) {
+            Poco::UInt64 id = 1 + (i * 7919) % size;
+            ASSERT_TRUE(modelByID(id, &related.TimeEntries));
+        }
+        benchmark::report("TimeEntryByID", size, "linear",
+                          stopwatch.elapsed(), linear_lookups);
+
+        stopwatch.restart();
+        for (Poco::UInt64 i = 0; i < indexed_lookups; i++) {
+            Poco::UInt64 id = 1 + (i * 7919) % size;
+            ASSERT_TRUE(related.TimeEntryByID(id));
+        }
+        benchmark::report("TimeEntryByID", size, "indexed",
+                          stopwatch.elapsed(), indexed_lookups);
+
+        std::vector<std::string> guids;
+        for (Poco::UInt64 i = 0; i < indexed_lookups; i++) {
+            guids.push_back(benchmark::guidFor(1 + (i * 7919) % size));
+        }
+
+        stopwatch.restart();
+        for (Poco::UInt64 i = 0; i < linear_lookups; i++) {
+            ASSERT_TRUE(modelByGUID(guids[i], &related.TimeEntries));
+        }
+        benchmark::report("TimeEntryByGUID", size, "linear",
+                          stopwatch.elapsed(), linear_lookups);
+
+        stopwatch.restart();
+        for (Poco::UInt64 i = 0; i < indexed_lookups; i++) {
+            ASSERT_TRUE(related.TimeEntryByGUID(guids[i]));
+        }
+        benchmark::report("TimeEntryByGUID", size, "indexed",
+                          stopwatch.elapsed(), indexed_lookups);
+
+        related.Clear();
+    }
+}
+
+TEST(Benchmark, TotalDurationForDate) {
+    const Poco::UInt64 size = 10000;
+    const Poco::UInt64 scans = 20;
+    const Poco::UInt64 lookups = 100000;
+
+    User user;
+    benchmark::fillUser(&user, size);
+    TimeEntry *match = user.related.TimeEntries[size / 2];
+
+    // Every entry's date header formatted and compared, as before
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    for (Poco::UInt64 n = 0; n < scans; n++) {
+        std::string date_header = Formatter::FormatDateHeader(match->Start());
+        Poco::Int64 duration(0);
+        for (size_t i = 0; i < user.related.TimeEntries.size(); i++) {
+            TimeEntry *te = user.related.TimeEntries[i];
+            if (Formatter::FormatDateHeader(te->Start()) == date_header) {
+                duration += Formatter::AbsDuration(te->Duration());
+            }
+        }
+        ASSERT_EQ(duration, user.related.TotalDurationForDate(match));
+    }
+    benchmark::report("TotalDurationForDate", size, "scan",
+                      stopwatch.elapsed(), scans);
+
+    stopwatch.restart();
+    for (Poco::UInt64 n = 0; n < lookups; n++) {
+        user.related.TotalDurationForDate(match);
+    }
+    benchmark::report("TotalDurationForDate", size, "by day",
+                      stopwatch.elapsed(), lookups);
+
+    // A change moves only the changed entry on the next lookup
+    stopwatch.restart();
+    for (Poco::UInt64 n = 0; n < lookups; n++) {
+        match->SetDurationInSeconds(1800 + n % 60);
+        user.related.TotalDurationForDate(match);
+    }
+    benchmark::report("TotalDurationForDate", size, "after a change",
+                      stopwatch.elapsed(), lookups);
+}
+
+TEST(Benchmark, FormatDurationsAndTimestamps) {
+    const Poco::UInt64 count = 1000000;
+    const std::time_t now = time(0);
+
+    // Durations up to a couple of days, timestamps of the last weeks
+    Poco::UInt64 chars(0);
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        chars += Formatter::FormatDuration(
+            i % 200000, Format::Improved).size();
+    }
+    benchmark::report("FormatDuration", count, "string",
+                      stopwatch.elapsed(), count);
+
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        chars += Formatter::FormatDurationForDateHeader(i % 200000).size();
+    }
+    benchmark::report("FormatDurationForDateHeader", count, "string",
+                      stopwatch.elapsed(), count);
+
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        chars += Formatter::Format8601(now - i).size();
+    }
+    benchmark::report("Format8601", count, "string",
+                      stopwatch.elapsed(), count);
+
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        chars += Formatter::FormatDateHeader(now - i * 3).size();
+    }
+    benchmark::report("FormatDateHeader", count, "string",
+                      stopwatch.elapsed(), count);
+
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        chars += Formatter::FormatTimeForTimeEntryEditor(now - i).size();
+    }
+    benchmark::report("FormatTimeForTimeEntryEditor", count, "string",
+                      stopwatch.elapsed(), count);
+
+    // Into a buffer, without allocating
+    char buf[kFormatBufferSize];
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        chars += Formatter::FormatDuration(
+            i % 200000, Format::Improved, true, buf);
+    }
+    benchmark::report("FormatDuration", count, "buffer",
+                      stopwatch.elapsed(), count);
+
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        chars += Formatter::Format8601(now - i, buf);
+    }
+    benchmark::report("Format8601", count, "buffer",
+                      stopwatch.elapsed(), count);
+
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        chars += Formatter::FormatDateHeader(now - i * 3, buf);
+    }
+    benchmark::report("FormatDateHeader", count, "buffer",
+                      stopwatch.elapsed(), count);
+
+    ASSERT_LT(count, chars);
+}
+
+TEST(Benchmark, Parse8601) {
+    const Poco::UInt64 count = 1000000;
+    const std::time_t now = time(0);
+
+    // Shapes the API sends, and one left to Poco
+    std::vector<std::string> utc, offset, fractional;
+    for (Poco::UInt64 i = 0; i < 1000; i++) {
+        std::string value = Formatter::Format8601(now - i * 3607);
+        utc.push_back(value);
+        offset.push_back(value.substr(0, 19) + "+00:00");
+        fractional.push_back(value.substr(0, 19) + ".000Z");
+    }
+
+    Poco::UInt64 sum(0);
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        sum += Formatter::Parse8601(utc[i % utc.size()]);
+    }
+    benchmark::report("Parse8601", count, "Z", stopwatch.elapsed(), count);
+
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        sum += Formatter::Parse8601(offset[i % offset.size()]);
+    }
+    benchmark::report("Parse8601", count, "+00:00",
+                      stopwatch.elapsed(), count);
+
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < count; i++) {
+        sum += Formatter::Parse8601(fractional[i % fractional.size()]);
+    }
+    benchmark::report("Parse8601", count, "fractional",
+                      stopwatch.elapsed(), count);
+
+    ASSERT_LT(count, sum);
+}
+
+TEST(Benchmark, SaveUserWithOneChange) {
+    const Poco::UInt64 sizes[] = { 1000, 10000, 50000 };
+    const Poco::UInt64 saves = 20;
+
+    for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+        const Poco::UInt64 size = sizes[n];
+
+        Database *db = nullptr;
+        benchmark::newDatabase(&db);
+
+        User user;
+        benchmark::fillUser(&user, size);
+
+        std::vector<ModelChange> changes;
+        ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+
+        Poco::Stopwatch stopwatch;
+        stopwatch.restart();
+        for (Poco::UInt64 i = 0; i < saves; i++) {
+            std::stringstream ss;
+            ss << "changed " << i;
+            user.related.TimeEntries[(i * 7919) % size]->SetDescription(
+                ss.str());
+
+            changes.clear();
+            ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+            ASSERT_EQ(size_t(1), changes.size());
+        }
+        benchmark::report("SaveUserWithOneChange", size, "journal",
+                          stopwatch.elapsed(), saves);
+
+        delete db;
+    }
+}
+
+TEST(Benchmark, CoalescedSaves) {
+    const Poco::UInt64 size = 10000;
+    const Poco::UInt64 edits = 50;
+
+    Database *db = nullptr;
+    benchmark::newDatabase(&db);
+
+    User user;
+    benchmark::fillUser(&user, size);
+
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+
+    // Every edit committed before the API call returns
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < edits; i++) {
+        std::stringstream ss;
+        ss << "typed " << i;
+        user.related.TimeEntries[0]->SetDescription(ss.str());
+        changes.clear();
+        ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+    }
+    benchmark::report("CoalescedSaves", size, "commit per edit",
+                      stopwatch.elapsed(), edits);
+
+    // Edits only update memory, the persister commits them at once
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < edits; i++) {
+        std::stringstream ss;
+        ss << "typed again " << i;
+        user.related.TimeEntries[0]->SetDescription(ss.str());
+    }
+    Poco::Timestamp::TimeDiff edited = stopwatch.elapsed();
+    changes.clear();
+    ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+    benchmark::report("CoalescedSaves", size, "edit",
+                      edited, edits);
+    benchmark::report("CoalescedSaves", size, "one commit",
+                      stopwatch.elapsed() - edited, 1);
+
+    delete db;
+}
+
+TEST(Benchmark, ApplyWebSocketUpdates) {
+    const Poco::UInt64 size = 10000;
+    const Poco::UInt64 edited = 250;
+
+    // A bulk edit: every edited time entry is pushed twice
+    std::vector<Json::Value> updates;
+    for (Poco::UInt64 round = 0; round < 2; round++) {
+        for (Poco::UInt64 i = 1; i <= edited; i++) {
+            Json::Value update;
+            update["action"] = "UPDATE";
+            update["model"] = "time_entry";
+            update["data"]["id"] = Json::UInt64(i);
+            update["data"]["guid"] = benchmark::guidFor(i);
+            update["data"]["wid"] = 1;
+            update["data"]["description"] = round ? "edited" : "editing";
+            update["data"]["start"] = "2015-01-01T10:00:00+00:00";
+            update["data"]["duration"] = 1800;
+            updates.push_back(update);
+        }
+    }
+
+    const std::string variants[] = { "one by one", "batched" };
+    for (size_t n = 0; n < 2; n++) {
+        Database *db = nullptr;
+        benchmark::newDatabase(&db);
+
+        User user;
+        benchmark::fillUser(&user, size);
+
+        std::vector<ModelChange> changes;
+        ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+
+        Poco::Stopwatch stopwatch;
+        stopwatch.restart();
+        if (0 == n) {
+            // A transaction per update, as before
+            for (size_t i = 0; i < updates.size(); i++) {
+                user.LoadUserUpdateFromJSON(updates[i]);
+                changes.clear();
+                ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+            }
+        } else {
+            ASSERT_EQ(edited, user.LoadUserUpdatesFromJSON(updates));
+            changes.clear();
+            ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+        }
+        benchmark::report("ApplyWebSocketUpdates", updates.size(),
+                          variants[n], stopwatch.elapsed(), updates.size());
+        ASSERT_EQ("edited", user.related.TimeEntryByID(edited)->Description());
+
+        delete db;
+    }
+}
+
+TEST(Benchmark, RenderWhileSyncing) {
+    const size_t size = 4 * 1024 * 1024;
+    const Poco::Timestamp::TimeDiff duration = 5 * Poco::Timespan::SECONDS;
+
+    Poco::File f(BENCHMARKDB);
+    if (f.exists()) {
+        f.remove(false);
+    }
+
+    void *ctx = toggl_context_init("benchmark", "0.1");
+    Context *context = reinterpret_cast<Context *>(ctx);
+    context->SetEnvironment("test");
+    ASSERT_TRUE(toggl_set_db_path(ctx, BENCHMARKDB));
+    benchmark::setCallbacks(ctx);
+
+    std::string json = "{\"since\": 1400000000, \"data\": "
+                       + benchmark::meData(size) + "}";
+    ASSERT_TRUE(testing_set_logged_in_user(ctx, json.c_str()));
+    Poco::UInt64 time_entries(0);
+    {
+        Json::Value root;
+        Json::Reader reader;
+        ASSERT_TRUE(reader.parse(json, root));
+        time_entries = root["data"]["time_entries"].size();
+    }
+
+    // Time entry list is rendered while updates keep arriving
+    benchmark::UpdateFeeder feeder(context, time_entries, duration);
+    Poco::Thread thread;
+    thread.start(feeder);
+
+    std::vector<Poco::Timestamp::TimeDiff> renders;
+    Poco::Timestamp::TimeDiff total(0);
+    Poco::Stopwatch stopwatch;
+    while (thread.isRunning()) {
+        stopwatch.restart();
+        context->OpenTimeEntryList();
+        renders.push_back(stopwatch.elapsed());
+        total += renders.back();
+        Poco::Thread::sleep(16);
+    }
+    thread.join();
+
+    std::sort(renders.begin(), renders.end());
+    benchmark::report("RenderWhileSyncing", time_entries, "render",
+                      total, renders.size());
+    std::cout << "RenderWhileSyncing size=" << time_entries
+              << " renders=" << renders.size()
+              << " p50=" << renders[renders.size() / 2] / 1000 << " ms"
+              << " p99=" << renders[renders.size() * 99 / 100] / 1000 << " ms"
+              << " max=" << renders.back() / 1000 << " ms"
+              << " updates=" << feeder.Updates()
+              << std::endl;
+
+    toggl_context_clear(ctx);
+}
+
+TEST(Benchmark, IdleWakeups) {
+    const Poco::Timestamp::TimeDiff idle = 5 * Poco::Timespan::SECONDS;
+
+    Poco::File f(BENCHMARKDB);
+    if (f.exists()) {
+        f.remove(false);
+    }
+
+    void *ctx = toggl_context_init("benchmark", "0.1");
+    Context *context = reinterpret_cast<Context *>(ctx);
+    context->SetEnvironment("test");
+    ASSERT_TRUE(toggl_set_db_path(ctx, BENCHMARKDB));
+    benchmark::setCallbacks(ctx);
+
+    std::string json = "{\"since\": 1400000000, \"data\": "
+                       + benchmark::meData(64 * 1024) + "}";
+    ASSERT_TRUE(testing_set_logged_in_user(ctx, json.c_str()));
+
+    // Let the login settle, then sit idle in the tray
+    Poco::Thread::sleep(1000);
+    Poco::UInt64 switches = benchmark::voluntaryContextSwitches();
+    Poco::Thread::sleep(static_cast<long>(idle / 1000));  // NOLINT
+    switches = benchmark::voluntaryContextSwitches() - switches;
+
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    toggl_context_clear(ctx);
+    Poco::Timestamp::TimeDiff shutdown = stopwatch.elapsed();
+
+    std::cout << "IdleWakeups wakeups="
+              << switches * Poco::Timespan::SECONDS / idle << "/s"
+              << " shutdown=" << shutdown / 1000 << " ms" << std::endl;
+}
+
+TEST(Benchmark, DatabaseStartup) {
+    const Poco::UInt64 size = 50000;
+
+    // Time entries of 2014, all due for purging
+    {
+        Database *db = nullptr;
+        benchmark::newDatabase(&db);
+        User user;
+        benchmark::fillUser(&user, size);
+        std::vector<ModelChange> changes;
+        ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+        delete db;
+    }
+
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    Database *db = new Database(BENCHMARKDB);
+    std::cout << "DatabaseStartup size=" << size << " open "
+              << stopwatch.elapsed() / 1000 << " ms" << std::endl;
+
+    // What used to happen on startup, now in budgeted background runs
+    Poco::UInt64 runs(0), rows(0);
+    Poco::Int64 pages(0);
+    Poco::Timestamp::TimeDiff longest(0);
+    Poco::Timestamp purge_before(
+        Poco::Timestamp::fromEpochTime(time(0) - kTimeEntrySecondsToKeep));
+    std::set<Poco::Int64> keep;
+    DatabaseMaintenance run;
+    stopwatch.restart();
+    while (!run.complete) {
+        ASSERT_EQ(noError, db->Maintain(
+            kDatabaseMaintenanceBudgetMillis * 1000,
+            purge_before, keep, &run));
+        runs++;
+        rows += run.rows_purged;
+        pages += run.pages_reclaimed;
+        longest = std::max(longest, run.ended - run.started);
+    }
+    std::cout << "DatabaseStartup size=" << size << " maintenance "
+              << stopwatch.elapsed() / 1000 << " ms in " << runs
+              << " runs, longest " << longest / 1000 << " ms"
+              << " rows_purged=" << rows
+              << " pages_reclaimed=" << pages << std::endl;
+    ASSERT_EQ(size, rows);
+
+    delete db;
+}
+
+TEST(Benchmark, StartupLoad) {
+    const Poco::UInt64 size = 200000;
+    const Poco::UInt64 recent = 200;
+    const Poco::UInt64 now = time(0);
+    const Poco::UInt64 since = now - kStartupTimeEntryDays * 86400;
+
+    // 170k old time entries, 10k each of projects, tasks and tags,
+    // and a couple of hundred time entries from the last days
+    {
+        Database *db = nullptr;
+        benchmark::newDatabase(&db);
+        User user;
+        benchmark::fillUser(&user, 0);
+        std::vector<ModelChange> changes;
+        ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+        ASSERT_EQ(noError, db->SetCurrentAPIToken(user.APIToken(), user.ID()));
+        delete db;
+
+        std::stringstream sql;
+        sql << "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL "
+            << "SELECT i + 1 FROM n WHERE i < 170000) "
+            << "INSERT INTO time_entries(id, uid, wid, guid, description, "
+            << "start, stop, duration) SELECT i, 1, 1, 'te-' || i, "
+            << "'benchmark', 1400000000 + i * 600, "
+            << "1400000000 + i * 600 + 300, 300 FROM n;"
+            << "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL "
+            << "SELECT i + 1 FROM n WHERE i < " << recent << ") "
+            << "INSERT INTO time_entries(id, uid, wid, guid, description, "
+            << "start, stop, duration) SELECT 1000000 + i, 1, 1, "
+            << "'recent-' || i, 'recent', " << now << " - i * 3600, "
+            << now << " - i * 3600 + 1800, 1800 FROM n;"
+            << "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL "
+            << "SELECT i + 1 FROM n WHERE i < 10000) "
+            << "INSERT INTO projects(id, uid, wid, guid, name, active) "
+            << "SELECT i, 1, 1, 'p-' || i, 'project ' || i, i % 10 = 0 "
+            << "FROM n;"
+            << "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL "
+            << "SELECT i + 1 FROM n WHERE i < 10000) "
+            << "INSERT INTO tasks(id, uid, wid, pid, name) "
+            << "SELECT i, 1, 1, i, 'task ' || i FROM n;"
+            << "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL "
+            << "SELECT i + 1 FROM n WHERE i < 10000) "
+            << "INSERT INTO tags(id, uid, wid, guid, name) "
+            << "SELECT i, 1, 1, 'tag-' || i, 'tag ' || i FROM n;";
+        sqlite3 *handle = nullptr;
+        ASSERT_EQ(SQLITE_OK, sqlite3_open(BENCHMARKDB, &handle));
+        ASSERT_EQ(SQLITE_OK,
+                  sqlite3_exec(handle, sql.str().c_str(), 0, 0, 0));
+        sqlite3_close(handle);
+    }
+
+    Database *db = new Database(BENCHMARKDB);
+
+    // Everything before the first render, as before
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    {
+        User user;
+        ASSERT_EQ(noError, db->LoadUserByID(1, &user));
+        ASSERT_EQ(size_t(170000 + recent), user.related.TimeEntries.size());
+    }
+    std::cout << "StartupLoad size=" << size << " full "
+              << stopwatch.elapsed() / 1000 << " ms" << std::endl;
+
+    stopwatch.restart();
+    User user;
+    ASSERT_EQ(noError, db->LoadCurrentUser(&user, since));
+    std::cout << "StartupLoad size=" << size << " first_render "
+              << stopwatch.elapsed() / 1000 << " ms" << std::endl;
+    ASSERT_EQ(size_t(recent), user.related.TimeEntries.size());
+
+    stopwatch.restart();
+    RelatedData rest;
+    ASSERT_EQ(noError, db->LoadUserRemainingData(1, since, &rest));
+    user.related.Merge(&rest);
+    std::cout << "StartupLoad size=" << size << " background "
+              << stopwatch.elapsed() / 1000 << " ms" << std::endl;
+    ASSERT_EQ(size_t(170000 + recent), user.related.TimeEntries.size());
+    ASSERT_EQ(size_t(10000), user.related.Projects.size());
+
+    delete db;
+}
+
+TEST(Benchmark, Migrations) {
+    const Poco::UInt64 iterations = 10;
+
+    // Every migration pending
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < iterations; i++) {
+        Database *db = nullptr;
+        benchmark::newDatabase(&db);
+        delete db;
+    }
+    benchmark::report("Migrations", 0, "empty",
+                      stopwatch.elapsed(), iterations);
+
+    // Every migration already applied, as on each app start
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < iterations; i++) {
+        Database *db = new Database(BENCHMARKDB);
+        delete db;
+    }
+    benchmark::report("Migrations", 0, "migrated",
+                      stopwatch.elapsed(), iterations);
+}
+
+TEST(Benchmark, SaveTimelineEvents) {
+    const Poco::UInt64 size = 1000;
+    const Poco::UInt64 events = kTimelineBufferSize * 4;
+
+    Database *db = nullptr;
+    benchmark::newDatabase(&db);
+
+    User user;
+    benchmark::fillUser(&user, size);
+
+    std::vector<ModelChange> changes;
+    ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+
+    // One save per recorded event, as before
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < events; i++) {
+        TimelineEvent *event = new TimelineEvent();
+        event->SetUID(user.ID());
+        event->SetTitle("benchmark");
+        event->SetStart(1400000000 + i * 60);
+        event->SetEndTime(event->Start() + 60);
+        user.related.Push(event);
+        changes.clear();
+        ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+    }
+    benchmark::report("SaveTimelineEvents", events, "save per event",
+                      stopwatch.elapsed(), events);
+
+    // Buffered and saved in batches
+    stopwatch.restart();
+    for (Poco::UInt64 i = 0; i < events; i++) {
+        TimelineEvent *event = new TimelineEvent();
+        event->SetTitle("benchmark");
+        event->SetStart(1500000000 + i * 60);
+        event->SetEndTime(event->Start() + 60);
+        user.related.TimelineBuffer.push_back(event);
+        if (user.related.TimelineBuffer.size() >= kTimelineBufferSize) {
+            ASSERT_EQ(noError, db->SaveTimelineEvents(&user));
+        }
+    }
+    benchmark::report("SaveTimelineEvents", events, "batched",
+                      stopwatch.elapsed(), events);
+    ASSERT_EQ(events * 2, user.related.TimelineEvents.size());
+
+    delete db;
+}
+
+TEST(Benchmark, ChunkTimelineEvents) {
+    const Poco::UInt64 size = 1000000;
+    const Poco::UInt64 blocks = 4;
+    const char *apps[] = {
+        "Terminal", "Browser", "Editor", "Mail", "Chat"
+    };
+    const char *titles[] = { "one", "two", "three", "four" };
+
+    User user;
+    user.SetID(1);
+
+    // Periods that have not ended yet, so events are added to chunks
+    const Poco::UInt64 start =
+        (time(0) / kTimelineChunkSeconds + 1) * kTimelineChunkSeconds;
+
+    Poco::Stopwatch stopwatch;
+    for (Poco::UInt64 block = 0; block < blocks; block++) {
+        stopwatch.restart();
+        for (Poco::UInt64 i = block * size / blocks;
+                i < (block + 1) * size / blocks; i++) {
+            TimelineEvent *event = new TimelineEvent();
+            event->SetFilename(apps[i % 5]);
+            event->SetTitle(titles[(i / 5) % 4]);
+            event->SetStart(start + i);
+            event->SetEndTime(start + i + 1);
+            user.related.AddTimelineEvent(event);
+        }
+        std::stringstream variant;
+        variant << "online events " << (block * size / blocks)
+                << "-" << ((block + 1) * size / blocks);
+        benchmark::report("ChunkTimelineEvents", size, variant.str(),
+                          stopwatch.elapsed(), size / blocks);
+    }
+
+    // Memory holds chunks only, not the recorded events
+    ASSERT_GT(size / 40, user.related.TimelineBuffer.size());
+
+    // Raw events compressed at upload time, as before
+    const Poco::UInt64 raw = size / 10;
+    User rescanned;
+    rescanned.SetID(1);
+    for (Poco::UInt64 i = 0; i < raw; i++) {
+        TimelineEvent *event = new TimelineEvent();
+        event->SetFilename(apps[i % 5]);
+        event->SetTitle(titles[(i / 5) % 4]);
+        event->SetStart(start + i);
+        event->SetEndTime(start + i + 1);
+        rescanned.related.Push(event);
+    }
+    stopwatch.restart();
+    rescanned.related.CompressTimeline(0);
+    benchmark::report("ChunkTimelineEvents", raw, "rescan raw events",
+                      stopwatch.elapsed(), raw);
+}
+
+TEST(Benchmark, EncodeTimelineUpload) {
+    const Poco::UInt64 size = 10000;
+    const Poco::UInt64 iterations = 10;
+
+    std::vector<TimelineEvent> events;
+    for (Poco::UInt64 i = 0; i < size; i++) {
+        TimelineEvent event;
+        event.SetGUID(benchmark::guidFor(i));
+        event.SetFilename("/Applications/Terminal.app");
+        event.SetTitle("vim src/timeline_uploader.cc - \"toggldesktop\"");
+        event.SetStart(1400000000 + i * kTimelineChunkSeconds);
+        event.SetEndTime(event.Start() + 600);
+        events.push_back(event);
+    }
+
+    // Styled JSON tree, gzipped by the HTTPS client
+    Poco::Stopwatch stopwatch;
+    std::string payload;
+    stopwatch.start();
+    for (Poco::UInt64 n = 0; n < iterations; n++) {
+        Json::Value root;
+        for (std::vector<TimelineEvent>::const_iterator i = events.begin();
+                i != events.end();
+                ++i) {
+            Json::Value v = i->SaveToJSON();
+            v["desktop_id"] = "benchmark";
+            root.append(v);
+        }
+        Json::StyledWriter writer;
+        std::istringstream json(writer.write(root));
+        Poco::DeflatingInputStream gzip(
+            json, Poco::DeflatingStreamBuf::STREAM_GZIP);
+        std::stringstream compressed;
+        Poco::StreamCopier::copyStream(gzip, compressed);
+        payload = compressed.str();
+    }
+    stopwatch.stop();
+    benchmark::report("EncodeTimelineUpload", size, "styled tree",
+                      stopwatch.elapsed(), iterations);
+    std::cout << "EncodeTimelineUpload size=" << size
+              << " styled tree " << payload.size() << " bytes" << std::endl;
+
+    // Compact JSON streamed into gzip
+    stopwatch.restart();
+    for (Poco::UInt64 n = 0; n < iterations; n++) {
+        payload = compressTimelineJSON(events, "benchmark");
+    }
+    stopwatch.stop();
+    benchmark::report("EncodeTimelineUpload", size, "compact stream",
+                      stopwatch.elapsed(), iterations);
+    std::cout << "EncodeTimelineUpload size=" << size
+              << " compact stream " << payload.size() << " bytes"
+              << std::endl;
+}
+
+TEST(Benchmark, InsertTimeEntries) {
+    const Poco::UInt64 size = 50000;
+
+    {
+        Database *db = nullptr;
+        benchmark::newDatabase(&db);
+
+        User user;
+        benchmark::fillUser(&user, size);
+
+        // Statement is parsed and bound by Poco for every row,
+        // as saveModel used to do.
+        Poco::Data::Session session("SQLite", BENCHMARKDB);
+
+        Poco::Stopwatch stopwatch;
+        stopwatch.restart();
+        session.begin();
+        for (Poco::UInt64 i = 0; i < size; i++) {
+            TimeEntry *te = user.related.TimeEntries[i];
+            session <<
+                    "insert into time_entries(id, uid, description, "
+                    "wid, guid, start, stop, duration) "
+                    "values(:id, :uid, :description, "
+                    ":wid, :guid, :start, :stop, :duration)",
+                    Poco::Data::Keywords::useRef(te->ID()),
+                    Poco::Data::Keywords::useRef(user.ID()),
+                    Poco::Data::Keywords::useRef(te->Description()),
+                    Poco::Data::Keywords::useRef(te->WID()),
+                    Poco::Data::Keywords::useRef(te->GUID()),
+                    Poco::Data::Keywords::useRef(te->Start()),
+                    Poco::Data::Keywords::useRef(te->Stop()),
+                    Poco::Data::Keywords::useRef(te->DurationInSeconds()),
+                    Poco::Data::Keywords::now;
+        }
+        session.commit();
+        benchmark::report("InsertTimeEntries", size, "poco",
+                          stopwatch.elapsed(), size);
+
+        session.close();
+        delete db;
+    }
+
+    {
+        Database *db = nullptr;
+        benchmark::newDatabase(&db);
+
+        User user;
+        benchmark::fillUser(&user, size);
+
+        Poco::Stopwatch stopwatch;
+        stopwatch.restart();
+        std::vector<ModelChange> changes;
+        ASSERT_EQ(noError, db->SaveUser(&user, true, &changes));
+        benchmark::report("InsertTimeEntries", size, "prepared",
+                          stopwatch.elapsed(), size);
+
+        delete db;
+    }
+}
+
+TEST(Benchmark, HTTPSRequests) {
+    const Poco::UInt64 requests = 50;
+
+    Poco::Net::SSLManager::instance().initializeServer(
+        new benchmark::SecretPassphraseHandler(),
+        new Poco::Net::AcceptCertificateHandler(true),
+        nullptr);
+    Poco::Net::Context::Ptr server_context = new Poco::Net::Context(
+        Poco::Net::Context::SERVER_USE, BENCHMARKCERT, BENCHMARKCERT, "",
+        Poco::Net::Context::VERIFY_NONE, 9, false, "ALL");
+    server_context->enableSessionCache(true, "benchmark");
+    Poco::Net::SecureServerSocket socket(0, 64, server_context);
+    Poco::Net::HTTPServer server(
+        new benchmark::StatusHandlerFactory(),
+        socket,
+        new Poco::Net::HTTPServerParams());
+    server.start();
+
+    std::stringstream host;
+    host << "https://localhost:" << socket.address().port();
+
+    HTTPSClientConfig config = HTTPSClient::Config;
+    HTTPSClient::Config.CACertPath = "../src/ssl/cacert.pem";
+    HTTPSClient::Config.IgnoreCert = true;
+    HTTPSClient::Config.AutodetectProxy = false;
+    HTTPSClient::Config.UseProxy = false;
+    urls::SetRequestsAllowed(true);
+
+    HTTPSRequest req;
+    req.host = host.str();
+    req.relative_url = "/api/v8/status";
+
+    const std::string variants[] = { "new connection", "keep-alive" };
+    for (size_t n = 0; n < 2; n++) {
+        HTTPSClient::Sessions.Clear();
+        Poco::UInt64 handshakes = HTTPSClient::Sessions.Handshakes();
+
+        HTTPSClient client;
+        Poco::Stopwatch stopwatch;
+        stopwatch.restart();
+        for (Poco::UInt64 i = 0; i < requests; i++) {
+            if (0 == n) {
+                // Same as before pooling: a fresh session every time
+                HTTPSClient::Sessions.Clear();
+            }
+            HTTPSResponse resp = client.Get(req);
+            ASSERT_EQ(noError, resp.err);
+            ASSERT_EQ("{}", resp.body);
+        }
+        benchmark::report("HTTPSRequests", requests, variants[n],
+                          stopwatch.elapsed(), requests);
+
+        handshakes = HTTPSClient::Sessions.Handshakes() - handshakes;
+        std::cout << "HTTPSRequests " << variants[n]
+                  << " handshakes=" << handshakes << std::endl;
+        if (n) {
+            ASSERT_EQ(Poco::UInt64(1), handshakes);
+        } else {
+            ASSERT_EQ(requests, handshakes);
+        }
+    }
+
+    HTTPSClient::Sessions.Clear();
+    urls::SetRequestsAllowed(false);
+    HTTPSClient::Config = config;
+    server.stop();
+}
+
+TEST(Benchmark, WebSocketLatency) {
+    const Poco::UInt64 messages = 20;
+
+    Poco::Net::SSLManager::instance().initializeServer(
+        new benchmark::SecretPassphraseHandler(),
+        new Poco::Net::AcceptCertificateHandler(true),
+        nullptr);
+    Poco::Net::Context::Ptr server_context = new Poco::Net::Context(
+        Poco::Net::Context::SERVER_USE, BENCHMARKCERT, BENCHMARKCERT, "",
+        Poco::Net::Context::VERIFY_NONE, 9, false, "ALL");
+    Poco::Net::SecureServerSocket socket(0, 64, server_context);
+    Poco::NotificationQueue queue;
+    Poco::Event connected;
+    Poco::Net::HTTPServer server(
+        new benchmark::PushHandlerFactory(&queue, &connected),
+        socket,
+        new Poco::Net::HTTPServerParams());
+    server.start();
+
+    std::stringstream url;
+    url << "https://localhost:" << socket.address().port();
+    urls::SetWebSocketURL(url.str());
+
+    HTTPSClientConfig config = HTTPSClient::Config;
+    HTTPSClient::Config.CACertPath = "../src/ssl/cacert.pem";
+    HTTPSClient::Config.IgnoreCert = true;
+    HTTPSClient::Config.AutodetectProxy = false;
+    HTTPSClient::Config.UseProxy = false;
+
+    User user;
+    user.SetID(1);
+    WebSocketClient client;
+    client.Start(&user, "benchmark", benchmark::onWebSocketMessage,
+                 benchmark::onWebSocketMissedMessage);
+    ASSERT_TRUE(connected.tryWait(10000));
+
+    // A pushed time entry update, and a whole user in 64 KB frames
+    const std::string updates[] = {
+        "{\"action\": \"INSERT\", \"model\": \"time_entry\", "
+        "\"data\": {\"id\": 1, \"guid\": \"" + benchmark::guidFor(1)
+        + "\", \"wid\": 1, \"description\": \"pushed\", "
+        "\"start\": \"2015-01-01T10:00:00+00:00\", \"duration\": -1, "
+        "\"at\": \"2015-01-01T10:00:00+00:00\"}}",
+        "{\"action\": \"UPDATE\", \"model\": \"user\", \"data\": "
+        + benchmark::meData(1024 * 1024) + "}"
+    };
+    const size_t frame_sizes[] = { 1024, 64 * 1024 };
+    const std::string variants[] = { "time entry", "user 1 MB" };
+    const std::string models[] = { "time_entry", "user" };
+    for (size_t n = 0; n < 2; n++) {
+        Poco::Timestamp::TimeDiff total(0), worst(0);
+        for (Poco::UInt64 i = 0; i < messages; i++) {
+            benchmark::websocket_received.reset();
+            Poco::Timestamp sent;
+            queue.enqueueNotification(
+                new benchmark::PushNotification(updates[n], frame_sizes[n]));
+            ASSERT_TRUE(benchmark::websocket_received.tryWait(10000));
+            ASSERT_EQ(models[n], benchmark::websocket_received_model);
+            Poco::Timestamp::TimeDiff latency =
+                benchmark::websocket_received_at - sent;
+            total += latency;
+            worst = std::max(worst, latency);
+        }
+        std::cout << "WebSocketLatency " << variants[n]
+                  << " size=" << updates[n].size()
+                  << " average " << total / messages << " us"
+                  << " worst " << worst << " us" << std::endl;
+        ASSERT_FALSE(user.related.TimeEntries.empty());
+    }
+
+    client.Shutdown();
+    queue.wakeUpAll();
+    urls::SetWebSocketURL("");
+    HTTPSClient::Config = config;
+    server.stop();
+}
+
+TEST(Benchmark, LoadUserAndRelatedData) {
+    const size_t size = 50 * 1024 * 1024;
+    const std::string variants[] = { "tree", "stream" };
+
+    for (size_t n = 0; n < 2; n++) {
+        // Each variant runs in its own process, so that the
+        // peak RSS of one doesn't hide the other.
+        pid_t pid = fork();
+        ASSERT_NE(-1, pid);
+        if (pid) {
+            int status(0);
+            waitpid(pid, &status, 0);
+            ASSERT_TRUE(WIFEXITED(status));
+            ASSERT_EQ(0, WEXITSTATUS(status));
+            continue;
+        }
+
+        std::string json;
+        if (0 == n) {
+            // Whole document parsed into Json::Value, as before
+            json = "{\"model\": \"user\", \"action\": \"update\", "
+                   "\"data\": " + benchmark::meData(size) + "}";
+        } else {
+            json = "{\"since\": 1400000000, \"data\": "
+                   + benchmark::meData(size) + "}";
+        }
+        Poco::UInt64 before = benchmark::peakRSS();
+
+        User user;
+        Poco::Stopwatch stopwatch;
+        stopwatch.restart();
+        error err(noError);
+        if (0 == n) {
+            err = user.LoadUserUpdateFromJSONString(json);
+        } else {
+            err = user.LoadUserAndRelatedDataFromJSONString(json, true);
+        }
+        Poco::Timestamp::TimeDiff elapsed = stopwatch.elapsed();
+
+        std::cout << "LoadUserAndRelatedData size=" << json.size()
+                  << " " << variants[n]
+                  << " " << elapsed / 1000 << " ms"
+                  << " time_entries=" << user.related.TimeEntries.size()
+                  << " rss_before=" << before << " KB"
+                  << " rss_peak=" << benchmark::peakRSS() << " KB"
+                  << std::endl;
+        _exit(noError == err && user.related.TimeEntries.size() ? 0 : 1);
+    }
+}
+
+TEST(Benchmark, RenderTimeEntryList) {
+    const size_t size = 5000;
+    const Poco::UInt64 renders = 20;
+
+    std::vector<view::TimeEntry> list;
+    for (size_t i = 0; i < size; i++) {
+        view::TimeEntry te;
+        te.Description = "Benchmark time entry";
+        te.GUID = benchmark::guidFor(i);
+        te.ProjectAndTaskLabel = "Project. Task";
+        te.Duration = "0:30:00";
+        te.DateHeader = "Mon 1. Jan";
+        te.Tags = "tag";
+        list.push_back(te);
+    }
+
+    // One allocation per view and string, freed after each render
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    for (Poco::UInt64 n = 0; n < renders; n++) {
+        TogglTimeEntryView *first = nullptr;
+        for (size_t i = 0; i < list.size(); i++) {
+            TogglTimeEntryView *item = time_entry_view_item_init(list[i]);
+            item->Next = first;
+            first = item;
+        }
+        time_entry_view_item_clear(first);
+    }
+    benchmark::report("RenderTimeEntryList", size, "linked list",
+                      stopwatch.elapsed(), renders * size);
+
+    ViewArena<TogglTimeEntryView> arena;
+    stopwatch.restart();
+    for (Poco::UInt64 n = 0; n < renders; n++) {
+        ASSERT_TRUE(time_entry_view_list_init(&arena, list));
+    }
+    benchmark::report("RenderTimeEntryList", size, "arena",
+                      stopwatch.elapsed(), renders * size);
+}
+
+TEST(Benchmark, TimeEntryTags) {
+    const size_t size = 200000;
+    const std::string tags[] = {
+        "billable-client-work\tdevelopment",
+        "billable-client-work\tmeetings-and-calls",
+        "internal-overhead\tmeetings-and-calls",
+        "internal-overhead\tcode-review\tdevelopment"
+    };
+
+    // Own process, so that the peak RSS isn't from earlier benchmarks
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid) {
+        int status(0);
+        waitpid(pid, &status, 0);
+        ASSERT_TRUE(WIFEXITED(status));
+        ASSERT_EQ(0, WEXITSTATUS(status));
+        return;
+    }
+
+    Poco::UInt64 before = benchmark::peakRSS();
+    std::vector<TimeEntry *> entries;
+    entries.reserve(size);
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    for (size_t i = 0; i < size; i++) {
+        TimeEntry *te = new TimeEntry();
+        te->SetTags(tags[i % 4]);
+        entries.push_back(te);
+    }
+    benchmark::report("TimeEntryTags", size, "set",
+                      stopwatch.elapsed(), size);
+    std::cout << "TimeEntryTags size=" << size
+              << " " << (benchmark::peakRSS() - before) * 1024 / size
+              << " bytes/entry" << std::endl;
+
+    // Tags as the list view reads them
+    size_t total(0);
+    stopwatch.restart();
+    for (size_t i = 0; i < size; i++) {
+        std::string value = entries[i]->Tags();
+        total += value.size();
+    }
+    benchmark::report("TimeEntryTags", size, "read",
+                      stopwatch.elapsed(), size);
+
+    // Comparing with the current tags, as on every sync
+    size_t changed(0);
+    stopwatch.restart();
+    for (size_t i = 0; i < size; i++) {
+        entries[i]->SetTags(tags[i % 4]);
+        changed += entries[i]->Dirty();
+    }
+    benchmark::report("TimeEntryTags", size, "compare",
+                      stopwatch.elapsed(), size);
+
+    for (size_t i = 0; i < size; i++) {
+        delete entries[i];
+    }
+    _exit(total && changed == size ? 0 : 1);
+}
+
+#if defined(__linux__)
+// Needs an X server, for example:
+//   xvfb-run ./toggl_benchmark --gtest_filter=Benchmark.FocusChanges
+TEST(Benchmark, AutocompleteQuery) {
+    const size_t size = 100000;
+    const size_t limit = 20;
+    const char *words[] = {
+        "meeting", "review", "design", "support", "planning",
+        "Toggl", "Desktop", "website", "invoice", "research"
+    };
+    const char *queries[] = { "des", "review web", "plnng", "xyzzy" };
+    const Poco::UInt64 query_count = sizeof(queries) / sizeof(queries[0]);
+
+    std::vector<view::Autocomplete> items;
+    for (size_t i = 0; i < size; i++) {
+        std::stringstream ss;
+        ss << words[i % 10] << " " << words[(i / 10) % 10]
+           << " - " << words[(i / 100) % 10] << " " << i;
+        view::Autocomplete item;
+        item.Text = ss.str();
+        items.push_back(item);
+    }
+
+    // Lowercase and search every item, as UIs filter the whole list
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    for (Poco::UInt64 n = 0; n < query_count; n++) {
+        std::string query = Poco::UTF8::toLower(std::string(queries[n]));
+        std::vector<view::Autocomplete> result;
+        for (size_t i = 0; i < items.size() && result.size() < limit; i++) {
+            std::string text = Poco::UTF8::toLower(items[i].Text);
+            if (text.find(query) != std::string::npos) {
+                result.push_back(items[i]);
+            }
+        }
+    }
+    benchmark::report("AutocompleteQuery", size, "scan",
+                      stopwatch.elapsed(), query_count);
+
+    AutocompleteIndex index;
+    stopwatch.restart();
+    index.Build(items);
+    benchmark::report("AutocompleteQuery", size, "build index",
+                      stopwatch.elapsed(), 1);
+
+    for (Poco::UInt64 n = 0; n < query_count; n++) {
+        std::vector<view::Autocomplete> result;
+        stopwatch.restart();
+        index.Query(queries[n], limit, &result);
+        std::stringstream variant;
+        variant << "query \"" << queries[n] << "\"";
+        benchmark::report("AutocompleteQuery", size, variant.str(),
+                          stopwatch.elapsed(), 1);
+    }
+}
+
+TEST(Benchmark, AutocompleteAfterEdit) {
+    const Poco::UInt64 size = 10000;
+    const Poco::UInt64 edits = 200;
+
+    User user;
+    benchmark::fillUser(&user, size);
+    for (Poco::UInt64 i = 0; i < size; i++) {
+        std::stringstream ss;
+        ss << "benchmark " << i % 1000;
+        user.related.TimeEntries[i]->SetDescription(ss.str());
+    }
+
+    std::vector<view::Autocomplete> result;
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    user.related.AutocompleteQuery(
+        kAutocompleteMinitimer, "bench", 20, &result);
+    benchmark::report("AutocompleteAfterEdit", size, "first query",
+                      stopwatch.elapsed(), 1);
+
+    // One time entry edited between queries, as while typing
+    stopwatch.restart();
+    for (Poco::UInt64 n = 0; n < edits; n++) {
+        std::stringstream ss;
+        ss << "edited " << n;
+        user.related.TimeEntries[n]->SetDescription(ss.str());
+        user.related.AutocompleteQuery(
+            kAutocompleteMinitimer, "edited", 20, &result);
+    }
+    benchmark::report("AutocompleteAfterEdit", size, "edit and query",
+                      stopwatch.elapsed(), edits);
+    ASSERT_EQ(size_t(20), result.size());
+}
+
+TEST(Benchmark, FocusChanges) {
+    benchmark::WindowSwitcher switcher;
+    if (!switcher.Available()) {
+        std::cout << "FocusChanges skipped, no X display" << std::endl;
+        return;
+    }
+
+    const int switches = 100;
+
+    std::string title(""), filename("");
+    bool idle(false);
+    ASSERT_EQ(0, getFocusedWindowInfo(&title, &filename, &idle));
+    ASSERT_EQ("Window 0", title);
+
+    // Detection latency of focus and title changes
+    Poco::Timestamp::TimeDiff focus_latency(0), title_latency(0);
+    for (int i = 1; i <= switches; i++) {
+        Poco::Stopwatch stopwatch;
+        stopwatch.restart();
+        switcher.Activate(i % 2);
+        ASSERT_TRUE(waitForFocusChange(1000));
+        focus_latency += stopwatch.elapsed();
+
+        ASSERT_EQ(0, getFocusedWindowInfo(&title, &filename, &idle));
+        ASSERT_EQ(0u, title.find("Window"));
+        ASSERT_FALSE(filename.empty());
+
+        std::stringstream ss;
+        ss << "Window " << (i % 2) << " title " << i;
+        stopwatch.restart();
+        switcher.SetTitle(i % 2, ss.str());
+        ASSERT_TRUE(waitForFocusChange(1000));
+        title_latency += stopwatch.elapsed();
+
+        ASSERT_EQ(0, getFocusedWindowInfo(&title, &filename, &idle));
+        ASSERT_EQ(ss.str(), title);
+    }
+    std::cout << "FocusChanges focus latency "
+              << focus_latency / switches << " us" << std::endl;
+    std::cout << "FocusChanges title latency "
+              << title_latency / switches << " us" << std::endl;
+
+    // Wakeups while nothing changes, as the recorder loop would see them
+    const long quiet_millis = 5000; // NOLINT
+    benchmark::FocusWaitCanceller canceller(quiet_millis);
+    Poco::Thread thread;
+    thread.start(canceller);
+    int wakeups(0);
+    while (waitForFocusChange(500)) {
+        wakeups++;
+    }
+    thread.join();
+    std::cout << "FocusChanges wakeups per minute "
+              << wakeups * 60000 / quiet_millis
+              << " (polling every 500 ms: 120)" << std::endl;
+    ASSERT_EQ(0, wakeups);
+
+    // Cost of one inspection, compared to opening
+    // a new display connection every time as before
+    Poco::Stopwatch stopwatch;
+    stopwatch.restart();
+    for (int i = 0; i < switches; i++) {
+        getFocusedWindowInfo(&title, &filename, &idle);
+    }
+    benchmark::report("FocusChanges", switches, "inspect",
+                      stopwatch.elapsed(), switches);
+    stopwatch.restart();
+    for (int i = 0; i < switches; i++) {
+        XCloseDisplay(XOpenDisplay(NULL));
+    }
+    benchmark::report("FocusChanges", switches, "XOpenDisplay",
+                      stopwatch.elapsed(), switches);
+}
+#endif
+
+}  // namespace toggl
+
+int main(int argc, char **argv) {
+    Poco::Logger &logger = Poco::Logger::get("");
+    logger.setLevel(Poco::Message::PRIO_ERROR);
+    Poco::Net::initializeSSL();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
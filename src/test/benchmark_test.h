@@ -0,0 +1,10 @@
+// Copyright 2014 Toggl Desktop developers.
+
+#ifndef SRC_TEST_BENCHMARK_TEST_H_
+#define SRC_TEST_BENCHMARK_TEST_H_
+
+#include "gtest/gtest.h"
+
+int main(int argc, char **argv);
+
+#endif  // SRC_TEST_BENCHMARK_TEST_H_
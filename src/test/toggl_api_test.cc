@@ -1,16 +1,22 @@
 // Copyright 2014 Toggl Desktop developers.
 
+#include <set>
+#include <sstream>
 #include <vector>
 
 #include "gtest/gtest.h"
 
+#include "./../context.h"
+#include "./../database.h"
 #include "./../https_client.h"
 #include "./../obm_action.h"
 #include "./../proxy.h"
 #include "./../settings.h"
 #include "./../time_entry.h"
+#include "./../timeline_event.h"
 #include "./../toggl_api.h"
 #include "./../toggl_api_private.h"
+#include "./../user.h"
 #include "./test_data.h"
 
 #include <iostream>   // NOLINT
@@ -147,6 +153,12 @@ void on_reminder(const char *title, const char *informative_text) {
     testresult::reminder_informative_text = std::string(informative_text);
 }
 
+void on_pomodoro(const char *title, const char *informative_text) {
+}
+
+void on_pomodoro_break(const char *title, const char *informative_text) {
+}
+
 void on_help_articles(TogglHelpArticleView *first) {
     testing::testresult::help_article_names.clear();
     TogglHelpArticleView *it = first;
@@ -333,6 +345,8 @@ class App {
         toggl_on_login(ctx_, on_login);
         toggl_on_url(ctx_, on_url);
         toggl_on_reminder(ctx_, on_reminder);
+        toggl_on_pomodoro(ctx_, on_pomodoro);
+        toggl_on_pomodoro_break(ctx_, on_pomodoro_break);
         toggl_on_time_entry_list(ctx_, on_time_entry_list);
         toggl_on_time_entry_autocomplete(ctx_, on_time_entry_autocomplete);
         toggl_on_mini_timer_autocomplete(ctx_, on_mini_timer_autocomplete);
@@ -1258,6 +1272,120 @@ TEST(toggl_api, toggl_set_time_entry_description) {
     ASSERT_EQ("this is a nuclear test", te.Description());
 }
 
+TEST(toggl_api, toggl_autocomplete_query) {
+    testing::App app;
+    std::string json = loadTestData();
+    ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+
+    std::string guid = "07fba193-91c4-0ec8-2894-820df0548a8f";
+    ASSERT_TRUE(toggl_set_time_entry_description(app.ctx(),
+                guid.c_str(), "nuclear test"));
+
+    TogglAutocompleteView *first =
+        toggl_autocomplete_query(app.ctx(), kAutocompleteTimeEntry,
+                                 "nucl", 10);
+    ASSERT_TRUE(first);
+    ASSERT_EQ("nuclear test", std::string(first->Description));
+    toggl_autocomplete_clear(first);
+
+    // Follows changes to the time entries
+    ASSERT_TRUE(toggl_set_time_entry_description(app.ctx(),
+                guid.c_str(), "atomic test"));
+    first = toggl_autocomplete_query(app.ctx(), kAutocompleteTimeEntry,
+                                     "nucl", 10);
+    ASSERT_FALSE(first);
+    first = toggl_autocomplete_query(app.ctx(), kAutocompleteTimeEntry,
+                                     "atom", 10);
+    ASSERT_TRUE(first);
+    toggl_autocomplete_clear(first);
+
+    ASSERT_FALSE(toggl_autocomplete_query(app.ctx(), 3, "test", 10));
+}
+
+TEST(toggl_api, toggl_context_clear_saves_buffered_data) {
+    std::string guid = "07fba193-91c4-0ec8-2894-820df0548a8f";
+    Poco::UInt64 start = time(0) - 600;
+
+    {
+        testing::App app;
+        std::string json = loadTestData();
+        ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+        ASSERT_TRUE(toggl_timeline_toggle_recording(app.ctx(), true));
+
+        // Fewer than kTimelineBufferSize, nothing is saved yet
+        for (int i = 0; i < 3; i++) {
+            std::stringstream title;
+            title << "buffered " << i;
+            TimelineEvent *event = new TimelineEvent();
+            event->SetFilename("editor");
+            event->SetTitle(title.str());
+            event->SetStart(start + i * 10);
+            event->SetEndTime(start + i * 10 + 5);
+            ASSERT_EQ(noError, ::app(app.ctx())->StartTimelineEvent(event));
+        }
+
+        ASSERT_TRUE(toggl_set_time_entry_description(app.ctx(),
+                    guid.c_str(), "saved on shutdown"));
+    }
+
+    Database db(TESTDB);
+    User user;
+    ASSERT_EQ(noError, db.LoadUserByID(10471231, &user));
+
+    TimeEntry *te = user.related.TimeEntryByGUID(guid);
+    ASSERT_TRUE(te);
+    ASSERT_EQ("saved on shutdown", te->Description());
+
+    std::set<std::string> titles;
+    for (std::vector<TimelineEvent *>::const_iterator it =
+        user.related.TimelineEvents.begin();
+            it != user.related.TimelineEvents.end(); it++) {
+        titles.insert((*it)->Title());
+    }
+    ASSERT_TRUE(titles.count("buffered 0"));
+    ASSERT_TRUE(titles.count("buffered 1"));
+    ASSERT_TRUE(titles.count("buffered 2"));
+}
+
+TEST(toggl_api, toggl_burst_of_edits_is_saved_once) {
+    std::string guid = "07fba193-91c4-0ec8-2894-820df0548a8f";
+
+    {
+        testing::App app;
+        std::string json = loadTestData();
+        ASSERT_TRUE(testing_set_logged_in_user(app.ctx(), json.c_str()));
+
+        Context *ctx = ::app(app.ctx());
+        ASSERT_EQ(noError, ctx->Flush());
+        Poco::UInt64 written = ctx->SavesWritten();
+
+        for (int i = 0; i < 10; i++) {
+            std::stringstream description;
+            description << "edit " << i;
+            ASSERT_TRUE(toggl_set_time_entry_description(app.ctx(),
+                        guid.c_str(), description.str().c_str()));
+        }
+        ASSERT_EQ(noError, ctx->Flush());
+        ASSERT_EQ(written + 1, ctx->SavesWritten());
+
+        // Nothing left to write
+        ASSERT_EQ(noError, ctx->Flush());
+        ASSERT_EQ(written + 1, ctx->SavesWritten());
+
+        // Written when the persister is stopped
+        ASSERT_TRUE(toggl_set_time_entry_description(app.ctx(),
+                    guid.c_str(), "last edit"));
+    }
+
+    Database db(TESTDB);
+    User user;
+    ASSERT_EQ(noError, db.LoadUserByID(10471231, &user));
+
+    TimeEntry *te = user.related.TimeEntryByGUID(guid);
+    ASSERT_TRUE(te);
+    ASSERT_EQ("last edit", te->Description());
+}
+
 TEST(toggl_api, toggl_stop) {
     testing::App app;
     std::string json = loadTestData();
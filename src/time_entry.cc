@@ -13,6 +13,7 @@
 
 #include <sstream>
 #include <algorithm>
+#include <unordered_map>
 
 #include <json/json.h>  // NOLINT
 
@@ -21,6 +22,7 @@
 #include "Poco/DateTime.h"
 #include "Poco/LocalDateTime.h"
 #include "Poco/Logger.h"
+#include "Poco/Mutex.h"
 #include "Poco/NumberParser.h"
 #include "Poco/Timestamp.h"
 
@@ -239,21 +241,101 @@ void TimeEntry::SetTID(const Poco::UInt64 value) {
 
 static const char kTagSeparator = '\t';
 
-void TimeEntry::SetTags(const std::string tags) {
-    if (Tags() != tags) {
-        TagNames.clear();
-        if (!tags.empty()) {
-            std::stringstream ss(tags);
-            while (ss.good()) {
-                std::string tag;
-                getline(ss, tag, kTagSeparator);
-                TagNames.push_back(tag);
+struct InternedTags {
+    std::string Joined;
+    std::vector<std::string> Names;
+};
+
+namespace {
+
+// Distinct tag lists of the time entries, by joined string.
+// Entries hold on to their list, which is not changed once
+// interned, so it is read without locking. A list is dropped
+// with the last entry that has it.
+class TagPool {
+ public:
+    std::shared_ptr<const InternedTags> Intern(const std::string &joined) {
+        if (joined.empty()) {
+            return std::shared_ptr<const InternedTags>();
+        }
+
+        Poco::Mutex::ScopedLock lock(m_);
+        std::weak_ptr<const InternedTags> &entry = lists_[joined];
+        std::shared_ptr<const InternedTags> list = entry.lock();
+        if (list) {
+            return list;
+        }
+        InternedTags *tags = new InternedTags();
+        tags->Joined = joined;
+        std::stringstream ss(joined);
+        while (ss.good()) {
+            std::string tag;
+            getline(ss, tag, kTagSeparator);
+            tags->Names.push_back(tag);
+        }
+        list = std::shared_ptr<const InternedTags>(tags, Release(this));
+        entry = list;
+        return list;
+    }
+
+ private:
+    // Deleter of the lists, forgets them in the pool
+    class Release {
+     public:
+        explicit Release(TagPool *pool)
+            : pool_(pool) {}
+
+        void operator()(const InternedTags *tags) const {
+            pool_->release(tags);
+        }
+
+     private:
+        TagPool *pool_;
+    };
+
+    void release(const InternedTags *tags) {
+        {
+            Poco::Mutex::ScopedLock lock(m_);
+            std::unordered_map<std::string,
+                std::weak_ptr<const InternedTags> >::iterator it =
+                    lists_.find(tags->Joined);
+            // Unless the same tags were interned again meanwhile
+            if (it != lists_.end() && it->second.expired()) {
+                lists_.erase(it);
             }
         }
+        delete tags;
+    }
+
+    Poco::Mutex m_;
+    std::unordered_map<std::string,
+        std::weak_ptr<const InternedTags> > lists_;
+};
+
+TagPool &tagPool() {
+    // Never destroyed, time entries may outlive static objects
+    static TagPool *pool = new TagPool();
+    return *pool;
+}
+
+}  // namespace
+
+void TimeEntry::SetTags(const std::string tags) {
+    std::shared_ptr<const InternedTags> list = tagPool().Intern(tags);
+    if (tags_ != list) {
+        tags_ = list;
         SetDirty();
     }
 }
 
+const std::vector<std::string> &TimeEntry::TagNames() const {
+    static const std::vector<std::string> none;
+    if (!tags_) {
+        return none;
+    }
+    return tags_->Names;
+}
+
 void TimeEntry::SetPID(const Poco::UInt64 value) {
     if (pid_ != value) {
         pid_ = value;
@@ -318,18 +400,12 @@ void TimeEntry::SetProjectGUID(const std::string value) {
     }
 }
 
-const std::string TimeEntry::Tags() const {
-    std::stringstream ss;
-    for (std::vector<std::string>::const_iterator it =
-        TagNames.begin();
-            it != TagNames.end();
-            it++) {
-        if (it != TagNames.begin()) {
-            ss << kTagSeparator;
-        }
-        ss << *it;
+const std::string &TimeEntry::Tags() const {
+    static const std::string none("");
+    if (!tags_) {
+        return none;
     }
-    return ss.str();
+    return tags_->Joined;
 }
 
 std::string TimeEntry::StopString() const {
@@ -349,7 +425,7 @@ bool TimeEntry::IsToday() const {
            today.day() == datetime.day();
 }
 
-void TimeEntry::LoadFromJSON(Json::Value data) {
+void TimeEntry::LoadFromJSON(const Json::Value &data) {
     Json::Value modified = data["ui_modified_at"];
     Poco::UInt64 ui_modified_at(0);
     if (modified.isString()) {
@@ -442,8 +518,9 @@ Json::Value TimeEntry::SaveToJSON() const {
     n["created_with"] = Formatter::EscapeJSONString(CreatedWith());
 
     Json::Value tag_nodes;
-    for (std::vector<std::string>::const_iterator it = TagNames.begin();
-            it != TagNames.end();
+    const std::vector<std::string> &tag_names = TagNames();
+    for (std::vector<std::string>::const_iterator it = tag_names.begin();
+            it != tag_names.end();
             it++) {
         std::string tag_name = Formatter::EscapeJSONString(*it);
         tag_nodes.append(Json::Value(tag_name));
@@ -460,14 +537,17 @@ Poco::Int64 TimeEntry::RealDurationInSeconds() const {
 }
 
 void TimeEntry::loadTagsFromJSON(Json::Value list) {
-    TagNames.clear();
-
+    std::string tags("");
     for (unsigned int i = 0; i < list.size(); i++) {
         std::string tag = list[i].asString();
         if (!tag.empty()) {
-            TagNames.push_back(tag);
+            if (!tags.empty()) {
+                tags += kTagSeparator;
+            }
+            tags += tag;
         }
     }
+    tags_ = tagPool().Intern(tags);
 }
 
 std::string TimeEntry::ModelName() const {
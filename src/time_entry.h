@@ -3,6 +3,7 @@
 #ifndef SRC_TIME_ENTRY_H_
 #define SRC_TIME_ENTRY_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -14,6 +15,8 @@
 
 namespace toggl {
 
+struct InternedTags;
+
 class TimeEntry : public BaseModel, public TimedEvent {
  public:
     TimeEntry()
@@ -30,7 +33,8 @@ class TimeEntry : public BaseModel, public TimedEvent {
     , created_with_("")
     , project_guid_("")
     , unsynced_(false)
-    , last_start_at_(0) {}
+    , last_start_at_(0)
+    , tags_() {}
 
     virtual ~TimeEntry() {}
 
@@ -39,9 +43,12 @@ class TimeEntry : public BaseModel, public TimedEvent {
     }
     void SetLastStartAt(const Poco::UInt64 value);
 
-    std::vector<std::string> TagNames;
+    // Tags are interned, entries with the same tags share
+    // the names and the joined string. Null if there are none.
+    const std::vector<std::string> &TagNames() const;
 
-    const std::string Tags() const;
+    // Tag names joined with tabs
+    const std::string &Tags() const;
     void SetTags(const std::string tags);
 
     const Poco::UInt64 &WID() const {
@@ -126,7 +133,7 @@ class TimeEntry : public BaseModel, public TimedEvent {
     std::string ModelURL() const;
     std::string String() const;
     virtual bool ResolveError(const error err);
-    void LoadFromJSON(Json::Value value);
+    void LoadFromJSON(const Json::Value &value);
     Json::Value SaveToJSON() const;
 
     // Implement TimedEvent
@@ -151,6 +158,7 @@ class TimeEntry : public BaseModel, public TimedEvent {
     std::string project_guid_;
     bool unsynced_;
     Poco::UInt64 last_start_at_;
+    std::shared_ptr<const InternedTags> tags_;
 
     bool setDurationStringHHMMSS(const std::string value);
     bool setDurationStringHHMM(const std::string value);
@@ -2,11 +2,29 @@
 
 #include "../src/timeline_event.h"
 
-#include <sstream>
 #include <cstring>
+#include <functional>
+#include <sstream>
+
+#include "./const.h"
 
 namespace toggl {
 
+TimelineChunkKey::TimelineChunkKey(const TimelineEvent &event)
+    : Filename(event.Filename())
+, Title(event.Title())
+, Idle(event.Idle())
+, ChunkStart(
+      (event.Start() / kTimelineChunkSeconds) * kTimelineChunkSeconds) {}
+
+size_t TimelineChunkKeyHash::operator()(const TimelineChunkKey &key) const {
+    std::hash<std::string> hash_string;
+    size_t hash = hash_string(key.Filename);
+    hash = hash * 31 + hash_string(key.Title);
+    hash = hash * 31 + static_cast<size_t>(key.ChunkStart);
+    return hash * 2 + key.Idle;
+}
+
 std::string TimelineEvent::String() const {
     std::stringstream ss;
     ss << "TimelineEvent"
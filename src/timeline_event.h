@@ -89,6 +89,31 @@ class TimelineEvent : public BaseModel, public TimedEvent {
     bool uploaded_;
 };
 
+// Timeline events of the same app, window title and idleness
+// that start in the same kTimelineChunkSeconds period are
+// uploaded as one event, the chunk.
+class TimelineChunkKey {
+ public:
+    explicit TimelineChunkKey(const TimelineEvent &event);
+
+    bool operator==(const TimelineChunkKey &other) const {
+        return ChunkStart == other.ChunkStart
+               && Idle == other.Idle
+               && Title == other.Title
+               && Filename == other.Filename;
+    }
+
+    std::string Filename;
+    std::string Title;
+    bool Idle;
+    Poco::UInt64 ChunkStart;
+};
+
+class TimelineChunkKeyHash {
+ public:
+    size_t operator()(const TimelineChunkKey &key) const;
+};
+
 }  // namespace toggl
 
 #endif  // SRC_TIMELINE_EVENT_H_
@@ -19,7 +19,9 @@ class TimelineBatch {
     TimelineBatch()
         : user_id_(0)
     , api_token_("")
-    , desktop_id_("") {}
+    , desktop_id_("")
+    , cursor_(0)
+    , limit_(0) {}
 
     ~TimelineBatch() {}
 
@@ -51,11 +53,30 @@ class TimelineBatch {
         desktop_id_ = value;
     }
 
+    // Where to continue looking for events of the next page,
+    // zero when starting a new round of uploads
+    const Poco::UInt64 &Cursor() const {
+        return cursor_;
+    }
+    void SetCursor(const Poco::UInt64 value) {
+        cursor_ = value;
+    }
+
+    // Page size, zero for no limit
+    const Poco::UInt64 &Limit() const {
+        return limit_;
+    }
+    void SetLimit(const Poco::UInt64 value) {
+        limit_ = value;
+    }
+
  private:
     Poco::UInt64 user_id_;
     std::string api_token_;
     std::vector<TimelineEvent> events_;
     std::string desktop_id_;
+    Poco::UInt64 cursor_;
+    Poco::UInt64 limit_;
 };
 
 class TimelineDatasource {
@@ -69,7 +90,8 @@ class TimelineDatasource {
     // or there's an idle event.
     virtual error StartTimelineEvent(TimelineEvent *event) = 0;
 
-    // Find timeline events for upload,
+    // Find a page of timeline events for upload,
+    // see TimelineBatch::Cursor and TimelineBatch::Limit
     virtual error CreateCompressedTimelineBatchForUpload(
         TimelineBatch *batch) = 0;
 
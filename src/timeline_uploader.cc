@@ -2,6 +2,7 @@
 
 #include "../src/timeline_uploader.h"
 
+#include <cstdio>
 #include <sstream>
 #include <string>
 
@@ -9,12 +10,10 @@
 #include "./https_client.h"
 #include "./urls.h"
 
+#include "Poco/DeflatingStream.h"
 #include "Poco/Foundation.h"
-#include "Poco/Thread.h"
 #include "Poco/Util/Application.h"
 
-#include <json/json.h>  // NOLINT
-
 namespace toggl {
 
 Poco::Logger &TimelineUploader::logger() const {
@@ -22,13 +21,8 @@ Poco::Logger &TimelineUploader::logger() const {
 }
 
 void TimelineUploader::sleep() {
-    // Sleep in increments for faster shutdown.
-    for (unsigned int i = 0; i < current_upload_interval_seconds_*4; i++) {
-        if (uploading_.isStopped()) {
-            return;
-        }
-        Poco::Thread::sleep(250);
-    }
+    // Shutdown() wakes us up
+    stop_requested_.tryWait(current_upload_interval_seconds_ * 1000);
 }
 
 void TimelineUploader::upload_loop_activity() {
@@ -53,37 +47,58 @@ error TimelineUploader::process() {
         return noError;
     }
 
-    TimelineBatch batch;
-    error err = timeline_datasource_->CreateCompressedTimelineBatchForUpload(
-        &batch);
-    if (err != noError) {
-        return err;
-    }
+    // Events are uploaded page by page. Each page is marked as
+    // uploaded right away, so a failing page does not lose the
+    // progress made by the ones before it.
+    Poco::UInt64 cursor(0);
+    while (!uploading_.isStopped()) {
+        TimelineBatch batch;
+        batch.SetCursor(cursor);
+        batch.SetLimit(page_size_);
+        error err =
+            timeline_datasource_->CreateCompressedTimelineBatchForUpload(
+                &batch);
+        if (err != noError) {
+            return err;
+        }
 
-    if (!batch.Events().size()) {
-        return noError;
-    }
+        if (!batch.Events().size()) {
+            return noError;
+        }
 
-    if (uploading_.isStopped()) {
-        return noError;
-    }
+        if (uploading_.isStopped()) {
+            return noError;
+        }
 
-    err = upload(&batch);
-    if (err != noError) {
-        backoff();
-        return err;
-    }
+        err = upload(&batch);
+        if (err != noError) {
+            backoff();
+            return err;
+        }
 
-    {
-        std::stringstream out;
-        out << "Sync of " << batch.Events().size()
-            << " event(s) was successful.";
-        logger().debug(out.str());
-    }
+        {
+            std::stringstream out;
+            out << "Sync of " << batch.Events().size()
+                << " event(s) was successful.";
+            logger().debug(out.str());
+        }
 
-    reset_backoff();
+        reset_backoff();
+
+        err = timeline_datasource_->MarkTimelineBatchAsUploaded(
+            batch.Events());
+        if (err != noError) {
+            return err;
+        }
 
-    return timeline_datasource_->MarkTimelineBatchAsUploaded(batch.Events());
+        if (batch.Events().size() < page_size_) {
+            return noError;
+        }
+
+        cursor = batch.Cursor();
+    }
+
+    return noError;
 }
 
 error TimelineUploader::upload(TimelineBatch *batch) {
@@ -94,38 +109,113 @@ error TimelineUploader::upload(TimelineBatch *batch) {
        << " event(s) of user " << batch->UserID();
     logger().debug(ss.str());
 
-    std::string json = convertTimelineToJSON(
-        batch->Events(),
-        batch->DesktopID());
-    logger().trace(json);
-
     HTTPSRequest req;
     req.host = urls::TimelineUpload();
     req.relative_url = "/api/v8/timeline";
-    req.payload = json;
+    req.payload = compressTimelineJSON(batch->Events(), batch->DesktopID());
+    req.payload_gzipped = true;
     req.basic_auth_username = batch->APIToken();
     req.basic_auth_password = "api_token";
 
     return client.Post(req).err;
 }
 
-std::string convertTimelineToJSON(
+namespace {
+
+void writeJSONString(const std::string &value, std::ostream *out) {
+    out->put('"');
+    std::string::size_type written(0);
+    for (std::string::size_type i = 0; i < value.size(); i++) {
+        const unsigned char c = value[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        out->write(value.data() + written, i - written);
+        written = i + 1;
+        switch (c) {
+        case '"':
+            *out << "\\\"";
+            break;
+        case '\\':
+            *out << "\\\\";
+            break;
+        case '\b':
+            *out << "\\b";
+            break;
+        case '\f':
+            *out << "\\f";
+            break;
+        case '\n':
+            *out << "\\n";
+            break;
+        case '\r':
+            *out << "\\r";
+            break;
+        case '\t':
+            *out << "\\t";
+            break;
+        default:
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            *out << escaped;
+        }
+    }
+    out->write(value.data() + written, value.size() - written);
+    out->put('"');
+}
+
+}  // namespace
+
+void writeTimelineJSON(
     const std::vector<TimelineEvent> &timeline_events,
-    const std::string &desktop_id) {
+    const std::string &desktop_id,
+    std::ostream *out) {
 
-    Json::Value root;
+    poco_check_ptr(out);
 
+    // Same fields as TimelineEvent::SaveToJSON, without building
+    // a JSON tree of the whole batch first
+    out->put('[');
     for (std::vector<TimelineEvent>::const_iterator i = timeline_events.begin();
             i != timeline_events.end();
             ++i) {
-        TimelineEvent event = *i;
-        Json::Value n = event.SaveToJSON();
-        n["desktop_id"] = desktop_id;
-        root.append(n);
+        if (i != timeline_events.begin()) {
+            out->put(',');
+        }
+        *out << "{\"guid\":";
+        writeJSONString(i->GUID(), out);
+        *out << ",\"filename\":";
+        writeJSONString(i->Filename(), out);
+        *out << ",\"title\":";
+        writeJSONString(i->Title(), out);
+        *out << ",\"start_time\":" << i->Start()
+             << ",\"end_time\":" << i->EndTime()
+             << ",\"created_with\":\"timeline\",\"desktop_id\":";
+        writeJSONString(desktop_id, out);
+        out->put('}');
     }
+    out->put(']');
+}
+
+std::string convertTimelineToJSON(
+    const std::vector<TimelineEvent> &timeline_events,
+    const std::string &desktop_id) {
+
+    std::stringstream json;
+    writeTimelineJSON(timeline_events, desktop_id, &json);
+    return json.str();
+}
+
+std::string compressTimelineJSON(
+    const std::vector<TimelineEvent> &timeline_events,
+    const std::string &desktop_id) {
 
-    Json::StyledWriter writer;
-    return writer.write(root);
+    std::stringstream compressed;
+    Poco::DeflatingOutputStream gzip(
+        compressed, Poco::DeflatingStreamBuf::STREAM_GZIP);
+    writeTimelineJSON(timeline_events, desktop_id, &gzip);
+    gzip.close();
+    return compressed.str();
 }
 
 void TimelineUploader::backoff() {
@@ -162,6 +252,7 @@ error TimelineUploader::Shutdown() {
     try {
         if (uploading_.isRunning()) {
             uploading_.stop();
+            stop_requested_.set();
             uploading_.wait();
         }
     } catch(const Poco::Exception& exc) {
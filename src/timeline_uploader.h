@@ -3,6 +3,7 @@
 #ifndef SRC_TIMELINE_UPLOADER_H_
 #define SRC_TIMELINE_UPLOADER_H_
 
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -11,6 +12,7 @@
 #include "./types.h"
 
 #include "Poco/Activity.h"
+#include "Poco/Event.h"
 
 namespace Poco {
 class Logger;
@@ -22,10 +24,24 @@ std::string convertTimelineToJSON(
     const std::vector<TimelineEvent> &timeline_events,
     const std::string &desktop_id);
 
+// Writes compact JSON of the events straight into out
+void writeTimelineJSON(
+    const std::vector<TimelineEvent> &timeline_events,
+    const std::string &desktop_id,
+    std::ostream *out);
+
+// Gzip compressed JSON of the events, as uploaded
+std::string compressTimelineJSON(
+    const std::vector<TimelineEvent> &timeline_events,
+    const std::string &desktop_id);
+
 class TimelineUploader {
  public:
-    explicit TimelineUploader(TimelineDatasource *ds)
+    explicit TimelineUploader(
+        TimelineDatasource *ds,
+        const Poco::UInt64 page_size = kTimelineUploadPageSize)
         : current_upload_interval_seconds_(kTimelineUploadIntervalSeconds)
+    , page_size_(page_size)
     , timeline_datasource_(ds)
     , uploading_(this, &TimelineUploader::upload_loop_activity) {
         start();
@@ -52,6 +68,9 @@ class TimelineUploader {
     void backoff();
     void reset_backoff();
 
+    // How many events to upload at most in one request
+    Poco::UInt64 page_size_;
+
     Poco::Logger &logger() const;
 
     error process();
@@ -62,6 +81,9 @@ class TimelineUploader {
     // An Activity is a possibly long running void/no arguments
     // member function running in its own thread.
     Poco::Activity<TimelineUploader> uploading_;
+
+    // Set when the activity is stopped, to cut its sleep short
+    Poco::Event stop_requested_;
 };
 
 }  // namespace toggl
@@ -831,6 +831,22 @@ uint64_t toggl_get_default_task_id(
     return ret;
 }
 
+TogglAutocompleteView *toggl_autocomplete_query(
+    void *context,
+    const uint64_t kind,
+    const char_t *text,
+    const uint64_t limit) {
+    std::vector<toggl::view::Autocomplete> items;
+    app(context)->AutocompleteQuery(
+        kind, to_string(text), limit, &items);
+    return autocomplete_view_list_init(items);
+}
+
+void toggl_autocomplete_clear(
+    TogglAutocompleteView *first) {
+    autocomplete_view_list_clear(first);
+}
+
 bool_t toggl_set_update_channel(
     void *context,
     const char_t *update_channel) {
@@ -959,6 +975,42 @@ void toggl_on_obm_experiment(
     app(context)->UI()->OnDisplayObmExperiment(cb);
 }
 
+void toggl_on_time_entry_list_array(
+    void *context,
+    TogglDisplayTimeEntryArray cb) {
+    app(context)->UI()->OnDisplayTimeEntryArray(cb);
+}
+
+void toggl_on_mini_timer_autocomplete_array(
+    void *context,
+    TogglDisplayAutocompleteArray cb) {
+    app(context)->UI()->OnDisplayMinitimerAutocompleteArray(cb);
+}
+
+void toggl_on_time_entry_autocomplete_array(
+    void *context,
+    TogglDisplayAutocompleteArray cb) {
+    app(context)->UI()->OnDisplayTimeEntryAutocompleteArray(cb);
+}
+
+void toggl_on_project_autocomplete_array(
+    void *context,
+    TogglDisplayAutocompleteArray cb) {
+    app(context)->UI()->OnDisplayProjectAutocompleteArray(cb);
+}
+
+void toggl_on_time_entry_list_diff(
+    void *context,
+    TogglDisplayTimeEntryListDiff cb) {
+    app(context)->UI()->OnDisplayTimeEntryListDiff(cb);
+}
+
+void toggl_on_data_complete(
+    void *context,
+    TogglDisplayDataComplete cb) {
+    app(context)->UI()->OnDisplayDataComplete(cb);
+}
+
 void toggl_set_sleep(void *context) {
     app(context)->SetSleep();
 }
@@ -1068,6 +1120,11 @@ void toggl_debug(const char_t *text) {
     logger().debug(to_string(text));
 }
 
+char_t *toggl_database_maintenance_report(
+    void *context) {
+    return copy_string(app(context)->DatabaseMaintenanceReport());
+}
+
 char_t *toggl_check_view_struct_size(
     const int time_entry_view_item_size,
     const int autocomplete_view_item_size,
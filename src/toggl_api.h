@@ -39,6 +39,15 @@ extern "C" {
 
 #define kPromotionJoinBetaChannel 1
 
+#define kTimeEntryListChangeRemove 0
+#define kTimeEntryListChangeInsert 1
+#define kTimeEntryListChangeMove 2
+#define kTimeEntryListChangeUpdate 3
+
+#define kAutocompleteTimeEntry 0
+#define kAutocompleteMinitimer 1
+#define kAutocompleteProject 2
+
 // Models
 
     typedef struct {
@@ -171,6 +180,19 @@ extern "C" {
         void *Next;
     } TogglTimelineEventView;
 
+    // Applied in order, changes turn the previously displayed
+    // time entry list into the current one. Removes come first.
+    typedef struct {
+        // kTimeEntryListChangeRemove, Insert, Move or Update
+        uint64_t Type;
+        // Position of the item after the change
+        uint64_t Index;
+        // Only for moves: position of the item before the move
+        uint64_t OldIndex;
+        // Current data of the item; not set for removes
+        TogglTimeEntryView *Item;
+    } TogglTimeEntryListChange;
+
     // Callbacks that need to be implemented in UI
 
     typedef void (*TogglDisplayApp)(
@@ -229,6 +251,34 @@ extern "C" {
     typedef void (*TogglDisplayAutocomplete)(
         TogglAutocompleteView *first);
 
+    // Array render mode: items are passed as one contiguous array,
+    // in the same order as the linked lists above (Next is set too).
+    // The array and its strings are reused for the next render,
+    // so they are only valid until the callback returns.
+    typedef void (*TogglDisplayTimeEntryArray)(
+        const bool_t open,
+        TogglTimeEntryView *items,
+        const uint64_t count,
+        const bool_t show_load_more_button);
+
+    typedef void (*TogglDisplayAutocompleteArray)(
+        TogglAutocompleteView *items,
+        const uint64_t count);
+
+    // Called instead of the full list when only some time entries
+    // have changed since the last render. The first render inserts
+    // every item. Valid only until the callback returns.
+    typedef void (*TogglDisplayTimeEntryListDiff)(
+        const bool_t open,
+        TogglTimeEntryListChange *changes,
+        const uint64_t count,
+        const bool_t show_load_more_button);
+
+    // Called once all of the user data has been loaded at startup.
+    // Before that, only the data for the first screen is available.
+    typedef void (*TogglDisplayDataComplete)(
+        const uint64_t user_id);
+
     typedef void (*TogglDisplayHelpArticles)(
         TogglHelpArticleView *first);
 
@@ -453,6 +503,32 @@ extern "C" {
         void *context,
         TogglDisplayObmExperiment cb);
 
+    // When set, these are used instead of the linked list callbacks
+
+    TOGGL_EXPORT void toggl_on_time_entry_list_array(
+        void *context,
+        TogglDisplayTimeEntryArray cb);
+
+    TOGGL_EXPORT void toggl_on_mini_timer_autocomplete_array(
+        void *context,
+        TogglDisplayAutocompleteArray cb);
+
+    TOGGL_EXPORT void toggl_on_time_entry_autocomplete_array(
+        void *context,
+        TogglDisplayAutocompleteArray cb);
+
+    TOGGL_EXPORT void toggl_on_project_autocomplete_array(
+        void *context,
+        TogglDisplayAutocompleteArray cb);
+
+    TOGGL_EXPORT void toggl_on_time_entry_list_diff(
+        void *context,
+        TogglDisplayTimeEntryListDiff cb);
+
+    TOGGL_EXPORT void toggl_on_data_complete(
+        void *context,
+        TogglDisplayDataComplete cb);
+
     // After UI callbacks are configured, start pumping UI events
 
     TOGGL_EXPORT bool_t toggl_ui_start(
@@ -801,6 +877,19 @@ extern "C" {
     TOGGL_EXPORT uint64_t toggl_get_default_task_id(
         void *context);
 
+    // Best matches for typed text among the autocomplete items of
+    // kind kAutocompleteTimeEntry, Minitimer or Project,
+    // at most limit of them. Free the result with
+    // toggl_autocomplete_clear
+    TOGGL_EXPORT TogglAutocompleteView *toggl_autocomplete_query(
+        void *context,
+        const uint64_t kind,
+        const char_t *text,
+        const uint64_t limit);
+
+    TOGGL_EXPORT void toggl_autocomplete_clear(
+        TogglAutocompleteView *first);
+
     TOGGL_EXPORT bool_t toggl_set_update_channel(
         void *context,
         const char_t *update_channel);
@@ -863,6 +952,11 @@ extern "C" {
     TOGGL_EXPORT void toggl_debug(
         const char_t *text);
 
+    // Start and end time, purged rows and reclaimed pages of the
+    // last background database maintenance, you must free() the result
+    TOGGL_EXPORT char_t *toggl_database_maintenance_report(
+        void *context);
+
     // Check if sizeof view struct matches those in UI
     // Else stuff blows up when Marshalling in C#
     // Will return error string if size is invalid,
@@ -467,6 +467,13 @@ static int l_toggl_debug(lua_State *L) {
     return 0;
 }
 
+static int l_toggl_database_maintenance_report(lua_State *L) {
+    char_t *str = toggl_database_maintenance_report(toggl_app_instance_);
+    pushstring(L, str);
+    free(str);
+    return 1;
+}
+
 static int l_testing_sleep(lua_State *L) {
     testing_sleep(
         static_cast<int>(lua_tointeger(L, -1)));
@@ -745,6 +752,7 @@ static const struct luaL_Reg toggl_f[] = {
         l_toggl_format_tracked_time_duration
     },
     {"debug", l_toggl_debug},
+    {"database_maintenance_report", l_toggl_database_maintenance_report},
     {"sleep", l_testing_sleep},
     {"set_logged_in_user", l_testing_set_logged_in_user},
     {"autotracker_add_rule", l_toggl_autotracker_add_rule},
@@ -15,69 +15,105 @@
 #include "Poco/Logger.h"
 #include "Poco/UnicodeConverter.h"
 
-TogglAutocompleteView *autocomplete_item_init(
-    const toggl::view::Autocomplete item) {
-    TogglAutocompleteView *result = new TogglAutocompleteView();
-    result->Description = copy_string(item.Description);
-    result->Text = copy_string(item.Text);
-    result->ProjectAndTaskLabel = copy_string(item.ProjectAndTaskLabel);
-    result->TaskLabel = copy_string(item.TaskLabel);
-    result->ProjectLabel = copy_string(item.ProjectLabel);
-    result->ClientLabel = copy_string(item.ClientLabel);
-    result->ProjectColor = copy_string(item.ProjectColor);
+namespace {
+
+// Copies each string to its own heap block,
+// to be freed when the view is cleared.
+class HeapStrings {
+ public:
+    void SetString(char_t **field, const std::string &value) {
+        *field = copy_string(value);
+    }
+};
+
+// Counts the characters a view's strings need in a ViewArena.
+// A UTF-8 string never converts to more UTF-16 characters than
+// it has bytes, so this is enough on Windows too.
+class StringsSize {
+ public:
+    StringsSize()
+        : Size(0) {}
+
+    void SetString(char_t **field, const std::string &value) {
+        Size += value.size() + 1;
+    }
+
+    size_t Size;
+};
+
+template <typename Strings>
+void autocomplete_item_fill(
+    const toggl::view::Autocomplete &item,
+    TogglAutocompleteView *result,
+    Strings *strings) {
+    strings->SetString(&result->Description, item.Description);
+    strings->SetString(&result->Text, item.Text);
+    strings->SetString(&result->ProjectAndTaskLabel,
+                       item.ProjectAndTaskLabel);
+    strings->SetString(&result->TaskLabel, item.TaskLabel);
+    strings->SetString(&result->ProjectLabel, item.ProjectLabel);
+    strings->SetString(&result->ClientLabel, item.ClientLabel);
+    strings->SetString(&result->ProjectColor, item.ProjectColor);
     result->TaskID = static_cast<unsigned int>(item.TaskID);
     result->ProjectID = static_cast<unsigned int>(item.ProjectID);
     result->WorkspaceID = static_cast<unsigned int>(item.WorkspaceID);
     result->Type = static_cast<unsigned int>(item.Type);
-    result->Tags = copy_string(item.Tags);
-    result->WorkspaceName = copy_string(item.WorkspaceName);
+    strings->SetString(&result->Tags, item.Tags);
+    strings->SetString(&result->WorkspaceName, item.WorkspaceName);
     result->ClientID = static_cast<unsigned int>(item.ClientID);
-    result->Next = nullptr;
-    return result;
 }
 
-void autocomplete_item_clear(TogglAutocompleteView *item) {
-    if (!item) {
-        return;
+template <typename Strings>
+void time_entry_view_item_fill(
+    const toggl::view::TimeEntry &te,
+    TogglTimeEntryView *view_item,
+    Strings *strings) {
+    view_item->DurationInSeconds = static_cast<int>(te.DurationInSeconds);
+    strings->SetString(&view_item->Description, te.Description);
+    strings->SetString(&view_item->GUID, te.GUID);
+    view_item->WID = static_cast<unsigned int>(te.WID);
+    view_item->TID = static_cast<unsigned int>(te.TID);
+    view_item->PID = static_cast<unsigned int>(te.PID);
+    strings->SetString(&view_item->Duration, te.Duration);
+    view_item->Started = static_cast<unsigned int>(te.Started);
+    view_item->Ended = static_cast<unsigned int>(te.Ended);
+    strings->SetString(&view_item->WorkspaceName, te.WorkspaceName);
+    strings->SetString(&view_item->ProjectAndTaskLabel,
+                       te.ProjectAndTaskLabel);
+    strings->SetString(&view_item->TaskLabel, te.TaskLabel);
+    strings->SetString(&view_item->ProjectLabel, te.ProjectLabel);
+    strings->SetString(&view_item->ClientLabel, te.ClientLabel);
+    strings->SetString(&view_item->Color, te.Color);
+    strings->SetString(&view_item->StartTimeString, te.StartTimeString);
+    strings->SetString(&view_item->EndTimeString, te.EndTimeString);
+    strings->SetString(&view_item->DateDuration, te.DateDuration);
+    view_item->Billable = te.Billable;
+    if (te.Tags.empty()) {
+        view_item->Tags = nullptr;
+    } else {
+        strings->SetString(&view_item->Tags, te.Tags);
     }
+    view_item->UpdatedAt = static_cast<unsigned int>(te.UpdatedAt);
+    strings->SetString(&view_item->DateHeader, te.DateHeader);
+    view_item->DurOnly = te.DurOnly;
+    view_item->IsHeader = false;
 
-    free(item->Text);
-    item->Text = nullptr;
-
-    free(item->ProjectAndTaskLabel);
-    item->ProjectAndTaskLabel = nullptr;
-
-    free(item->TaskLabel);
-    item->TaskLabel = nullptr;
-
-    free(item->ProjectLabel);
-    item->ProjectLabel = nullptr;
-
-    free(item->ClientLabel);
-    item->ClientLabel = nullptr;
-
-    free(item->Description);
-    item->Description = nullptr;
-
-    free(item->ProjectColor);
-    item->ProjectColor = nullptr;
-
-    free(item->Tags);
-    item->Tags = nullptr;
+    view_item->CanAddProjects = te.CanAddProjects;
+    view_item->CanSeeBillable = te.CanSeeBillable;
+    view_item->DefaultWID = te.DefaultWID;
 
-    free(item->WorkspaceName);
-    item->WorkspaceName = nullptr;
+    view_item->Unsynced = te.Unsynced;
+    view_item->Locked = te.Locked;
 
-    if (item->Next) {
-        TogglAutocompleteView *next =
-            reinterpret_cast<TogglAutocompleteView *>(item->Next);
-        autocomplete_item_clear(next);
-        item->Next = nullptr;
+    if (te.Error != toggl::noError) {
+        strings->SetString(&view_item->Error, te.Error);
+    } else {
+        view_item->Error = nullptr;
     }
-
-    delete item;
 }
 
+}  // namespace
+
 TogglGenericView *generic_to_view_item_list(
     const std::vector<toggl::view::Generic> list) {
     TogglGenericView *first = nullptr;
@@ -197,51 +233,47 @@ TogglTimeEntryView *time_entry_view_item_init(
     TogglTimeEntryView *view_item = new TogglTimeEntryView();
     poco_check_ptr(view_item);
 
-    view_item->DurationInSeconds = static_cast<int>(te.DurationInSeconds);
-    view_item->Description = copy_string(te.Description);
-    view_item->GUID = copy_string(te.GUID);
-    view_item->WID = static_cast<unsigned int>(te.WID);
-    view_item->TID = static_cast<unsigned int>(te.TID);
-    view_item->PID = static_cast<unsigned int>(te.PID);
-    view_item->Duration = copy_string(te.Duration);
-    view_item->Started = static_cast<unsigned int>(te.Started);
-    view_item->Ended = static_cast<unsigned int>(te.Ended);
-    view_item->WorkspaceName = copy_string(te.WorkspaceName);
-    view_item->ProjectAndTaskLabel = copy_string(te.ProjectAndTaskLabel);
-    view_item->TaskLabel = copy_string(te.TaskLabel);
-    view_item->ProjectLabel = copy_string(te.ProjectLabel);
-    view_item->ClientLabel = copy_string(te.ClientLabel);
-    view_item->Color = copy_string(te.Color);
-    view_item->StartTimeString = copy_string(te.StartTimeString);
-    view_item->EndTimeString = copy_string(te.EndTimeString);
-    view_item->DateDuration = copy_string(te.DateDuration);
-    view_item->Billable = te.Billable;
-    if (te.Tags.empty()) {
-        view_item->Tags = nullptr;
-    } else {
-        view_item->Tags = copy_string(te.Tags.c_str());
-    }
-    view_item->UpdatedAt = static_cast<unsigned int>(te.UpdatedAt);
-    view_item->DateHeader = copy_string(te.DateHeader);
-    view_item->DurOnly = te.DurOnly;
-    view_item->IsHeader = false;
+    HeapStrings strings;
+    time_entry_view_item_fill(te, view_item, &strings);
 
-    view_item->CanAddProjects = te.CanAddProjects;
-    view_item->CanSeeBillable = te.CanSeeBillable;
-    view_item->DefaultWID = te.DefaultWID;
+    view_item->Next = nullptr;
 
-    view_item->Unsynced = te.Unsynced;
-    view_item->Locked = te.Locked;
+    return view_item;
+}
 
-    if (te.Error != toggl::noError) {
-        view_item->Error = copy_string(te.Error);
-    } else {
-        view_item->Error = nullptr;
+TogglTimeEntryView *time_entry_view_items_init(
+    ViewArena<TogglTimeEntryView> *arena,
+    const std::vector<const toggl::view::TimeEntry *> &items) {
+    TogglTimeEntryView *first = arena->Reset(items.size());
+    StringsSize size;
+    for (size_t i = 0; i < items.size(); i++) {
+        time_entry_view_item_fill(*items[i], first + i, &size);
     }
+    arena->Reserve(size.Size);
+    for (size_t i = 0; i < items.size(); i++) {
+        time_entry_view_item_fill(*items[i], first + i, arena);
+    }
+    return first;
+}
 
-    view_item->Next = nullptr;
-
-    return view_item;
+TogglTimeEntryView *time_entry_view_list_init(
+    ViewArena<TogglTimeEntryView> *arena,
+    const std::vector<toggl::view::TimeEntry> &list) {
+    TogglTimeEntryView *first = arena->Reset(list.size());
+    const size_t count = list.size();
+    StringsSize size;
+    for (size_t i = 0; i < count; i++) {
+        time_entry_view_item_fill(list[i], first + i, &size);
+    }
+    arena->Reserve(size.Size);
+    for (size_t i = 0; i < count; i++) {
+        const toggl::view::TimeEntry &te = list[count - 1 - i];
+        time_entry_view_item_fill(te, first + i, arena);
+        // First entry of each day is the header of that day
+        first[i].IsHeader = !i
+                            || te.DateHeader != list[count - i].DateHeader;
+    }
+    return first;
 }
 
 void time_entry_view_item_clear(
@@ -369,19 +401,52 @@ void settings_view_item_clear(TogglSettingsView *view) {
 }
 
 TogglAutocompleteView *autocomplete_list_init(
-    std::vector<toggl::view::Autocomplete> *items) {
+    ViewArena<TogglAutocompleteView> *arena,
+    const std::vector<toggl::view::Autocomplete> &items) {
+    TogglAutocompleteView *first = arena->Reset(items.size());
+    StringsSize size;
+    for (size_t i = 0; i < items.size(); i++) {
+        autocomplete_item_fill(items[i], first + i, &size);
+    }
+    arena->Reserve(size.Size);
+    for (size_t i = 0; i < items.size(); i++) {
+        autocomplete_item_fill(items[i], first + i, arena);
+    }
+    return first;
+}
+
+TogglAutocompleteView *autocomplete_view_list_init(
+    const std::vector<toggl::view::Autocomplete> &items) {
     TogglAutocompleteView *first = nullptr;
+    HeapStrings strings;
     for (std::vector<toggl::view::Autocomplete>::const_reverse_iterator it =
-        items->rbegin();
-            it != items->rend();
-            it++) {
-        TogglAutocompleteView *item = autocomplete_item_init(*it);
+        items.rbegin(); it != items.rend(); it++) {
+        TogglAutocompleteView *item = new TogglAutocompleteView();
+        autocomplete_item_fill(*it, item, &strings);
         item->Next = first;
         first = item;
     }
     return first;
 }
 
+void autocomplete_view_list_clear(TogglAutocompleteView *first) {
+    while (first) {
+        TogglAutocompleteView *next =
+            reinterpret_cast<TogglAutocompleteView *>(first->Next);
+        free(first->Description);
+        free(first->Text);
+        free(first->ProjectAndTaskLabel);
+        free(first->TaskLabel);
+        free(first->ProjectLabel);
+        free(first->ClientLabel);
+        free(first->ProjectColor);
+        free(first->Tags);
+        free(first->WorkspaceName);
+        delete first;
+        first = next;
+    }
+}
+
 TogglHelpArticleView *help_artice_init(
     const toggl::HelpArticle item) {
     TogglHelpArticleView *result = new TogglHelpArticleView();
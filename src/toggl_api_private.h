@@ -3,6 +3,8 @@
 #ifndef SRC_TOGGL_API_PRIVATE_H_
 #define SRC_TOGGL_API_PRIVATE_H_
 
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -12,6 +14,10 @@
 #include "./settings.h"
 #include "./toggl_api.h"
 
+#if defined(_WIN32) || defined(WIN32)
+#include "Poco/UnicodeConverter.h"
+#endif
+
 namespace Poco {
 class Logger;
 }
@@ -29,6 +35,72 @@ class TimeEntry;
 }
 }  // namespace toggl
 
+// Holds the views of a rendered list in one array, and their strings
+// in one block. Both are reused between renders, so once they have
+// grown to fit the list, rendering it again allocates nothing.
+template <typename T>
+class ViewArena {
+ public:
+    ViewArena()
+        : strings_(nullptr)
+    , strings_size_(0)
+    , strings_used_(0) {}
+    ~ViewArena() {
+        free(strings_);
+    }
+
+    // Returns count empty views, linked to each other with Next
+    T *Reset(const size_t count) {
+        strings_used_ = 0;
+        if (!count) {
+            items_.clear();
+            return nullptr;
+        }
+        items_.resize(count);
+        memset(&items_[0], 0, count * sizeof(T));
+        for (size_t i = 1; i < count; i++) {
+            items_[i - 1].Next = &items_[i];
+        }
+        return &items_[0];
+    }
+
+    // Makes room for size characters of strings, including
+    // terminators. Must be called before SetString.
+    void Reserve(const size_t size) {
+        if (size > strings_size_) {
+            free(strings_);
+            strings_ = reinterpret_cast<char_t *>(
+                malloc(size * sizeof(char_t)));
+            strings_size_ = size;
+        }
+    }
+
+    void SetString(char_t **field, const std::string &value) {
+        *field = strings_ + strings_used_;
+#if defined(_WIN32) || defined(WIN32)
+        Poco::UnicodeConverter::toUTF16(value, wide_);
+        memcpy(*field, wide_.data(), wide_.size() * sizeof(char_t));
+        strings_used_ += wide_.size();
+#else
+        memcpy(*field, value.data(), value.size());
+        strings_used_ += value.size();
+#endif
+        strings_[strings_used_++] = 0;
+    }
+
+ private:
+    ViewArena(const ViewArena &);
+    ViewArena &operator=(const ViewArena &);
+
+    std::vector<T> items_;
+    char_t *strings_;
+    size_t strings_size_;
+    size_t strings_used_;
+#if defined(_WIN32) || defined(WIN32)
+    std::wstring wide_;
+#endif
+};
+
 int compare_string(const char_t *s1, const char_t *s2);
 char_t *copy_string(const std::string s);
 std::string to_string(const char_t *s);
@@ -44,16 +116,21 @@ TogglAutotrackerRuleView *autotracker_rule_to_view_item(
 
 void autotracker_view_item_clear(TogglAutotrackerRuleView *view);
 
-TogglAutocompleteView *autocomplete_item_init(
-    const toggl::view::Autocomplete item);
-
 void view_item_clear(TogglGenericView *item);
 
-void autocomplete_item_clear(TogglAutocompleteView *item);
-
 TogglTimeEntryView *time_entry_view_item_init(
     const toggl::view::TimeEntry &te);
 
+// Renders the items into the arena in the same order
+TogglTimeEntryView *time_entry_view_items_init(
+    ViewArena<TogglTimeEntryView> *arena,
+    const std::vector<const toggl::view::TimeEntry *> &items);
+
+// Renders the list into the arena, latest time entry first
+TogglTimeEntryView *time_entry_view_list_init(
+    ViewArena<TogglTimeEntryView> *arena,
+    const std::vector<toggl::view::TimeEntry> &list);
+
 void time_entry_view_item_clear(TogglTimeEntryView *item);
 
 TogglSettingsView *settings_view_item_init(
@@ -65,7 +142,14 @@ TogglSettingsView *settings_view_item_init(
 void settings_view_item_clear(TogglSettingsView *view);
 
 TogglAutocompleteView *autocomplete_list_init(
-    std::vector<toggl::view::Autocomplete> *items);
+    ViewArena<TogglAutocompleteView> *arena,
+    const std::vector<toggl::view::Autocomplete> &items);
+
+// Heap allocated list, for results returned to the caller
+TogglAutocompleteView *autocomplete_view_list_init(
+    const std::vector<toggl::view::Autocomplete> &items);
+
+void autocomplete_view_list_clear(TogglAutocompleteView *first);
 
 TogglHelpArticleView *help_article_list_init(
     const std::vector<toggl::HelpArticle> items);
@@ -28,7 +28,18 @@ std::string TimelineUpload() {
     return "https://timeline.toggl.com";
 }
 
+// Websocket URL that overrides the backend one
+
+std::string websocket_url_("");
+
+void SetWebSocketURL(const std::string value) {
+    websocket_url_ = value;
+}
+
 std::string WebSocket() {
+    if (!websocket_url_.empty()) {
+        return websocket_url_;
+    }
     if (use_staging_as_backend) {
         return "https://fubar-ws.toggl.com";
     }
@@ -15,6 +15,9 @@ std::string WebSocket();
 
 void SetUseStagingAsBackend(const bool value);
 
+// Overrides the websocket URL (like in benchmarks), empty to reset
+void SetWebSocketURL(const std::string value);
+
 bool RequestsAllowed();
 
 void SetRequestsAllowed(const bool value);
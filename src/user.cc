@@ -10,6 +10,7 @@
 #include "./const.h"
 #include "./formatter.h"
 #include "./https_client.h"
+#include "./json_stream.h"
 #include "./obm_action.h"
 #include "./project.h"
 #include "./tag.h"
@@ -49,6 +50,7 @@ Project *User::CreateProject(
     const std::string project_color) {
 
     Project *p = new Project();
+    p->EnsureGUID();
     p->SetWID(workspace_id);
     p->SetName(project_name);
     p->SetCID(client_id);
@@ -60,7 +62,7 @@ Project *User::CreateProject(
         p->SetColorCode(project_color);
     }
 
-    related.Projects.push_back(p);
+    related.Push(p);
 
     return p;
 }
@@ -69,10 +71,11 @@ Client *User::CreateClient(
     const Poco::UInt64 workspace_id,
     const std::string client_name) {
     Client *c = new Client();
+    c->EnsureGUID();
     c->SetWID(workspace_id);
     c->SetName(client_name);
     c->SetUID(ID());
-    related.Clients.push_back(c);
+    related.Push(c);
     return c;
 }
 
@@ -94,6 +97,8 @@ TimeEntry *User::Start(
     ss << "User::Start now=" << now;
 
     TimeEntry *te = new TimeEntry();
+    // The UI needs the GUID before the entry is saved
+    te->EnsureGUID();
     te->SetCreatedWith(HTTPSClient::Config.UserAgent());
     te->SetDescription(description);
     te->SetUID(ID());
@@ -138,7 +143,7 @@ TimeEntry *User::Start(
     te->SetDurOnly(!StoreStartAndStopTime());
     te->SetUIModified();
 
-    related.TimeEntries.push_back(te);
+    related.Push(te);
 
     return te;
 }
@@ -169,6 +174,7 @@ TimeEntry *User::Continue(
     }
 
     TimeEntry *result = new TimeEntry();
+    result->EnsureGUID();
     result->SetCreatedWith(HTTPSClient::Config.UserAgent());
     result->SetDescription(existing->Description());
     result->SetDurOnly(existing->DurOnly());
@@ -186,7 +192,7 @@ TimeEntry *User::Continue(
 
     result->SetCreatedWith(HTTPSClient::Config.UserAgent());
 
-    related.TimeEntries.push_back(result);
+    related.Push(result);
 
     return result;
 }
@@ -355,6 +361,7 @@ TimeEntry *User::DiscardTimeAt(
 
     if (te && split_into_new_entry) {
         TimeEntry *split = new TimeEntry();
+        split->EnsureGUID();
         split->SetCreatedWith(HTTPSClient::Config.UserAgent());
         split->SetDurOnly(te->DurOnly());
         split->SetUID(ID());
@@ -362,7 +369,7 @@ TimeEntry *User::DiscardTimeAt(
         split->SetDurationInSeconds(-at);
         split->SetUIModified();
         split->SetWID(te->WID());
-        related.TimeEntries.push_back(split);
+        related.Push(split);
         return split;
     }
 
@@ -442,8 +449,83 @@ void User::RemoveTaskFromRelatedModels(const Poco::UInt64 tid) {
     }
 }
 
+void User::ForgetTimeEntries(
+    const Poco::UInt64 stopped_before,
+    std::set<Poco::Int64> *kept) {
+    related.ForgetTimeEntries(stopped_before, has_loaded_more_, kept);
+}
+
+void User::TakeSnapshot(UserSnapshot *snapshot) {
+    poco_check_ptr(snapshot);
+
+    User *copy = &snapshot->Copy;
+    copy->BaseModel::operator=(*this);
+    copy->api_token_ = api_token_;
+    copy->default_wid_ = default_wid_;
+    copy->since_ = since_;
+    copy->fullname_ = fullname_;
+    copy->email_ = email_;
+    copy->record_timeline_ = record_timeline_;
+    copy->store_start_and_stop_time_ = store_start_and_stop_time_;
+    copy->timeofday_format_ = timeofday_format_;
+    copy->duration_format_ = duration_format_;
+    copy->offline_data_ = offline_data_;
+    copy->default_pid_ = default_pid_;
+    copy->default_tid_ = default_tid_;
+
+    // Saved, unless it changes again before it is
+    snapshot->user_changed_ = NeedsToBeSaved();
+    ClearDirty();
+
+    related.TakeSnapshot(&copy->related, &snapshot->Related);
+}
+
+bool User::ApplySnapshot(
+    UserSnapshot *snapshot,
+    const bool saved,
+    const std::vector<ModelChange> &changes) {
+
+    poco_check_ptr(snapshot);
+
+    if (!saved) {
+        if (snapshot->user_changed_) {
+            SetDirty();
+        }
+        related.ApplySnapshot(&snapshot->Related, false);
+        return false;
+    }
+
+    if (!LocalID()) {
+        SetLocalID(snapshot->Copy.LocalID());
+    }
+
+    // Deletions were applied to the copies only
+    bool cascaded(false);
+    for (std::vector<ModelChange>::const_iterator it = changes.begin();
+            it != changes.end(); it++) {
+        if (!it->IsDeletion()) {
+            continue;
+        }
+        if (it->ModelType() == kModelWorkspace) {
+            DeleteRelatedModelsWithWorkspace(it->ModelID());
+        } else if (it->ModelType() == kModelClient) {
+            RemoveClientFromRelatedModels(it->ModelID());
+        } else if (it->ModelType() == kModelProject) {
+            RemoveProjectFromRelatedModels(it->ModelID());
+        } else if (it->ModelType() == kModelTask) {
+            RemoveTaskFromRelatedModels(it->ModelID());
+        } else {
+            continue;
+        }
+        cascaded = true;
+    }
+
+    related.ApplySnapshot(&snapshot->Related, true);
+    return cascaded;
+}
+
 void User::loadUserTagFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -469,7 +551,7 @@ void User::loadUserTagFromJSON(
 
     if (!model) {
         model = new Tag();
-        related.Tags.push_back(model);
+        related.Push(model);
     }
     if (alive) {
         alive->insert(id);
@@ -479,7 +561,7 @@ void User::loadUserTagFromJSON(
 }
 
 void User::loadUserTaskFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -503,7 +585,7 @@ void User::loadUserTaskFromJSON(
 
     if (!model) {
         model = new Task();
-        related.Tasks.push_back(model);
+        related.Push(model);
     }
 
     if (alive) {
@@ -526,15 +608,62 @@ error User::LoadUserUpdateFromJSONString(
         return error("Failed to LoadUserUpdateFromJSONString");
     }
 
-    loadUserUpdateFromJSON(root);
+    LoadUserUpdateFromJSON(root);
 
     return noError;
 }
 
-void User::loadUserUpdateFromJSON(
-    Json::Value node) {
+namespace {
+
+// Identifies the model an update is for, empty if it can't be told
+std::string updateKey(const Json::Value &update) {
+    const Json::Value &data = update["data"];
+    if (!data.isObject()) {
+        return "";
+    }
+    std::stringstream ss;
+    ss << update["model"].asString() << " ";
+    if (data.isMember("guid") && !data["guid"].asString().empty()) {
+        ss << data["guid"].asString();
+    } else if (data.isMember("id") && data["id"].asUInt64()) {
+        ss << data["id"].asUInt64();
+    } else {
+        return "";
+    }
+    return ss.str();
+}
+
+}  // namespace
+
+size_t User::LoadUserUpdatesFromJSON(
+    const std::vector<Json::Value> &updates) {
+
+    std::vector<std::string> keys;
+    keys.reserve(updates.size());
+    std::map<std::string, size_t> last;
+    for (size_t i = 0; i < updates.size(); i++) {
+        keys.push_back(updateKey(updates[i]));
+        if (!keys.back().empty()) {
+            last[keys.back()] = i;
+        }
+    }
+
+    size_t applied(0);
+    for (size_t i = 0; i < updates.size(); i++) {
+        if (!keys[i].empty() && last[keys[i]] != i) {
+            // Superseded by a later update of the same model
+            continue;
+        }
+        LoadUserUpdateFromJSON(updates[i]);
+        applied++;
+    }
+    return applied;
+}
+
+void User::LoadUserUpdateFromJSON(
+    const Json::Value &node) {
 
-    Json::Value data = node["data"];
+    const Json::Value &data = node["data"];
     std::string model = node["model"].asString();
     std::string action = node["action"].asString();
 
@@ -564,7 +693,7 @@ void User::loadUserUpdateFromJSON(
 }
 
 void User::loadUserWorkspaceFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -587,7 +716,7 @@ void User::loadUserWorkspaceFromJSON(
 
     if (!model) {
         model = new Workspace();
-        related.Workspaces.push_back(model);
+        related.Push(model);
     }
     if (alive) {
         alive->insert(id);
@@ -606,22 +735,47 @@ error User::LoadUserAndRelatedDataFromJSONString(
         return noError;
     }
 
-    Json::Value root;
-    Json::Reader reader;
-    if (!reader.parse(json, root)) {
+    // The payload can be tens of megabytes for large accounts, so
+    // it's read one item at a time instead of into a single tree.
+    // First pass only checks the structure and finds the data.
+    JSONStream stream(json);
+    Json::Value since;
+    size_t data_pos(0);
+    if (stream.BeginObject()) {
+        std::string name;
+        while (stream.NextMember(&name)) {
+            if ("since" == name) {
+                stream.ReadValue(&since);
+            } else {
+                if ("data" == name) {
+                    data_pos = stream.Position();
+                }
+                stream.SkipValue();
+            }
+        }
+    }
+    if (stream.Failed()) {
         return error("Failed to LoadUserAndRelatedDataFromJSONString");
     }
 
-    SetSince(root["since"].asUInt64());
+    SetSince(since.asUInt64());
 
     Poco::Logger &logger = Poco::Logger::get("json");
     std::stringstream s;
     s << "User data as of: " << Since();
     logger.debug(s.str());
 
-    loadUserAndRelatedDataFromJSON(root["data"], including_related_data);
+    if (data_pos) {
+        stream.Seek(data_pos);
+    }
+    if (!data_pos || stream.Peek() != '{') {
+        // Logs the missing user ID, like an update without data
+        loadUserFromJSON(Json::Value());
+        return noError;
+    }
 
-    return noError;
+    return loadUserAndRelatedDataFromJSONStream(
+        &stream, including_related_data);
 }
 
 error User::LoadTimeEntriesFromJSONString(const std::string& json) {
@@ -629,16 +783,26 @@ error User::LoadTimeEntriesFromJSONString(const std::string& json) {
         return noError;
     }
 
-    Json::Value root;
-    Json::Reader reader;
-    if (!reader.parse(json, root)) {
+    // Check the whole payload before applying any of it
+    JSONStream stream(json);
+    if (!stream.SkipValue()) {
         return error("Failed to LoadTimeEntriesFromJSONString");
     }
+    stream.Seek(0);
 
     std::set<Poco::UInt64> alive;
 
-    for (unsigned int i = 0; i < root.size(); i++) {
-        loadUserTimeEntryFromJSON(root[i], &alive);
+    if (stream.BeginArray()) {
+        while (stream.NextElement()) {
+            Json::Value data;
+            if (!stream.ReadValue(&data)) {
+                break;
+            }
+            loadUserTimeEntryFromJSON(data, &alive);
+        }
+    }
+    if (stream.Failed()) {
+        return error("Failed to LoadTimeEntriesFromJSONString");
     }
 
     deleteZombies(related.TimeEntries, alive);
@@ -676,19 +840,18 @@ void User::loadObmExperimentFromJson(Json::Value const &obm) {
         model = new ObmExperiment();
         model->SetUID(ID());
         model->SetNr(nr);
-        related.ObmExperiments.push_back(model);
+        related.Push(model);
     }
     model->SetIncluded(obm["included"].asBool());
     model->SetActions(obm["actions"].asString());
 }
 
-void User::loadUserAndRelatedDataFromJSON(
-    Json::Value data,
-    const bool &including_related_data) {
+bool User::loadUserFromJSON(
+    const Json::Value &data) {
 
     if (!data["id"].asUInt64()) {
         logger().error("Backend is sending invalid data: ignoring update without an ID");  // NOLINT
-        return;
+        return false;
     }
 
     SetID(data["id"].asUInt64());
@@ -701,6 +864,114 @@ void User::loadUserAndRelatedDataFromJSON(
     SetTimeOfDayFormat(data["timeofday_format"].asString());
     SetDurationFormat(data["duration_format"].asString());
 
+    return true;
+}
+
+template<typename T>
+error User::loadRelatedDataFromJSONStream(
+    JSONStream *stream,
+    const std::map<std::string, size_t> &lists,
+    const std::string &name,
+    void (User::*load)(const Json::Value &, std::set<Poco::UInt64> *),
+    const std::vector<T *> &list,
+    const bool &including_related_data) {
+
+    std::set<Poco::UInt64> alive;
+
+    std::map<std::string, size_t>::const_iterator it = lists.find(name);
+    if (it != lists.end()) {
+        stream->Seek(it->second);
+        if (stream->BeginArray()) {
+            while (stream->NextElement()) {
+                Json::Value item;
+                if (!stream->ReadValue(&item)) {
+                    break;
+                }
+                (this->*load)(item, &alive);
+            }
+        }
+        if (stream->Failed()) {
+            return error("Failed to load " + name + " from JSON");
+        }
+    }
+
+    if (including_related_data) {
+        deleteZombies(list, alive);
+    }
+
+    return noError;
+}
+
+error User::loadUserAndRelatedDataFromJSONStream(
+    JSONStream *stream,
+    const bool &including_related_data) {
+
+    // Keep user fields, but only remember where the
+    // related data lists are, they're read later item by item.
+    Json::Value data(Json::objectValue);
+    std::map<std::string, size_t> lists;
+    if (stream->BeginObject()) {
+        std::string name;
+        while (stream->NextMember(&name)) {
+            if ('[' == stream->Peek()
+                    && ("projects" == name || "tags" == name
+                        || "tasks" == name || "time_entries" == name
+                        || "workspaces" == name || "clients" == name)) {
+                lists[name] = stream->Position();
+                stream->SkipValue();
+            } else {
+                stream->ReadValue(&data[name]);
+            }
+        }
+    }
+    if (stream->Failed()) {
+        return error("Failed to LoadUserAndRelatedDataFromJSONString");
+    }
+
+    if (!loadUserFromJSON(data)) {
+        return noError;
+    }
+
+    // Same order as in loadUserAndRelatedDataFromJSON
+    error err = loadRelatedDataFromJSONStream(
+        stream, lists, "projects", &User::loadUserProjectFromJSON,
+        related.Projects, including_related_data);
+    if (noError == err) {
+        err = loadRelatedDataFromJSONStream(
+            stream, lists, "tags", &User::loadUserTagFromJSON,
+            related.Tags, including_related_data);
+    }
+    if (noError == err) {
+        err = loadRelatedDataFromJSONStream(
+            stream, lists, "tasks", &User::loadUserTaskFromJSON,
+            related.Tasks, including_related_data);
+    }
+    if (noError == err) {
+        err = loadRelatedDataFromJSONStream(
+            stream, lists, "time_entries", &User::loadUserTimeEntryFromJSON,
+            related.TimeEntries, including_related_data);
+    }
+    if (noError == err) {
+        err = loadRelatedDataFromJSONStream(
+            stream, lists, "workspaces", &User::loadUserWorkspaceFromJSON,
+            related.Workspaces, including_related_data);
+    }
+    if (noError == err) {
+        err = loadRelatedDataFromJSONStream(
+            stream, lists, "clients", &User::loadUserClientFromJSON,
+            related.Clients, including_related_data);
+    }
+    return err;
+}
+
+void User::loadUserAndRelatedDataFromJSON(
+    const Json::Value &data,
+    const bool &including_related_data) {
+
+    if (!loadUserFromJSON(data)) {
+        return;
+    }
+
     {
         std::set<Poco::UInt64> alive;
 
@@ -799,7 +1070,7 @@ void User::loadUserAndRelatedDataFromJSON(
 }
 
 void User::loadUserClientFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -824,7 +1095,7 @@ void User::loadUserClientFromJSON(
 
     if (!model) {
         model = new Client();
-        related.Clients.push_back(model);
+        related.Push(model);
     }
     if (alive) {
         alive->insert(id);
@@ -834,7 +1105,7 @@ void User::loadUserClientFromJSON(
 }
 
 void User::loadUserProjectFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -860,7 +1131,7 @@ void User::loadUserProjectFromJSON(
 
     if (!model) {
         model = new Project();
-        related.Projects.push_back(model);
+        related.Push(model);
     }
     if (alive) {
         alive->insert(id);
@@ -870,7 +1141,7 @@ void User::loadUserProjectFromJSON(
 }
 
 void User::loadUserTimeEntryFromJSON(
-    Json::Value data,
+    const Json::Value &data,
     std::set<Poco::UInt64> *alive) {
 
     // alive can be 0, dont assert/check it
@@ -896,7 +1167,7 @@ void User::loadUserTimeEntryFromJSON(
 
     if (!model) {
         model = new TimeEntry();
-        related.TimeEntries.push_back(model);
+        related.Push(model);
     }
     if (alive) {
         alive->insert(id);
@@ -1136,123 +1407,44 @@ void User::MarkTimelineBatchAsUploaded(
 }
 
 void User::CompressTimeline() {
-    // Group events by app name into chunks
-    std::map<std::string, TimelineEvent *> compressed;
-
-    // Older events will be deleted
+    // Events are chunked as they are recorded, this only takes
+    // care of events saved unchunked and purges old chunks
     Poco::UInt64 minimum_time = time(0) - kTimelineSecondsToKeep;
 
-    // Find the chunk start time of current time.
-    // then process only events that are older that this chunk start time.
-    // Else we will have no full chunks to compress.
-    Poco::UInt64 chunk_up_to =
-        (time(0) / kTimelineChunkSeconds) * kTimelineChunkSeconds;
-
+    related.CompressTimeline(minimum_time);
 
-    time_t start = time(0);
-
-    {
-        std::stringstream ss;
-        ss << "CompressTimeline "
-           << " user_id=" << ID()
-           << " chunk_up_to=" << chunk_up_to
-           << " number of events=" << related.TimelineEvents.size();
-
-        logger().debug(ss.str());
-    }
-
-    for (std::vector<TimelineEvent *>::iterator i =
-        related.TimelineEvents.begin();
-            i != related.TimelineEvents.end();
-            ++i) {
-        TimelineEvent *event = *i;
-
-        poco_check_ptr(event);
-
-        // Delete too old timeline events
-        if (event->Start() < minimum_time) {
-            event->Delete();
-        }
-
-        // Events that do not fit into chunk yet, ignore
-        if (event->Start() >= chunk_up_to) {
-            continue;
-        }
-
-        // Ignore deleted events
-        if (event->DeletedAt()) {
-            continue;
-        }
-
-        // Ignore chunked and already uploaded stuff
-        if (event->Chunked() || event->Uploaded()) {
-            continue;
-        }
+    std::stringstream ss;
+    ss << "CompressTimeline "
+       << " user_id=" << ID()
+       << " number of chunks=" << related.TimelineEvents.size();
+    logger().debug(ss.str());
+}
 
-        // Calculate the start time of the chunk
-        // that fits this timeline event
-        time_t chunk_start_time =
-            (event->Start() / kTimelineChunkSeconds)
-            * kTimelineChunkSeconds;
-
-        // Build dictionary key so that the chunk can be accessed later
-        std::stringstream ss;
-        ss << event->Filename();
-        ss << "::";
-        ss << event->Title();
-        ss << "::";
-        ss << event->Idle();
-        ss << "::";
-        ss << chunk_start_time;
-        std::string key = ss.str();
-
-        // Calculate positive value of timeline event duration
-        time_t duration = event->Duration();
-        if (duration < 0) {
-            duration = 0;
-        }
+std::vector<TimelineEvent> User::CompressedTimeline() const {
+    Poco::UInt64 cursor(0);
+    return CompressedTimeline(0, &cursor);
+}
 
-        poco_assert(!event->Uploaded());
-        poco_assert(!event->Chunked());
+std::vector<TimelineEvent> User::CompressedTimeline(
+    const Poco::UInt64 limit,
+    Poco::UInt64 *cursor) const {
 
-        TimelineEvent *chunk = nullptr;
-        if (compressed.find(key) == compressed.end()) {
-            // If chunk is not created yet,
-            // turn the timeline event into chunk
-            chunk = event;
-            chunk->SetEndTime(chunk->Start() + duration);
-            chunk->SetChunked(true);
-        } else {
-            // If chunk already exists, add duration
-            // to that junk and delete the original event
-            chunk = compressed[key];
-            chunk->SetEndTime(chunk->EndTime() + duration);
-            event->Delete();
-        }
-        compressed[key] = chunk;
-    }
+    poco_check_ptr(cursor);
 
-    {
-        std::stringstream ss;
-        ss << "CompressTimeline done in " << (time(0) - start)
-           << " seconds, "
-           << related.TimelineEvents.size()
-           << " compressed into "
-           << compressed.size()
-           << " chunks";
-        logger().debug(ss.str());
-    }
-}
+    // Only chunks of periods that have ended can be uploaded,
+    // later events can still be added to the current ones
+    Poco::UInt64 chunk_up_to =
+        (time(0) / kTimelineChunkSeconds) * kTimelineChunkSeconds;
 
-std::vector<TimelineEvent> User::CompressedTimeline() const {
     std::vector<TimelineEvent> list;
-    for (std::vector<TimelineEvent *>::const_iterator i =
-        related.TimelineEvents.begin();
-            i != related.TimelineEvents.end();
-            ++i) {
-        TimelineEvent *event = *i;
+    while (*cursor < related.TimelineEvents.size()
+            && (!limit || list.size() < limit)) {
+        TimelineEvent *event = related.TimelineEvents[*cursor];
         poco_check_ptr(event);
-        if (event->VisibleToUser()) {
+        (*cursor)++;
+        if (event->VisibleToUser()
+                && !event->IsMarkedAsDeletedOnServer()
+                && event->Start() < chunk_up_to) {
             // Make a copy of the timeline event
             list.push_back(*event);
         }
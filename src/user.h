@@ -12,6 +12,7 @@
 
 #include "./base_model.h"
 #include "./batch_update_result.h"
+#include "./model_change.h"
 #include "./related_data.h"
 #include "./types.h"
 #include "./workspace.h"
@@ -20,6 +21,9 @@
 
 namespace toggl {
 
+class JSONStream;
+class UserSnapshot;
+
 class User : public BaseModel {
  public:
     User()
@@ -35,7 +39,8 @@ class User : public BaseModel {
     , offline_data_("")
     , default_pid_(0)
     , default_tid_(0)
-    , has_loaded_more_(false) {}
+    , has_loaded_more_(false)
+    , partial_data_since_(0) {}
 
     ~User();
 
@@ -167,6 +172,10 @@ class User : public BaseModel {
     void RemoveTaskFromRelatedModels(const Poco::UInt64 tid);
 
     error LoadUserUpdateFromJSONString(const std::string json);
+    void LoadUserUpdateFromJSON(const Json::Value &node);
+    // Applies a batch of updates, only the last update of each
+    // model in the batch is applied. Returns how many were applied.
+    size_t LoadUserUpdatesFromJSON(const std::vector<Json::Value> &updates);
 
     error LoadUserAndRelatedDataFromJSONString(
         const std::string &json,
@@ -180,6 +189,12 @@ class User : public BaseModel {
         const std::vector<TimelineEvent> &events);
     void CompressTimeline();
     std::vector<TimelineEvent> CompressedTimeline() const;
+    // At most limit (zero for no limit) chunks ready for upload,
+    // looking from *cursor on. The cursor is moved past the chunks
+    // looked at, so the next page can continue from there.
+    std::vector<TimelineEvent> CompressedTimeline(
+        const Poco::UInt64 limit,
+        Poco::UInt64 *cursor) const;
 
     error UpdateJSON(
         std::vector<Client *> * const,
@@ -232,36 +247,77 @@ class User : public BaseModel {
         has_loaded_more_ = true;
     }
 
+    // When not 0, only the recent data since this time has been
+    // loaded from database and the rest is still to be loaded.
+    Poco::UInt64 PartialDataSince() const {
+        return partial_data_since_;
+    }
+
+    void SetPartialDataSince(const Poco::UInt64 value) {
+        partial_data_since_ = value;
+    }
+
+    // Drop old time entries from memory so their rows can be purged,
+    // see RelatedData::ForgetTimeEntries. The ones fetched with
+    // "Load more" stay for the rest of the session.
+    void ForgetTimeEntries(
+        const Poco::UInt64 stopped_before,
+        std::set<Poco::Int64> *kept);
+
+    // Copy the user and the related models waiting to be saved,
+    // so they can be saved while the user is changed further.
+    // Apply the snapshot when saving is done, with the changes
+    // saving made. Returns true if deletions changed models
+    // that were not saved along.
+    void TakeSnapshot(UserSnapshot *snapshot);
+    bool ApplySnapshot(
+        UserSnapshot *snapshot,
+        const bool saved,
+        const std::vector<ModelChange> &changes);
+
  private:
+    bool loadUserFromJSON(
+        const Json::Value &data);
+
+    error loadUserAndRelatedDataFromJSONStream(
+        JSONStream *stream,
+        const bool &including_related_data);
+
+    template<typename T>
+    error loadRelatedDataFromJSONStream(
+        JSONStream *stream,
+        const std::map<std::string, size_t> &lists,
+        const std::string &name,
+        void (User::*load)(const Json::Value &, std::set<Poco::UInt64> *),
+        const std::vector<T *> &list,
+        const bool &including_related_data);
+
     void loadUserTagFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     void loadUserAndRelatedDataFromJSON(
-        Json::Value node,
+        const Json::Value &data,
         const bool &including_related_data);
 
-    void loadUserUpdateFromJSON(
-        Json::Value list);
-
     void loadUserProjectFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     void loadUserWorkspaceFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     void loadUserClientFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     void loadUserTaskFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     void loadUserTimeEntryFromJSON(
-        Json::Value data,
+        const Json::Value &data,
         std::set<Poco::UInt64> *alive = nullptr);
 
     std::string dirtyObjectsJSON(std::vector<TimeEntry *> * const) const;
@@ -301,6 +357,30 @@ class User : public BaseModel {
     Poco::UInt64 default_tid_;
 
     bool has_loaded_more_;
+    Poco::UInt64 partial_data_since_;
+};
+
+// What User::TakeSnapshot copied, to be saved instead of the user
+class UserSnapshot {
+ public:
+    UserSnapshot()
+        : user_changed_(false) {}
+    ~UserSnapshot() {}
+
+    User Copy;
+    RelatedSnapshot Related;
+
+    bool Empty() const {
+        return !user_changed_ && !Related.Count();
+    }
+
+ private:
+    friend class User;
+
+    UserSnapshot(const UserSnapshot &);
+    UserSnapshot &operator=(const UserSnapshot &);
+
+    bool user_changed_;
 };
 
 template<class T>
@@ -2,6 +2,7 @@
 
 #include "../src/websocket_client.h"
 
+#include <algorithm>
 #include <string>
 #include <sstream>
 
@@ -9,6 +10,7 @@
 
 #include "Poco/Exception.h"
 #include "Poco/Logger.h"
+#include "Poco/Net/DatagramSocket.h"
 #include "Poco/Net/AcceptCertificateHandler.h"
 #include "Poco/Net/Context.h"
 #include "Poco/Net/HTTPMessage.h"
@@ -16,6 +18,7 @@
 #include "Poco/Net/HTTPResponse.h"
 #include "Poco/Net/HTTPSClientSession.h"
 #include "Poco/Net/InvalidCertificateHandler.h"
+#include "Poco/Net/NetException.h"
 #include "Poco/Net/PrivateKeyPassphraseHandler.h"
 #include "Poco/Net/SSLManager.h"
 #include "Poco/Net/WebSocket.h"
@@ -31,15 +34,22 @@ namespace toggl {
 
 WebSocketClient::~WebSocketClient() {
     deleteSession();
+
+    if (wakeup_) {
+        delete wakeup_;
+        wakeup_ = nullptr;
+    }
 }
 
 void WebSocketClient::Start(
     void *ctx,
     const std::string api_token,
-    WebSocketMessageCallback on_websocket_message) {
+    WebSocketMessageCallback on_websocket_message,
+    WebSocketMissedMessageCallback on_websocket_missed_message) {
 
     poco_check_ptr(ctx);
     poco_check_ptr(on_websocket_message);
+    poco_check_ptr(on_websocket_missed_message);
 
     if (api_token.empty()) {
         logger().error("API token is empty, cannot start websocket");
@@ -52,10 +62,22 @@ void WebSocketClient::Start(
         return;
     }
 
+    try {
+        if (!wakeup_) {
+            wakeup_ = new Poco::Net::DatagramSocket(
+                Poco::Net::SocketAddress("127.0.0.1", 0));
+        }
+    } catch(const Poco::Exception& exc) {
+        logger().error(exc.displayText());
+        return;
+    }
+    stop_requested_.reset();
+
     activity_.start();
 
     ctx_ = ctx;
     on_websocket_message_ = on_websocket_message;
+    on_websocket_missed_message_ = on_websocket_missed_message;
     api_token_ = api_token;
 }
 
@@ -66,6 +88,8 @@ void WebSocketClient::Shutdown() {
         return;
     }
     activity_.stop();  // request stop
+    stop_requested_.set();
+    wake();
     activity_.wait();  // wait until activity actually stops
 
     deleteSession();
@@ -129,7 +153,6 @@ error WebSocketClient::createSession() {
         req_->set("User-Agent", HTTPSClient::Config.UserAgent());
         res_ = new Poco::Net::HTTPResponse();
         ws_ = new Poco::Net::WebSocket(*session_, *req_, *res_);
-        ws_->setBlocking(false);
         ws_->setReceiveTimeout(Poco::Timespan(3 * Poco::Timespan::SECONDS));
         ws_->setSendTimeout(Poco::Timespan(3 * Poco::Timespan::SECONDS));
 
@@ -161,35 +184,78 @@ void WebSocketClient::authenticate() {
 }
 
 std::string WebSocketClient::parseWebSocketMessageType(
-    const std::string json) {
+    const std::string json,
+    Json::Value *root) {
+
+    poco_check_ptr(root);
 
     if (json.empty()) {
         return "";
     }
 
-    Json::Value root;
     Json::Reader reader;
-    if (!reader.parse(json, root)) {
+    if (!reader.parse(json, *root)) {
         return "";
     }
 
-    if (root.isMember("type")) {
-        return root["type"].asString();
+    if (root->isMember("type")) {
+        return (*root)["type"].asString();
     }
 
     return "data";
 }
 
-const int kWebsocketBufSize = 1024 * 10;
-
 error WebSocketClient::receiveWebSocketMessage(std::string *message) {
-    int flags = Poco::Net::WebSocket::FRAME_BINARY;
-    std::string json("");
+    poco_check_ptr(message);
+
+    message->clear();
     try {
-        char buf[kWebsocketBufSize];
-        int n = ws_->receiveFrame(buf, kWebsocketBufSize, flags);
-        if (n > 0) {
-            json.append(buf, n);
+        if (!frame_.size()) {
+            frame_.resize(kWebsocketMinFrameBytes, false);
+        }
+
+        // Messages can be split into any number of frames,
+        // with control frames in between
+        while (true) {
+            int flags(0);
+            int n(0);
+            try {
+                n = ws_->receiveFrame(
+                    frame_.begin(), static_cast<int>(frame_.size()), flags);
+            } catch(const Poco::Net::WebSocketException& exc) {
+                // The frame header has been read already, so the frame
+                // cannot be read again. The connection is restarted,
+                // with a buffer big enough for any next frame, and
+                // the dropped update is fetched with a sync.
+                if (Poco::Net::WebSocket::WS_ERR_PAYLOAD_TOO_BIG
+                        == exc.code()) {
+                    frame_.resize(kWebsocketMaxFrameBytes, false);
+                    on_websocket_missed_message_(ctx_);
+                }
+                throw;
+            }
+            int opcode = flags & Poco::Net::WebSocket::FRAME_OP_BITMASK;
+            if ((n <= 0 && !flags)
+                    || Poco::Net::WebSocket::FRAME_OP_CLOSE == opcode) {
+                // Connection closed
+                message->clear();
+                return noError;
+            }
+            if (Poco::Net::WebSocket::FRAME_OP_PING == opcode) {
+                ws_->sendFrame(frame_.begin(), n,
+                               Poco::Net::WebSocket::FRAME_FLAG_FIN
+                               | Poco::Net::WebSocket::FRAME_OP_PONG);
+                continue;
+            }
+            if (Poco::Net::WebSocket::FRAME_OP_PONG == opcode) {
+                continue;
+            }
+            if (n > 0) {
+                message->append(frame_.begin(), n);
+            }
+            if (flags & Poco::Net::WebSocket::FRAME_FLAG_FIN) {
+                return noError;
+            }
         }
     } catch(const Poco::Exception& exc) {
         return error(exc.displayText());
@@ -198,17 +264,51 @@ error WebSocketClient::receiveWebSocketMessage(std::string *message) {
     } catch(const std::string& ex) {
         return error(ex);
     }
-    *message = json;
     return noError;
 }
 
 const std::string kPong("{\"type\": \"pong\"}");
 
-error WebSocketClient::poll() {
+bool WebSocketClient::sleep(const Poco::Timespan &timeout) {
+    return stop_requested_.tryWait(
+        static_cast<long>(timeout.totalMilliseconds()))  // NOLINT
+           || activity_.isStopped();
+}
+
+void WebSocketClient::wake() {
     try {
-        Poco::Timespan span(250 * Poco::Timespan::MILLISECONDS);
-        if (!ws_->poll(span, Poco::Net::Socket::SELECT_READ)) {
-            return noError;
+        Poco::Net::DatagramSocket sender;
+        sender.sendTo("w", 1, wakeup_->address());
+    } catch(const Poco::Exception& exc) {
+        logger().error(exc.displayText());
+    }
+}
+
+error WebSocketClient::poll(const Poco::Timespan &timeout) {
+    try {
+        // Block on the socket until a message, or until
+        // Shutdown() writes to the wakeup socket
+        if (!ws_->available()) {
+            Poco::Net::Socket::SocketList readable;
+            readable.push_back(*ws_);
+            readable.push_back(*wakeup_);
+            Poco::Net::Socket::SocketList writable, failed;
+            if (!Poco::Net::Socket::select(
+                    readable, writable, failed, timeout)) {
+                return noError;
+            }
+            if (std::find(readable.begin(), readable.end(), *wakeup_)
+                    != readable.end()) {
+                char c;
+                wakeup_->receiveBytes(&c, 1);
+            }
+            if (activity_.isStopped()) {
+                return noError;
+            }
+            if (std::find(readable.begin(), readable.end(), *ws_)
+                    == readable.end()) {
+                return noError;
+            }
         }
 
         std::string json("");
@@ -225,7 +325,9 @@ error WebSocketClient::poll() {
 
         last_connection_at_ = time(0);
 
-        std::string type = parseWebSocketMessageType(json);
+        // Parsed once, the same node is handed over to the callback
+        Json::Value root;
+        std::string type = parseWebSocketMessageType(json, &root);
 
         if (activity_.isStopped()) {
             return noError;
@@ -239,7 +341,7 @@ error WebSocketClient::poll() {
         }
 
         if ("data" == type) {
-            on_websocket_message_(ctx_, json);
+            on_websocket_message_(ctx_, root);
         }
     } catch(const Poco::Exception& exc) {
         return error(exc.displayText());
@@ -252,23 +354,37 @@ error WebSocketClient::poll() {
 }
 
 void WebSocketClient::runActivity() {
+    const Poco::Timespan error_delay(10 * Poco::Timespan::SECONDS);
     int restart_interval = nextWebsocketRestartInterval();
     while (!activity_.isStopped()) {
+        // Nothing to do before the next restart is due,
+        // unless a message arrives
+        Poco::Timespan until_restart(
+            static_cast<long>(std::max(  // NOLINT
+                std::time_t(1),
+                last_connection_at_ + restart_interval + 1 - time(0))),
+            0);
+
         if (ws_) {
-            error err = poll();
+            error err = poll(until_restart);
+            if (activity_.isStopped()) {
+                break;
+            }
             if (err != noError) {
                 logger().error(err);
                 logger().debug("encountered an error and will delete session");
                 deleteSession();
                 logger().debug("will sleep for 10 sec");
-                for (int i = 0; i < 20; i++) {
-                    if (activity_.isStopped()) {
-                        return;
-                    }
-                    Poco::Thread::sleep(500);
+                if (sleep(error_delay)) {
+                    break;
                 }
                 logger().debug("sleep done");
             }
+        } else if (time(0) - last_connection_at_ <= restart_interval) {
+            // Not connected, wait for the next restart
+            if (sleep(until_restart)) {
+                break;
+            }
         }
 
         if (time(0) - last_connection_at_ > restart_interval) {
@@ -277,16 +393,11 @@ void WebSocketClient::runActivity() {
             error err = createSession();
             if (err != noError) {
                 logger().error(err);
-                for (int i = 0; i < 20; i++) {
-                    if (activity_.isStopped()) {
-                        return;
-                    }
-                    Poco::Thread::sleep(500);
+                if (sleep(error_delay)) {
+                    break;
                 }
             }
         }
-
-        Poco::Thread::sleep(1000);
     }
 
     logger().debug("activity finished");
@@ -7,7 +7,12 @@
 #include <vector>
 #include <ctime>
 
+#include <json/json.h>  // NOLINT
+
 #include "Poco/Activity.h"
+#include "Poco/Buffer.h"
+#include "Poco/Event.h"
+#include "Poco/Timespan.h"
 
 #include "./types.h"
 
@@ -15,18 +20,23 @@ namespace Poco {
 class Logger;
 
 namespace Net {
+class DatagramSocket;
 class HTTPSClientSession;
 class HTTPRequest;
 class HTTPResponse;
 class WebSocket;
-}
-}
+}  // namespace Net
+}  // namespace Poco
 
 namespace toggl {
 
 typedef void (*WebSocketMessageCallback)(
     void *callback,
-    std::string json);
+    const Json::Value &message);
+
+// Called when a message had to be dropped
+typedef void (*WebSocketMissedMessageCallback)(
+    void *callback);
 
 class WebSocketClient {
  public:
@@ -36,7 +46,10 @@ class WebSocketClient {
     req_(nullptr),
     res_(nullptr),
     ws_(nullptr),
+    wakeup_(nullptr),
+    frame_(0),
     on_websocket_message_(nullptr),
+    on_websocket_missed_message_(nullptr),
     ctx_(nullptr),
     last_connection_at_(0),
     api_token_("") {}
@@ -45,7 +58,8 @@ class WebSocketClient {
     virtual void Start(
         void *ctx,
         const std::string api_token,
-        WebSocketMessageCallback on_websocket_message);
+        WebSocketMessageCallback on_websocket_message,
+        WebSocketMissedMessageCallback on_websocket_missed_message);
     virtual void Shutdown();
 
  protected:
@@ -56,9 +70,18 @@ class WebSocketClient {
 
     void authenticate();
 
-    error poll();
+    error poll(const Poco::Timespan &timeout);
+
+    // Waits until the activity is stopped or the timeout is over,
+    // returns true when stopped
+    bool sleep(const Poco::Timespan &timeout);
+
+    // Cuts a poll short
+    void wake();
 
-    std::string parseWebSocketMessageType(const std::string json);
+    std::string parseWebSocketMessageType(
+        const std::string json,
+        Json::Value *root);
 
     error receiveWebSocketMessage(std::string *message);
 
@@ -73,7 +96,13 @@ class WebSocketClient {
     Poco::Net::HTTPRequest *req_;
     Poco::Net::HTTPResponse *res_;
     Poco::Net::WebSocket *ws_;
+    // Polled along with the websocket, written to when stopping
+    Poco::Net::DatagramSocket *wakeup_;
+    Poco::Event stop_requested_;
+    // Receive buffer for a single frame, grown when a frame does not fit
+    Poco::Buffer<char> frame_;
     WebSocketMessageCallback on_websocket_message_;
+    WebSocketMissedMessageCallback on_websocket_missed_message_;
     void *ctx_;
 
     std::time_t last_connection_at_;
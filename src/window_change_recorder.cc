@@ -8,7 +8,6 @@
 #include "./const.h"
 
 #include "Poco/Logger.h"
-#include "Poco/Thread.h"
 
 namespace toggl {
 
@@ -115,9 +114,11 @@ void WindowChangeRecorder::inspectFocusedWindow() {
     last_event_started_at_ = now;
 }
 
-#define kWindowRecorderSleepMillis 250
+// Used where focus changes can't be observed and have to be polled
+#define kWindowRecorderSleepMillis 500
 
 void WindowChangeRecorder::recordLoop() {
+    bool changed(true);
     while (!recording_.isStopped()) {
         {
             Poco::Mutex::ScopedLock lock(shutdown_m_);
@@ -126,19 +127,15 @@ void WindowChangeRecorder::recordLoop() {
             }
         }
 
-        inspectFocusedWindow();
-
-        if (recording_.isStopped()) {
-            break;
+        if (changed) {
+            inspectFocusedWindow();
         }
 
-        Poco::Thread::sleep(kWindowRecorderSleepMillis);
-
         if (recording_.isStopped()) {
             break;
         }
 
-        Poco::Thread::sleep(kWindowRecorderSleepMillis);
+        changed = waitForFocusChange(kWindowRecorderSleepMillis);
     }
 }
 
@@ -150,6 +147,7 @@ error WindowChangeRecorder::Shutdown() {
         }
         if (recording_.isRunning()) {
             recording_.stop();
+            cancelWaitForFocusChange();
             recording_.wait(5);
         }
     } catch(const Poco::Exception& exc) {
@@ -56,7 +56,7 @@ class Workspace : public BaseModel {
     std::string String() const;
     std::string ModelName() const;
     std::string ModelURL() const;
-    void LoadFromJSON(Json::Value value);
+    void LoadFromJSON(const Json::Value &value);
     void LoadSettingsFromJson(Json::Value value);
 
  private:
@@ -0,0 +1,84 @@
+BEGIN TRANSACTION;
+CREATE TABLE analytics_settings(id INTEGER PRIMARY KEY, analytics_client_id VARCHAR NOT NULL);
+INSERT INTO "analytics_settings" VALUES(1,'2c7a5f0e-3d9b-4b8e-a1f6-7e4c2d9b0a13');
+CREATE TABLE clients(local_id integer primary key,id integer, uid integer not null, name varchar not null, guid varchar, wid integer not null, constraint fk_clients_wid foreign key (wid)    references workpaces(id) on delete no action on update no action,constraint fk_clients_uid foreign key (uid)    references users(id) on delete no action on update no action);
+INSERT INTO "clients" VALUES(1,878318,10471231,'Big Client','59b464cd-0f8e-e601-ff44-f135225a6738',123456789);
+CREATE TABLE kopsik_migrations(id integer primary key, name varchar not null);
+INSERT INTO "kopsik_migrations" VALUES(1,'users');
+INSERT INTO "kopsik_migrations" VALUES(2,'users.store_start_and_stop_time');
+INSERT INTO "kopsik_migrations" VALUES(3,'users.timeofday_format');
+INSERT INTO "kopsik_migrations" VALUES(4,'users.id');
+INSERT INTO "kopsik_migrations" VALUES(5,'users.duration_format');
+INSERT INTO "kopsik_migrations" VALUES(6,'drop users.email index');
+INSERT INTO "kopsik_migrations" VALUES(7,'users.api_token');
+INSERT INTO "kopsik_migrations" VALUES(8,'users.offline_data');
+INSERT INTO "kopsik_migrations" VALUES(9,'workspaces');
+INSERT INTO "kopsik_migrations" VALUES(10,'workspaces.id');
+INSERT INTO "kopsik_migrations" VALUES(11,'workspaces.premium');
+INSERT INTO "kopsik_migrations" VALUES(12,'workspaces.only_admins_may_create_projects');
+INSERT INTO "kopsik_migrations" VALUES(13,'clients');
+INSERT INTO "kopsik_migrations" VALUES(14,'clients.id');
+INSERT INTO "kopsik_migrations" VALUES(15,'clients.guid');
+INSERT INTO "kopsik_migrations" VALUES(16,'projects');
+INSERT INTO "kopsik_migrations" VALUES(17,'projects.billable');
+INSERT INTO "kopsik_migrations" VALUES(18,'projects.is_private');
+INSERT INTO "kopsik_migrations" VALUES(19,'tasks');
+INSERT INTO "kopsik_migrations" VALUES(20,'tags');
+INSERT INTO "kopsik_migrations" VALUES(21,'tags.id');
+INSERT INTO "kopsik_migrations" VALUES(22,'time_entries');
+INSERT INTO "kopsik_migrations" VALUES(23,'time_entries.id');
+INSERT INTO "kopsik_migrations" VALUES(24,'time_entries.guid');
+INSERT INTO "kopsik_migrations" VALUES(25,'time_entries.project_guid');
+INSERT INTO "kopsik_migrations" VALUES(26,'sessions');
+INSERT INTO "kopsik_migrations" VALUES(27,'sessions.active');
+INSERT INTO "kopsik_migrations" VALUES(28,'settings');
+INSERT INTO "kopsik_migrations" VALUES(29,'settings.update_channel');
+INSERT INTO "kopsik_migrations" VALUES(30,'settings.default');
+INSERT INTO "kopsik_migrations" VALUES(31,'settings.menubar_timer');
+INSERT INTO "kopsik_migrations" VALUES(32,'settings.menubar_project');
+INSERT INTO "kopsik_migrations" VALUES(33,'settings.dock_icon');
+INSERT INTO "kopsik_migrations" VALUES(34,'settings.on_top');
+INSERT INTO "kopsik_migrations" VALUES(35,'settings.reminder');
+INSERT INTO "kopsik_migrations" VALUES(36,'settings.ignore_cert');
+INSERT INTO "kopsik_migrations" VALUES(37,'settings.idle_minutes');
+INSERT INTO "kopsik_migrations" VALUES(38,'settings.focus_on_shortcut');
+INSERT INTO "kopsik_migrations" VALUES(39,'settings.reminder_minutes');
+INSERT INTO "kopsik_migrations" VALUES(40,'settings.manual_mode');
+INSERT INTO "kopsik_migrations" VALUES(41,'analytics_settings');
+INSERT INTO "kopsik_migrations" VALUES(42,'analytics_settings.analytics_client_id');
+INSERT INTO "kopsik_migrations" VALUES(43,'timeline_installation');
+INSERT INTO "kopsik_migrations" VALUES(44,'timeline_installation.desktop_id');
+INSERT INTO "kopsik_migrations" VALUES(45,'timeline_events');
+CREATE TABLE projects(local_id integer primary key, id integer, uid integer not null, name varchar not null, guid varchar, color varchar, wid integer not null, cid integer, active integer not null default 1, billable INT NOT NULL DEFAULT 0, is_private INT NOT NULL DEFAULT 0,constraint fk_projects_wid foreign key (wid)    references workpaces(id) on delete no action on update no action,constraint fk_projects_cid foreign key (cid)    references clients(id) on delete no action on update no action,constraint fk_projects_uid foreign key (uid)    references users(id) ON DELETE NO ACTION ON UPDATE NO ACTION);
+INSERT INTO "projects" VALUES(1,2598305,10471231,'Testing stuff','2f0b8f11-f898-d992-3e1a-6bc261fc41ef','14',123456789,878318,1,1,0);
+CREATE TABLE sessions(local_id integer primary key, api_token varchar not null, active integer not null default 1 );
+INSERT INTO "sessions" VALUES(1,'fa3ba4e5e5b2a3e4e9e3f4c1b6d4a2e8',1);
+CREATE TABLE settings(local_id integer primary key, use_proxy integer not null default 0, proxy_host varchar, proxy_port integer, proxy_username varchar, proxy_password varchar, use_idle_detection integer not null default 1, update_channel varchar not null default 'stable', menubar_timer integer not null default 0, menubar_project integer not null default 0, dock_icon INTEGER NOT NULL DEFAULT 1, on_top INTEGER NOT NULL DEFAULT 0, reminder INTEGER NOT NULL DEFAULT 1, ignore_cert INTEGER NOT NULL DEFAULT 0, idle_minutes INTEGER NOT NULL DEFAULT 5, focus_on_shortcut INTEGER NOT NULL DEFAULT 0, reminder_minutes INTEGER NOT NULL DEFAULT 10, manual_mode INTEGER NOT NULL DEFAULT 0);
+INSERT INTO "settings" VALUES(1,0,NULL,NULL,NULL,NULL,0,'stable',1,0,1,0,1,0,5,0,10,0);
+CREATE TABLE tags(local_id integer primary key, id integer not null, uid integer not null, name varchar not null, wid integer not null, guid varchar, constraint fk_tags_wid foreign key (wid)    references workspaces(id) on delete no action on update no action,constraint fk_tags_uid foreign key (uid)    references users(id) on delete no action on update no action);
+INSERT INTO "tags" VALUES(1,36253522,10471231,'billed',123456789,'f3a7d2e6-1c2b-4e0c-9b3f-3a1f1b6a7c10');
+CREATE TABLE tasks(local_id integer primary key, id integer not null, uid integer not null, name varchar not null, wid integer not null, pid integer, constraint fk_tasks_wid foreign key (wid)    references workpaces(id) on delete no action on update no action, constraint fk_tasks_pid foreign key (pid)    references projects(id) on delete no action on update no action, constraint fk_tasks_uid foreign key (uid)    references users(id) on delete no action on update no action );
+CREATE TABLE time_entries(local_id integer primary key, id integer, uid integer not null, description varchar, wid integer not null, guid varchar, pid integer, tid integer, billable integer not null default 0,duronly integer not null default 0, ui_modified_at integer, start integer not null, stop integer, duration integer not null,tags text,created_with varchar,deleted_at integer,updated_at integer, project_guid VARCHAR,constraint fk_time_entries_wid foreign key (wid)    references workspaces(id) on delete no action on update no action, constraint fk_time_entries_pid foreign key (pid)    references projects(id) on delete no action on update no action, constraint fk_time_entries_tid foreign key (tid)    references tasks(id) on delete no action on update no action, constraint fk_time_entries_uid foreign key (uid)    references users(id) on delete no action on update no action);
+INSERT INTO "time_entries" VALUES(1,89818605,10471231,'Changes to the old database',123456789,'07fba193-91c4-0ec8-2894-820df0548a8f',2598305,NULL,1,0,NULL,1417440000,1417443600,3600,'billed','TogglDesktop/7.0.0',NULL,1417443600,NULL);
+INSERT INTO "time_entries" VALUES(2,NULL,10471231,'Not yet pushed',123456789,'b6b7ad0f-4f2a-7e1c-9d2e-5e3a0d1f9c42',NULL,NULL,0,0,NULL,1417447200,1417449000,1800,NULL,'TogglDesktop/7.0.0',NULL,NULL,NULL);
+CREATE TABLE timeline_events(id INTEGER PRIMARY KEY, user_id INTEGER NOT NULL, title VARCHAR, filename VARCHAR, start_time INTEGER NOT NULL, end_time INTEGER, idle INTEGER NOT NULL);
+INSERT INTO "timeline_events" VALUES(1,10471231,'old_database.sql - Editor','editor',1417440000,1417440060,0);
+CREATE TABLE timeline_installation(id INTEGER PRIMARY KEY, desktop_id VARCHAR NOT NULL);
+INSERT INTO "timeline_installation" VALUES(1,'9e1f3c2b-6a4d-4f7e-8b0c-1d2e3f4a5b6c');
+CREATE TABLE users(local_id integer primary key, id integer not null, api_token varchar not null, default_wid integer, since integer, fullname varchar, email varchar not null, record_timeline integer not null default 0, store_start_and_stop_time INT NOT NULL DEFAULT 0, timeofday_format varchar NOT NULL DEFAULT 'HH:mm', duration_format varchar not null default 'classic', offline_data varchar);
+INSERT INTO "users" VALUES(1,10471231,'fa3ba4e5e5b2a3e4e9e3f4c1b6d4a2e8',123456789,1417000000,'John Doe','johndoe@example.com',1,0,'HH:mm','classic',NULL);
+CREATE TABLE workspaces(local_id integer primary key,id integer not null, uid integer not null, name varchar not null, premium int default 0, only_admins_may_create_projects integer not null default 0, constraint fk_workspaces_uid foreign key (uid)    references users(id)      on delete no action on update no action);
+INSERT INTO "workspaces" VALUES(1,123456789,10471231,'John''s workspace',1,0);
+CREATE UNIQUE INDEX id_kopsik_migrations_name ON kopsik_migrations (name);
+CREATE UNIQUE INDEX id_users_id ON users (id);
+CREATE UNIQUE INDEX id_users_api_token ON users (api_token);
+CREATE UNIQUE INDEX id_workspaces_id ON workspaces (uid, id);
+CREATE UNIQUE INDEX id_clients_id ON clients (uid, id);
+CREATE UNIQUE INDEX id_clients_guid ON clients (uid, guid);
+CREATE UNIQUE INDEX id_tags_id ON tags (uid, id);
+CREATE UNIQUE INDEX id_time_entries_id ON time_entries (uid, id);
+CREATE UNIQUE INDEX id_time_entries_guid ON time_entries (uid, guid);
+CREATE UNIQUE INDEX id_sessions_active ON sessions (active);
+CREATE UNIQUE INDEX id_analytics_settings_client_id ON analytics_settings(analytics_client_id);
+CREATE UNIQUE INDEX id_timeline_installation_desktop_id ON timeline_installation(desktop_id);
+COMMIT;